@@ -10,6 +10,11 @@ set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -fPIC")
 
 if(${CMAKE_C_COMPILER_ID} STREQUAL "Intel")
   set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -xHost")
+elseif(DEFINED PORTABLE)
+  # Generic x86-64 code. MTTKRP still picks AVX2/AVX-512 kernels at runtime.
+  message("Building portable binary (no -march=native)")
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -mtune=generic")
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -ftree-vectorize")
 else()
   set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -march=native")
   set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -ftree-vectorize")
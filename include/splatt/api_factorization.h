@@ -45,6 +45,140 @@ int splatt_cpd_als(
     splatt_kruskal * factored);
 
 
+/**
+* @brief Compute a constrained or regularized CPD with AO-ADMM. Each factor
+*        update runs a few ADMM iterations which reuse one Cholesky
+*        factorization of the Gram matrix, and apply the proximal operator of
+*        that mode's constraint to the factor rows in parallel.
+*
+* @param tensors An array of splatt_csf created by SPLATT.
+* @param nfactors The rank of the decomposition to perform.
+* @param constraints The constraint of each mode (length tensors->nmodes).
+*                    NULL is equivalent to splatt_cpd_als().
+* @param options Options array for SPLATT.
+* @param[out] factored The factored tensor in Kruskal format. Modes with
+*             SPLATT_CON_L1, SPLATT_CON_SIMPLEX, or SPLATT_CON_ROWSPARSE are
+*             not normalized into lambda.
+*
+* @return SPLATT error code (splatt_error_t). SPLATT_SUCCESS on success.
+*/
+int splatt_cpd_constrained(
+    splatt_csf const * const tensors,
+    splatt_idx_t const nfactors,
+    splatt_cpd_constraint const * const constraints,
+    double const * const options,
+    splatt_kruskal * factored);
+
+
+/**
+* @brief Compute the CPD with randomized (sketched) alternating least squares.
+*        Each factor update samples rows of the Khatri-Rao product, fetches
+*        the matching tensor fibers, and solves the sampled least squares
+*        problem. The exact fit is computed every few iterations.
+*
+* @param tensors An array of splatt_csf created by SPLATT. Only tensors[0]
+*                is used.
+* @param nfactors The rank of the decomposition to perform.
+* @param options Options array for SPLATT. SPLATT_OPTION_SKETCH is the number
+*                of rows sampled per update (0 chooses one based on the rank)
+*                and SPLATT_OPTION_SAMPLING is a splatt_sample_type.
+* @param[out] factored The factored tensor in Kruskal format.
+*
+* @return SPLATT error code (splatt_error_t). SPLATT_SUCCESS on success.
+*/
+int splatt_cpd_sketched(
+    splatt_csf const * const tensors,
+    splatt_idx_t const nfactors,
+    double const * const options,
+    splatt_kruskal * factored);
+
+
+/**
+* @brief Compute a non-negative CPD of count data by maximizing the Poisson
+*        likelihood with CP-APR (alternating Poisson regression with
+*        multiplicative updates).
+*
+* @param tensors An array of splatt_csf created by SPLATT. Values must be
+*                non-negative.
+* @param nfactors The rank of the decomposition to perform.
+* @param options Options array for SPLATT. SPLATT_OPTION_TOLERANCE bounds the
+*                KKT violation of each factor.
+* @param[out] factored The factored tensor in Kruskal format. The columns of
+*                      each factor sum to one, lambda holds the expected
+*                      count of each component, and fit is the final
+*                      log-likelihood.
+*
+* @return SPLATT error code (splatt_error_t). SPLATT_SUCCESS on success, or
+*         SPLATT_ERROR_BADINPUT if the tensor has a negative value.
+*/
+int splatt_cpd_apr(
+    splatt_csf const * const tensors,
+    splatt_idx_t const nfactors,
+    double const * const options,
+    splatt_kruskal * factored);
+
+
+/**
+* @brief Compute the Tucker decomposition using higher-order orthogonal
+*        iteration (HOOI). Each iteration computes a TTMc for every mode and
+*        takes the leading left singular vectors of the result.
+*
+* @param tensors An array of splatt_csf created by SPLATT.
+* @param ranks The rank of each mode. ranks[m] may not exceed the tensor's
+*              dimension in mode m or the product of the other ranks.
+* @param options Options array for SPLATT.
+* @param[out] factored The factored tensor in Tucker format.
+*
+* @return SPLATT error code (splatt_error_t). SPLATT_SUCCESS on success.
+*/
+int splatt_tucker_hooi(
+    splatt_csf const * const tensors,
+    splatt_idx_t const * const ranks,
+    double const * const options,
+    splatt_tucker * factored);
+
+
+/**
+* @brief Complete a partially observed tensor with a rank-'nfactors' CPD model.
+*        Unlike splatt_cpd_als(), the loss is only taken over the stored
+*        nonzeros. The factors with the lowest RMSE on 'validate' are
+*        returned, and the search stops early once it stops improving.
+*
+* @param train An array of splatt_csf holding the observed entries.
+*              SPLATT_TC_ALS and SPLATT_TC_CCD require an untiled CSF rooted
+*              at every mode (SPLATT_CSF_ALLMODE, SPLATT_NOTILE).
+* @param validate Held-out entries for early stopping (only validate[0] is
+*                 used). May be NULL to use the training RMSE instead.
+* @param nfactors The rank of the model.
+* @param which The algorithm to use.
+* @param options Options array for SPLATT. SPLATT_OPTION_REGULARIZE weights
+*                the squared Frobenius norms of the factors, and
+*                SPLATT_OPTION_LEARNRATE is the initial SGD step size.
+* @param[out] factored The model in Kruskal format, with unit lambda. Unlike
+*                      the CPD routines, 'fit' is not in [0,1]: it holds the
+*                      best RMSE on 'validate' (or 'train'), so lower is
+*                      better.
+*
+* @return SPLATT error code (splatt_error_t). SPLATT_SUCCESS on success.
+*/
+int splatt_tc(
+    splatt_csf const * const train,
+    splatt_csf const * const validate,
+    splatt_idx_t const nfactors,
+    splatt_tc_type const which,
+    double const * const options,
+    splatt_kruskal * factored);
+
+
+/**
+* @brief Free a splatt_tucker allocated by splatt_tucker_hooi().
+*
+* @param factored The factored tensor to free.
+*/
+void splatt_free_tucker(
+    splatt_tucker * factored);
+
+
 /** @} */
 
 
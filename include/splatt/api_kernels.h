@@ -15,6 +15,22 @@
 
 
 
+/**
+* @brief How the output of MTTKRP is handled for a mode.
+*/
+typedef enum
+{
+  /** @brief Threads share the output and synchronize their updates. */
+  SPLATT_PRIV_NONE,
+  /** @brief Each thread has a full private output which is cleared and
+   *         reduced in its entirety. */
+  SPLATT_PRIV_DENSE,
+  /** @brief Each thread has a full private output, but only the rows that the
+   *         thread touches are reduced and cleared. */
+  SPLATT_PRIV_SPARSE
+} splatt_priv_type;
+
+
 /**
 * @brief Workspace used during MTTKRP. This is allocated outside of MTTKRP
 *        kernels in order to avoid repeated overheads.
@@ -35,7 +51,8 @@ typedef struct
 
   /*
    * Partitioning information. If the CSF is tiled, we distribute tiles to
-   * threads. If the CSF is untiled, we distribute slices to threads.
+   * threads. If the CSF is untiled, we distribute slices to threads, and
+   * heavy slices may be split across threads at fiber boundaries.
    * Partitioning is performed on a per-CSF basis, so we have one for each
    * mode (the maximum number of CSF).
    *
@@ -45,8 +62,12 @@ typedef struct
 
   /** @brief A thread partitioning of the tiles in each CSF. NULL if untiled.*/
   splatt_idx_t * tile_partition[SPLATT_MAX_NMODES];
-  /** @brief A thread partitioning of the slices in each CSF. NULL if tiled. */
+  /** @brief A thread partitioning of the fibers (the nodes one level below
+   *         the root) in each CSF. NULL if tiled. */
   splatt_idx_t * tree_partition[SPLATT_MAX_NMODES];
+  /** @brief The load imbalance of tree_partition: the nonzeros in the
+   *         heaviest partition divided by nnz/num_threads. */
+  double tree_imbalance[SPLATT_MAX_NMODES];
 
   /*
    * Privatization information. Privatizing a mode replicates the output matrix
@@ -56,17 +77,87 @@ typedef struct
 
   /** @brief Marks if a tensor mode is privatized. */
   bool is_privatized[SPLATT_MAX_NMODES];
+  /** @brief Which type of privatization each mode uses. */
+  splatt_priv_type priv_type[SPLATT_MAX_NMODES];
   /** @brief The buffer used by each thread for privatization.
    *         privatize_buffer[thread_id] is large enough to process the largest
-   *         privatized mode.
+   *         privatized mode. Buffers are all zero between MTTKRP calls.
    */
   splatt_val_t * * privatize_buffer;
+  /** @brief For SPLATT_PRIV_SPARSE modes, priv_rows[mode][thread_id] is the
+   *         sorted list of output rows touched by that thread. NULL otherwise.
+   */
+  splatt_idx_t * * priv_rows[SPLATT_MAX_NMODES];
+  /** @brief The length of each list in priv_rows[mode]. */
+  splatt_idx_t * priv_nrows[SPLATT_MAX_NMODES];
 
   /** @brief The time spent on the latest privatized reduction.*/
   double reduction_time;
+
+  /** @brief How shared output rows are updated (SPLATT_OPTION_SYNC). */
+  splatt_sync_type sync;
+  /** @brief The locks used when sync is SPLATT_SYNC_LOCK or SPIN. Each
+   *         workspace owns its pool, so concurrent MTTKRPs do not share
+   *         locks. */
+  struct mutex_pool * pool;
+
+  /** @brief The instruction set used by the CSF kernels. Resolved from CPUID
+   *         (or SPLATT_OPTION_SIMD) when the workspace is allocated. */
+  splatt_simd_type simd;
+
+  /*
+   * Memoization information. With a single untiled CSF, the partial results
+   * computed during a root-mode MTTKRP are reused by the deeper modes of an
+   * ALS sweep, as long as those modes are processed in CSF order.
+   */
+
+  /** @brief How many internal CSF levels have memoized results. 0 if off. */
+  splatt_idx_t memo_levels;
+  /** @brief memo[d] holds, for each node at depth d (1 <= d <= memo_levels),
+   *         the sum over its subtree of the Hadamard products of all deeper
+   *         factor rows. NULL at other depths. */
+  splatt_val_t * memo[SPLATT_MAX_NMODES];
+  /** @brief The CSF depth of the latest MTTKRP which used memo[]. */
+  splatt_idx_t memo_depth;
+
+  /*
+   * Mixed precision. The input factors are converted to a narrower copy
+   * before each MTTKRP, and the kernels accumulate in double precision.
+   */
+
+  /** @brief The storage precision of factors (SPLATT_OPTION_PRECISION). */
+  splatt_precision_type precision;
+  /** @brief lowp_factors[m] holds mode m's factor at 'precision'. NULL if
+   *         precision is SPLATT_PREC_FULL. */
+  void * lowp_factors[SPLATT_MAX_NMODES];
+
+  /*
+   * Column blocking. At large ranks the rows touched by a fiber no longer fit
+   * in L1, so MTTKRP traverses the tree once per block of columns.
+   */
+
+  /** @brief Columns per traversal. No blocking if >= the number of columns. */
+  splatt_idx_t col_block;
+  /** @brief block_vals[m] holds one column block of mode m's factor. */
+  splatt_val_t * block_vals[SPLATT_MAX_NMODES];
+
+  /** @brief Per-thread accumulators for the reduced-precision kernels. Each
+   *         thread uses lowp_scratch_stride doubles. NULL if precision is
+   *         SPLATT_PREC_FULL. */
+  double * lowp_scratch;
+  /** @brief The number of doubles in each thread's part of lowp_scratch. */
+  splatt_idx_t lowp_scratch_stride;
 } splatt_mttkrp_ws;
 
 
+/**
+* @brief A persistent MTTKRP context. It holds the thread structures,
+*        workspace, and matrix wrappers that splatt_mttkrp() would otherwise
+*        set up on every call. Allocate with splatt_mttkrp_ctx_alloc().
+*/
+typedef struct splatt_mttkrp_ctx splatt_mttkrp_ctx;
+
+
 /*
  * KERNEL API
  */
@@ -103,6 +194,63 @@ int splatt_mttkrp(
     splatt_val_t * const matout,
     double const * const options);
 
+/**
+* @brief Compute only some rows of a MTTKRP, e.g., those of the users whose
+*        data changed. The work scales with the nonzeros of the selected rows
+*        when a CSF is rooted at 'mode' (e.g., with SPLATT_CSF_ALLMODE);
+*        otherwise the tree is traversed but only the selected rows'
+*        subtrees are multiplied.
+*
+* @param mode Which mode we are operating on.
+* @param ncolumns How many columns each matrix has ('nfactors').
+* @param tensors The CSF tensor to multipy with.
+* @param matrices The row-major dense matrices to multiply with.
+* @param nrows The number of rows to compute.
+* @param rows The rows to compute, in any order. Duplicates are allowed.
+* @param[out] matout The output matrix, 'nrows' x 'ncolumns'. Row i holds
+*                    output row rows[i].
+* @param options SPLATT options array.
+*
+* @return SPLATT error code. SPLATT_SUCCESS on success.
+*/
+int splatt_mttkrp_rows(
+    splatt_idx_t const mode,
+    splatt_idx_t const ncolumns,
+    splatt_csf const * const tensors,
+    splatt_val_t ** matrices,
+    splatt_idx_t const nrows,
+    splatt_idx_t const * const rows,
+    splatt_val_t * const matout,
+    double const * const options);
+
+
+/**
+* @brief Compute several independent MTTKRPs with the same tensor and mode in
+*        a single traversal of the tensor. The factor sets are concatenated
+*        column-wise internally, so each nonzero is loaded once for all sets.
+*        Sets may have different numbers of columns (e.g., CPDs of several
+*        ranks).
+*
+* @param mode Which mode we are operating on.
+* @param nsets How many sets of factors to multiply with.
+* @param ncolumns The number of columns in each set, length 'nsets'.
+* @param tensors The CSF tensor to multipy with.
+* @param matrices matrices[s][m] is the row-major factor of mode 'm' in set
+*                 's'. matrices[s][mode] is not accessed.
+* @param[out] matouts matouts[s] is the output matrix of set 's'.
+* @param options SPLATT options array.
+*
+* @return SPLATT error code. SPLATT_SUCCESS on success.
+*/
+int splatt_mttkrp_batch(
+    splatt_idx_t const mode,
+    splatt_idx_t const nsets,
+    splatt_idx_t const * const ncolumns,
+    splatt_csf const * const tensors,
+    splatt_val_t *** matrices,
+    splatt_val_t ** matouts,
+    double const * const options);
+
 
 splatt_mttkrp_ws * splatt_mttkrp_alloc_ws(
     splatt_csf const * const tensors,
@@ -119,6 +267,52 @@ void splatt_mttkrp_free_ws(
     splatt_mttkrp_ws * const ws);
 
 
+/**
+* @brief Prepare to run MTTKRP many times with the same tensor and number of
+*        columns. Partitioning, thread scratch, and privatization buffers are
+*        set up once, so splatt_mttkrp_ctx_exec() allocates no memory.
+*
+* @param tensors The CSF tensor(s). They must outlive the context.
+* @param ncolumns How many columns each matrix has ('nfactors').
+* @param options SPLATT options array. A copy is kept.
+*
+* @return The context. Free with splatt_mttkrp_ctx_free().
+*/
+splatt_mttkrp_ctx * splatt_mttkrp_ctx_alloc(
+    splatt_csf const * const tensors,
+    splatt_idx_t const ncolumns,
+    double const * const options);
+
+
+/**
+* @brief Run MTTKRP with a context from splatt_mttkrp_ctx_alloc(). This is
+*        equivalent to splatt_mttkrp() with the context's tensor, number of
+*        columns, and options. Memoized partial results are never reused
+*        across calls, so 'matrices' may change freely between them.
+*
+* @param ctx The MTTKRP context.
+* @param mode Which mode we are operating on.
+* @param matrices The row-major dense matrices to multiply with.
+* @param[out] matout The output matrix.
+*
+* @return SPLATT error code. SPLATT_SUCCESS on success.
+*/
+int splatt_mttkrp_ctx_exec(
+    splatt_mttkrp_ctx * const ctx,
+    splatt_idx_t const mode,
+    splatt_val_t ** matrices,
+    splatt_val_t * const matout);
+
+
+/**
+* @brief Free an MTTKRP context. The tensors it was made with are not freed.
+*
+* @param ctx The context to free.
+*/
+void splatt_mttkrp_ctx_free(
+    splatt_mttkrp_ctx * ctx);
+
+
 /** @} */
 
 
@@ -34,6 +34,27 @@ extern "C" {
 void splatt_free_kruskal(
     splatt_kruskal * factored);
 
+
+/**
+* @brief Evaluate a Kruskal tensor at every nonzero of a CSF tensor. This is
+*        the building block for residuals, losses, and predictions.
+*
+* @param tensor The CSF tensor whose sparsity pattern is evaluated. Only
+*               tensor[0] is used.
+* @param factored The Kruskal tensor. lambda may be NULL.
+* @param options SPLATT options array. SPLATT_OPTION_NTHREADS is used.
+* @param[out] values The model values, aligned with the leaves of the CSF:
+*             tile after tile, in the same order as the tensor->pt[t].vals
+*             arrays. Must hold tensor->nnz values.
+*
+* @return SPLATT_SUCCESS, or SPLATT_ERROR_BADINPUT if the shapes differ.
+*/
+int splatt_kruskal_values(
+    splatt_csf const * const tensor,
+    splatt_kruskal const * const factored,
+    double const * const options,
+    splatt_val_t * const values);
+
 /** @} */
 
 
@@ -39,11 +39,54 @@ typedef struct splatt_kruskal
   /** @brief The number of rows in each factor. */
   splatt_idx_t dims[SPLATT_MAX_NMODES];
 
-  /** @brief The quality [0,1] of the CPD */
+  /** @brief The quality [0,1] of the CPD. splatt_tc() stores its best RMSE
+   *         here instead. */
   double fit;
 } splatt_kruskal;
 
 
+/**
+* @brief The constraint or regularization on one factor of a constrained CPD.
+*/
+typedef struct splatt_cpd_constraint
+{
+  /** @brief Which constraint to enforce. */
+  splatt_con_type type;
+
+  /** @brief The penalty weight of SPLATT_CON_L1 and SPLATT_CON_ROWSPARSE.
+   *         Ignored by the others. */
+  double param;
+} splatt_cpd_constraint;
+
+
+/**
+* @brief Tucker tensors are the output of HOOI. Each mode has a factor with
+*        orthonormal columns, and a small dense core tensor holds the
+*        interactions between the columns of each mode.
+*/
+typedef struct splatt_tucker
+{
+  /** @brief The number of modes in the tensor. */
+  splatt_idx_t nmodes;
+
+  /** @brief The number of rows in each factor. */
+  splatt_idx_t dims[SPLATT_MAX_NMODES];
+
+  /** @brief The rank (number of columns) of each factor. */
+  splatt_idx_t ranks[SPLATT_MAX_NMODES];
+
+  /** @brief The row-major matrix factors for each mode. */
+  splatt_val_t * factors[SPLATT_MAX_NMODES];
+
+  /** @brief The dense core, ranks[0] x ranks[1] x ... in row-major order (the
+   *         last mode varies fastest). */
+  splatt_val_t * core;
+
+  /** @brief The quality [0,1] of the decomposition. */
+  double fit;
+} splatt_tucker;
+
+
 
 /**
 * @brief The sparsity pattern of a CSF (sub-)tensor.
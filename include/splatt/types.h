@@ -0,0 +1,303 @@
+/**
+* @file types_config.h
+* @brief Primitive data types used by SPLATT. This will be copied to types.h
+*        by CMake.
+* @author Shaden Smith <shaden@cs.umn.edu>
+* @version 2.0.0
+* @date 2017-01-08
+*/
+
+
+
+#ifndef SPLATT_SPLATT_TYPES_H
+#define SPLATT_SPLATT_TYPES_H
+
+
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+
+#include <inttypes.h>
+#include <float.h>
+
+
+
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/* These values are configured by CMake and can be altered by supplying flags
+ * to 'configure'. Default index and value widths are 64 bits. Changing these
+ * values to 32 will decrease memory consumption at the cost of precision and
+ * maximum supported tensor size. */
+
+#define SPLATT_IDX_TYPEWIDTH 64
+#define SPLATT_VAL_TYPEWIDTH 64
+
+/* Type for BLAS/LAPACK integers. This is usually int32_t, but needs to be
+ * int64_t when linking against 64b BLAS (e.g., Matlab's MKL). */
+#define SPLATT_BLAS_INTWIDTH 32
+
+
+
+/* Set type constants based on width. */
+#if   SPLATT_IDX_TYPEWIDTH == 32
+  typedef uint32_t splatt_idx_t;
+  #define SPLATT_IDX_MAX UINT32_MAX
+  #define SPLATT_PF_IDX PRIu32
+  #define SPLATT_MPI_IDX MPI_UINT32_T
+
+#elif SPLATT_IDX_TYPEWIDTH == 64
+  typedef uint64_t splatt_idx_t;
+  #define SPLATT_IDX_MAX UINT64_MAX
+  #define SPLATT_PF_IDX PRIu64
+  #define SPLATT_MPI_IDX MPI_UINT64_T
+#else
+  #error "*** Incorrect user-supplied value of SPLATT_IDX_TYPEWIDTH ***"
+#endif
+
+
+#if   SPLATT_VAL_TYPEWIDTH == 32
+  typedef float splatt_val_t;
+  #define SPLATT_VAL_MIN FLT_MIN
+  #define SPLATT_VAL_MAX FLT_MAX
+  #define SPLATT_PF_VAL "f"
+  #define SPLATT_MPI_VAL MPI_FLOAT
+
+#elif SPLATT_VAL_TYPEWIDTH == 64
+  typedef double splatt_val_t;
+  #define SPLATT_VAL_MIN DBL_MIN
+  #define SPLATT_VAL_MAX DBL_MAX
+  #define SPLATT_PF_VAL "f"
+  #define SPLATT_MPI_VAL MPI_DOUBLE
+
+#else
+  #error "*** Incorrect user-supplied value of SPLATT_VAL_TYPEWIDTH ***"
+#endif
+
+
+#if   SPLATT_BLAS_INTWIDTH == 32
+  typedef int32_t splatt_blas_int;
+#elif SPLATT_BLAS_INTWIDTH == 64
+  typedef int64_t splatt_blas_int;
+#else
+  #error "*** Incorrect user-supplied value of SPLATT_BLAS_INTWIDTH ***"
+#endif
+
+
+
+
+/******************************************************************************
+ * ENUMS
+ *****************************************************************************/
+
+
+/**
+* @brief Enum for defining SPLATT options. Use the splatt_default_opts() and
+*        splatt_free_opts() functions to initialize and free an options array.
+*/
+typedef enum
+{
+  /* high level options */
+  SPLATT_OPTION_NTHREADS,   /* Number of OpenMP threads to use. */
+  SPLATT_OPTION_TOLERANCE,  /* Threshold for convergence. */
+  SPLATT_OPTION_REGULARIZE, /* Regularization parameter. */
+  SPLATT_OPTION_NITER,      /* Maximum number of iterations to perform. */
+  SPLATT_OPTION_VERBOSITY,  /* Verbosity level */
+
+  /* low level options */
+  SPLATT_OPTION_RANDSEED,   /* Random number seed */
+  SPLATT_OPTION_CSF_ALLOC,  /* How many (and which) tensors to allocate. */
+  SPLATT_OPTION_TILE,       /* Use cache tiling during MTTKRP. */
+  SPLATT_OPTION_TILELEVEL,  /* How many levels of the CSF are tiled? */
+  SPLATT_OPTION_PRIVTHRESH, /* Threshold for privatizing a mode. */
+  SPLATT_OPTION_SPARSE_PRIVTHRESH, /* Threshold for touched-rows privatization. */
+  SPLATT_OPTION_SIMD,       /* Instruction set used by MTTKRP kernels. */
+  SPLATT_OPTION_SYNC,       /* How MTTKRP protects shared output rows. */
+  SPLATT_OPTION_MEMOIZE,    /* CSF levels of partial MTTKRP results to reuse. */
+  SPLATT_OPTION_PRECISION,  /* Storage precision of factors read by MTTKRP. */
+  SPLATT_OPTION_COLBLOCK,   /* MTTKRP columns per pass (0: auto, <0: off). */
+  SPLATT_OPTION_NUMA,       /* NUMA first-touch placement and thread pinning. */
+  SPLATT_OPTION_LEARNRATE,  /* Initial step size of SGD tensor completion. */
+  SPLATT_OPTION_LINESEARCH, /* Extrapolate CPD-ALS every k iterations (0: off). */
+  SPLATT_OPTION_SKETCH,     /* Khatri-Rao rows sampled by sketched CPD-ALS. */
+  SPLATT_OPTION_SAMPLING,   /* How sketched CPD-ALS samples Khatri-Rao rows. */
+  SPLATT_OPTION_LOSS,       /* The loss function minimized by CPD. */
+
+  SPLATT_OPTION_DECOMP,     /* Decomposition to use on distributed systems */
+  SPLATT_OPTION_COMM,       /* Communication pattern to use */
+
+  SPLATT_OPTION_NOPTIONS    /* Gives the size of the options array. */
+} splatt_option_type;
+
+
+/**
+* @brief Return codes used by SPLATT.
+*/
+typedef enum
+{
+  SPLATT_SUCCESS = 1,     /* Successful SPLATT API call. */
+  SPLATT_ERROR_BADINPUT,  /* SPLATT found an issue with the input.
+                             Try splatt-check to debug. */
+  SPLATT_ERROR_NOMEMORY   /* SPLATT did not have enough memory to complete.
+                             Try using fewer factors, a smaller tensor, or
+                             recompile with less precision. */
+} splatt_error_type;
+
+
+/**
+* @brief Verbosity levels used by SPLATT.
+*/
+typedef enum
+{
+  SPLATT_VERBOSITY_NONE, /* Nothing written to STDOUT. */
+  SPLATT_VERBOSITY_LOW,  /* Only headers/footers and high-level timing. */
+  SPLATT_VERBOSITY_HIGH, /* Timers for all modes. */
+  SPLATT_VERBOSITY_MAX   /* All output, including detailed timers. */
+} splatt_verbosity_type;
+
+
+/**
+* @brief Types of tiling used by SPLATT.
+*/
+typedef enum
+{
+  SPLATT_NOTILE,
+  SPLATT_DENSETILE,
+  /* DEPRECATED - pending CSF implementations */
+  SPLATT_SYNCTILE,
+  SPLATT_COOPTILE,
+} splatt_tile_type;
+
+
+/**
+* @brief Instruction sets for the CSF MTTKRP kernels. SPLATT_SIMD_AUTO picks
+*        the widest one supported by the CPU at runtime.
+*/
+typedef enum
+{
+  SPLATT_SIMD_AUTO,   /** Detect with CPUID when the MTTKRP workspace is made. */
+  SPLATT_SIMD_SCALAR, /** Plain C kernels (rank-specialized where possible). */
+  SPLATT_SIMD_AVX2,   /** Hand-vectorized AVX2 + FMA kernels. */
+  SPLATT_SIMD_AVX512  /** Hand-vectorized AVX-512F kernels. */
+} splatt_simd_type;
+
+
+/**
+* @brief How MTTKRP synchronizes updates to output rows that may be shared
+*        between threads (i.e., modes which are not tiled or privatized).
+*/
+typedef enum
+{
+  SPLATT_SYNC_LOCK,   /** Guard each row with a lock from a mutex pool. */
+  SPLATT_SYNC_ATOMIC, /** Lock-free atomic adds on each element. */
+  SPLATT_SYNC_SPIN    /** Like SPLATT_SYNC_LOCK, but with cache-line-padded
+                          spinlocks sized from the threads and output rows. */
+} splatt_sync_type;
+
+
+/**
+* @brief Storage precision of the factor matrices read by the CSF MTTKRP
+*        kernels. Anything but SPLATT_PREC_FULL converts the factors to a
+*        narrower copy before each MTTKRP and accumulates in double precision.
+*/
+typedef enum
+{
+  SPLATT_PREC_FULL, /** Read factors directly as splatt_val_t. */
+  SPLATT_PREC_FP32, /** IEEE single precision. */
+  SPLATT_PREC_BF16, /** bfloat16: 8 exponent bits, 7 mantissa bits. */
+  SPLATT_PREC_FP16  /** IEEE half precision: 5 exponent bits, 10 mantissa. */
+} splatt_precision_type;
+
+
+/**
+* @brief Types of CSF allocation available.
+*/
+typedef enum
+{
+  SPLATT_CSF_ONEMODE, /** Only allocate one CSF for factorization. */
+  SPLATT_CSF_TWOMODE, /** Allocate one for the smallest and largest modes. */
+  SPLATT_CSF_ALLMODE, /** Allocate one CSF for every mode. */
+} splatt_csf_type;
+
+
+/**
+* @brief Constraints and regularizations on the factors of a CPD, enforced by
+*        AO-ADMM. Each mode may use a different one.
+*/
+typedef enum
+{
+  SPLATT_CON_NONE,     /** Unconstrained least squares. */
+  SPLATT_CON_NONNEG,   /** Non-negative entries. */
+  SPLATT_CON_L1,       /** Penalize param * ||A||_1 for sparse factors. */
+  SPLATT_CON_SIMPLEX,  /** Non-negative rows which sum to one. */
+  SPLATT_CON_ROWSPARSE /** Penalize param * sum_i ||A(i,:)||_2 to zero whole
+                           rows (group lasso). */
+} splatt_con_type;
+
+
+/**
+* @brief Distributions for sampling Khatri-Rao rows in sketched CPD-ALS.
+*/
+typedef enum
+{
+  SPLATT_SAMPLE_UNIFORM,  /** Every row is equally likely. */
+  SPLATT_SAMPLE_LEVERAGE  /** Proportional to the product of the factors'
+                              leverage scores. */
+} splatt_sample_type;
+
+
+/**
+* @brief Loss functions for CPD.
+*/
+typedef enum
+{
+  SPLATT_LOSS_LS,      /** Least squares (CPD-ALS). */
+  SPLATT_LOSS_POISSON  /** Poisson log-likelihood for count data (CP-APR). */
+} splatt_loss_type;
+
+
+/**
+* @brief Algorithms for tensor completion.
+*/
+typedef enum
+{
+  SPLATT_TC_ALS, /** Alternating least squares with per-row normal equations. */
+  SPLATT_TC_CCD, /** Rank-one coordinate descent (CCD++). */
+  SPLATT_TC_SGD  /** Parallel stochastic gradient descent. */
+} splatt_tc_type;
+
+
+/**
+* @brief Tensor decomposition schemes.
+*/
+typedef enum
+{
+  /** @brief Coarse-grained decomposition is using a separate 1D decomposition
+   *         for each mode. */
+  SPLATT_DECOMP_COARSE,
+  /** @brief Medium-grained decomposition is an 'nmodes'-dimensional
+   *         decomposition. */
+  SPLATT_DECOMP_MEDIUM,
+  /** @brief Fine-grained decomposition distributes work at the nonzero level.
+   *         NOTE: requires a partitioning on the nonzeros. */
+  SPLATT_DECOMP_FINE
+} splatt_decomp_type;
+
+
+/**
+* @brief Communication pattern type. We support point-to-point, and all-to-all
+*        (vectorized).
+*/
+typedef enum
+{
+  SPLATT_COMM_POINT2POINT,
+  SPLATT_COMM_ALL2ALL
+} splatt_comm_type;
+
+
+#endif
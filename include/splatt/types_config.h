@@ -115,6 +115,18 @@ typedef enum
   SPLATT_OPTION_TILE,       /* Use cache tiling during MTTKRP. */
   SPLATT_OPTION_TILELEVEL,  /* How many levels of the CSF are tiled? */
   SPLATT_OPTION_PRIVTHRESH, /* Threshold for privatizing a mode. */
+  SPLATT_OPTION_SPARSE_PRIVTHRESH, /* Threshold for touched-rows privatization. */
+  SPLATT_OPTION_SIMD,       /* Instruction set used by MTTKRP kernels. */
+  SPLATT_OPTION_SYNC,       /* How MTTKRP protects shared output rows. */
+  SPLATT_OPTION_MEMOIZE,    /* CSF levels of partial MTTKRP results to reuse. */
+  SPLATT_OPTION_PRECISION,  /* Storage precision of factors read by MTTKRP. */
+  SPLATT_OPTION_COLBLOCK,   /* MTTKRP columns per pass (0: auto, <0: off). */
+  SPLATT_OPTION_NUMA,       /* NUMA first-touch placement and thread pinning. */
+  SPLATT_OPTION_LEARNRATE,  /* Initial step size of SGD tensor completion. */
+  SPLATT_OPTION_LINESEARCH, /* Extrapolate CPD-ALS every k iterations (0: off). */
+  SPLATT_OPTION_SKETCH,     /* Khatri-Rao rows sampled by sketched CPD-ALS. */
+  SPLATT_OPTION_SAMPLING,   /* How sketched CPD-ALS samples Khatri-Rao rows. */
+  SPLATT_OPTION_LOSS,       /* The loss function minimized by CPD. */
 
   SPLATT_OPTION_DECOMP,     /* Decomposition to use on distributed systems */
   SPLATT_OPTION_COMM,       /* Communication pattern to use */
@@ -162,6 +174,46 @@ typedef enum
 } splatt_tile_type;
 
 
+/**
+* @brief Instruction sets for the CSF MTTKRP kernels. SPLATT_SIMD_AUTO picks
+*        the widest one supported by the CPU at runtime.
+*/
+typedef enum
+{
+  SPLATT_SIMD_AUTO,   /** Detect with CPUID when the MTTKRP workspace is made. */
+  SPLATT_SIMD_SCALAR, /** Plain C kernels (rank-specialized where possible). */
+  SPLATT_SIMD_AVX2,   /** Hand-vectorized AVX2 + FMA kernels. */
+  SPLATT_SIMD_AVX512  /** Hand-vectorized AVX-512F kernels. */
+} splatt_simd_type;
+
+
+/**
+* @brief How MTTKRP synchronizes updates to output rows that may be shared
+*        between threads (i.e., modes which are not tiled or privatized).
+*/
+typedef enum
+{
+  SPLATT_SYNC_LOCK,   /** Guard each row with a lock from a mutex pool. */
+  SPLATT_SYNC_ATOMIC, /** Lock-free atomic adds on each element. */
+  SPLATT_SYNC_SPIN    /** Like SPLATT_SYNC_LOCK, but with cache-line-padded
+                          spinlocks sized from the threads and output rows. */
+} splatt_sync_type;
+
+
+/**
+* @brief Storage precision of the factor matrices read by the CSF MTTKRP
+*        kernels. Anything but SPLATT_PREC_FULL converts the factors to a
+*        narrower copy before each MTTKRP and accumulates in double precision.
+*/
+typedef enum
+{
+  SPLATT_PREC_FULL, /** Read factors directly as splatt_val_t. */
+  SPLATT_PREC_FP32, /** IEEE single precision. */
+  SPLATT_PREC_BF16, /** bfloat16: 8 exponent bits, 7 mantissa bits. */
+  SPLATT_PREC_FP16  /** IEEE half precision: 5 exponent bits, 10 mantissa. */
+} splatt_precision_type;
+
+
 /**
 * @brief Types of CSF allocation available.
 */
@@ -173,6 +225,53 @@ typedef enum
 } splatt_csf_type;
 
 
+/**
+* @brief Constraints and regularizations on the factors of a CPD, enforced by
+*        AO-ADMM. Each mode may use a different one.
+*/
+typedef enum
+{
+  SPLATT_CON_NONE,     /** Unconstrained least squares. */
+  SPLATT_CON_NONNEG,   /** Non-negative entries. */
+  SPLATT_CON_L1,       /** Penalize param * ||A||_1 for sparse factors. */
+  SPLATT_CON_SIMPLEX,  /** Non-negative rows which sum to one. */
+  SPLATT_CON_ROWSPARSE /** Penalize param * sum_i ||A(i,:)||_2 to zero whole
+                           rows (group lasso). */
+} splatt_con_type;
+
+
+/**
+* @brief Distributions for sampling Khatri-Rao rows in sketched CPD-ALS.
+*/
+typedef enum
+{
+  SPLATT_SAMPLE_UNIFORM,  /** Every row is equally likely. */
+  SPLATT_SAMPLE_LEVERAGE  /** Proportional to the product of the factors'
+                              leverage scores. */
+} splatt_sample_type;
+
+
+/**
+* @brief Loss functions for CPD.
+*/
+typedef enum
+{
+  SPLATT_LOSS_LS,      /** Least squares (CPD-ALS). */
+  SPLATT_LOSS_POISSON  /** Poisson log-likelihood for count data (CP-APR). */
+} splatt_loss_type;
+
+
+/**
+* @brief Algorithms for tensor completion.
+*/
+typedef enum
+{
+  SPLATT_TC_ALS, /** Alternating least squares with per-row normal equations. */
+  SPLATT_TC_CCD, /** Rank-one coordinate descent (CCD++). */
+  SPLATT_TC_SGD  /** Parallel stochastic gradient descent. */
+} splatt_tc_type;
+
+
 /**
 * @brief Tensor decomposition schemes.
 */
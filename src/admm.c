@@ -0,0 +1,289 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "admm.h"
+#include "splatt_lapack.h"
+#include "timer.h"
+
+#include <math.h>
+
+
+
+/******************************************************************************
+ * PROXIMAL OPERATORS
+ *****************************************************************************/
+
+static void p_prox_nonneg(
+    val_t * const restrict row,
+    idx_t const ncols,
+    val_t const rho,
+    val_t const param)
+{
+  for(idx_t f=0; f < ncols; ++f) {
+    row[f] = (row[f] > 0.) ? row[f] : 0.;
+  }
+}
+
+
+/**
+* @brief Soft thresholding: the prox of param * ||x||_1.
+*/
+static void p_prox_l1(
+    val_t * const restrict row,
+    idx_t const ncols,
+    val_t const rho,
+    val_t const param)
+{
+  val_t const thresh = param / rho;
+  for(idx_t f=0; f < ncols; ++f) {
+    val_t const v = row[f];
+    if(v > thresh) {
+      row[f] = v - thresh;
+    } else if(v < -thresh) {
+      row[f] = v + thresh;
+    } else {
+      row[f] = 0.;
+    }
+  }
+}
+
+
+/**
+* @brief Euclidean projection onto the probability simplex. The threshold is
+*        found with Michelot's algorithm, which needs no sorting or extra
+*        memory: it only grows while entries drop out of the support.
+*/
+static void p_prox_simplex(
+    val_t * const restrict row,
+    idx_t const ncols,
+    val_t const rho,
+    val_t const param)
+{
+  val_t sum = 0.;
+  for(idx_t f=0; f < ncols; ++f) {
+    sum += row[f];
+  }
+  val_t theta = (sum - 1.) / (val_t) ncols;
+
+  while(true) {
+    val_t supp_sum = 0.;
+    idx_t supp_size = 0;
+    for(idx_t f=0; f < ncols; ++f) {
+      if(row[f] > theta) {
+        supp_sum += row[f];
+        ++supp_size;
+      }
+    }
+    val_t const next = (supp_sum - 1.) / (val_t) supp_size;
+    if(next <= theta) {
+      break;
+    }
+    theta = next;
+  }
+
+  for(idx_t f=0; f < ncols; ++f) {
+    row[f] = (row[f] > theta) ? row[f] - theta : 0.;
+  }
+}
+
+
+/**
+* @brief Group soft thresholding: the prox of param * ||x||_2, which zeroes
+*        whole rows.
+*/
+static void p_prox_rowsparse(
+    val_t * const restrict row,
+    idx_t const ncols,
+    val_t const rho,
+    val_t const param)
+{
+  val_t norm = 0.;
+  for(idx_t f=0; f < ncols; ++f) {
+    norm += row[f] * row[f];
+  }
+  norm = sqrt(norm);
+
+  val_t const thresh = param / rho;
+  val_t const scale = (norm > thresh) ? 1. - (thresh / norm) : 0.;
+  for(idx_t f=0; f < ncols; ++f) {
+    row[f] *= scale;
+  }
+}
+
+
+/**
+* @brief The proximal operator of each splatt_con_type.
+*/
+static admm_prox_func const p_prox_table[] = {
+  [SPLATT_CON_NONE]      = NULL,
+  [SPLATT_CON_NONNEG]    = p_prox_nonneg,
+  [SPLATT_CON_L1]        = p_prox_l1,
+  [SPLATT_CON_SIMPLEX]   = p_prox_simplex,
+  [SPLATT_CON_ROWSPARSE] = p_prox_rowsparse,
+};
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+admm_prox_func admm_prox_lookup(
+    splatt_con_type const type)
+{
+  assert(type < sizeof(p_prox_table) / sizeof(p_prox_table[0]));
+  return p_prox_table[type];
+}
+
+
+bool admm_scale_invariant(
+    splatt_con_type const type)
+{
+  return type == SPLATT_CON_NONE || type == SPLATT_CON_NONNEG;
+}
+
+
+admm_ws * admm_ws_alloc(
+    matrix_t ** mats,
+    idx_t const nmodes,
+    splatt_cpd_constraint const * const cons)
+{
+  admm_ws * ws = splatt_malloc(sizeof(*ws));
+  ws->nmodes = nmodes;
+
+  idx_t const nfactors = mats[0]->J;
+  idx_t maxdim = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    ws->cons[m] = cons[m];
+    ws->duals[m] = NULL;
+    if(cons[m].type != SPLATT_CON_NONE) {
+      ws->duals[m] = mat_alloc(mats[m]->I, nfactors);
+      memset(ws->duals[m]->vals, 0, mats[m]->I * nfactors * sizeof(val_t));
+      maxdim = SS_MAX(maxdim, mats[m]->I);
+    }
+  }
+  ws->auxil = mat_alloc(maxdim, nfactors);
+  ws->chol = mat_alloc(nfactors, nfactors);
+  return ws;
+}
+
+
+void admm_ws_free(
+    admm_ws * ws)
+{
+  for(idx_t m=0; m < ws->nmodes; ++m) {
+    if(ws->duals[m] != NULL) {
+      mat_free(ws->duals[m]);
+    }
+  }
+  mat_free(ws->auxil);
+  mat_free(ws->chol);
+  splatt_free(ws);
+}
+
+
+idx_t admm_inner(
+    idx_t const mode,
+    matrix_t ** mats,
+    matrix_t ** aTa,
+    matrix_t const * const mttkrp,
+    admm_ws * const ws,
+    val_t const reg,
+    thd_info * const thds,
+    idx_t const nthreads)
+{
+  timer_start(&timers[TIMER_INV]);
+
+  idx_t const nrows = mats[mode]->I;
+  idx_t const nfactors = mats[mode]->J;
+  admm_prox_func const prox = admm_prox_lookup(ws->cons[mode].type);
+  val_t const param = (val_t) ws->cons[mode].param;
+
+  /* Gram + (reg + rho) I, with rho = trace(Gram) / rank */
+  matrix_t * const chol = ws->chol;
+  mat_form_gram(aTa, chol, mode, ws->nmodes);
+  val_t rho = 0.;
+  for(idx_t f=0; f < nfactors; ++f) {
+    rho += chol->vals[f + (f*nfactors)];
+  }
+  rho /= (val_t) nfactors;
+  if(rho <= 0.) {
+    /* a factor of all zeros makes the Gram matrix vanish */
+    rho = 1.;
+  }
+  for(idx_t f=0; f < nfactors; ++f) {
+    chol->vals[f + (f*nfactors)] += reg + rho;
+  }
+
+  /* factor once for all ADMM iterations */
+  char uplo = 'L';
+  splatt_blas_int N = (splatt_blas_int) nfactors;
+  splatt_blas_int nrhs = (splatt_blas_int) nrows;
+  splatt_blas_int info;
+  SPLATT_BLAS(potrf)(&uplo, &N, chol->vals, &N, &info);
+  if(info) {
+    fprintf(stderr, "SPLATT: ADMM Gram matrix is not SPD (info=%d).\n",
+        (int) info);
+    timer_stop(&timers[TIMER_INV]);
+    return 0;
+  }
+
+  val_t * const restrict primal = mats[mode]->vals;
+  val_t * const restrict dual = ws->duals[mode]->vals;
+  val_t * const restrict auxil = ws->auxil->vals;
+  val_t const * const restrict mvals = mttkrp->vals;
+
+  idx_t it;
+  for(it=0; it < ADMM_MAX_ITS; ++it) {
+    /* auxil = (Gram + rho I)^-1 (mttkrp + rho (primal + dual)) */
+    #pragma omp parallel for schedule(static) num_threads(nthreads)
+    for(idx_t x=0; x < nrows * nfactors; ++x) {
+      auxil[x] = mvals[x] + (rho * (primal[x] + dual[x]));
+    }
+    SPLATT_BLAS(potrs)(&uplo, &N, &nrhs, chol->vals, &N, auxil, &N, &info);
+
+    /* primal = prox(auxil - dual); dual += primal - auxil */
+    double primal_res = 0.;
+    double dual_res = 0.;
+    double primal_norm = 0.;
+    double dual_norm = 0.;
+    #pragma omp parallel num_threads(nthreads) \
+        reduction(+:primal_res, dual_res, primal_norm, dual_norm)
+    {
+      int const tid = splatt_omp_get_thread_num();
+      val_t * const restrict old = thds[tid].scratch[0];
+
+      #pragma omp for schedule(static)
+      for(idx_t i=0; i < nrows; ++i) {
+        val_t * const restrict row = primal + (i * nfactors);
+        val_t * const restrict drow = dual + (i * nfactors);
+        val_t const * const restrict arow = auxil + (i * nfactors);
+
+        for(idx_t f=0; f < nfactors; ++f) {
+          old[f] = row[f];
+          row[f] = arow[f] - drow[f];
+        }
+        prox(row, nfactors, rho, param);
+
+        for(idx_t f=0; f < nfactors; ++f) {
+          val_t const diff = row[f] - arow[f];
+          drow[f] += diff;
+
+          primal_res += diff * diff;
+          dual_res += (row[f] - old[f]) * (row[f] - old[f]);
+          primal_norm += row[f] * row[f];
+          dual_norm += drow[f] * drow[f];
+        }
+      }
+    } /* end omp parallel */
+
+    if(primal_res <= ADMM_TOL * ADMM_TOL * primal_norm &&
+        dual_res <= ADMM_TOL * ADMM_TOL * dual_norm) {
+      ++it;
+      break;
+    }
+  }
+
+  timer_stop(&timers[TIMER_INV]);
+  return it;
+}
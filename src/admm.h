@@ -0,0 +1,148 @@
+#ifndef SPLATT_ADMM_H
+#define SPLATT_ADMM_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "matrix.h"
+#include "thd_info.h"
+
+
+
+/******************************************************************************
+ * DEFAULTS
+ *****************************************************************************/
+
+/* The maximum number of ADMM iterations per factor update. */
+static idx_t const ADMM_MAX_ITS = 50;
+
+/* Relative primal and dual residual at which ADMM stops. */
+static double const ADMM_TOL = 1e-2;
+
+
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+* @brief A proximal operator applied to one row of a factor:
+*        row <- argmin_x  r(x) + (rho/2) ||x - row||^2.
+*
+* @param[out] row The row to update in place.
+* @param ncols The length of the row.
+* @param rho The ADMM penalty parameter.
+* @param param The constraint parameter (e.g., the L1 weight).
+*/
+typedef void (* admm_prox_func)(
+    val_t * const restrict row,
+    idx_t const ncols,
+    val_t const rho,
+    val_t const param);
+
+
+/**
+* @brief Workspace for AO-ADMM. The dual variables persist between outer
+*        iterations as a warm start.
+*/
+typedef struct
+{
+  /** @brief The scaled dual variable of each mode, zero if unconstrained. */
+  matrix_t * duals[MAX_NMODES];
+  /** @brief Holds the unconstrained (least squares) iterate. */
+  matrix_t * auxil;
+  /** @brief The Cholesky factor of (Gram + rho * I). */
+  matrix_t * chol;
+  /** @brief The constraint of each mode. */
+  splatt_cpd_constraint cons[MAX_NMODES];
+  /** @brief The number of modes. */
+  idx_t nmodes;
+} admm_ws;
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define admm_prox_lookup splatt_admm_prox_lookup
+/**
+* @brief Find the proximal operator of a constraint.
+*
+* @param type The constraint.
+*
+* @return The row-wise proximal operator, or NULL for SPLATT_CON_NONE.
+*/
+admm_prox_func admm_prox_lookup(
+    splatt_con_type const type);
+
+
+#define admm_scale_invariant splatt_admm_scale_invariant
+/**
+* @brief Whether scaling the columns of a factor preserves its constraint. Only
+*        these modes may be normalized into lambda.
+*
+* @param type The constraint.
+*
+* @return True for SPLATT_CON_NONE and SPLATT_CON_NONNEG.
+*/
+bool admm_scale_invariant(
+    splatt_con_type const type);
+
+
+#define admm_ws_alloc splatt_admm_ws_alloc
+/**
+* @brief Allocate an AO-ADMM workspace.
+*
+* @param mats The factors.
+* @param nmodes The number of modes.
+* @param cons The constraint of each mode.
+*
+* @return The workspace. Free with admm_ws_free().
+*/
+admm_ws * admm_ws_alloc(
+    matrix_t ** mats,
+    idx_t const nmodes,
+    splatt_cpd_constraint const * const cons);
+
+
+#define admm_ws_free splatt_admm_ws_free
+/**
+* @brief Free an AO-ADMM workspace.
+*
+* @param ws The workspace to free.
+*/
+void admm_ws_free(
+    admm_ws * ws);
+
+
+#define admm_inner splatt_admm_inner
+/**
+* @brief Update a constrained factor with ADMM. Gram + rho*I is factored once
+*        and the Cholesky factor is reused by every iteration; the proximal
+*        operator is applied to the rows in parallel.
+*
+* @param mode The mode to update.
+* @param mats The factors. mats[mode] is the warm start and the output.
+* @param aTa The Gram matrices of each factor. aTa[MAX_NMODES] is scratch.
+* @param mttkrp The MTTKRP result for 'mode'.
+* @param ws The AO-ADMM workspace.
+* @param reg Ridge regularization added to the Gram matrix.
+* @param thds Thread structures, with scratch[0] of at least ncols values.
+* @param nthreads The number of threads to use.
+*
+* @return The number of ADMM iterations performed.
+*/
+idx_t admm_inner(
+    idx_t const mode,
+    matrix_t ** mats,
+    matrix_t ** aTa,
+    matrix_t const * const mttkrp,
+    admm_ws * const ws,
+    val_t const reg,
+    thd_info * const thds,
+    idx_t const nthreads);
+
+#endif
@@ -0,0 +1,159 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "affinity.h"
+#include "thd_info.h"
+#include "util.h"
+
+#include <stdint.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+static size_t p_page_size(void)
+{
+  long const page = sysconf(_SC_PAGESIZE);
+  return (page > 0) ? (size_t) page : 4096;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+bool affinity_pin_threads(
+    int const nthreads)
+{
+#if defined(__linux__) && defined(CPU_SET)
+  if(getenv("OMP_PROC_BIND") != NULL || getenv("GOMP_CPU_AFFINITY") != NULL) {
+    return false;
+  }
+
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    return false;
+  }
+  int cpus[CPU_SETSIZE];
+  int ncpus = 0;
+  for(int c=0; c < CPU_SETSIZE; ++c) {
+    if(CPU_ISSET(c, &allowed)) {
+      cpus[ncpus++] = c;
+    }
+  }
+  if(ncpus == 0) {
+    return false;
+  }
+
+  bool pinned = true;
+  #pragma omp parallel num_threads(nthreads) reduction(&&: pinned)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    cpu_set_t mine;
+    CPU_ZERO(&mine);
+    CPU_SET(cpus[tid % ncpus], &mine);
+    /* pid 0 is the calling thread */
+    pinned = (sched_setaffinity(0, sizeof(mine), &mine) == 0);
+  }
+  return pinned;
+#else
+  return false;
+#endif
+}
+
+
+void * affinity_interleave(
+    void * buf,
+    size_t const bytes,
+    int const nthreads)
+{
+  if(bytes == 0) {
+    return buf;
+  }
+
+  size_t const page = p_page_size();
+  size_t const npages = (bytes + page - 1) / page;
+  char * const dst = splatt_malloc(bytes);
+  char const * const src = buf;
+
+  /* page p is first touched by thread p % nthreads */
+  #pragma omp parallel for schedule(static, 1) num_threads(nthreads)
+  for(size_t p=0; p < npages; ++p) {
+    size_t const start = p * page;
+    size_t const len = SS_MIN(page, bytes - start);
+    memcpy(dst + start, src + start, len);
+  }
+
+  splatt_free(buf);
+  return dst;
+}
+
+
+void affinity_node_bytes(
+    void const * const buf,
+    size_t const bytes,
+    size_t * const node_bytes)
+{
+#if defined(__linux__) && defined(SYS_move_pages)
+  if(buf == NULL || bytes == 0) {
+    return;
+  }
+
+  size_t const page = p_page_size();
+  uintptr_t const first = ((uintptr_t) buf) & ~((uintptr_t) page - 1);
+  uintptr_t const last = ((uintptr_t) buf) + bytes;
+
+  /* query in batches; with no target nodes, move_pages() only reports */
+  enum { BATCH = 1024 };
+  void * pages[BATCH];
+  int status[BATCH];
+  for(uintptr_t addr = first; addr < last; ) {
+    int count = 0;
+    for(; count < BATCH && addr < last; ++count, addr += page) {
+      pages[count] = (void *) addr;
+    }
+    if(syscall(SYS_move_pages, 0, (unsigned long) count, pages, NULL, status,
+        0) != 0) {
+      return;
+    }
+    for(int p=0; p < count; ++p) {
+      /* negative status: the page is not yet backed by memory */
+      if(status[p] >= 0 && status[p] < AFFINITY_MAX_NODES) {
+        node_bytes[status[p]] += page;
+      }
+    }
+  }
+#endif
+}
+
+
+void affinity_print(
+    char const * const name,
+    size_t const * const node_bytes)
+{
+  printf("NUMA-PLACEMENT %s:", name);
+  bool any = false;
+  for(int n=0; n < AFFINITY_MAX_NODES; ++n) {
+    if(node_bytes[n] > 0) {
+      char * bstr = bytes_str(node_bytes[n]);
+      printf(" node%d=%s", n, bstr);
+      free(bstr);
+      any = true;
+    }
+  }
+  if(!any) {
+    printf(" unknown");
+  }
+  printf("\n");
+}
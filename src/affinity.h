@@ -0,0 +1,92 @@
+#ifndef SPLATT_AFFINITY_H
+#define SPLATT_AFFINITY_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+
+
+
+/******************************************************************************
+ * DEFINES
+ *****************************************************************************/
+
+/* The most NUMA nodes that placement reports distinguish. */
+#define AFFINITY_MAX_NODES 64
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+/*
+ * NUMA placement without libnuma. Pages are placed by the Linux first-touch
+ * policy, so memory ends up local to a thread if that thread is the first to
+ * write it. Pinning keeps the threads (and thus their memory) from migrating.
+ * On other systems these functions do nothing.
+ */
+
+
+#define affinity_pin_threads splatt_affinity_pin_threads
+/**
+* @brief Pin OpenMP thread t of a team of 'nthreads' to the t-th CPU this
+*        process may run on (wrapping around). Nothing is done if the user
+*        already chose a binding with OMP_PROC_BIND or GOMP_CPU_AFFINITY.
+*
+* @param nthreads The size of the team to pin.
+*
+* @return True if threads were pinned.
+*/
+bool affinity_pin_threads(
+    int const nthreads);
+
+
+#define affinity_interleave splatt_affinity_interleave
+/**
+* @brief Move a buffer to freshly allocated pages which are first touched
+*        round-robin by the threads of a team, interleaving it over the NUMA
+*        nodes they run on. The contents are unchanged.
+*
+* @param buf The buffer, allocated with splatt_malloc(). It is freed.
+* @param bytes The size of the buffer.
+* @param nthreads The size of the team.
+*
+* @return The new buffer.
+*/
+void * affinity_interleave(
+    void * buf,
+    size_t const bytes,
+    int const nthreads);
+
+
+#define affinity_node_bytes splatt_affinity_node_bytes
+/**
+* @brief Find the NUMA node of each page of a buffer and add the bytes on each
+*        node to 'node_bytes'.
+*
+* @param buf The buffer.
+* @param bytes The size of the buffer.
+* @param[out] node_bytes Bytes per node, of length AFFINITY_MAX_NODES.
+*/
+void affinity_node_bytes(
+    void const * const buf,
+    size_t const bytes,
+    size_t * const node_bytes);
+
+
+#define affinity_print splatt_affinity_print
+/**
+* @brief Print the memory on each NUMA node, as found by
+*        affinity_node_bytes().
+*
+* @param name A label for the memory (e.g., "CSF").
+* @param node_bytes Bytes per node, of length AFFINITY_MAX_NODES.
+*/
+void affinity_print(
+    char const * const name,
+    size_t const * const node_bytes);
+
+#endif
@@ -0,0 +1,427 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "apr.h"
+#include "kruskal.h"
+#include "timer.h"
+#include "util.h"
+
+#include <math.h>
+
+
+
+/******************************************************************************
+ * API FUNCTIONS
+ *****************************************************************************/
+
+int splatt_cpd_apr(
+    splatt_csf const * const tensors,
+    splatt_idx_t const nfactors,
+    double const * const options,
+    splatt_kruskal * factored)
+{
+  idx_t const nmodes = tensors->nmodes;
+  if(nmodes < 2 || nfactors == 0) {
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  /* Poisson rates are only defined for non-negative data */
+  for(idx_t t=0; t < tensors->ntiles; ++t) {
+    val_t const * const vals = tensors->pt[t].vals;
+    if(vals == NULL) {
+      continue;
+    }
+    idx_t const nnz = tensors->pt[t].nfibs[nmodes-1];
+    for(idx_t x=0; x < nnz; ++x) {
+      if(vals[x] < 0.) {
+        return SPLATT_ERROR_BADINPUT;
+      }
+    }
+  }
+
+  /* allocate factor matrices. The seed is private to this call. */
+  unsigned int seed = (unsigned int) options[SPLATT_OPTION_RANDSEED];
+  matrix_t * mats[MAX_NMODES+1];
+  idx_t maxdim = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    idx_t const len = tensors->dims[m] * nfactors;
+    mats[m] = mat_alloc(tensors->dims[m], nfactors);
+    fill_rand_r(mats[m]->vals, len, &seed);
+    for(idx_t x=0; x < len; ++x) {
+      mats[m]->vals[x] = fabs(mats[m]->vals[x]);
+    }
+    maxdim = SS_MAX(maxdim, tensors->dims[m]);
+  }
+  mats[MAX_NMODES] = mat_alloc(maxdim, nfactors);
+
+  val_t * lambda = splatt_malloc(nfactors * sizeof(*lambda));
+
+  factored->fit = apr_iterate(tensors, mats, lambda, nfactors, options);
+
+  /* store output */
+  factored->rank = nfactors;
+  factored->nmodes = nmodes;
+  factored->lambda = lambda;
+  for(idx_t m=0; m < nmodes; ++m) {
+    factored->dims[m] = tensors->dims[m];
+    factored->factors[m] = mats[m]->vals;
+  }
+
+  /* clean up */
+  mat_free(mats[MAX_NMODES]);
+  for(idx_t m=0; m < nmodes; ++m) {
+    free(mats[m]); /* just the matrix_t ptr, data is safely in factored */
+  }
+  return SPLATT_SUCCESS;
+}
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Scale the columns of a stochastic factor by lambda, giving the B of
+*        a CP-APR subproblem. Entries stuck at an inadmissible zero (B is
+*        nearly zero but Phi says it should grow) are moved off of it.
+*
+* @param A The factor, overwritten with B.
+* @param lambda The column weights.
+* @param phi The last Phi of this mode, or NULL to skip the check.
+* @param nthreads The number of threads to use.
+*/
+static void p_absorb_lambda(
+    matrix_t * const A,
+    val_t const * const restrict lambda,
+    matrix_t const * const phi,
+    idx_t const nthreads)
+{
+  idx_t const I = A->I;
+  idx_t const J = A->J;
+  val_t * const restrict vals = A->vals;
+  val_t const * const restrict pvals = (phi == NULL) ? NULL : phi->vals;
+
+  #pragma omp parallel for schedule(static) num_threads(nthreads)
+  for(idx_t i=0; i < I; ++i) {
+    for(idx_t j=0; j < J; ++j) {
+      idx_t const x = j + (i*J);
+      vals[x] *= lambda[j];
+      if(pvals != NULL && vals[x] < APR_KAPPA_TOL && pvals[x] > 1.) {
+        vals[x] += APR_KAPPA;
+      }
+    }
+  }
+}
+
+
+/**
+* @brief The KKT violation of a CP-APR subproblem, max |min(B, 1 - Phi)|.
+*/
+static val_t p_kkt_violation(
+    matrix_t const * const B,
+    matrix_t const * const phi,
+    idx_t const nthreads)
+{
+  idx_t const len = B->I * B->J;
+  val_t const * const restrict bvals = B->vals;
+  val_t const * const restrict pvals = phi->vals;
+
+  val_t kkt = 0.;
+  #pragma omp parallel for schedule(static) num_threads(nthreads) \
+      reduction(max:kkt)
+  for(idx_t x=0; x < len; ++x) {
+    val_t const v = fabs(SS_MIN(bvals[x], 1. - pvals[x]));
+    kkt = SS_MAX(kkt, v);
+  }
+  return kkt;
+}
+
+
+/**
+* @brief The multiplicative update B = B .* Phi.
+*/
+static void p_mult_update(
+    matrix_t * const B,
+    matrix_t const * const phi,
+    idx_t const nthreads)
+{
+  idx_t const len = B->I * B->J;
+  val_t * const restrict bvals = B->vals;
+  val_t const * const restrict pvals = phi->vals;
+
+  #pragma omp parallel for schedule(static) num_threads(nthreads)
+  for(idx_t x=0; x < len; ++x) {
+    bvals[x] *= pvals[x];
+  }
+}
+
+
+/**
+* @brief The Poisson log-likelihood of the data, sum(x log(m)) - sum(m). The
+*        factors' columns sum to one (or are zero with a zero weight), so the
+*        sum of the model over the whole tensor is the sum of lambda.
+*
+* @param tensors The CSF tensor(s). Only tensors[0] is used.
+* @param mats The stochastic factors.
+* @param lambda The weight of each component.
+* @param ws The CP-APR workspace, whose 'model' is overwritten.
+*
+* @return The log-likelihood.
+*/
+static double p_loglik(
+    splatt_csf const * const tensors,
+    matrix_t ** mats,
+    val_t const * const lambda,
+    apr_ws * const ws)
+{
+  timer_start(&timers[TIMER_FIT]);
+
+  idx_t const nmodes = tensors->nmodes;
+  idx_t const nfactors = mats[0]->J;
+
+  kruskal_csf_values(tensors, mats, lambda, ws->model, ws->nthreads);
+
+  double loglik = 0.;
+  idx_t offset = 0;
+  for(idx_t t=0; t < tensors->ntiles; ++t) {
+    val_t const * const restrict vals = tensors->pt[t].vals;
+    if(vals == NULL) {
+      continue;
+    }
+    idx_t const nnz = tensors->pt[t].nfibs[nmodes-1];
+    val_t const * const restrict model = ws->model + offset;
+
+    #pragma omp parallel for schedule(static) num_threads(ws->nthreads) \
+        reduction(+:loglik)
+    for(idx_t x=0; x < nnz; ++x) {
+      if(vals[x] > 0.) {
+        loglik += vals[x] * log(SS_MAX(model[x], APR_EPS));
+      }
+    }
+    offset += nnz;
+  }
+
+  for(idx_t f=0; f < nfactors; ++f) {
+    loglik -= lambda[f];
+  }
+
+  timer_stop(&timers[TIMER_FIT]);
+  return loglik;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+apr_ws * apr_ws_alloc(
+    splatt_csf const * const tensors,
+    idx_t const nfactors,
+    double const * const opts)
+{
+  apr_ws * ws = splatt_malloc(sizeof(*ws));
+
+  ws->nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+  splatt_omp_set_num_threads(ws->nthreads);
+  ws->thds = thd_init(ws->nthreads, 3,
+      (tensors->nmodes * nfactors * sizeof(val_t)) + 64,
+      0,
+      (tensors->nmodes * nfactors * sizeof(val_t)) + 64);
+
+  /* memoized partials are only valid while the tensor's values are fixed, and
+   * the ratios change with every update */
+  ws->mttkrp_opts = splatt_default_opts();
+  memcpy(ws->mttkrp_opts, opts, SPLATT_OPTION_NOPTIONS * sizeof(*opts));
+  ws->mttkrp_opts[SPLATT_OPTION_MEMOIZE] = 0;
+  ws->mttkrp_opts[SPLATT_OPTION_PRECISION] = SPLATT_PREC_FULL;
+  ws->mttkrp_ws = splatt_mttkrp_alloc_ws(tensors, nfactors, ws->mttkrp_opts);
+
+  ws->model = splatt_malloc(tensors->nnz * sizeof(*ws->model));
+  ws->ratios = splatt_malloc(tensors->nnz * sizeof(*ws->ratios));
+
+  /* share the sparsity structure, but read values from 'ratios' */
+  ws->num_csf = ws->mttkrp_ws->num_csf;
+  for(idx_t c=0; c < ws->num_csf; ++c) {
+    splatt_csf const * const csf = tensors + c;
+    ws->ratio[c] = *csf;
+    ws->ratio[c].pt = splatt_malloc(csf->ntiles * sizeof(*ws->ratio[c].pt));
+    memcpy(ws->ratio[c].pt, csf->pt, csf->ntiles * sizeof(*csf->pt));
+    for(idx_t t=0; t < csf->ntiles; ++t) {
+      if(csf->pt[t].vals != NULL) {
+        ws->ratio[c].pt[t].vals = ws->ratios +
+            kruskal_csf_leaf_offset(csf, t);
+      }
+    }
+  }
+
+  return ws;
+}
+
+
+void apr_ws_free(
+    apr_ws * ws)
+{
+  if(ws == NULL) {
+    return;
+  }
+  for(idx_t c=0; c < ws->num_csf; ++c) {
+    splatt_free(ws->ratio[c].pt);
+  }
+  splatt_free(ws->model);
+  splatt_free(ws->ratios);
+  splatt_mttkrp_free_ws(ws->mttkrp_ws);
+  splatt_free_opts(ws->mttkrp_opts);
+  thd_free(ws->thds, ws->nthreads);
+  splatt_free(ws);
+}
+
+
+void apr_phi(
+    splatt_csf const * const tensors,
+    idx_t const mode,
+    matrix_t ** mats,
+    apr_ws * const ws)
+{
+  timer_start(&timers[TIMER_PHI]);
+
+  /* the ratios must be ordered like the CSF which MTTKRP will traverse */
+  splatt_csf const * const csf =
+      tensors + ws->mttkrp_ws->mode_csf_map[mode];
+  idx_t const nmodes = csf->nmodes;
+
+  kruskal_csf_values(csf, mats, NULL, ws->model, ws->nthreads);
+
+  idx_t offset = 0;
+  for(idx_t t=0; t < csf->ntiles; ++t) {
+    val_t const * const restrict vals = csf->pt[t].vals;
+    if(vals == NULL) {
+      continue;
+    }
+    idx_t const nnz = csf->pt[t].nfibs[nmodes-1];
+    val_t const * const restrict model = ws->model + offset;
+    val_t * const restrict ratios = ws->ratios + offset;
+
+    #pragma omp parallel for schedule(static) num_threads(ws->nthreads)
+    for(idx_t x=0; x < nnz; ++x) {
+      ratios[x] = vals[x] / SS_MAX(model[x], APR_EPS);
+    }
+    offset += nnz;
+  }
+
+  mttkrp_csf(ws->ratio, mats, mode, ws->thds, ws->mttkrp_ws, ws->mttkrp_opts);
+
+  timer_stop(&timers[TIMER_PHI]);
+}
+
+
+double apr_iterate(
+    splatt_csf const * const tensors,
+    matrix_t ** mats,
+    val_t * const lambda,
+    idx_t const nfactors,
+    double const * const opts)
+{
+  idx_t const nmodes = tensors->nmodes;
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+  val_t const tol = opts[SPLATT_OPTION_TOLERANCE];
+
+  rank_info rinfo;
+  rinfo.rank = 0;
+
+  apr_ws * ws = apr_ws_alloc(tensors, nfactors, opts);
+
+  /* the last Phi of each mode, which also receives the MTTKRP output */
+  matrix_t * const out = mats[MAX_NMODES];
+  matrix_t * phi[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    phi[m] = mat_alloc(tensors->dims[m], nfactors);
+    memset(phi[m]->vals, 0, tensors->dims[m] * nfactors * sizeof(val_t));
+  }
+
+  /* stochastic columns, with the data's mass spread evenly over components */
+  val_t total = 0.;
+  for(idx_t t=0; t < tensors->ntiles; ++t) {
+    val_t const * const vals = tensors->pt[t].vals;
+    if(vals == NULL) {
+      continue;
+    }
+    idx_t const nnz = tensors->pt[t].nfibs[nmodes-1];
+    for(idx_t x=0; x < nnz; ++x) {
+      total += vals[x];
+    }
+  }
+  for(idx_t m=0; m < nmodes; ++m) {
+    mat_normalize(mats[m], lambda, MAT_NORM_1, &rinfo, ws->thds, nthreads);
+  }
+  for(idx_t f=0; f < nfactors; ++f) {
+    lambda[f] = total / (val_t) nfactors;
+  }
+
+  double oldll = 0.;
+  double loglik = 0.;
+
+  sp_timer_t itertime;
+  sp_timer_t modetime[MAX_NMODES];
+  timer_start(&timers[TIMER_CPD]);
+
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  for(idx_t it=0; it < niters; ++it) {
+    timer_fstart(&itertime);
+    bool converged = true;
+    idx_t ninner = 0;
+    for(idx_t m=0; m < nmodes; ++m) {
+      timer_fstart(&modetime[m]);
+      matrix_t * const B = mats[m];
+      p_absorb_lambda(B, lambda, (it > 0) ? phi[m] : NULL, nthreads);
+
+      mats[MAX_NMODES] = phi[m];
+      idx_t inner = 0;
+      for(; inner < APR_MAX_INNER; ++inner) {
+        apr_phi(tensors, m, mats, ws);
+        if(p_kkt_violation(B, phi[m], nthreads) < tol) {
+          break;
+        }
+        p_mult_update(B, phi[m], nthreads);
+      }
+      mats[MAX_NMODES] = out;
+
+      /* a factor which needed no update is at a KKT point */
+      converged &= (inner == 0);
+      ninner += inner;
+
+      mat_normalize(B, lambda, MAT_NORM_1, &rinfo, ws->thds, nthreads);
+      timer_stop(&modetime[m]);
+    }
+    timer_stop(&itertime);
+
+    loglik = p_loglik(tensors, mats, lambda, ws);
+    if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      printf("  its = %3"SPLATT_PF_IDX" (%0.3fs)  loglik = %0.5e  "
+          "delta = %+0.4e  inner = %"SPLATT_PF_IDX"\n", it+1,
+          itertime.seconds, loglik, loglik - oldll, ninner);
+      if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW) {
+        for(idx_t m=0; m < nmodes; ++m) {
+          printf("     mode = %1"SPLATT_PF_IDX" (%0.3fs)\n", m+1,
+              modetime[m].seconds);
+        }
+      }
+    }
+    if(converged) {
+      break;
+    }
+    oldll = loglik;
+  }
+  timer_stop(&timers[TIMER_CPD]);
+
+  /* CLEAN UP */
+  for(idx_t m=0; m < nmodes; ++m) {
+    mat_free(phi[m]);
+  }
+  apr_ws_free(ws);
+
+  return loglik;
+}
@@ -0,0 +1,137 @@
+#ifndef SPLATT_APR_H
+#define SPLATT_APR_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "csf.h"
+#include "matrix.h"
+#include "mttkrp.h"
+#include "thd_info.h"
+
+
+
+/******************************************************************************
+ * DEFAULTS
+ *****************************************************************************/
+
+/* Multiplicative updates per factor in each outer iteration. */
+static idx_t const APR_MAX_INNER = 10;
+
+/* Entries of a factor below APR_KAPPA_TOL whose Phi exceeds one are stuck at
+ * an inadmissible zero, and are moved off of it by APR_KAPPA. */
+static val_t const APR_KAPPA = 1e-2;
+static val_t const APR_KAPPA_TOL = 1e-10;
+
+/* The smallest model value which data are divided by. */
+static val_t const APR_EPS = 1e-10;
+
+
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+* @brief Workspace for CP-APR. Phi is the MTTKRP of a tensor whose values are
+*        the data divided by the model, so 'ratio' holds shallow copies of the
+*        input CSF whose leaves point into 'ratios' instead.
+*/
+typedef struct
+{
+  /** @brief The model value at every nonzero of the CSF in use. */
+  val_t * model;
+  /** @brief The data divided by 'model', aligned in the same way. */
+  val_t * ratios;
+  /** @brief The input CSF tensors with their values replaced by 'ratios'. */
+  splatt_csf ratio[MAX_NMODES];
+  /** @brief How many CSF representations are in 'ratio'. */
+  idx_t num_csf;
+  /** @brief The workspace of the MTTKRP computing Phi. */
+  splatt_mttkrp_ws * mttkrp_ws;
+  /** @brief The options the MTTKRP runs with. */
+  double * mttkrp_opts;
+  /** @brief Thread structures. */
+  thd_info * thds;
+  /** @brief The number of threads to use. */
+  idx_t nthreads;
+} apr_ws;
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define apr_ws_alloc splatt_apr_ws_alloc
+/**
+* @brief Allocate a CP-APR workspace.
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param nfactors The rank of the factorization.
+* @param opts SPLATT options array.
+*
+* @return The workspace. Free with apr_ws_free().
+*/
+apr_ws * apr_ws_alloc(
+    splatt_csf const * const tensors,
+    idx_t const nfactors,
+    double const * const opts);
+
+
+#define apr_ws_free splatt_apr_ws_free
+/**
+* @brief Free a CP-APR workspace.
+*
+* @param ws The workspace to free.
+*/
+void apr_ws_free(
+    apr_ws * ws);
+
+
+#define apr_phi splatt_apr_phi
+/**
+* @brief Compute Phi = (X_(mode) ./ (B * KR^T)) * KR, where B is mats[mode]
+*        and KR is the Khatri-Rao product of the other factors. The model is
+*        evaluated at each nonzero, the data are divided by it, and the ratios
+*        are fed to mttkrp_csf(), which distributes and privatizes the work.
+*        Output is written to mats[MAX_NMODES].
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param mode The mode of Phi.
+* @param mats The factors, with mats[mode] scaled by lambda.
+* @param ws The CP-APR workspace.
+*/
+void apr_phi(
+    splatt_csf const * const tensors,
+    idx_t const mode,
+    matrix_t ** mats,
+    apr_ws * const ws);
+
+
+#define apr_iterate splatt_apr_iterate
+/**
+* @brief The primary computation in CP-APR: alternating Poisson regression
+*        with multiplicative updates (Chi and Kolda, 2012). Each factor is
+*        updated until its KKT violation falls below SPLATT_OPTION_TOLERANCE,
+*        and we stop when an outer iteration leaves every factor unchanged.
+*
+* @param tensors The CSF tensor(s) to factor. Values must be non-negative.
+* @param mats [OUT] The factors, non-negatively initialized. On output their
+*             columns sum to one.
+* @param lambda [OUT] The weight of each component.
+* @param nfactors The rank of the factorization.
+* @param opts SPLATT options array.
+*
+* @return The final log-likelihood, sum(x log(m)) - sum(m).
+*/
+double apr_iterate(
+    splatt_csf const * const tensors,
+    matrix_t ** mats,
+    val_t * const lambda,
+    idx_t const nfactors,
+    double const * const opts);
+
+#endif
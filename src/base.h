@@ -28,6 +28,21 @@ typedef splatt_val_t val_t;
 #define SS_MIN(x,y) ((x) < (y) ? (x) : (y))
 #define SS_MAX(x,y) ((x) > (y) ? (x) : (y))
 
+/* Inline even when the compiler's heuristics decline to. Used to stamp out
+ * specialized copies of kernels with compile-time constant parameters. */
+#if defined(__GNUC__)
+#define SPLATT_FORCE_INLINE static inline __attribute__((always_inline))
+#else
+#define SPLATT_FORCE_INLINE static inline
+#endif
+
+/* Storage which each thread has its own copy of. */
+#if defined(__GNUC__)
+#define SPLATT_THREAD_LOCAL __thread
+#else
+#define SPLATT_THREAD_LOCAL _Thread_local
+#endif
+
 
 /******************************************************************************
  * DEFAULTS
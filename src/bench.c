@@ -14,6 +14,9 @@
 #include "tile.h"
 #include "stats.h"
 #include "util.h"
+#include "simd.h"
+#include "hicoo.h"
+#include "lintensor.h"
 
 static void p_log_mat(
   char const * const ofname,
@@ -29,6 +32,20 @@ static void p_log_mat(
   }
 }
 
+static char const * p_sync_name(
+  splatt_sync_type const sync)
+{
+  switch(sync) {
+  case SPLATT_SYNC_LOCK:
+    return "lock";
+  case SPLATT_SYNC_ATOMIC:
+    return "atomic";
+  case SPLATT_SYNC_SPIN:
+    return "spin";
+  }
+  return "unknown";
+}
+
 static void p_shuffle_mats(
   matrix_t ** mats,
   idx_t * const * const perms,
@@ -150,6 +167,8 @@ void bench_csf(
   cpd_opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
   cpd_opts[SPLATT_OPTION_TILE] = SPLATT_DENSETILE;
   cpd_opts[SPLATT_OPTION_NTHREADS] = threads[nruns-1];
+  cpd_opts[SPLATT_OPTION_SIMD] = opts->simd;
+  cpd_opts[SPLATT_OPTION_SYNC] = opts->sync;
 
   idx_t const nfactors = mats[0]->J;
   /* add 64 bytes to avoid false sharing */
@@ -167,6 +186,9 @@ void bench_csf(
   free(bstr);
 
   stats_csf(cs);
+  printf("MTTKRP-KERNEL: %s\n", mttkrp_csf_kernel_name(nfactors,
+      simd_resolve((splatt_simd_type) cpd_opts[SPLATT_OPTION_SIMD])));
+  printf("MTTKRP-SYNC: %s\n", p_sync_name(opts->sync));
   printf("\n");
 
   timer_start(&timers[TIMER_MISC]);
@@ -223,6 +245,25 @@ void bench_csf(
   p_shuffle_mats(mats, opts->perm->iperms, tt->nmodes);
 }
 
+void bench_csf_sync(
+  sptensor_t * const tt,
+  matrix_t ** mats,
+  bench_opts const * const opts)
+{
+  bench_opts sync_opts = *opts;
+
+  sync_opts.sync = SPLATT_SYNC_LOCK;
+  bench_csf(tt, mats, &sync_opts);
+  printf("\n");
+
+  sync_opts.sync = SPLATT_SYNC_SPIN;
+  bench_csf(tt, mats, &sync_opts);
+  printf("\n");
+
+  sync_opts.sync = SPLATT_SYNC_ATOMIC;
+  bench_csf(tt, mats, &sync_opts);
+}
+
 void bench_giga(
   sptensor_t * const tt,
   matrix_t ** mats,
@@ -358,6 +399,142 @@ void bench_coord(
 }
 
 
+void bench_hicoo(
+  sptensor_t * const tt,
+  matrix_t ** mats,
+  bench_opts const * const opts)
+{
+  idx_t const niters = opts->niters;
+  idx_t const * const threads = opts->threads;
+  idx_t const nruns = opts->nruns;
+  char matname[64];
+
+  /* shuffle matrices if permutation exists */
+  p_shuffle_mats(mats, opts->perm->perms, tt->nmodes);
+
+  sp_timer_t itertime;
+  sp_timer_t modetime;
+
+  hicoo_t * hc = hicoo_alloc(tt, HICOO_DEFAULT_BITS);
+
+  printf("** HiCOO **\n");
+  char * bstr = bytes_str(hicoo_storage(hc));
+  printf("HICOO-STORAGE: %s\n\n", bstr);
+  free(bstr);
+
+  printf("BLOCK-WIDTH: %d\n", 1 << hc->bits);
+  printf("NBLOCKS: %"SPLATT_PF_IDX" (avg. %0.1f nnz/block)\n", hc->nblocks,
+      (double) hc->nnz / (double) SS_MAX(hc->nblocks, 1));
+  printf("\n");
+
+  timer_start(&timers[TIMER_MISC]);
+
+  /* for each # threads */
+  for(idx_t t=0; t < nruns; ++t) {
+    idx_t const nthreads = threads[t];
+    splatt_omp_set_num_threads(nthreads);
+    if(nruns > 1) {
+      printf("## THREADS %" SPLATT_PF_IDX "\n", nthreads);
+    }
+
+    for(idx_t i=0; i < niters; ++i) {
+      timer_fstart(&itertime);
+      /* time each mode */
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        timer_fstart(&modetime);
+        mttkrp_hicoo(hc, mats, m, nthreads);
+        timer_stop(&modetime);
+        printf("  mode %" SPLATT_PF_IDX " %0.3fs\n", m+1, modetime.seconds);
+        if(opts->write && t == nruns-1 && i == 0) {
+          sprintf(matname, "hicoo_mode%"SPLATT_PF_IDX".mat", m+1);
+          p_log_mat(matname, mats[MAX_NMODES], opts->perm->iperms[m]);
+        }
+      }
+      timer_stop(&itertime);
+      printf("    its = %3"SPLATT_PF_IDX" (%0.3fs)\n", i+1, itertime.seconds);
+    }
+  }
+  timer_stop(&timers[TIMER_MISC]);
+
+  hicoo_free(hc);
+
+  /* fix any matrices that we shuffled */
+  p_shuffle_mats(mats, opts->perm->iperms, tt->nmodes);
+}
+
+
+void bench_linear(
+  sptensor_t * const tt,
+  matrix_t ** mats,
+  bench_opts const * const opts)
+{
+  idx_t const niters = opts->niters;
+  idx_t const * const threads = opts->threads;
+  idx_t const nruns = opts->nruns;
+  char matname[64];
+
+  /* shuffle matrices if permutation exists */
+  p_shuffle_mats(mats, opts->perm->perms, tt->nmodes);
+
+  sp_timer_t itertime;
+  sp_timer_t modetime;
+
+  printf("** LINEAR **\n");
+  lintensor_t * lt = lintensor_alloc(tt);
+  if(lt == NULL) {
+    p_shuffle_mats(mats, opts->perm->iperms, tt->nmodes);
+    return;
+  }
+
+  char * bstr = bytes_str(lintensor_storage(lt));
+  printf("LINEAR-STORAGE: %s\n\n", bstr);
+  free(bstr);
+
+  printf("KEY-BITS: %"SPLATT_PF_IDX" (%"SPLATT_PF_IDX"-bit keys)\n", lt->nbits,
+      lt->nwords * 64);
+  printf("\n");
+
+  timer_start(&timers[TIMER_MISC]);
+
+  /* for each # threads */
+  for(idx_t t=0; t < nruns; ++t) {
+    idx_t const nthreads = threads[t];
+    splatt_omp_set_num_threads(nthreads);
+    if(nruns > 1) {
+      printf("## THREADS %" SPLATT_PF_IDX "\n", nthreads);
+    }
+
+    lintensor_ws_t * ws = lintensor_ws_alloc(lt, mats[MAX_NMODES]->J,
+        nthreads);
+
+    for(idx_t i=0; i < niters; ++i) {
+      timer_fstart(&itertime);
+      /* time each mode */
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        timer_fstart(&modetime);
+        mttkrp_lintensor(lt, mats, m, ws);
+        timer_stop(&modetime);
+        printf("  mode %" SPLATT_PF_IDX " %0.3fs\n", m+1, modetime.seconds);
+        if(opts->write && t == nruns-1 && i == 0) {
+          sprintf(matname, "linear_mode%"SPLATT_PF_IDX".mat", m+1);
+          p_log_mat(matname, mats[MAX_NMODES], opts->perm->iperms[m]);
+        }
+      }
+      timer_stop(&itertime);
+      printf("    its = %3"SPLATT_PF_IDX" (%0.3fs)\n", i+1, itertime.seconds);
+    }
+
+    lintensor_ws_free(ws);
+  }
+  timer_stop(&timers[TIMER_MISC]);
+
+  lintensor_free(lt);
+
+  /* fix any matrices that we shuffled */
+  p_shuffle_mats(mats, opts->perm->iperms, tt->nmodes);
+}
+
+
 void bench_ttbox(
   sptensor_t * const tt,
   matrix_t ** mats,
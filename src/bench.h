@@ -22,6 +22,8 @@ typedef struct
   idx_t nruns;
   int write;
   int tile;
+  splatt_simd_type simd;
+  splatt_sync_type sync;
   permutation_t * perm;
 } bench_opts;
 
@@ -40,6 +42,15 @@ void bench_csf(
   matrix_t ** mats,
   bench_opts const * const opts);
 
+/**
+* @brief Run bench_csf() with mutex-pool locks, spinlocks, and atomic updates
+*        to compare the synchronization strategies.
+*/
+void bench_csf_sync(
+  sptensor_t * const tt,
+  matrix_t ** mats,
+  bench_opts const * const opts);
+
 void bench_giga(
   sptensor_t * const tt,
   matrix_t ** mats,
@@ -55,4 +66,20 @@ void bench_coord(
   matrix_t ** mats,
   bench_opts const * const opts);
 
+/**
+* @brief Benchmark MTTKRP with the blocked HiCOO format (see hicoo.h).
+*/
+void bench_hicoo(
+  sptensor_t * const tt,
+  matrix_t ** mats,
+  bench_opts const * const opts);
+
+/**
+* @brief Benchmark MTTKRP with the linearized format (see lintensor.h).
+*/
+void bench_linear(
+  sptensor_t * const tt,
+  matrix_t ** mats,
+  bench_opts const * const opts);
+
 #endif
@@ -18,22 +18,33 @@ static char bench_doc[] =
   "Available MTTKRP algorithms are:\n"
   "  splatt\tThe algorithm introduced by splatt\n"
   "  csf\t\tGeneralized CSF format\n"
+  "  csf-sync\tCSF with mutex-pool locks vs. spinlocks vs. atomic updates\n"
   "  giga\t\tGigaTensor algorithm adapted from the MapReduce paradigm\n"
   "  coord\t\tStream through a coordinate tensor\n"
+  "  hicoo\t\tBlocked coordinate (HiCOO) format\n"
+  "  linear\tBit-interleaved linearized coordinate format\n"
   "  ttbox\t\tTensor-Vector products as done by Tensor Toolbox\n"
   "Available reordering algorithms are:\n"
   "  graph\t\t\tReorder based on the partitioning of a mode-independent graph\n"
   "  hgraph\t\tReorder based on the partitioning of a hypergraph\n"
-  "  fib\t\t'hgraph' reordering AND reschedule fiber execution\n";
+  "  fib\t\t'hgraph' reordering AND reschedule fiber execution\n"
+  "Available CSF instruction sets are:\n"
+  "  auto\t\tDetect the best supported (default)\n"
+  "  scalar\t\tPlain C kernels\n"
+  "  avx2\t\tHand-vectorized AVX2 kernels\n"
+  "  avx512\t\tHand-vectorized AVX-512 kernels\n";
 
 typedef enum
 {
   ALG_SPLATT,
   ALG_CSF,
+  ALG_CSF_SYNC,
   ALG_GIGA,
   ALG_DFACTO,
   ALG_TTBOX,
   ALG_COORD,
+  ALG_HICOO,
+  ALG_LINEAR,
   ALG_ERR,
   ALG_NALGS
 } splatt_algs;
@@ -45,7 +56,10 @@ static void (*bench_funcs[ALG_NALGS]) (sptensor_t * const tt,
   = {
     [ALG_SPLATT] = bench_splatt,
     [ALG_CSF]    = bench_csf,
+    [ALG_CSF_SYNC] = bench_csf_sync,
     [ALG_COORD]  = bench_coord,
+    [ALG_HICOO]  = bench_hicoo,
+    [ALG_LINEAR] = bench_linear,
     [ALG_GIGA]   = bench_giga,
     [ALG_TTBOX]  = bench_ttbox
   };
@@ -64,10 +78,12 @@ typedef struct
   int scale;
   int write;
   int tile;
+  splatt_simd_type simd;
   idx_t permmode;
 } bench_args;
 
 #define TT_TILE 255
+#define TT_SIMD 256
 
 static struct argp_option bench_options[] = {
   {"alg", 'a', "ALG", 0, "algorithm to benchmark"},
@@ -77,6 +93,7 @@ static struct argp_option bench_options[] = {
   {"rank", 'r', "RANK", 0, "rank of decomposition to find (default: 10)"},
   {"scale", 's', 0, 0, "scale threads from 1 to NTHREADS (by 2)"},
   {"tile", TT_TILE, 0, 0, "use tiling during SPLATT"},
+  {"simd", TT_SIMD, "ISA", 0, "instruction set for CSF kernels (default: auto)"},
   {"write", 'w', 0, 0, "write results to files ALG_mode<N>.mat (for testing)"},
   {"rtype", 'z', "TYPE", 0, "designate reordering type"},
   {"pfile", 'p', "FILE", 0, "partition file for reordering"},
@@ -96,8 +113,14 @@ static error_t parse_bench_opt(
       args->which[ALG_SPLATT] = 1;
     } else if(strcmp(arg, "csf") == 0) {
       args->which[ALG_CSF] = 1;
+    } else if(strcmp(arg, "csf-sync") == 0) {
+      args->which[ALG_CSF_SYNC] = 1;
     } else if(strcmp(arg, "coord") == 0) {
       args->which[ALG_COORD] = 1;
+    } else if(strcmp(arg, "hicoo") == 0) {
+      args->which[ALG_HICOO] = 1;
+    } else if(strcmp(arg, "linear") == 0) {
+      args->which[ALG_LINEAR] = 1;
     } else if(strcmp(arg, "giga") == 0) {
       args->which[ALG_GIGA] = 1;
     } else if(strcmp(arg, "dfacto") == 0) {
@@ -147,6 +170,21 @@ static error_t parse_bench_opt(
     args->tile = SPLATT_SYNCTILE;
     break;
 
+  case TT_SIMD:
+    if(strcmp(arg, "auto") == 0) {
+      args->simd = SPLATT_SIMD_AUTO;
+    } else if(strcmp(arg, "scalar") == 0) {
+      args->simd = SPLATT_SIMD_SCALAR;
+    } else if(strcmp(arg, "avx2") == 0) {
+      args->simd = SPLATT_SIMD_AVX2;
+    } else if(strcmp(arg, "avx512") == 0) {
+      args->simd = SPLATT_SIMD_AVX512;
+    } else {
+      fprintf(stderr, "SPLATT: instruction set '%s' is not recognized.\n", arg);
+      argp_usage(state);
+    }
+    break;
+
   case ARGP_KEY_ARG:
     if(args->ifname != NULL) {
       argp_usage(state);
@@ -210,6 +248,7 @@ int splatt_bench(
   args.rank = 10;
   args.write = 0;
   args.tile = 0;
+  args.simd = SPLATT_SIMD_AUTO;
   args.permmode = 0;
   args.rtype = PERM_ERROR;
   for(int a=0; a < ALG_NALGS; ++a) {
@@ -236,6 +275,8 @@ int splatt_bench(
   opts.niters = args.niters;
   opts.write = args.write;
   opts.tile = args.tile;
+  opts.simd = args.simd;
+  opts.sync = SPLATT_SYNC_LOCK;
 
   if(args.pfname != NULL) {
     if(args.rtype == PERM_ERROR) {
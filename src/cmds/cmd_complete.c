@@ -0,0 +1,265 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "splatt_cmds.h"
+#include "../io.h"
+#include "../sptensor.h"
+#include "../stats.h"
+#include "../thd_info.h"
+
+
+/******************************************************************************
+ * SPLATT COMPLETE
+ *****************************************************************************/
+static char tc_args_doc[] = "TRAIN [VALIDATE]";
+static char tc_doc[] =
+  "splatt-complete -- Complete a partially observed sparse tensor.\n"
+  "The loss is only taken over the given entries. If VALIDATE is given, its "
+  "RMSE is used for early stopping.\n";
+
+#define TT_ALG 249
+#define TT_CSF 250
+#define TT_REG 251
+#define TT_SEED 252
+#define TT_NOWRITE 253
+#define TT_TOL 254
+#define TT_RATE 255
+static struct argp_option tc_options[] = {
+  {"alg", TT_ALG, "ALG", 0, "completion algorithm {als,ccd,sgd} default: als"},
+  {"iters", 'i', "NITERS", 0, "maximum number of epochs to use (default: 50)"},
+  {"tol", TT_TOL, "TOLERANCE", 0, "minimum RMSE improvement (default: 1e-5)"},
+  {"reg", TT_REG, "REGULARIZATION", 0, "regularization parameter (default: 0.01)"},
+  {"rate", TT_RATE, "RATE", 0, "initial SGD step size (default: 0.001)"},
+  {"rank", 'r', "RANK", 0, "rank of the model (default: 10)"},
+  {"threads", 't', "NTHREADS", 0, "number of threads to use (default: #cores)"},
+  {"nowrite", TT_NOWRITE, 0, 0, "do not write output to file"},
+  {"seed", TT_SEED, "SEED", 0, "random seed (default: system time)"},
+  {"verbose", 'v', 0, 0, "turn on verbose output (default: no)"},
+  {"stem", 's', "PATH", 0, "file stem for factorization output files (default: ./)"},
+  { 0 }
+};
+
+
+typedef struct
+{
+  char * train_fname;  /** file that we read the training entries from */
+  char * val_fname;    /** file of held-out entries, or NULL */
+  char * stem;         /** file stem */
+  int write;           /** do we write output to file? */
+  double * opts;       /** splatt_tc options */
+  idx_t nfactors;
+  splatt_tc_type which;
+} tc_cmd_args;
+
+
+/**
+* @brief Fill a tc_cmd_args struct with default values.
+*
+* @param args The tc_cmd_args struct to fill.
+*/
+static void default_tc_opts(
+  tc_cmd_args * args)
+{
+  args->opts = splatt_default_opts();
+  args->opts[SPLATT_OPTION_REGULARIZE] = 0.01;
+  args->train_fname = NULL;
+  args->val_fname = NULL;
+  args->stem = NULL;
+  args->write = DEFAULT_WRITE;
+  args->nfactors = DEFAULT_NFACTORS;
+  args->which = SPLATT_TC_ALS;
+}
+
+
+static void free_tc_args(
+  tc_cmd_args * args)
+{
+  splatt_free_opts(args->opts);
+}
+
+
+static error_t parse_tc_opt(
+  int key,
+  char * arg,
+  struct argp_state * state)
+{
+  tc_cmd_args * args = state->input;
+
+  /* -i=50 should also work... */
+  if(arg != NULL && arg[0] == '=') {
+    ++arg;
+  }
+
+  switch(key) {
+  case 'i':
+    args->opts[SPLATT_OPTION_NITER] = (double) atoi(arg);
+    break;
+  case TT_TOL:
+    args->opts[SPLATT_OPTION_TOLERANCE] = atof(arg);
+    break;
+  case TT_REG:
+    args->opts[SPLATT_OPTION_REGULARIZE] = atof(arg);
+    break;
+  case TT_RATE:
+    args->opts[SPLATT_OPTION_LEARNRATE] = atof(arg);
+    break;
+  case 't':
+    args->opts[SPLATT_OPTION_NTHREADS] = (double) atoi(arg);
+    splatt_omp_set_num_threads((int)args->opts[SPLATT_OPTION_NTHREADS]);
+    break;
+  case 'v':
+    timer_inc_verbose();
+    args->opts[SPLATT_OPTION_VERBOSITY] += 1;
+    break;
+  case TT_NOWRITE:
+    args->write = 0;
+    break;
+  case 'r':
+    args->nfactors = atoi(arg);
+    break;
+  case 's':
+    args->stem = arg;
+    break;
+  case TT_ALG:
+    if(strcmp("als", arg) == 0) {
+      args->which = SPLATT_TC_ALS;
+    } else if(strcmp("ccd", arg) == 0) {
+      args->which = SPLATT_TC_CCD;
+    } else if(strcmp("sgd", arg) == 0) {
+      args->which = SPLATT_TC_SGD;
+    } else {
+      fprintf(stderr, "SPLATT: --alg option '%s' not recognized.\n", arg);
+      argp_usage(state);
+    }
+    break;
+
+  case TT_SEED:
+    args->opts[SPLATT_OPTION_RANDSEED] = atoi(arg);
+    break;
+
+  case ARGP_KEY_ARG:
+    if(args->train_fname == NULL) {
+      args->train_fname = arg;
+    } else if(args->val_fname == NULL) {
+      args->val_fname = arg;
+    } else {
+      argp_usage(state);
+    }
+    break;
+  case ARGP_KEY_END:
+    if(args->train_fname == NULL) {
+      argp_usage(state);
+      break;
+    }
+  }
+  return 0;
+}
+
+static struct argp tc_argp =
+  {tc_options, parse_tc_opt, tc_args_doc, tc_doc};
+
+
+/******************************************************************************
+ * SPLATT-COMPLETE
+ *****************************************************************************/
+int splatt_complete_cmd(
+  int argc,
+  char ** argv)
+{
+  /* assign defaults and parse arguments */
+  tc_cmd_args args;
+  default_tc_opts(&args);
+  argp_parse(&tc_argp, argc, argv, ARGP_IN_ORDER, 0, &args);
+
+  /* ALS and CCD++ update whole rows, so every mode needs its own tree */
+  args.opts[SPLATT_OPTION_CSF_ALLOC] = (args.which == SPLATT_TC_SGD) ?
+      SPLATT_CSF_ONEMODE : SPLATT_CSF_ALLMODE;
+
+  print_header();
+
+  sptensor_t * train = tt_read(args.train_fname);
+  if(train == NULL) {
+    free_tc_args(&args);
+    return SPLATT_ERROR_BADINPUT;
+  }
+  sptensor_t * validate = NULL;
+  if(args.val_fname != NULL) {
+    validate = tt_read(args.val_fname);
+    if(validate == NULL) {
+      tt_free(train);
+      free_tc_args(&args);
+      return SPLATT_ERROR_BADINPUT;
+    }
+  }
+
+  /* print basic tensor stats? */
+  splatt_verbosity_type which_verb = args.opts[SPLATT_OPTION_VERBOSITY];
+  if(which_verb >= SPLATT_VERBOSITY_LOW) {
+    stats_tt(train, args.train_fname, STATS_BASIC, 0, NULL);
+    if(validate != NULL) {
+      stats_tt(validate, args.val_fname, STATS_BASIC, 0, NULL);
+    }
+  }
+
+  idx_t const nmodes = train->nmodes;
+  splatt_csf * train_csf = splatt_csf_alloc(train, args.opts);
+  tt_free(train);
+
+  /* validation entries are only evaluated, so one tree is enough */
+  double * val_opts = splatt_default_opts();
+  memcpy(val_opts, args.opts, SPLATT_OPTION_NOPTIONS * sizeof(*val_opts));
+  val_opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+  splatt_csf * val_csf = NULL;
+  if(validate != NULL) {
+    val_csf = splatt_csf_alloc(validate, val_opts);
+    tt_free(validate);
+  }
+
+  /* print completion stats? */
+  if(which_verb >= SPLATT_VERBOSITY_LOW) {
+    tc_stats(train_csf, args.nfactors, args.which, args.opts);
+  }
+
+  splatt_kruskal factored;
+  int ret = splatt_tc(train_csf, val_csf, args.nfactors, args.which,
+      args.opts, &factored);
+  if(ret != SPLATT_SUCCESS) {
+    fprintf(stderr, "splatt_tc returned %d. Aborting.\n", ret);
+  } else {
+    printf("Final RMSE: %0.5f\n", factored.fit);
+  }
+
+  /* write output */
+  if(ret == SPLATT_SUCCESS && args.write == 1) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      char * matfname = NULL;
+      if(args.stem) {
+        asprintf(&matfname, "%s.mode%"SPLATT_PF_IDX".mat", args.stem, m+1);
+      } else {
+        asprintf(&matfname, "mode%"SPLATT_PF_IDX".mat", m+1);
+      }
+
+      matrix_t tmpmat;
+      tmpmat.rowmajor = 1;
+      tmpmat.I = factored.dims[m];
+      tmpmat.J = args.nfactors;
+      tmpmat.vals = factored.factors[m];
+
+      mat_write(&tmpmat, matfname);
+      free(matfname);
+    }
+  }
+
+  /* cleanup */
+  splatt_csf_free(train_csf, args.opts);
+  if(val_csf != NULL) {
+    splatt_csf_free(val_csf, val_opts);
+  }
+  splatt_free_opts(val_opts);
+  free_tc_args(&args);
+  if(ret == SPLATT_SUCCESS) {
+    splatt_free_kruskal(&factored);
+  }
+
+  return (ret == SPLATT_SUCCESS) ? EXIT_SUCCESS : ret;
+}
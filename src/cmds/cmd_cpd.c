@@ -23,6 +23,14 @@ static char cpd_doc[] =
 #define TT_NOWRITE 253
 #define TT_TOL 254
 #define TT_TILE 255
+#define TT_MEMO 256
+#define TT_PREC 257
+#define TT_NUMA 258
+#define TT_CON 259
+#define TT_LS 260
+#define TT_SKETCH 261
+#define TT_SAMPLING 262
+#define TT_LOSS 263
 static struct argp_option cpd_options[] = {
   {"iters", 'i', "NITERS", 0, "maximum number of iterations to use (default: 50)"},
   {"tol", TT_TOL, "TOLERANCE", 0, "minimum change for convergence (default: 1e-5)"},
@@ -31,6 +39,14 @@ static struct argp_option cpd_options[] = {
   {"threads", 't', "NTHREADS", 0, "number of threads to use (default: #cores)"},
   {"csf", TT_CSF, "#CSF", 0, "how many CSF to use? {one,two,all} default: two"},
   {"tile", TT_TILE, 0, 0, "use tiling during SPLATT"},
+  {"memo", TT_MEMO, "LEVELS", 0, "reuse partial MTTKRP results from LEVELS CSF levels (implies --csf=one, default: 0)"},
+  {"prec", TT_PREC, "PREC", 0, "factor precision read by MTTKRP {full,fp32,bf16,fp16} default: full"},
+  {"numa", TT_NUMA, 0, 0, "pin threads and place data by first touch"},
+  {"ls", TT_LS, "K", 0, "extrapolate the factors with a line search every K iterations (default: 0, off)"},
+  {"sketch", TT_SKETCH, "NSAMPLES", 0, "randomized ALS which samples NSAMPLES Khatri-Rao rows per update (0: 100 * rank)"},
+  {"sampling", TT_SAMPLING, "DIST", 0, "how --sketch samples rows {uniform,leverage} default: leverage"},
+  {"loss", TT_LOSS, "LOSS", 0, "loss to minimize {ls,poisson} default: ls. poisson fits count data with CP-APR"},
+  {"con", TT_CON, "[MODE:]TYPE[:PARAM]", 0, "constrain a mode (all modes if MODE is omitted) with AO-ADMM {none,nonneg,l1,simplex,rowsparse}. May be repeated."},
   {"nowrite", TT_NOWRITE, 0, 0, "do not write output to file"},
   {"seed", TT_SEED, "SEED", 0, "random seed (default: system time)"},
   {"verbose", 'v', 0, 0, "turn on verbose output (default: no)"},
@@ -46,6 +62,9 @@ typedef struct
   int write;       /** do we write output to file? */
   double * opts;   /** splatt_cpd options */
   idx_t nfactors;
+  int constrained; /** was --con given? */
+  int sketched;    /** was --sketch given? */
+  splatt_cpd_constraint cons[MAX_NMODES];
 } cpd_cmd_args;
 
 
@@ -62,6 +81,77 @@ static void default_cpd_opts(
   args->ifname    = NULL;
   args->write     = DEFAULT_WRITE;
   args->nfactors  = DEFAULT_NFACTORS;
+  args->constrained = 0;
+  args->sketched = 0;
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    args->cons[m].type = SPLATT_CON_NONE;
+    args->cons[m].param = 0.;
+  }
+}
+
+
+/**
+* @brief Parse a constraint of the form [MODE:]TYPE[:PARAM]. MODE is
+*        1-indexed.
+*
+* @param arg The string to parse. It is modified by strtok().
+* @param args The cpd_cmd_args to update.
+*
+* @return 1 on success, 0 if the string was malformed.
+*/
+static int parse_constraint(
+  char * arg,
+  cpd_cmd_args * args)
+{
+  char * tok = strtok(arg, ":");
+  if(tok == NULL) {
+    return 0;
+  }
+
+  /* optional mode */
+  idx_t mode = MAX_NMODES;
+  if(tok[0] >= '0' && tok[0] <= '9') {
+    mode = (idx_t) atoi(tok);
+    if(mode == 0 || mode > MAX_NMODES) {
+      return 0;
+    }
+    --mode;
+    tok = strtok(NULL, ":");
+    if(tok == NULL) {
+      return 0;
+    }
+  }
+
+  splatt_cpd_constraint con;
+  con.param = 0.;
+  if(strcmp("none", tok) == 0) {
+    con.type = SPLATT_CON_NONE;
+  } else if(strcmp("nonneg", tok) == 0) {
+    con.type = SPLATT_CON_NONNEG;
+  } else if(strcmp("l1", tok) == 0) {
+    con.type = SPLATT_CON_L1;
+  } else if(strcmp("simplex", tok) == 0) {
+    con.type = SPLATT_CON_SIMPLEX;
+  } else if(strcmp("rowsparse", tok) == 0) {
+    con.type = SPLATT_CON_ROWSPARSE;
+  } else {
+    return 0;
+  }
+
+  tok = strtok(NULL, ":");
+  if(tok != NULL) {
+    con.param = atof(tok);
+  }
+
+  if(mode == MAX_NMODES) {
+    for(idx_t m=0; m < MAX_NMODES; ++m) {
+      args->cons[m] = con;
+    }
+  } else {
+    args->cons[mode] = con;
+  }
+  args->constrained = 1;
+  return 1;
 }
 
 
@@ -133,6 +223,68 @@ static error_t parse_cpd_opt(
     args->opts[SPLATT_OPTION_RANDSEED] = atoi(arg);
     break;
 
+  case TT_PREC:
+    if(strcmp("full", arg) == 0) {
+      args->opts[SPLATT_OPTION_PRECISION] = SPLATT_PREC_FULL;
+    } else if(strcmp("fp32", arg) == 0) {
+      args->opts[SPLATT_OPTION_PRECISION] = SPLATT_PREC_FP32;
+    } else if(strcmp("bf16", arg) == 0) {
+      args->opts[SPLATT_OPTION_PRECISION] = SPLATT_PREC_BF16;
+    } else if(strcmp("fp16", arg) == 0) {
+      args->opts[SPLATT_OPTION_PRECISION] = SPLATT_PREC_FP16;
+    } else {
+      fprintf(stderr, "SPLATT: --prec option '%s' not recognized.\n", arg);
+      argp_usage(state);
+    }
+    break;
+
+  case TT_NUMA:
+    args->opts[SPLATT_OPTION_NUMA] = 1;
+    break;
+
+  case TT_LS:
+    args->opts[SPLATT_OPTION_LINESEARCH] = (double) atoi(arg);
+    break;
+
+  case TT_SKETCH:
+    args->sketched = 1;
+    args->opts[SPLATT_OPTION_SKETCH] = (double) atoi(arg);
+    break;
+
+  case TT_SAMPLING:
+    if(strcmp("uniform", arg) == 0) {
+      args->opts[SPLATT_OPTION_SAMPLING] = SPLATT_SAMPLE_UNIFORM;
+    } else if(strcmp("leverage", arg) == 0) {
+      args->opts[SPLATT_OPTION_SAMPLING] = SPLATT_SAMPLE_LEVERAGE;
+    } else {
+      fprintf(stderr, "SPLATT: --sampling option '%s' not recognized.\n", arg);
+      argp_usage(state);
+    }
+    break;
+
+  case TT_LOSS:
+    if(strcmp("ls", arg) == 0) {
+      args->opts[SPLATT_OPTION_LOSS] = SPLATT_LOSS_LS;
+    } else if(strcmp("poisson", arg) == 0) {
+      args->opts[SPLATT_OPTION_LOSS] = SPLATT_LOSS_POISSON;
+    } else {
+      fprintf(stderr, "SPLATT: --loss option '%s' not recognized.\n", arg);
+      argp_usage(state);
+    }
+    break;
+
+  case TT_CON:
+    if(!parse_constraint(arg, args)) {
+      fprintf(stderr, "SPLATT: --con option '%s' not recognized.\n", arg);
+      argp_usage(state);
+    }
+    break;
+
+  case TT_MEMO:
+    args->opts[SPLATT_OPTION_MEMOIZE] = (double) atoi(arg);
+    args->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+    break;
+
   case ARGP_KEY_ARG:
     if(args->ifname != NULL) {
       argp_usage(state);
@@ -145,6 +297,18 @@ static error_t parse_cpd_opt(
       argp_usage(state);
       break;
     }
+    if(args->sketched && args->constrained) {
+      fprintf(stderr, "SPLATT: --sketch does not support --con.\n");
+      argp_usage(state);
+      break;
+    }
+    if((splatt_loss_type) args->opts[SPLATT_OPTION_LOSS] ==
+        SPLATT_LOSS_POISSON && (args->sketched || args->constrained)) {
+      fprintf(stderr, "SPLATT: --loss poisson does not support --sketch or "
+          "--con.\n");
+      argp_usage(state);
+      break;
+    }
   }
   return 0;
 }
@@ -194,13 +358,27 @@ int splatt_cpd_cmd(
   splatt_kruskal factored;
 
   /* do the factorization! */
-  int ret = splatt_cpd_als(csf, args.nfactors, args.opts, &factored);
+  int ret;
+  bool const poisson =
+      (splatt_loss_type) args.opts[SPLATT_OPTION_LOSS] == SPLATT_LOSS_POISSON;
+  if(poisson) {
+    ret = splatt_cpd_apr(csf, args.nfactors, args.opts, &factored);
+  } else if(args.sketched) {
+    ret = splatt_cpd_sketched(csf, args.nfactors, args.opts, &factored);
+  } else {
+    ret = splatt_cpd_constrained(csf, args.nfactors,
+        args.constrained ? args.cons : NULL, args.opts, &factored);
+  }
   if(ret != SPLATT_SUCCESS) {
-    fprintf(stderr, "splatt_cpd_als returned %d. Aborting.\n", ret);
+    fprintf(stderr, "SPLATT: CPD returned %d. Aborting.\n", ret);
     return ret;
   }
 
-  printf("Final fit: %0.5"SPLATT_PF_VAL"\n", factored.fit);
+  if(poisson) {
+    printf("Final log-likelihood: %0.5e\n", factored.fit);
+  } else {
+    printf("Final fit: %0.5"SPLATT_PF_VAL"\n", factored.fit);
+  }
 
   /* write output */
   if(args.write == 1) {
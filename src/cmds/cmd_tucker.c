@@ -0,0 +1,258 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "splatt_cmds.h"
+#include "../io.h"
+#include "../sptensor.h"
+#include "../stats.h"
+#include "../thd_info.h"
+
+
+/******************************************************************************
+ * SPLATT TUCKER
+ *****************************************************************************/
+static char tucker_args_doc[] = "TENSOR";
+static char tucker_doc[] =
+  "splatt-tucker -- Compute the Tucker decomposition of a sparse tensor "
+  "with HOOI.\n";
+
+#define TT_CSF 250
+#define TT_SEED 252
+#define TT_NOWRITE 253
+#define TT_TOL 254
+#define TT_TILE 255
+static struct argp_option tucker_options[] = {
+  {"iters", 'i', "NITERS", 0, "maximum number of iterations to use (default: 50)"},
+  {"tol", TT_TOL, "TOLERANCE", 0, "minimum change for convergence (default: 1e-5)"},
+  {"rank", 'r', "RANKS", 0, "rank of each mode, either one value or a comma-separated list (default: 10)"},
+  {"threads", 't', "NTHREADS", 0, "number of threads to use (default: #cores)"},
+  {"csf", TT_CSF, "#CSF", 0, "how many CSF to use? {one,two,all} default: two"},
+  {"tile", TT_TILE, 0, 0, "use tiling during TTMc"},
+  {"nowrite", TT_NOWRITE, 0, 0, "do not write output to file"},
+  {"seed", TT_SEED, "SEED", 0, "random seed (default: system time)"},
+  {"verbose", 'v', 0, 0, "turn on verbose output (default: no)"},
+  {"stem", 's', "PATH", 0, "file stem for factorization output files (default: ./)"},
+  { 0 }
+};
+
+
+typedef struct
+{
+  char * ifname;   /** file that we read the tensor from */
+  char * stem;     /** file stem */
+  int write;       /** do we write output to file? */
+  double * opts;   /** splatt_tucker options */
+  idx_t nranks;    /** how many ranks were given (1 means all modes) */
+  idx_t ranks[MAX_NMODES];
+} tucker_cmd_args;
+
+
+/**
+* @brief Fill a tucker_cmd_args struct with default values.
+*
+* @param args The tucker_cmd_args struct to fill.
+*/
+static void default_tucker_opts(
+  tucker_cmd_args * args)
+{
+  args->opts = splatt_default_opts();
+  args->stem = NULL;
+  args->ifname = NULL;
+  args->write = DEFAULT_WRITE;
+  args->nranks = 1;
+  args->ranks[0] = DEFAULT_NFACTORS;
+}
+
+
+static void free_tucker_args(
+  tucker_cmd_args * args)
+{
+  splatt_free_opts(args->opts);
+}
+
+
+static error_t parse_tucker_opt(
+  int key,
+  char * arg,
+  struct argp_state * state)
+{
+  tucker_cmd_args * args = state->input;
+
+  /* -i=50 should also work... */
+  if(arg != NULL && arg[0] == '=') {
+    ++arg;
+  }
+
+  switch(key) {
+  case 'i':
+    args->opts[SPLATT_OPTION_NITER] = (double) atoi(arg);
+    break;
+  case TT_TOL:
+    args->opts[SPLATT_OPTION_TOLERANCE] = atof(arg);
+    break;
+  case 't':
+    args->opts[SPLATT_OPTION_NTHREADS] = (double) atoi(arg);
+    splatt_omp_set_num_threads((int)args->opts[SPLATT_OPTION_NTHREADS]);
+    break;
+  case 'v':
+    timer_inc_verbose();
+    args->opts[SPLATT_OPTION_VERBOSITY] += 1;
+    break;
+  case TT_TILE:
+    args->opts[SPLATT_OPTION_TILE] = SPLATT_DENSETILE;
+    break;
+  case TT_NOWRITE:
+    args->write = 0;
+    break;
+  case 'r':
+    args->nranks = 0;
+    for(char * tok = strtok(arg, ","); tok != NULL; tok = strtok(NULL, ",")) {
+      if(args->nranks == MAX_NMODES) {
+        fprintf(stderr, "SPLATT: too many ranks given.\n");
+        argp_usage(state);
+      }
+      args->ranks[args->nranks++] = atoi(tok);
+    }
+    break;
+  case 's':
+    args->stem = arg;
+    break;
+  case TT_CSF:
+    if(strcmp("one", arg) == 0) {
+      args->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+    } else if(strcmp("two", arg) == 0) {
+      args->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_TWOMODE;
+    } else if(strcmp("all", arg) == 0) {
+      args->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
+    } else {
+      fprintf(stderr, "SPLATT: --csf option '%s' not recognized.\n", arg);
+      argp_usage(state);
+    }
+    break;
+
+  case TT_SEED:
+    args->opts[SPLATT_OPTION_RANDSEED] = atoi(arg);
+    break;
+
+  case ARGP_KEY_ARG:
+    if(args->ifname != NULL) {
+      argp_usage(state);
+      break;
+    }
+    args->ifname = arg;
+    break;
+  case ARGP_KEY_END:
+    if(args->ifname == NULL) {
+      argp_usage(state);
+      break;
+    }
+  }
+  return 0;
+}
+
+static struct argp tucker_argp =
+  {tucker_options, parse_tucker_opt, tucker_args_doc, tucker_doc};
+
+
+/******************************************************************************
+ * SPLATT-TUCKER
+ *****************************************************************************/
+int splatt_tucker_cmd(
+  int argc,
+  char ** argv)
+{
+  /* assign defaults and parse arguments */
+  tucker_cmd_args args;
+  default_tucker_opts(&args);
+  argp_parse(&tucker_argp, argc, argv, ARGP_IN_ORDER, 0, &args);
+
+  sptensor_t * tt = NULL;
+
+  print_header();
+
+  tt = tt_read(args.ifname);
+  if(tt == NULL) {
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  idx_t const nmodes = tt->nmodes;
+  if(args.nranks != 1 && args.nranks != nmodes) {
+    fprintf(stderr, "SPLATT: %"SPLATT_PF_IDX" ranks given for a tensor of "
+        "%"SPLATT_PF_IDX" modes.\n", args.nranks, nmodes);
+    tt_free(tt);
+    free_tucker_args(&args);
+    return SPLATT_ERROR_BADINPUT;
+  }
+  for(idx_t m=args.nranks; m < nmodes; ++m) {
+    args.ranks[m] = args.ranks[0];
+  }
+
+  /* print basic tensor stats? */
+  splatt_verbosity_type which_verb = args.opts[SPLATT_OPTION_VERBOSITY];
+  if(which_verb >= SPLATT_VERBOSITY_LOW) {
+    stats_tt(tt, args.ifname, STATS_BASIC, 0, NULL);
+  }
+
+  splatt_csf * csf = splatt_csf_alloc(tt, args.opts);
+  tt_free(tt);
+
+  /* print Tucker stats? */
+  if(which_verb >= SPLATT_VERBOSITY_LOW) {
+    tucker_stats(csf, args.ranks, args.opts);
+  }
+
+  splatt_tucker factored;
+
+  /* do the factorization! */
+  int ret = splatt_tucker_hooi(csf, args.ranks, args.opts, &factored);
+  if(ret != SPLATT_SUCCESS) {
+    fprintf(stderr, "splatt_tucker_hooi returned %d. Aborting.\n", ret);
+    splatt_csf_free(csf, args.opts);
+    free_tucker_args(&args);
+    return ret;
+  }
+
+  printf("Final fit: %0.5"SPLATT_PF_VAL"\n", factored.fit);
+
+  /* write output */
+  if(args.write == 1) {
+    idx_t ncore = 1;
+    for(idx_t m=0; m < nmodes; ++m) {
+      ncore *= args.ranks[m];
+    }
+
+    char * core_name = NULL;
+    if(args.stem) {
+      asprintf(&core_name, "%s.core.mat", args.stem);
+    } else {
+      asprintf(&core_name, "core.mat");
+    }
+    vec_write(factored.core, ncore, core_name);
+    free(core_name);
+
+    for(idx_t m=0; m < nmodes; ++m) {
+      char * matfname = NULL;
+      if(args.stem) {
+        asprintf(&matfname, "%s.mode%"SPLATT_PF_IDX".mat", args.stem, m+1);
+      } else {
+        asprintf(&matfname, "mode%"SPLATT_PF_IDX".mat", m+1);
+      }
+
+      matrix_t tmpmat;
+      tmpmat.rowmajor = 1;
+      tmpmat.I = csf->dims[m];
+      tmpmat.J = args.ranks[m];
+      tmpmat.vals = factored.factors[m];
+
+      mat_write(&tmpmat, matfname);
+      free(matfname);
+    }
+  }
+
+  /* cleanup */
+  splatt_csf_free(csf, args.opts);
+  free_tucker_args(&args);
+  splatt_free_tucker(&factored);
+
+  return EXIT_SUCCESS;
+}
@@ -17,6 +17,8 @@ static char cmd_doc[] =
   "splatt -- the Surprisingly ParalleL spArse Tensor Toolkit\n\n"
   "The available commands are:\n"
   "  cpd\t\tCompute the Canonical Polyadic Decomposition.\n"
+  "  tucker\tCompute the Tucker Decomposition.\n"
+  "  complete\tComplete a partially observed tensor.\n"
   "  bench\t\tBenchmark MTTKRP algorithms.\n"
   "  check\t\tCheck a tensor file for correctness.\n"
   "  convert\tConvert a tensor to different formats.\n"
@@ -53,6 +55,8 @@ int splatt_mpi_cpd_cmd(int argc, char ** argv);
 #else
 int splatt_cpd_cmd(int argc, char ** argv);
 #endif
+int splatt_tucker_cmd(int argc, char ** argv);
+int splatt_complete_cmd(int argc, char ** argv);
 int splatt_bench(int argc, char ** argv);
 int splatt_check(int argc, char ** argv);
 int splatt_convert(int argc, char ** argv);
@@ -80,6 +84,8 @@ static cmd_struct const splatt_cmds[] = {
 #else
   { "cpd", splatt_cpd_cmd },
 #endif
+  { "tucker", splatt_tucker_cmd },
+  { "complete", splatt_complete_cmd },
 
   { "bench", splatt_bench },
   { "check", splatt_check },
@@ -0,0 +1,856 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "completion.h"
+#include "kruskal.h"
+#include "thd_info.h"
+#include "timer.h"
+#include "util.h"
+
+#include <math.h>
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief The squared error of the model over the nonzeros of csf[0].
+*
+* @param csf The tensor.
+* @param mats The factors.
+* @param preds Buffer for the model values, of length csf->nnz.
+* @param nthreads The number of threads to use.
+*
+* @return sum (x - model(x))^2.
+*/
+static double p_sq_error(
+    splatt_csf const * const csf,
+    matrix_t ** mats,
+    val_t * const preds,
+    idx_t const nthreads)
+{
+  timer_start(&timers[TIMER_FIT]);
+  kruskal_csf_values(csf, mats, NULL, preds, nthreads);
+
+  double err = 0;
+  for(idx_t t=0; t < csf->ntiles; ++t) {
+    csf_sparsity const * const pt = csf->pt + t;
+    if(pt->vals == NULL) {
+      continue;
+    }
+    idx_t const nnz = pt->nfibs[csf->nmodes-1];
+    val_t const * const restrict tvals = pt->vals;
+    val_t const * const restrict tpreds = preds + kruskal_csf_leaf_offset(csf,t);
+
+    #pragma omp parallel for schedule(static) reduction(+:err) \
+        num_threads(nthreads)
+    for(idx_t x=0; x < nnz; ++x) {
+      double const diff = tvals[x] - tpreds[x];
+      err += diff * diff;
+    }
+  }
+  timer_stop(&timers[TIMER_FIT]);
+  return err;
+}
+
+
+/**
+* @brief Find the CSF rooted at each mode.
+*
+* @param train The CSF tensors.
+* @param opts The options used to allocate 'train'.
+* @param[out] root_csf root_csf[m] is the tensor whose root is mode m, or
+*                      train->nmodes if there is none.
+*
+* @return Whether every mode has a root CSF.
+*/
+static bool p_find_root_csf(
+    splatt_csf const * const train,
+    double const * const opts,
+    idx_t * const root_csf)
+{
+  idx_t const nmodes = train->nmodes;
+  idx_t ncsf = 1;
+  switch((splatt_csf_type) opts[SPLATT_OPTION_CSF_ALLOC]) {
+  case SPLATT_CSF_TWOMODE:
+    ncsf = 2;
+    break;
+  case SPLATT_CSF_ALLMODE:
+    ncsf = nmodes;
+    break;
+  default:
+    break;
+  }
+
+  bool found_all = true;
+  for(idx_t m=0; m < nmodes; ++m) {
+    root_csf[m] = nmodes;
+    for(idx_t c=0; c < ncsf; ++c) {
+      if(csf_depth_to_mode(train + c, 0) == m) {
+        root_csf[m] = c;
+        break;
+      }
+    }
+    if(root_csf[m] == nmodes) {
+      found_all = false;
+    }
+  }
+  return found_all;
+}
+
+
+/**
+* @brief Solve LL^T x = b in place.
+*
+* @param L The lower-triangular Cholesky factor, row-major.
+* @param N The dimension of L.
+* @param[out] b The right-hand side, overwritten with x.
+*/
+static void p_chol_solve(
+    val_t const * const restrict L,
+    idx_t const N,
+    val_t * const restrict b)
+{
+  /* forward solve Ly = b */
+  for(idx_t i=0; i < N; ++i) {
+    val_t v = b[i];
+    for(idx_t k=0; k < i; ++k) {
+      v -= L[k + (i*N)] * b[k];
+    }
+    b[i] = v / L[i + (i*N)];
+  }
+
+  /* backward solve L^T x = y */
+  for(idx_t i=N; i-- > 0; ) {
+    val_t v = b[i];
+    for(idx_t k=i+1; k < N; ++k) {
+      v -= L[i + (k*N)] * b[k];
+    }
+    b[i] = v / L[i + (i*N)];
+  }
+}
+
+
+
+/******************************************************************************
+ * ALS
+ *****************************************************************************/
+
+/**
+* @brief Accumulate the normal equations of a root row from the nonzeros below
+*        nodes [start, end) of 'level'. buf[level-1] holds the Hadamard
+*        product of the rows on the path from the root (excluded).
+*
+* @param[out] gram The lower triangle of sum h h^T.
+* @param[out] rhs sum x h.
+*/
+static void p_als_accum(
+    csf_sparsity const * const pt,
+    idx_t const level,
+    idx_t const start,
+    idx_t const end,
+    val_t const * const * const lvals,
+    idx_t const nfactors,
+    idx_t const nmodes,
+    val_t ** buf,
+    val_t * const restrict gram,
+    val_t * const restrict rhs)
+{
+  idx_t const * const restrict fids = pt->fids[level];
+  val_t const * const restrict mvals = lvals[level];
+  val_t const * const restrict path = buf[level-1];
+  val_t * const restrict prod = buf[level];
+
+  for(idx_t n=start; n < end; ++n) {
+    val_t const * const restrict row = mvals + (fids[n] * nfactors);
+    for(idx_t f=0; f < nfactors; ++f) {
+      prod[f] = path[f] * row[f];
+    }
+
+    if(level < nmodes - 1) {
+      p_als_accum(pt, level+1, pt->fptr[level][n], pt->fptr[level][n+1],
+          lvals, nfactors, nmodes, buf, gram, rhs);
+      continue;
+    }
+
+    val_t const v = pt->vals[n];
+    for(idx_t i=0; i < nfactors; ++i) {
+      rhs[i] += v * prod[i];
+      for(idx_t j=0; j <= i; ++j) {
+        gram[j + (i*nfactors)] += prod[i] * prod[j];
+      }
+    }
+  }
+}
+
+
+/**
+* @brief Update every observed row of 'mode' by solving its regularized
+*        normal equations. Each row is owned by one thread.
+*
+* @param csf The untiled CSF rooted at 'mode'.
+* @param mats The factors.
+* @param mode The mode to update.
+* @param reg The regularization parameter.
+* @param thds Thread structures, with four scratch buffers.
+* @param nthreads The number of threads to use.
+*/
+static void p_tc_als_mode(
+    splatt_csf const * const csf,
+    matrix_t ** mats,
+    idx_t const mode,
+    val_t const reg,
+    thd_info * const thds,
+    idx_t const nthreads)
+{
+  idx_t const nmodes = csf->nmodes;
+  idx_t const nfactors = mats[mode]->J;
+  csf_sparsity const * const pt = csf->pt;
+
+  val_t const * lvals[MAX_NMODES];
+  for(idx_t l=0; l < nmodes; ++l) {
+    lvals[l] = mats[csf_depth_to_mode(csf, l)]->vals;
+  }
+  val_t * const avals = mats[mode]->vals;
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    matrix_t gram;
+    gram.I = nfactors;
+    gram.J = nfactors;
+    gram.rowmajor = 1;
+    gram.vals = thds[tid].scratch[0];
+    matrix_t chol = gram;
+    chol.vals = thds[tid].scratch[1];
+    val_t * const rhs = thds[tid].scratch[2];
+
+    val_t * buf[MAX_NMODES];
+    for(idx_t l=0; l < nmodes; ++l) {
+      buf[l] = ((val_t *) thds[tid].scratch[3]) + (l * nfactors);
+    }
+    for(idx_t f=0; f < nfactors; ++f) {
+      buf[0][f] = 1.;
+    }
+
+    idx_t const * const restrict sptr = pt->fptr[0];
+    idx_t const * const restrict sids = pt->fids[0];
+
+    #pragma omp for schedule(dynamic, 16)
+    for(idx_t s=0; s < pt->nfibs[0]; ++s) {
+      if(sptr[s] == sptr[s+1]) {
+        continue;
+      }
+      memset(gram.vals, 0, nfactors * nfactors * sizeof(val_t));
+      memset(rhs, 0, nfactors * sizeof(val_t));
+      p_als_accum(pt, 1, sptr[s], sptr[s+1], lvals, nfactors, nmodes, buf,
+          gram.vals, rhs);
+      for(idx_t f=0; f < nfactors; ++f) {
+        gram.vals[f + (f*nfactors)] += reg;
+      }
+
+      mat_cholesky(&gram, &chol);
+      p_chol_solve(chol.vals, nfactors, rhs);
+
+      idx_t const fid = (sids == NULL) ? s : sids[s];
+      memcpy(avals + (fid * nfactors), rhs, nfactors * sizeof(val_t));
+    }
+  } /* end omp parallel */
+}
+
+
+
+/******************************************************************************
+ * CCD++
+ *****************************************************************************/
+
+/**
+* @brief Add sign * (the rank-one component of column 'f') to the residual of
+*        each nonzero below nodes [start, end) of 'level'.
+*
+* @param lcols The factor of each level, offset to column f.
+* @param path The product of the column entries on the path from the root.
+* @param sign +1 or -1.
+* @param[out] resid The residuals, aligned with the leaves.
+*/
+static void p_ccd_update_resid(
+    csf_sparsity const * const pt,
+    idx_t const level,
+    idx_t const start,
+    idx_t const end,
+    val_t const * const * const lcols,
+    idx_t const nfactors,
+    idx_t const nmodes,
+    val_t const path,
+    val_t const sign,
+    val_t * const restrict resid)
+{
+  idx_t const * const restrict fids = pt->fids[level];
+  val_t const * const restrict col = lcols[level];
+
+  if(level == nmodes - 1) {
+    for(idx_t n=start; n < end; ++n) {
+      resid[n] += sign * path * col[fids[n] * nfactors];
+    }
+    return;
+  }
+
+  for(idx_t n=start; n < end; ++n) {
+    p_ccd_update_resid(pt, level+1, pt->fptr[level][n], pt->fptr[level][n+1],
+        lcols, nfactors, nmodes, path * col[fids[n] * nfactors], sign, resid);
+  }
+}
+
+
+/**
+* @brief Accumulate the numerator (sum r h) and denominator (sum h^2) of the
+*        CCD++ update of a root row from the nonzeros below [start, end).
+*/
+static void p_ccd_accum(
+    csf_sparsity const * const pt,
+    idx_t const level,
+    idx_t const start,
+    idx_t const end,
+    val_t const * const * const lcols,
+    idx_t const nfactors,
+    idx_t const nmodes,
+    val_t const path,
+    val_t const * const restrict resid,
+    val_t * const numer,
+    val_t * const denom)
+{
+  idx_t const * const restrict fids = pt->fids[level];
+  val_t const * const restrict col = lcols[level];
+
+  if(level == nmodes - 1) {
+    val_t num = 0;
+    val_t den = 0;
+    for(idx_t n=start; n < end; ++n) {
+      val_t const h = path * col[fids[n] * nfactors];
+      num += resid[n] * h;
+      den += h * h;
+    }
+    *numer += num;
+    *denom += den;
+    return;
+  }
+
+  for(idx_t n=start; n < end; ++n) {
+    p_ccd_accum(pt, level+1, pt->fptr[level][n], pt->fptr[level][n+1],
+        lcols, nfactors, nmodes, path * col[fids[n] * nfactors], resid,
+        numer, denom);
+  }
+}
+
+
+/**
+* @brief Point each level of a CSF at column 'f' of its factor.
+*/
+static void p_ccd_columns(
+    splatt_csf const * const csf,
+    matrix_t ** mats,
+    idx_t const f,
+    val_t const ** lcols)
+{
+  for(idx_t l=0; l < csf->nmodes; ++l) {
+    lcols[l] = mats[csf_depth_to_mode(csf, l)]->vals + f;
+  }
+}
+
+
+/**
+* @brief Add sign * (rank-one component f) to the residuals of an untiled CSF.
+*/
+static void p_ccd_resid_tree(
+    splatt_csf const * const csf,
+    matrix_t ** mats,
+    idx_t const f,
+    val_t const sign,
+    val_t * const resid,
+    idx_t const nthreads)
+{
+  idx_t const nfactors = mats[0]->J;
+  csf_sparsity const * const pt = csf->pt;
+  val_t const * lcols[MAX_NMODES];
+  p_ccd_columns(csf, mats, f, lcols);
+
+  idx_t const * const restrict sptr = pt->fptr[0];
+  idx_t const * const restrict sids = pt->fids[0];
+
+  #pragma omp parallel for schedule(dynamic, 16) num_threads(nthreads)
+  for(idx_t s=0; s < pt->nfibs[0]; ++s) {
+    idx_t const fid = (sids == NULL) ? s : sids[s];
+    p_ccd_update_resid(pt, 1, sptr[s], sptr[s+1], lcols, nfactors,
+        csf->nmodes, lcols[0][fid * nfactors], sign, resid);
+  }
+}
+
+
+/**
+* @brief One outer CCD++ iteration: update each column of every factor in
+*        turn. Every CSF in 'root_csf' keeps its own residual array.
+*
+* @param train The untiled CSF tensors.
+* @param root_csf The CSF rooted at each mode.
+* @param mats The factors.
+* @param reg The regularization parameter.
+* @param resid The residuals of each CSF, aligned with its leaves.
+* @param nthreads The number of threads to use.
+*/
+static void p_tc_ccd_iter(
+    splatt_csf const * const train,
+    idx_t const * const root_csf,
+    matrix_t ** mats,
+    val_t const reg,
+    val_t ** resid,
+    idx_t const nthreads)
+{
+  idx_t const nmodes = train->nmodes;
+  idx_t const nfactors = mats[0]->J;
+
+  for(idx_t f=0; f < nfactors; ++f) {
+    /* residuals without component f */
+    for(idx_t m=0; m < nmodes; ++m) {
+      idx_t const c = root_csf[m];
+      p_ccd_resid_tree(train + c, mats, f, 1., resid[c], nthreads);
+    }
+
+    for(idx_t m=0; m < nmodes; ++m) {
+      splatt_csf const * const csf = train + root_csf[m];
+      csf_sparsity const * const pt = csf->pt;
+      val_t const * const restrict r = resid[root_csf[m]];
+      val_t * const restrict avals = mats[m]->vals;
+
+      val_t const * lcols[MAX_NMODES];
+      p_ccd_columns(csf, mats, f, lcols);
+
+      idx_t const * const restrict sptr = pt->fptr[0];
+      idx_t const * const restrict sids = pt->fids[0];
+
+      #pragma omp parallel for schedule(dynamic, 16) num_threads(nthreads)
+      for(idx_t s=0; s < pt->nfibs[0]; ++s) {
+        if(sptr[s] == sptr[s+1]) {
+          continue;
+        }
+        val_t numer = 0;
+        val_t denom = 0;
+        p_ccd_accum(pt, 1, sptr[s], sptr[s+1], lcols, nfactors, nmodes, 1.,
+            r, &numer, &denom);
+        idx_t const fid = (sids == NULL) ? s : sids[s];
+        avals[f + (fid * nfactors)] = numer / (reg + denom);
+      }
+    }
+
+    /* put the new component back */
+    for(idx_t m=0; m < nmodes; ++m) {
+      idx_t const c = root_csf[m];
+      p_ccd_resid_tree(train + c, mats, f, -1., resid[c], nthreads);
+    }
+  }
+}
+
+
+
+/******************************************************************************
+ * SGD
+ *****************************************************************************/
+
+/**
+* @brief Take one SGD step for each nonzero below nodes [start, end) of
+*        'level'. rows[l] points to the factor row of the path at level l.
+*
+* @param grads Buffer for the gradient of every level, nmodes * nfactors.
+*/
+static void p_sgd_tree(
+    csf_sparsity const * const pt,
+    idx_t const level,
+    idx_t const start,
+    idx_t const end,
+    val_t * const * const lvals,
+    idx_t const nfactors,
+    idx_t const nmodes,
+    val_t ** rows,
+    val_t const rate,
+    val_t const reg,
+    val_t * const restrict grads)
+{
+  idx_t const * const restrict fids = pt->fids[level];
+
+  for(idx_t n=start; n < end; ++n) {
+    rows[level] = lvals[level] + (fids[n] * nfactors);
+
+    if(level < nmodes - 1) {
+      p_sgd_tree(pt, level+1, pt->fptr[level][n], pt->fptr[level][n+1],
+          lvals, nfactors, nmodes, rows, rate, reg, grads);
+      continue;
+    }
+
+    /* prediction and error */
+    val_t pred = 0;
+    for(idx_t f=0; f < nfactors; ++f) {
+      val_t prod = 1.;
+      for(idx_t l=0; l < nmodes; ++l) {
+        prod *= rows[l][f];
+      }
+      pred += prod;
+    }
+    val_t const err = pt->vals[n] - pred;
+
+    /* all gradients are taken before any row changes */
+    for(idx_t l=0; l < nmodes; ++l) {
+      for(idx_t f=0; f < nfactors; ++f) {
+        val_t h = err;
+        for(idx_t l2=0; l2 < nmodes; ++l2) {
+          if(l2 != l) {
+            h *= rows[l2][f];
+          }
+        }
+        grads[f + (l * nfactors)] = h;
+      }
+    }
+    for(idx_t l=0; l < nmodes; ++l) {
+      val_t * const restrict row = rows[l];
+      for(idx_t f=0; f < nfactors; ++f) {
+        row[f] += rate * (grads[f + (l * nfactors)] - (reg * row[f]));
+      }
+    }
+  }
+}
+
+
+/**
+* @brief One SGD epoch over train[0]. Threads process the nnz-balanced parts
+*        of each tree that MTTKRP uses. Rows shared between threads are
+*        updated without synchronization (Hogwild!-style), which is benign
+*        for the sparse updates of SGD.
+*
+* @param train The CSF tensor.
+* @param parts The partitioning of each tile, NULL for empty tiles.
+* @param mats The factors.
+* @param rate The step size.
+* @param reg The regularization parameter.
+* @param thds Thread structures, with scratch[3] of nmodes * nfactors values.
+* @param nthreads The number of threads to use.
+*/
+static void p_tc_sgd_epoch(
+    splatt_csf const * const train,
+    idx_t * * const parts,
+    matrix_t ** mats,
+    val_t const rate,
+    val_t const reg,
+    thd_info * const thds,
+    idx_t const nthreads)
+{
+  idx_t const nmodes = train->nmodes;
+  idx_t const nfactors = mats[0]->J;
+
+  val_t * lvals[MAX_NMODES];
+  for(idx_t l=0; l < nmodes; ++l) {
+    lvals[l] = mats[csf_depth_to_mode(train, l)]->vals;
+  }
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    val_t * const grads = thds[tid].scratch[3];
+    val_t * rows[MAX_NMODES];
+
+    for(idx_t t=0; t < train->ntiles; ++t) {
+      csf_sparsity const * const pt = train->pt + t;
+      if(pt->vals == NULL) {
+        continue;
+      }
+      idx_t const * const restrict sptr = pt->fptr[0];
+      idx_t const * const restrict sids = pt->fids[0];
+
+      idx_t start, stop, fstart, fstop;
+      csf_thread_range(pt, parts[t], tid, &start, &stop, &fstart, &fstop);
+      for(idx_t s=start; s < stop; ++s) {
+        idx_t const fid = (sids == NULL) ? s : sids[s];
+        rows[0] = lvals[0] + (fid * nfactors);
+        p_sgd_tree(pt, 1, SS_MAX(sptr[s], fstart), SS_MIN(sptr[s+1], fstop),
+            lvals, nfactors, nmodes, rows, rate, reg, grads);
+      }
+    }
+  } /* end omp parallel */
+}
+
+
+/**
+* @brief The SGD objective: squared error plus the regularization term.
+*/
+static double p_sgd_objective(
+    double const sq_error,
+    matrix_t ** mats,
+    idx_t const nmodes,
+    val_t const reg)
+{
+  double norms = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    val_t const * const restrict vals = mats[m]->vals;
+    idx_t const nvals = mats[m]->I * mats[m]->J;
+    for(idx_t x=0; x < nvals; ++x) {
+      norms += vals[x] * vals[x];
+    }
+  }
+  return sq_error + (reg * norms);
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+double tc_rmse(
+    splatt_csf const * const csf,
+    matrix_t ** mats,
+    idx_t const nthreads)
+{
+  val_t * preds = splatt_malloc(csf->nnz * sizeof(*preds));
+  double const err = p_sq_error(csf, mats, preds, nthreads);
+  splatt_free(preds);
+  return sqrt(err / (double) csf->nnz);
+}
+
+
+double tc_iterate(
+    splatt_csf const * const train,
+    splatt_csf const * const validate,
+    matrix_t ** mats,
+    splatt_tc_type const which,
+    double const * const opts)
+{
+  idx_t const nmodes = train->nmodes;
+  idx_t const nfactors = mats[0]->J;
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  double const tol = opts[SPLATT_OPTION_TOLERANCE];
+  val_t const reg = (val_t) opts[SPLATT_OPTION_REGULARIZE];
+  bool const verbose = opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE;
+
+  thd_info * thds = thd_init(nthreads, 4,
+      nfactors * nfactors * sizeof(val_t),
+      nfactors * nfactors * sizeof(val_t),
+      nfactors * sizeof(val_t),
+      nmodes * nfactors * sizeof(val_t));
+
+  idx_t const npreds = SS_MAX(train->nnz,
+      (validate != NULL) ? validate->nnz : 0);
+  val_t * preds = splatt_malloc(npreds * sizeof(*preds));
+
+  idx_t root_csf[MAX_NMODES];
+  p_find_root_csf(train, opts, root_csf);
+
+  /* algorithm-specific state */
+  val_t * resid[MAX_NMODES] = { NULL };
+  idx_t * * sgd_parts = NULL;
+  val_t rate = (val_t) opts[SPLATT_OPTION_LEARNRATE];
+  double prev_obj = 0;
+
+  switch(which) {
+  case SPLATT_TC_CCD:
+    for(idx_t m=0; m < nmodes; ++m) {
+      idx_t const c = root_csf[m];
+      resid[c] = splatt_malloc(train[c].nnz * sizeof(**resid));
+      kruskal_csf_values(train + c, mats, NULL, resid[c], nthreads);
+      val_t const * const restrict tvals = train[c].pt->vals;
+      for(idx_t x=0; x < train[c].nnz; ++x) {
+        resid[c][x] = tvals[x] - resid[c][x];
+      }
+    }
+    break;
+
+  case SPLATT_TC_SGD:
+    sgd_parts = splatt_malloc(train->ntiles * sizeof(*sgd_parts));
+    for(idx_t t=0; t < train->ntiles; ++t) {
+      idx_t bneck;
+      sgd_parts[t] = (train->pt[t].vals == NULL) ? NULL :
+          csf_partition_split_1d(train, t, nthreads, &bneck);
+    }
+    prev_obj = p_sgd_objective(p_sq_error(train, mats, preds, nthreads),
+        mats, nmodes, reg);
+    break;
+
+  default:
+    break;
+  }
+
+  /* best factors seen so far */
+  matrix_t * best[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    best[m] = mat_alloc(mats[m]->I, nfactors);
+    par_memcpy(best[m]->vals, mats[m]->vals,
+        mats[m]->I * nfactors * sizeof(val_t));
+  }
+  double best_rmse = INFINITY;
+  idx_t stale = 0;
+
+  sp_timer_t itertime;
+  timer_start(&timers[TIMER_TC]);
+
+  for(idx_t it=0; it < niters; ++it) {
+    timer_fstart(&itertime);
+
+    switch(which) {
+    case SPLATT_TC_ALS:
+      for(idx_t m=0; m < nmodes; ++m) {
+        p_tc_als_mode(train + root_csf[m], mats, m, reg, thds, nthreads);
+      }
+      break;
+    case SPLATT_TC_CCD:
+      p_tc_ccd_iter(train, root_csf, mats, reg, resid, nthreads);
+      break;
+    case SPLATT_TC_SGD:
+      p_tc_sgd_epoch(train, sgd_parts, mats, rate, reg, thds, nthreads);
+      break;
+    }
+
+    double const train_err = p_sq_error(train, mats, preds, nthreads);
+    double const train_rmse = sqrt(train_err / (double) train->nnz);
+    double rmse = train_rmse;
+    if(validate != NULL) {
+      rmse = sqrt(p_sq_error(validate, mats, preds, nthreads) /
+          (double) validate->nnz);
+    }
+
+    /* bold driver: grow the step while the objective improves */
+    if(which == SPLATT_TC_SGD) {
+      double const obj = p_sgd_objective(train_err, mats, nmodes, reg);
+      rate *= (obj < prev_obj) ? 1.05 : 0.5;
+      prev_obj = obj;
+    }
+    timer_stop(&itertime);
+
+    if(verbose) {
+      printf("  epoch = %3"SPLATT_PF_IDX" (%0.3fs)  train RMSE = %0.5f  "
+          "val RMSE = %0.5f\n", it+1, itertime.seconds, train_rmse, rmse);
+    }
+
+    if(!isfinite(rmse)) {
+      break;
+    }
+    /* snapshot first, so an improvement on the last epoch is kept */
+    bool const improved = (rmse < best_rmse - tol);
+    if(rmse < best_rmse) {
+      best_rmse = rmse;
+      for(idx_t m=0; m < nmodes; ++m) {
+        par_memcpy(best[m]->vals, mats[m]->vals,
+            mats[m]->I * nfactors * sizeof(val_t));
+      }
+    }
+    if(improved) {
+      stale = 0;
+    } else if(++stale == TC_PATIENCE) {
+      break;
+    }
+  }
+  timer_stop(&timers[TIMER_TC]);
+
+  /* return the best factors */
+  for(idx_t m=0; m < nmodes; ++m) {
+    par_memcpy(mats[m]->vals, best[m]->vals,
+        mats[m]->I * nfactors * sizeof(val_t));
+    mat_free(best[m]);
+  }
+
+  /* clean up */
+  for(idx_t m=0; m < nmodes; ++m) {
+    splatt_free(resid[m]);
+  }
+  if(sgd_parts != NULL) {
+    for(idx_t t=0; t < train->ntiles; ++t) {
+      splatt_free(sgd_parts[t]);
+    }
+    splatt_free(sgd_parts);
+  }
+  splatt_free(preds);
+  thd_free(thds, nthreads);
+
+  return best_rmse;
+}
+
+
+
+/******************************************************************************
+ * API FUNCTIONS
+ *****************************************************************************/
+
+int splatt_tc(
+    splatt_csf const * const train,
+    splatt_csf const * const validate,
+    splatt_idx_t const nfactors,
+    splatt_tc_type const which,
+    double const * const options,
+    splatt_kruskal * factored)
+{
+  idx_t const nmodes = train->nmodes;
+
+  /* ALS and CCD++ own whole rows, so they need an untiled tree per mode */
+  if(which != SPLATT_TC_SGD) {
+    idx_t root_csf[MAX_NMODES];
+    if(!p_find_root_csf(train, options, root_csf)) {
+      return SPLATT_ERROR_BADINPUT;
+    }
+    for(idx_t m=0; m < nmodes; ++m) {
+      if(train[root_csf[m]].ntiles != 1) {
+        return SPLATT_ERROR_BADINPUT;
+      }
+    }
+  }
+  if(validate != NULL) {
+    if(validate->nmodes != nmodes) {
+      return SPLATT_ERROR_BADINPUT;
+    }
+    for(idx_t m=0; m < nmodes; ++m) {
+      if(validate->dims[m] > train->dims[m]) {
+        return SPLATT_ERROR_BADINPUT;
+      }
+    }
+  }
+
+  /* scale the initial model to the average magnitude of the data */
+  double avg = 0;
+  for(idx_t t=0; t < train->ntiles; ++t) {
+    csf_sparsity const * const pt = train->pt + t;
+    if(pt->vals != NULL) {
+      for(idx_t x=0; x < pt->nfibs[nmodes-1]; ++x) {
+        avg += fabs(pt->vals[x]);
+      }
+    }
+  }
+  avg /= (double) SS_MAX(train->nnz, 1);
+  val_t const scale = 2. * pow(SS_MAX(avg, 1e-12) / (double) nfactors,
+      1. / (double) nmodes);
+
+  unsigned int seed = (unsigned int) options[SPLATT_OPTION_RANDSEED];
+  matrix_t * mats[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    mats[m] = mat_alloc(train->dims[m], nfactors);
+    idx_t const nvals = train->dims[m] * nfactors;
+    fill_rand_r(mats[m]->vals, nvals, &seed);
+    for(idx_t x=0; x < nvals; ++x) {
+      mats[m]->vals[x] = scale * fabs(mats[m]->vals[x]) / 3.;
+    }
+  }
+
+  factored->fit = tc_iterate(train, validate, mats, which, options);
+
+  /* store output */
+  factored->rank = nfactors;
+  factored->nmodes = nmodes;
+  factored->lambda = splatt_malloc(nfactors * sizeof(*factored->lambda));
+  for(idx_t f=0; f < nfactors; ++f) {
+    factored->lambda[f] = 1.;
+  }
+  for(idx_t m=0; m < nmodes; ++m) {
+    factored->dims[m] = train->dims[m];
+    factored->factors[m] = mats[m]->vals;
+    free(mats[m]); /* just the matrix_t ptr, data is safely in factored */
+  }
+  return SPLATT_SUCCESS;
+}
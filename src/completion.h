@@ -0,0 +1,73 @@
+#ifndef SPLATT_COMPLETION_H
+#define SPLATT_COMPLETION_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "matrix.h"
+#include "csf.h"
+
+
+
+/******************************************************************************
+ * DEFAULTS
+ *****************************************************************************/
+
+/* How many epochs without improvement before tensor completion stops. */
+static idx_t const TC_PATIENCE = 5;
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define tc_iterate splatt_tc_iterate
+/**
+* @brief The primary computation in tensor completion. API functions call
+*        this one. The loss is only taken over the stored nonzeros:
+*
+*          sum_{x in train} (x - model(x))^2 + reg * sum_m ||A_m||_F^2.
+*
+*        After each epoch the RMSE on 'validate' is measured, and the best
+*        factors so far are kept. The search stops after TC_PATIENCE epochs
+*        without an improvement of at least SPLATT_OPTION_TOLERANCE.
+*
+* @param train The training tensor. ALS and CCD++ need a CSF rooted at every
+*              mode (SPLATT_CSF_ALLMODE) and an untiled tensor. SGD only
+*              uses train[0], which may be tiled.
+* @param validate The held-out nonzeros (only validate[0] is used). If NULL,
+*                 the training RMSE is used for early stopping.
+* @param mats [OUT] The factors, initialized by the caller. Overwritten with
+*             the factors with the lowest validation RMSE.
+* @param which The algorithm to use.
+* @param opts SPLATT options array.
+*
+* @return The RMSE of the final factors on 'validate' (or 'train').
+*/
+double tc_iterate(
+    splatt_csf const * const train,
+    splatt_csf const * const validate,
+    matrix_t ** mats,
+    splatt_tc_type const which,
+    double const * const opts);
+
+
+#define tc_rmse splatt_tc_rmse
+/**
+* @brief Compute the root-mean-square error of a Kruskal model (with unit
+*        weights) over the nonzeros of a CSF tensor.
+*
+* @param csf The tensor to evaluate (only csf[0] is used).
+* @param mats The factors.
+* @param nthreads The number of threads to use.
+*
+* @return The RMSE.
+*/
+double tc_rmse(
+    splatt_csf const * const csf,
+    matrix_t ** mats,
+    idx_t const nthreads);
+
+#endif
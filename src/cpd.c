@@ -4,6 +4,8 @@
  * INCLUDES
  *****************************************************************************/
 #include "base.h"
+#include "admm.h"
+#include "affinity.h"
 #include "cpd.h"
 #include "matrix.h"
 #include "mttkrp.h"
@@ -15,6 +17,14 @@
 
 
 
+/******************************************************************************
+ * DEFINES
+ *****************************************************************************/
+/* with reduced-precision factors, check the fit at full precision this often */
+#define LOWP_FIT_EVERY 5
+
+
+
 /******************************************************************************
  * API FUNCTIONS
  *****************************************************************************/
@@ -24,26 +34,56 @@ int splatt_cpd_als(
     splatt_idx_t const nfactors,
     double const * const options,
     splatt_kruskal * factored)
+{
+  return splatt_cpd_constrained(tensors, nfactors, NULL, options, factored);
+}
+
+
+int splatt_cpd_constrained(
+    splatt_csf const * const tensors,
+    splatt_idx_t const nfactors,
+    splatt_cpd_constraint const * const constraints,
+    double const * const options,
+    splatt_kruskal * factored)
 {
   matrix_t * mats[MAX_NMODES+1];
 
   idx_t nmodes = tensors->nmodes;
 
+  if(constraints != NULL) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      if(constraints[m].type > SPLATT_CON_ROWSPARSE ||
+          constraints[m].param < 0.) {
+        return SPLATT_ERROR_BADINPUT;
+      }
+    }
+  }
+
   rank_info rinfo;
   rinfo.rank = 0;
 
-  /* allocate factor matrices */
+  /* allocate factor matrices. The seed is private to this call, so concurrent
+   * decompositions are reproducible. */
+  unsigned int seed = (unsigned int) options[SPLATT_OPTION_RANDSEED];
   idx_t maxdim = tensors->dims[argmax_elem(tensors->dims, nmodes)];
   for(idx_t m=0; m < nmodes; ++m) {
-    mats[m] = (matrix_t *) mat_rand(tensors[0].dims[m], nfactors);
+    mats[m] = mat_alloc(tensors[0].dims[m], nfactors);
+    fill_rand_r(mats[m]->vals, tensors[0].dims[m] * nfactors, &seed);
+
+    /* start constrained factors in the non-negative orthant */
+    if(constraints != NULL && constraints[m].type != SPLATT_CON_NONE) {
+      for(idx_t x=0; x < tensors[0].dims[m] * nfactors; ++x) {
+        mats[m]->vals[x] = fabs(mats[m]->vals[x]);
+      }
+    }
   }
   mats[MAX_NMODES] = mat_alloc(maxdim, nfactors);
 
   val_t * lambda = (val_t *) splatt_malloc(nfactors * sizeof(val_t));
 
   /* do the factorization! */
-  factored->fit = cpd_als_iterate(tensors, mats, lambda, nfactors, &rinfo,
-      options);
+  factored->fit = cpd_als_iterate(tensors, mats, lambda, nfactors,
+      constraints, &rinfo, options);
 
   /* store output */
   factored->rank = nfactors;
@@ -155,21 +195,20 @@ static val_t p_kruskal_norm(
 /**
 * @brief Compute the inner product of a Kruskal tensor and an unfactored
 *        tensor. Assumes that 'm1' contains the MTTKRP result along the last
-*        mode of the two input tensors. This naturally follows the end of a
-*        CPD iteration.
+*        mode updated. This naturally follows the end of a CPD iteration.
 *
-* @param nmodes The number of modes in the input tensors.
+* @param lastm The mode of the MTTKRP in 'm1'.
 * @param rinfo MPI rank information.
 * @param thds OpenMP thread data structures.
 * @param lambda The vector of column norms.
 * @param mats The Kruskal-tensor matrices.
-* @param m1 The result of doing MTTKRP along the last mode.
+* @param m1 The result of doing MTTKRP along mode 'lastm'.
 *
 * @return The inner product of the two tensors, computed via:
-*         1^T hadamard(mats[nmodes-1], m1) \lambda.
+*         1^T hadamard(mats[lastm], m1) \lambda.
 */
 static val_t p_tt_kruskal_inner(
-  idx_t const nmodes,
+  idx_t const lastm,
   rank_info * const rinfo,
   thd_info * const thds,
   val_t const * const restrict lambda,
@@ -177,7 +216,6 @@ static val_t p_tt_kruskal_inner(
   matrix_t const * const m1)
 {
   idx_t const rank = mats[0]->J;
-  idx_t const lastm = nmodes - 1;
   idx_t const dim = m1->I;
 
   val_t const * const m0 = mats[lastm]->vals;
@@ -228,11 +266,12 @@ static val_t p_tt_kruskal_inner(
 * @param ttnormsq The norm (squared) of the original input tensor, <X,X>.
 * @param lambda The vector of column norms.
 * @param mats The Kruskal-tensor matrices.
-* @param m1 The result of doing MTTKRP along the last mode.
+* @param lastm The mode of the MTTKRP in 'm1'.
+* @param m1 The result of doing MTTKRP along mode 'lastm'.
 * @param aTa An array of matrices (length MAX_NMODES)containing BtB, CtC, etc.
 *
 * @return The inner product of the two tensors, computed via:
-*         \lambda^T hadamard(mats[nmodes-1], m1) \lambda.
+*         \lambda^T hadamard(mats[lastm], m1) \lambda.
 */
 static val_t p_calc_fit(
   idx_t const nmodes,
@@ -241,6 +280,7 @@ static val_t p_calc_fit(
   val_t const ttnormsq,
   val_t const * const restrict lambda,
   matrix_t ** mats,
+  idx_t const lastm,
   matrix_t const * const m1,
   matrix_t ** aTa)
 {
@@ -250,7 +290,7 @@ static val_t p_calc_fit(
   val_t const norm_mats = p_kruskal_norm(nmodes, lambda, aTa);
 
   /* Compute inner product of tensor with new model */
-  val_t const inner = p_tt_kruskal_inner(nmodes, rinfo, thds, lambda, mats,m1);
+  val_t const inner = p_tt_kruskal_inner(lastm, rinfo, thds, lambda, mats,m1);
 
   /*
    * We actually want sqrt(<X,X> + <Y,Y> - 2<X,Y>), but if the fit is perfect
@@ -265,6 +305,274 @@ static val_t p_calc_fit(
 }
 
 
+/**
+* @brief Interleave the factor matrices over the NUMA nodes of the threads.
+*        Every thread reads rows of all factors during MTTKRP, so no single
+*        node is a good home for them. With maximum verbosity, the placement
+*        of the CSF tensors and factors is reported.
+*
+* @param tensors The CSF tensor(s).
+* @param num_csf The number of CSF tensors.
+* @param mats The factor matrices and MTTKRP output (mats[MAX_NMODES]).
+* @param opts SPLATT options.
+*/
+static void p_numa_place(
+  splatt_csf const * const tensors,
+  idx_t const num_csf,
+  matrix_t ** mats,
+  double const * const opts)
+{
+  idx_t const nmodes = tensors[0].nmodes;
+  int const nthreads = (int) opts[SPLATT_OPTION_NTHREADS];
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    mats[m]->vals = affinity_interleave(mats[m]->vals,
+        mats[m]->I * mats[m]->J * sizeof(*mats[m]->vals), nthreads);
+  }
+  matrix_t * const M = mats[MAX_NMODES];
+  M->vals = affinity_interleave(M->vals, M->I * M->J * sizeof(*M->vals),
+      nthreads);
+
+  if((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
+    size_t node_bytes[AFFINITY_MAX_NODES];
+    memset(node_bytes, 0, sizeof(node_bytes));
+    for(idx_t c=0; c < num_csf; ++c) {
+      csf_node_bytes(tensors + c, node_bytes);
+    }
+    affinity_print("CSF", node_bytes);
+
+    memset(node_bytes, 0, sizeof(node_bytes));
+    for(idx_t m=0; m < nmodes; ++m) {
+      affinity_node_bytes(mats[m]->vals,
+          mats[m]->I * mats[m]->J * sizeof(*mats[m]->vals), node_bytes);
+    }
+    affinity_print("FACTORS", node_bytes);
+  }
+}
+
+
+/**
+* @brief State of the line search which extrapolates the CPD-ALS factors
+*        along the direction of recent progress (Bro, 1998).
+*/
+typedef struct
+{
+  idx_t every;      /** extrapolate after every 'every' iterations */
+  double power;     /** the step is it^(1/power); grows after a failed step */
+
+  matrix_t * prev[MAX_NMODES];  /** factors at the end of the last iteration */
+  matrix_t * save[MAX_NMODES];  /** the ALS factors, in case of a rollback */
+  matrix_t * save_aTa[MAX_NMODES];
+  val_t * prev_lambda;
+  val_t * save_lambda;
+
+  idx_t attempts;   /** extrapolations tried */
+  idx_t accepted;   /** extrapolations which improved the fit */
+  double its_saved; /** how many ALS iterations the accepted steps are worth */
+  double seconds;   /** time spent extrapolating */
+} p_line_search;
+
+
+/**
+* @brief Allocate line search state if SPLATT_OPTION_LINESEARCH is set.
+*
+* @param mats The factor matrices.
+* @param nmodes The number of modes.
+* @param opts SPLATT options.
+*
+* @return The line search state, or NULL if line search is off.
+*/
+static p_line_search * p_ls_alloc(
+  matrix_t ** mats,
+  idx_t const nmodes,
+  double const * const opts)
+{
+  idx_t const every = (idx_t) opts[SPLATT_OPTION_LINESEARCH];
+  if(opts[SPLATT_OPTION_LINESEARCH] < 1.) {
+    return NULL;
+  }
+
+  idx_t const nfactors = mats[0]->J;
+  p_line_search * ls = splatt_malloc(sizeof(*ls));
+  ls->every = every;
+  ls->power = 3.;
+  for(idx_t m=0; m < nmodes; ++m) {
+    ls->prev[m] = mat_alloc(mats[m]->I, nfactors);
+    ls->save[m] = mat_alloc(mats[m]->I, nfactors);
+    ls->save_aTa[m] = mat_alloc(nfactors, nfactors);
+  }
+  ls->prev_lambda = splatt_malloc(nfactors * sizeof(*ls->prev_lambda));
+  ls->save_lambda = splatt_malloc(nfactors * sizeof(*ls->save_lambda));
+
+  ls->attempts = 0;
+  ls->accepted = 0;
+  ls->its_saved = 0.;
+  ls->seconds = 0.;
+  return ls;
+}
+
+
+static void p_ls_free(
+  p_line_search * ls,
+  idx_t const nmodes)
+{
+  for(idx_t m=0; m < nmodes; ++m) {
+    mat_free(ls->prev[m]);
+    mat_free(ls->save[m]);
+    mat_free(ls->save_aTa[m]);
+  }
+  splatt_free(ls->prev_lambda);
+  splatt_free(ls->save_lambda);
+  splatt_free(ls);
+}
+
+
+/**
+* @brief Remember the factors at the end of an iteration, which the next
+*        extrapolation starts from.
+*/
+static void p_ls_store(
+  p_line_search * const ls,
+  matrix_t ** mats,
+  val_t const * const lambda,
+  idx_t const nmodes)
+{
+  idx_t const nfactors = mats[0]->J;
+  for(idx_t m=0; m < nmodes; ++m) {
+    par_memcpy(ls->prev[m]->vals, mats[m]->vals,
+        mats[m]->I * nfactors * sizeof(val_t));
+  }
+  memcpy(ls->prev_lambda, lambda, nfactors * sizeof(*lambda));
+}
+
+
+/**
+* @brief Extrapolate the factors to prev + step * (mats - prev) and keep the
+*        result if it improves the fit. The fit costs one MTTKRP and the
+*        Gram-based norm of p_calc_fit(), instead of the nmodes MTTKRPs of an
+*        ALS iteration. A failed step restores the ALS iterate and makes
+*        later steps more conservative.
+*
+* @param ls The line search state.
+* @param it The (0-indexed) iteration which just finished.
+* @param fit The fit of the ALS iterate.
+* @param als_delta The fit improvement of the last ALS iteration, which
+*                  converts fit gains into iterations saved.
+*
+* @return The fit of the factors which are kept.
+*/
+static double p_ls_step(
+  p_line_search * const ls,
+  idx_t const it,
+  double const fit,
+  double const als_delta,
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  val_t * const lambda,
+  matrix_t ** aTa,
+  idx_t const lastm,
+  thd_info * const thds,
+  idx_t const nthreads,
+  splatt_mttkrp_ws * const mttkrp_ws,
+  val_t const ttnormsq,
+  rank_info * const rinfo,
+  double const * const opts)
+{
+  sp_timer_t lstime;
+  timer_fstart(&lstime);
+
+  idx_t const nmodes = tensors[0].nmodes;
+  idx_t const nfactors = mats[0]->J;
+  val_t const step = pow((double) (it+1), 1. / ls->power);
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    idx_t const nvals = mats[m]->I * nfactors;
+    val_t * const restrict cur = mats[m]->vals;
+    val_t const * const restrict prev = ls->prev[m]->vals;
+    par_memcpy(ls->save[m]->vals, cur, nvals * sizeof(val_t));
+    memcpy(ls->save_aTa[m]->vals, aTa[m]->vals,
+        nfactors * nfactors * sizeof(val_t));
+
+    #pragma omp parallel for schedule(static) num_threads(nthreads)
+    for(idx_t x=0; x < nvals; ++x) {
+      cur[x] = prev[x] + (step * (cur[x] - prev[x]));
+    }
+    mat_aTa(mats[m], aTa[m], rinfo, thds, nthreads);
+  }
+  memcpy(ls->save_lambda, lambda, nfactors * sizeof(*lambda));
+  for(idx_t f=0; f < nfactors; ++f) {
+    lambda[f] = ls->prev_lambda[f] + (step * (lambda[f]-ls->prev_lambda[f]));
+  }
+
+  /* <X,Z> needs a fresh MTTKRP, always at full precision */
+  splatt_precision_type const prec = mttkrp_ws->precision;
+  mttkrp_ws->precision = SPLATT_PREC_FULL;
+  timer_start(&timers[TIMER_MTTKRP]);
+  mttkrp_csf(tensors, mats, lastm, thds, mttkrp_ws, opts);
+  timer_stop(&timers[TIMER_MTTKRP]);
+  mttkrp_ws->precision = prec;
+
+  double newfit = p_calc_fit(nmodes, rinfo, thds, ttnormsq, lambda, mats,
+      lastm, mats[MAX_NMODES], aTa);
+
+  ++ls->attempts;
+  if(newfit > fit) {
+    ++ls->accepted;
+    if(als_delta > 0.) {
+      ls->its_saved += (newfit - fit) / als_delta;
+    }
+  } else {
+    for(idx_t m=0; m < nmodes; ++m) {
+      par_memcpy(mats[m]->vals, ls->save[m]->vals,
+          mats[m]->I * nfactors * sizeof(val_t));
+      memcpy(aTa[m]->vals, ls->save_aTa[m]->vals,
+          nfactors * nfactors * sizeof(val_t));
+    }
+    memcpy(lambda, ls->save_lambda, nfactors * sizeof(*lambda));
+    ls->power += 1.;
+    newfit = fit;
+  }
+
+  timer_stop(&lstime);
+  ls->seconds += lstime.seconds;
+
+  if(rinfo->rank == 0 &&
+      opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW) {
+    printf("     line search: step = %0.3f  fit = %0.5f  (%s, %0.3fs)\n",
+        step, newfit, (newfit > fit) ? "accepted" : "rejected",
+        lstime.seconds);
+  }
+
+  return newfit;
+}
+
+
+/**
+* @brief Rescale the scaled dual variable of an AO-ADMM mode after its factor
+*        was normalized, so it remains a warm start for the next update.
+*
+* @param dual The dual variable to rescale.
+* @param lambda The column norms which were divided out of the factor.
+*/
+static void p_scale_duals(
+    matrix_t * const dual,
+    val_t const * const lambda)
+{
+  idx_t const I = dual->I;
+  idx_t const J = dual->J;
+  val_t * const restrict vals = dual->vals;
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < I; ++i) {
+    for(idx_t j=0; j < J; ++j) {
+      if(lambda[j] > 0.) {
+        vals[j + (i*J)] /= lambda[j];
+      }
+    }
+  }
+}
+
+
 /******************************************************************************
  * PUBLIC FUNCTIONS
  *****************************************************************************/
@@ -273,12 +581,25 @@ double cpd_als_iterate(
   matrix_t ** mats,
   val_t * const lambda,
   idx_t const nfactors,
+  splatt_cpd_constraint const * const cons,
   rank_info * const rinfo,
   double const * const opts)
 {
   idx_t const nmodes = tensors[0].nmodes;
   idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
 
+  /* a NULL constraint list means plain least squares in every mode */
+  splatt_cpd_constraint con[MAX_NMODES];
+  bool constrained = false;
+  for(idx_t m=0; m < nmodes; ++m) {
+    con[m].type = SPLATT_CON_NONE;
+    con[m].param = 0.;
+    if(cons != NULL) {
+      con[m] = cons[m];
+      constrained |= (con[m].type != SPLATT_CON_NONE);
+    }
+  }
+
   /* Setup thread structures. + 64 bytes is to avoid false sharing.
    * TODO make this better */
   splatt_omp_set_num_threads(nthreads);
@@ -289,6 +610,14 @@ double cpd_als_iterate(
 
   matrix_t * m1 = mats[MAX_NMODES];
 
+  /* Constraints which fix the scale of a factor are only meaningful if the
+   * other factors are not arbitrarily scaled, so start from unit columns. */
+  if(constrained) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      mat_normalize(mats[m], lambda, MAT_NORM_2, rinfo, thds, nthreads);
+    }
+  }
+
   /* Initialize first A^T * A mats. We redundantly do the first because it
    * makes communication easier. */
   matrix_t * aTa[MAX_NMODES+1];
@@ -303,6 +632,27 @@ double cpd_als_iterate(
   /* mttkrp workspace */
   splatt_mttkrp_ws * mttkrp_ws = splatt_mttkrp_alloc_ws(tensors,nfactors,opts);
 
+  admm_ws * admm = NULL;
+  if(constrained) {
+    admm = admm_ws_alloc(mats, nmodes, con);
+  }
+
+  /* extrapolated factors may leave the feasible set of a constraint */
+  p_line_search * ls = constrained ? NULL : p_ls_alloc(mats, nmodes, opts);
+  double als_seconds = 0.;
+  idx_t als_its = 0;
+
+  if(opts[SPLATT_OPTION_NUMA]) {
+    p_numa_place(tensors, mttkrp_ws->num_csf, mats, opts);
+  }
+
+  /* Memoized MTTKRP reuses work only if we sweep the modes in CSF order. */
+  idx_t mode_order[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    mode_order[m] = (mttkrp_ws->memo_levels > 0) ?
+        csf_depth_to_mode(tensors, m) : m;
+  }
+
   /* Compute input tensor norm */
   double oldfit = 0;
   double fit = 0;
@@ -317,7 +667,8 @@ double cpd_als_iterate(
   idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
   for(idx_t it=0; it < niters; ++it) {
     timer_fstart(&itertime);
-    for(idx_t m=0; m < nmodes; ++m) {
+    for(idx_t i=0; i < nmodes; ++i) {
+      idx_t const m = mode_order[i];
       timer_fstart(&modetime[m]);
       mats[MAX_NMODES]->I = tensors[0].dims[m];
       m1->I = mats[m]->I;
@@ -334,16 +685,31 @@ double cpd_als_iterate(
       memset(mats[m]->vals, 0, mats[m]->I * nfactors * sizeof(val_t));
       mat_matmul(m1, aTa[MAX_NMODES], mats[m]);
 #else
-      par_memcpy(mats[m]->vals, m1->vals, m1->I * nfactors * sizeof(val_t));
-      mat_solve_normals(m, nmodes, aTa, mats[m],
-          opts[SPLATT_OPTION_REGULARIZE]);
+      if(con[m].type != SPLATT_CON_NONE) {
+        admm_inner(m, mats, aTa, m1, admm, opts[SPLATT_OPTION_REGULARIZE],
+            thds, nthreads);
+      } else {
+        par_memcpy(mats[m]->vals, m1->vals, m1->I * nfactors * sizeof(val_t));
+        mat_solve_normals(m, nmodes, aTa, mats[m],
+            opts[SPLATT_OPTION_REGULARIZE]);
+      }
 #endif
 
       /* normalize columns and extract lambda */
-      if(it == 0) {
-        mat_normalize(mats[m], lambda, MAT_NORM_2, rinfo, thds, nthreads);
+      if(!admm_scale_invariant(con[m].type)) {
+        /* the scale is part of the constraint, so it stays in the factor */
+        for(idx_t f=0; f < nfactors; ++f) {
+          lambda[f] = 1.;
+        }
       } else {
-        mat_normalize(mats[m], lambda, MAT_NORM_MAX, rinfo, thds,nthreads);
+        if(it == 0) {
+          mat_normalize(mats[m], lambda, MAT_NORM_2, rinfo, thds, nthreads);
+        } else {
+          mat_normalize(mats[m], lambda, MAT_NORM_MAX, rinfo, thds,nthreads);
+        }
+        if(con[m].type != SPLATT_CON_NONE) {
+          p_scale_duals(admm->duals[m], lambda);
+        }
       }
 
       /* update A^T*A */
@@ -351,8 +717,39 @@ double cpd_als_iterate(
       timer_stop(&modetime[m]);
     } /* foreach mode */
 
-    fit = p_calc_fit(nmodes, rinfo, thds, ttnormsq, lambda, mats, m1, aTa);
+    fit = p_calc_fit(nmodes, rinfo, thds, ttnormsq, lambda, mats,
+        mode_order[nmodes-1], m1, aTa);
+
+    /*
+     * The fit cancels <X,X> against 2<X,Z>, which amplifies any error in a
+     * reduced-precision MTTKRP. Redoing the last one at full precision costs
+     * an extra full-bandwidth traversal (1/nmodes of an iteration), so only
+     * do it every LOWP_FIT_EVERY iterations, on the last one, before a line
+     * search step (which compares against an exact fit), and whenever the
+     * cheap fit looks converged. Only an exact fit may stop the solver.
+     */
+    bool const ls_now = (ls != NULL && it > 1 && (it % ls->every) == 0);
+    bool exact_fit = true;
+    if(mttkrp_ws->precision != SPLATT_PREC_FULL) {
+      bool const near = (fit == 1.) ||
+          (it > 0 && fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE]);
+      exact_fit = near || ls_now || ((it+1) % LOWP_FIT_EVERY == 0) ||
+          (it+1 == niters);
+    }
+    if(exact_fit && mttkrp_ws->precision != SPLATT_PREC_FULL) {
+      splatt_precision_type const prec = mttkrp_ws->precision;
+      mttkrp_ws->precision = SPLATT_PREC_FULL;
+      timer_start(&timers[TIMER_MTTKRP]);
+      mttkrp_csf(tensors, mats, mode_order[nmodes-1], thds, mttkrp_ws, opts);
+      timer_stop(&timers[TIMER_MTTKRP]);
+      mttkrp_ws->precision = prec;
+
+      fit = p_calc_fit(nmodes, rinfo, thds, ttnormsq, lambda, mats,
+          mode_order[nmodes-1], m1, aTa);
+    }
     timer_stop(&itertime);
+    als_seconds += itertime.seconds;
+    ++als_its;
 
     if(rinfo->rank == 0 &&
         opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
@@ -365,17 +762,44 @@ double cpd_als_iterate(
         }
       }
     }
-    if(fit == 1. || 
-        (it > 0 && fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE])) {
+
+    /* extrapolate from the previous iterate. The first iteration used a
+     * different normalization, so it is not a useful direction. */
+    if(ls_now) {
+      fit = p_ls_step(ls, it, fit, fit - oldfit, tensors, mats, lambda, aTa,
+          mode_order[nmodes-1], thds, nthreads, mttkrp_ws, ttnormsq, rinfo,
+          opts);
+    }
+
+    if(exact_fit && (fit == 1. ||
+        (it > 0 && fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE]))) {
       break;
     }
     oldfit = fit;
+    if(ls != NULL) {
+      p_ls_store(ls, mats, lambda, nmodes);
+    }
   }
   timer_stop(&timers[TIMER_CPD]);
 
-  cpd_post_process(nfactors, nmodes, mats, lambda, thds, nthreads, rinfo);
+  if(ls != NULL) {
+    if(rinfo->rank == 0 &&
+        opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      double const per_it = als_seconds / (double) als_its;
+      printf("  line search: %"SPLATT_PF_IDX"/%"SPLATT_PF_IDX" steps "
+          "accepted, ~%0.1f iterations saved (~%0.3fs saved, net)\n",
+          ls->accepted, ls->attempts, ls->its_saved,
+          (ls->its_saved * per_it) - ls->seconds);
+    }
+    p_ls_free(ls, nmodes);
+  }
+
+  cpd_post_process(nfactors, nmodes, mats, lambda, con, thds, nthreads, rinfo);
 
   /* CLEAN UP */
+  if(admm != NULL) {
+    admm_ws_free(admm);
+  }
   splatt_mttkrp_free_ws(mttkrp_ws);
   for(idx_t m=0; m < nmodes; ++m) {
     mat_free(aTa[m]);
@@ -393,6 +817,7 @@ void cpd_post_process(
   idx_t const nmodes,
   matrix_t ** mats,
   val_t * const lambda,
+  splatt_cpd_constraint const * const cons,
   thd_info * const thds,
   idx_t const nthreads,
   rank_info * const rinfo)
@@ -401,6 +826,9 @@ void cpd_post_process(
 
   /* normalize each matrix and adjust lambda */
   for(idx_t m=0; m < nmodes; ++m) {
+    if(cons != NULL && !admm_scale_invariant(cons[m].type)) {
+      continue;
+    }
     mat_normalize(mats[m], tmp, MAT_NORM_2, rinfo, thds, nthreads);
     for(idx_t f=0; f < nfactors; ++f) {
       lambda[f] *= tmp[f];
@@ -24,6 +24,8 @@
 * @param mats [OUT] The output factors.
 * @param lambda [OUT] The output vector for scaling.
 * @param nfactors The rank of the factorization.
+* @param cons The constraint of each mode, updated with AO-ADMM. NULL means
+*             every mode is unconstrained.
 * @param rinfo MPI rank information (not used, TODO remove).
 * @param opts SPLATT options array.
 *
@@ -34,6 +36,7 @@ double cpd_als_iterate(
   matrix_t ** mats,
   val_t * const lambda,
   idx_t const nfactors,
+  splatt_cpd_constraint const * const cons,
   rank_info * const rinfo,
   double const * const opts);
 
@@ -49,6 +52,9 @@ double cpd_als_iterate(
 * @param nmodes The number of modes of the tensor.
 * @param mats [OUT] The output factors.
 * @param lambda [OUT] The output vector for scaling.
+* @param cons The constraint of each mode, or NULL. Modes whose constraint
+*             fixes their scale (see admm_scale_invariant()) are not
+*             normalized.
 * @param thds Thread buffers.
 * @param nthreads The number of threads to use.
 * @param rinfo MPI rank information (not used, TODO remove).
@@ -58,6 +64,7 @@ void cpd_post_process(
   idx_t const nmodes,
   matrix_t ** mats,
   val_t * const lambda,
+  splatt_cpd_constraint const * const cons,
   thd_info * const thds,
   idx_t const nthreads,
   rank_info * const rinfo);
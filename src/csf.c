@@ -7,6 +7,7 @@
 #include "tile.h"
 #include "util.h"
 #include "thread_partition.h"
+#include "affinity.h"
 
 #include "io.h"
 
@@ -71,19 +72,22 @@ void splatt_free_csf(
 /**
 * @brief Count the nonzeros below a given node in a CSF tensor.
 *
-* @param fptr The adjacency pointer of the CSF tensor.
-* @param nmodes The number of modes in the tensor.
+* @param csf The CSF tensor.
+* @param tile_id The tile containing the node.
 * @param depth The depth of the node
 * @param fiber The id of the node.
 *
 * @return The nonzeros below fptr[depth][fiber].
 */
 idx_t p_csf_count_nnz(
-    idx_t * * fptr,
-    idx_t const nmodes,
+    splatt_csf const * const csf,
+    idx_t const tile_id,
     idx_t depth,
     idx_t const fiber)
 {
+  idx_t const nmodes = csf->nmodes;
+  idx_t * const * const fptr = csf->pt[tile_id].fptr;
+
   if(depth == nmodes-1) {
     return 1;
   }
@@ -101,6 +105,30 @@ idx_t p_csf_count_nnz(
 }
 
 
+/**
+* @brief Compute the heaviest part of a 1D partitioning.
+*
+* @param prefix The inclusive prefix sum of the item weights.
+* @param parts The partitioning, of length (nparts+1).
+* @param nparts The number of parts.
+*
+* @return The total weight of the heaviest part.
+*/
+static idx_t p_partition_bneck(
+    idx_t const * const prefix,
+    idx_t const * const parts,
+    idx_t const nparts)
+{
+  idx_t bneck = 0;
+  for(idx_t p=0; p < nparts; ++p) {
+    idx_t const left  = (parts[p] > 0)   ? prefix[parts[p]-1]   : 0;
+    idx_t const right = (parts[p+1] > 0) ? prefix[parts[p+1]-1] : 0;
+    bneck = SS_MAX(bneck, right - left);
+  }
+  return bneck;
+}
+
+
 /**
 * @brief Find a permutation of modes that results in non-increasing mode size.
 *
@@ -601,6 +629,164 @@ static void p_fill_dim_iperm(
 }
 
 
+/**
+* @brief Move an array to freshly allocated memory which is first touched by
+*        the thread that will later work on it. Thread t copies elements
+*        [bounds[t], bounds[t+1]) and the last thread also copies 'extra'
+*        trailing elements.
+*
+* @param arr The array to move. It is freed.
+* @param elem_size The size of each element.
+* @param bounds The thread boundaries, of length (nthreads+1).
+* @param extra Elements past bounds[nthreads] (e.g., the end of an fptr).
+* @param nthreads The number of threads.
+*
+* @return The new array.
+*/
+static void * p_first_touch_array(
+    void * arr,
+    size_t const elem_size,
+    idx_t const * const bounds,
+    idx_t const extra,
+    int const nthreads)
+{
+  if(arr == NULL) {
+    return NULL;
+  }
+
+  char * const dst = splatt_malloc((bounds[nthreads] + extra) * elem_size);
+  char const * const src = arr;
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    idx_t const start = bounds[tid];
+    idx_t const end = bounds[tid+1] + ((tid == nthreads-1) ? extra : 0);
+    memcpy(dst + (start * elem_size), src + (start * elem_size),
+        (end - start) * elem_size);
+  }
+
+  splatt_free(arr);
+  return dst;
+}
+
+
+/**
+* @brief Copy an array into memory first touched by the calling thread.
+*
+* @param arr The array to move. It is freed.
+* @param bytes The size of the array.
+*
+* @return The new array.
+*/
+static void * p_first_touch_local(
+    void * arr,
+    size_t const bytes)
+{
+  if(arr == NULL) {
+    return NULL;
+  }
+  void * dst = splatt_malloc(bytes);
+  memcpy(dst, arr, bytes);
+  splatt_free(arr);
+  return dst;
+}
+
+
+/**
+* @brief Place an untiled CSF tensor according to the partitioning which
+*        MTTKRP uses, csf_partition_split_1d(). Thread t's subtrees are
+*        found level by level, starting from its range of level-1 nodes.
+*
+* @param csf The tensor to place.
+* @param nthreads The number of threads.
+*/
+static void p_first_touch_untiled(
+    splatt_csf * const csf,
+    int const nthreads)
+{
+  idx_t const nmodes = csf->nmodes;
+  csf_sparsity * const pt = csf->pt;
+
+  idx_t bneck;
+  idx_t * parts = csf_partition_split_1d(csf, 0, nthreads, &bneck);
+
+  idx_t * bounds[MAX_NMODES];
+  for(idx_t d=0; d < nmodes; ++d) {
+    bounds[d] = splatt_malloc((nthreads+1) * sizeof(**bounds));
+  }
+
+  /* a split slice is placed with the thread that starts it */
+  for(int t=0; t < nthreads; ++t) {
+    idx_t s = 0;
+    while(s < pt->nfibs[0] && pt->fptr[0][s] < parts[t]) {
+      ++s;
+    }
+    bounds[0][t] = s;
+    bounds[1][t] = parts[t];
+  }
+  bounds[0][nthreads] = pt->nfibs[0];
+  bounds[1][nthreads] = pt->nfibs[1];
+  for(idx_t d=1; d < nmodes-1; ++d) {
+    for(int t=0; t <= nthreads; ++t) {
+      bounds[d+1][t] = pt->fptr[d][bounds[d][t]];
+    }
+  }
+  splatt_free(parts);
+
+  for(idx_t d=0; d < nmodes-1; ++d) {
+    pt->fptr[d] = p_first_touch_array(pt->fptr[d], sizeof(**pt->fptr),
+        bounds[d], 1, nthreads);
+    pt->fids[d] = p_first_touch_array(pt->fids[d], sizeof(**pt->fids),
+        bounds[d], 0, nthreads);
+  }
+  pt->fids[nmodes-1] = p_first_touch_array(pt->fids[nmodes-1],
+      sizeof(**pt->fids), bounds[nmodes-1], 0, nthreads);
+  pt->vals = p_first_touch_array(pt->vals, sizeof(*pt->vals),
+      bounds[nmodes-1], 0, nthreads);
+
+  for(idx_t d=0; d < nmodes; ++d) {
+    splatt_free(bounds[d]);
+  }
+}
+
+
+/**
+* @brief Place a tiled CSF tensor. Each tile is moved to the thread which
+*        csf_partition_tiles_1d() assigns it to.
+*
+* @param csf The tensor to place.
+* @param nthreads The number of threads.
+*/
+static void p_first_touch_tiled(
+    splatt_csf * const csf,
+    int const nthreads)
+{
+  idx_t const nmodes = csf->nmodes;
+  idx_t * parts = csf_partition_tiles_1d(csf, nthreads);
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    for(idx_t t=parts[tid]; t < parts[tid+1]; ++t) {
+      csf_sparsity * const pt = csf->pt + t;
+      for(idx_t d=0; d < nmodes-1; ++d) {
+        pt->fptr[d] = p_first_touch_local(pt->fptr[d],
+            (pt->nfibs[d] + 1) * sizeof(**pt->fptr));
+        pt->fids[d] = p_first_touch_local(pt->fids[d],
+            pt->nfibs[d] * sizeof(**pt->fids));
+      }
+      pt->fids[nmodes-1] = p_first_touch_local(pt->fids[nmodes-1],
+          pt->nfibs[nmodes-1] * sizeof(**pt->fids));
+      pt->vals = p_first_touch_local(pt->vals,
+          pt->nfibs[nmodes-1] * sizeof(*pt->vals));
+    }
+  } /* end omp parallel */
+
+  splatt_free(parts);
+}
+
+
 /**
 * @brief Allocate and fill a CSF tensor.
 *
@@ -641,6 +827,12 @@ static void p_mk_csf(
         ct->which_tile);
     break;
   }
+
+  if(splatt_opts[SPLATT_OPTION_NUMA]) {
+    int const nthreads = (int) splatt_opts[SPLATT_OPTION_NTHREADS];
+    affinity_pin_threads(nthreads);
+    csf_first_touch(ct, nthreads);
+  }
 }
 
 /******************************************************************************
@@ -861,7 +1053,7 @@ idx_t * csf_partition_1d(
 
   #pragma omp parallel for schedule(static)
   for(idx_t i=0; i < nslices; ++i) {
-    weights[i] = p_csf_count_nnz(csf->pt[tile_id].fptr, csf->nmodes, 0, i);
+    weights[i] = p_csf_count_nnz(csf, tile_id, 0, i);
   }
 
   idx_t bneck;
@@ -872,6 +1064,70 @@ idx_t * csf_partition_1d(
 }
 
 
+idx_t * csf_partition_split_1d(
+    splatt_csf const * const csf,
+    idx_t const tile_id,
+    idx_t const nparts,
+    idx_t * const bottleneck)
+{
+  csf_sparsity const * const pt = &(csf->pt[tile_id]);
+  idx_t const nmodes = csf->nmodes;
+  idx_t const nslices = pt->nfibs[0];
+  idx_t const nnz = pt->nfibs[nmodes-1];
+
+  /* first try to balance whole slices */
+  idx_t * weights = splatt_malloc(nslices * sizeof(*weights));
+  idx_t heaviest = 0;
+  #pragma omp parallel for schedule(static) reduction(max:heaviest)
+  for(idx_t i=0; i < nslices; ++i) {
+    weights[i] = p_csf_count_nnz(csf, tile_id, 0, i);
+    heaviest = SS_MAX(heaviest, weights[i]);
+  }
+
+  idx_t slice_bneck;
+  idx_t * slice_parts = partition_weighted(weights, nslices, nparts,
+      &slice_bneck);
+  slice_bneck = p_partition_bneck(weights, slice_parts, nparts);
+  splatt_free(weights);
+
+  /*
+   * A slice with more than a fair share of the nonzeros will be the
+   * bottleneck no matter how the other slices are distributed. Try again
+   * with the nodes one level down, which allows slices to be split.
+   */
+  if(heaviest * nparts > nnz) {
+    idx_t const nfibs = pt->nfibs[1];
+    idx_t * fweights = splatt_malloc(nfibs * sizeof(*fweights));
+    #pragma omp parallel for schedule(static)
+    for(idx_t i=0; i < nfibs; ++i) {
+      fweights[i] = p_csf_count_nnz(csf, tile_id, 1, i);
+    }
+
+    idx_t fib_bneck;
+    idx_t * fib_parts = partition_weighted(fweights, nfibs, nparts, &fib_bneck);
+    fib_bneck = p_partition_bneck(fweights, fib_parts, nparts);
+    splatt_free(fweights);
+
+    if(fib_bneck < slice_bneck) {
+      splatt_free(slice_parts);
+      *bottleneck = fib_bneck;
+      return fib_parts;
+    }
+    splatt_free(fib_parts);
+  }
+
+  /* no splitting, just convert slice boundaries to fiber boundaries */
+  idx_t * parts = splatt_malloc((nparts+1) * sizeof(*parts));
+  for(idx_t p=0; p <= nparts; ++p) {
+    parts[p] = pt->fptr[0][slice_parts[p]];
+  }
+  splatt_free(slice_parts);
+
+  *bottleneck = slice_bneck;
+  return parts;
+}
+
+
 idx_t * csf_partition_tiles_1d(
     splatt_csf const * const csf,
     idx_t const nparts)
@@ -893,4 +1149,97 @@ idx_t * csf_partition_tiles_1d(
 }
 
 
+void csf_first_touch(
+    splatt_csf * const csf,
+    int const nthreads)
+{
+  if(nthreads < 1 || csf->nnz == 0) {
+    return;
+  }
+  if(csf->ntiles > 1) {
+    p_first_touch_tiled(csf, nthreads);
+  } else {
+    p_first_touch_untiled(csf, nthreads);
+  }
+}
+
+
+void csf_node_bytes(
+    splatt_csf const * const csf,
+    size_t * const node_bytes)
+{
+  idx_t const nmodes = csf->nmodes;
+  for(idx_t t=0; t < csf->ntiles; ++t) {
+    csf_sparsity const * const pt = csf->pt + t;
+    for(idx_t d=0; d < nmodes-1; ++d) {
+      if(pt->fptr[d] != NULL) {
+        affinity_node_bytes(pt->fptr[d],
+            (pt->nfibs[d] + 1) * sizeof(**pt->fptr), node_bytes);
+      }
+      affinity_node_bytes(pt->fids[d], pt->nfibs[d] * sizeof(**pt->fids),
+          node_bytes);
+    }
+    affinity_node_bytes(pt->fids[nmodes-1],
+        pt->nfibs[nmodes-1] * sizeof(**pt->fids), node_bytes);
+    affinity_node_bytes(pt->vals, pt->nfibs[nmodes-1] * sizeof(*pt->vals),
+        node_bytes);
+  }
+}
+
+
+sptensor_t * csf_to_coord(
+    splatt_csf const * const csf)
+{
+  idx_t const nmodes = csf->nmodes;
+  sptensor_t * tt = tt_alloc(csf->nnz, nmodes);
+  for(idx_t m=0; m < nmodes; ++m) {
+    tt->dims[m] = csf->dims[m];
+  }
+
+  idx_t offset = 0;
+  for(idx_t t=0; t < csf->ntiles; ++t) {
+    csf_sparsity const * const pt = csf->pt + t;
+    if(pt->vals == NULL) {
+      continue;
+    }
+    idx_t const nnz = pt->nfibs[nmodes-1];
+
+    /* lptr[n] is the first leaf below node n of the current level */
+    idx_t * lptr = splatt_malloc((nnz + 1) * sizeof(*lptr));
+    for(idx_t x=0; x <= nnz; ++x) {
+      lptr[x] = x;
+    }
+
+    for(idx_t d=nmodes; d-- > 0; ) {
+      idx_t const nfibs = pt->nfibs[d];
+      idx_t const * const restrict fids = pt->fids[d];
+      idx_t * const restrict ind = tt->ind[csf_depth_to_mode(csf, d)] + offset;
 
+      #pragma omp parallel for schedule(dynamic, 16)
+      for(idx_t n=0; n < nfibs; ++n) {
+        idx_t const id = (fids == NULL) ? n : fids[n];
+        for(idx_t x=lptr[n]; x < lptr[n+1]; ++x) {
+          ind[x] = id;
+        }
+      }
+
+      /* move up a level */
+      if(d > 0) {
+        idx_t const * const restrict fp = pt->fptr[d-1];
+        idx_t const nparents = pt->nfibs[d-1];
+        idx_t * parent = splatt_malloc((nparents + 1) * sizeof(*parent));
+        for(idx_t n=0; n <= nparents; ++n) {
+          parent[n] = lptr[fp[n]];
+        }
+        splatt_free(lptr);
+        lptr = parent;
+      }
+    }
+    splatt_free(lptr);
+
+    par_memcpy(tt->vals + offset, pt->vals, nnz * sizeof(*pt->vals));
+    offset += nnz;
+  }
+
+  return tt;
+}
@@ -182,6 +182,86 @@ static inline idx_t csf_depth_to_mode(
 
 
 
+#define csf_find_slice splatt_csf_find_slice
+/**
+* @brief Binary search for the slice which holds a fiber.
+*
+* @param sptr The slice pointer (fptr[0]) of a CSF tile.
+* @param nslices The number of slices in the tile.
+* @param fiber The fiber to look for.
+*
+* @return The slice 's' with sptr[s] <= fiber < sptr[s+1].
+*/
+static inline idx_t csf_find_slice(
+    idx_t const * const restrict sptr,
+    idx_t const nslices,
+    idx_t const fiber)
+{
+  idx_t lo = 0;
+  idx_t hi = nslices;
+  while(hi - lo > 1) {
+    idx_t const mid = lo + ((hi - lo) / 2);
+    if(sptr[mid] <= fiber) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+
+#define csf_thread_range splatt_csf_thread_range
+/**
+* @brief Find the part of a CSF tree processed by a thread. The
+*        partition may split a slice across threads, so the thread processes
+*        slices [slice_start, slice_stop) but only the fibers within
+*        [fib_start, fib_stop). Outputs that depend on a split slice (e.g., its
+*        row in a root-mode MTTKRP) are partial and must be merged with a
+*        synchronized update.
+*
+* @param pt The sparsity pattern of the tile being processed.
+* @param partition The fiber partitioning (see csf_partition_split_1d()), or
+*                  NULL.
+* @param tid The thread ID.
+* @param[out] slice_start The first slice to process.
+* @param[out] slice_stop One past the last slice to process.
+* @param[out] fib_start The first fiber to process.
+* @param[out] fib_stop One past the last fiber to process.
+*/
+static inline void csf_thread_range(
+    csf_sparsity const * const pt,
+    idx_t const * const partition,
+    idx_t const tid,
+    idx_t * const slice_start,
+    idx_t * const slice_stop,
+    idx_t * const fib_start,
+    idx_t * const fib_stop)
+{
+  idx_t const nslices = pt->nfibs[0];
+  if(partition == NULL) {
+    *slice_start = 0;
+    *slice_stop = nslices;
+    *fib_start = 0;
+    *fib_stop = pt->nfibs[1];
+    return;
+  }
+
+  *fib_start = partition[tid];
+  *fib_stop  = partition[tid+1];
+  if(*fib_start == *fib_stop) {
+    *slice_start = 0;
+    *slice_stop = 0;
+    return;
+  }
+
+  /* the slices which hold the first and last fibers */
+  *slice_start = csf_find_slice(pt->fptr[0], nslices, *fib_start);
+  *slice_stop  = csf_find_slice(pt->fptr[0], nslices, *fib_stop - 1) + 1;
+}
+
+
+
 #define csf_partition_1d splatt_csf_partition_1d
 /**
 * @brief Split the root nodes of a CSF tensor into 'nparts' partitions.
@@ -197,6 +277,29 @@ idx_t * csf_partition_1d(
     idx_t const nparts);
 
 
+#define csf_partition_split_1d splatt_csf_partition_split_1d
+/**
+* @brief Split a CSF tree into 'nparts' partitions at the granularity of the
+*        nodes one level below the root (i.e., fibers in a third-order tensor).
+*        Whole slices are balanced first. If a single slice holds more than
+*        nnz/nparts nonzeros, slices may instead be split across partitions
+*        when that lowers the bottleneck.
+*
+* @param csf The CSF tensor to partition.
+* @param tile_id The tile to partition.
+* @param nparts The number of partitions.
+* @param[out] bottleneck The number of nonzeros in the heaviest partition.
+*
+* @return An array of length (nparts+1) specifying the first level-1 node of
+*         each part.
+*/
+idx_t * csf_partition_split_1d(
+    splatt_csf const * const csf,
+    idx_t const tile_id,
+    idx_t const nparts,
+    idx_t * const bottleneck);
+
+
 #define csf_partition_tiles_1d splatt_csf_partition_tiles_1d
 /**
 * @brief Split the tiles of csf into 'nparts' partitions.
@@ -231,5 +334,46 @@ idx_t csf_count_nnz(
     idx_t const fiber);
 
 
+#define csf_first_touch splatt_csf_first_touch
+/**
+* @brief Re-allocate the arrays of a CSF tensor so that each thread is the
+*        first to touch the part it processes during MTTKRP. Under a
+*        first-touch policy this places each part on the NUMA node of its
+*        thread. The tensor's contents are unchanged.
+*
+* @param csf The tensor to place.
+* @param nthreads The number of threads which will process the tensor.
+*/
+void csf_first_touch(
+    splatt_csf * const csf,
+    int const nthreads);
+
+
+#define csf_node_bytes splatt_csf_node_bytes
+/**
+* @brief Add the bytes of a CSF tensor which reside on each NUMA node to
+*        'node_bytes'.
+*
+* @param csf The tensor.
+* @param[out] node_bytes Bytes per node, of length AFFINITY_MAX_NODES.
+*/
+void csf_node_bytes(
+    splatt_csf const * const csf,
+    size_t * const node_bytes);
+
+
+#define csf_to_coord splatt_csf_to_coord
+/**
+* @brief Expand a CSF tensor back into coordinate form. Nonzeros appear in the
+*        order of the leaves, tile after tile.
+*
+* @param csf The tensor to expand (only csf[0] is used).
+*
+* @return The coordinate tensor. Free with tt_free().
+*/
+sptensor_t * csf_to_coord(
+    splatt_csf const * const csf);
+
+
 
 #endif
@@ -0,0 +1,286 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "hicoo.h"
+#include "thread_partition.h"
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Stable counting sort of 'perm' by key(perm[x]) = keys[perm[x]] >>
+*        shift.
+*
+* @param perm The permutation to reorder.
+* @param n The length of perm.
+* @param keys The keys to sort by.
+* @param shift How far to shift each key.
+* @param nkeys One more than the largest shifted key.
+* @param buf Scratch of length n.
+*/
+static void p_counting_sort(
+    idx_t * const perm,
+    idx_t const n,
+    idx_t const * const keys,
+    idx_t const shift,
+    idx_t const nkeys,
+    idx_t * const buf)
+{
+  idx_t * counts = splatt_malloc((nkeys + 1) * sizeof(*counts));
+  memset(counts, 0, (nkeys + 1) * sizeof(*counts));
+  for(idx_t x=0; x < n; ++x) {
+    ++counts[(keys[perm[x]] >> shift) + 1];
+  }
+  for(idx_t k=0; k < nkeys; ++k) {
+    counts[k+1] += counts[k];
+  }
+  for(idx_t x=0; x < n; ++x) {
+    buf[counts[keys[perm[x]] >> shift]++] = perm[x];
+  }
+  memcpy(perm, buf, n * sizeof(*perm));
+  splatt_free(counts);
+}
+
+
+/**
+* @brief Build the per-mode block schedules of a HiCOO tensor.
+*
+* @param hc The tensor, whose blocks are already filled.
+*/
+static void p_hicoo_schedule(
+    hicoo_t * const hc)
+{
+  idx_t const nblocks = hc->nblocks;
+  idx_t * buf = splatt_malloc(nblocks * sizeof(*buf));
+
+  for(idx_t m=0; m < hc->nmodes; ++m) {
+    idx_t const nbrows = (hc->dims[m] >> hc->bits) + 1;
+    hc->nbrows[m] = nbrows;
+
+    idx_t * sched = splatt_malloc(nblocks * sizeof(*sched));
+    for(idx_t b=0; b < nblocks; ++b) {
+      sched[b] = b;
+    }
+    p_counting_sort(sched, nblocks, hc->binds[m], 0, nbrows, buf);
+
+    idx_t * ptr = splatt_malloc((nbrows + 1) * sizeof(*ptr));
+    idx_t * brow_nnz = splatt_malloc(nbrows * sizeof(*brow_nnz));
+    memset(ptr, 0, (nbrows + 1) * sizeof(*ptr));
+    memset(brow_nnz, 0, nbrows * sizeof(*brow_nnz));
+    for(idx_t b=0; b < nblocks; ++b) {
+      idx_t const r = hc->binds[m][b];
+      ++ptr[r+1];
+      brow_nnz[r] += hc->bptr[b+1] - hc->bptr[b];
+    }
+    for(idx_t r=0; r < nbrows; ++r) {
+      ptr[r+1] += ptr[r];
+    }
+
+    hc->sched[m] = sched;
+    hc->sched_ptr[m] = ptr;
+    hc->brow_nnz[m] = brow_nnz;
+  }
+
+  splatt_free(buf);
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+hicoo_t * hicoo_alloc(
+    sptensor_t const * const tt,
+    idx_t const bits)
+{
+  assert(bits >= 1 && bits <= HICOO_MAX_BITS);
+
+  idx_t const nmodes = tt->nmodes;
+  idx_t const nnz = tt->nnz;
+
+  hicoo_t * hc = splatt_malloc(sizeof(*hc));
+  hc->nmodes = nmodes;
+  hc->nnz = nnz;
+  hc->bits = bits;
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    hc->dims[m] = (m < nmodes) ? tt->dims[m] : 0;
+    hc->binds[m] = NULL;
+    hc->einds[m] = NULL;
+    hc->sched[m] = NULL;
+    hc->sched_ptr[m] = NULL;
+    hc->brow_nnz[m] = NULL;
+    hc->nbrows[m] = 0;
+  }
+
+  /* order nonzeros by block coordinates (LSD radix sort over the modes) */
+  idx_t * perm = splatt_malloc(nnz * sizeof(*perm));
+  idx_t * buf = splatt_malloc(nnz * sizeof(*buf));
+  for(idx_t n=0; n < nnz; ++n) {
+    perm[n] = n;
+  }
+  for(idx_t m=nmodes; m-- > 0; ) {
+    p_counting_sort(perm, nnz, tt->ind[m], bits,
+        (tt->dims[m] >> bits) + 1, buf);
+  }
+  splatt_free(buf);
+
+  /* count blocks */
+  idx_t nblocks = (nnz > 0) ? 1 : 0;
+  for(idx_t x=1; x < nnz; ++x) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      if((tt->ind[m][perm[x]] >> bits) != (tt->ind[m][perm[x-1]] >> bits)) {
+        ++nblocks;
+        break;
+      }
+    }
+  }
+  hc->nblocks = nblocks;
+
+  /* fill */
+  idx_t const mask = (1 << bits) - 1;
+  hc->bptr = splatt_malloc((nblocks + 1) * sizeof(*hc->bptr));
+  hc->vals = splatt_malloc(nnz * sizeof(*hc->vals));
+  for(idx_t m=0; m < nmodes; ++m) {
+    hc->binds[m] = splatt_malloc(nblocks * sizeof(**hc->binds));
+    hc->einds[m] = splatt_malloc(nnz * sizeof(**hc->einds));
+  }
+
+  idx_t b = 0;
+  for(idx_t x=0; x < nnz; ++x) {
+    idx_t const n = perm[x];
+    bool newblock = (x == 0);
+    for(idx_t m=0; m < nmodes && !newblock; ++m) {
+      newblock = (tt->ind[m][n] >> bits) != (tt->ind[m][perm[x-1]] >> bits);
+    }
+    if(newblock) {
+      hc->bptr[b] = x;
+      for(idx_t m=0; m < nmodes; ++m) {
+        hc->binds[m][b] = tt->ind[m][n] >> bits;
+      }
+      ++b;
+    }
+
+    for(idx_t m=0; m < nmodes; ++m) {
+      hc->einds[m][x] = (uint8_t) (tt->ind[m][n] & mask);
+    }
+    hc->vals[x] = tt->vals[n];
+  }
+  hc->bptr[nblocks] = nnz;
+  splatt_free(perm);
+
+  p_hicoo_schedule(hc);
+
+  return hc;
+}
+
+
+void hicoo_free(
+    hicoo_t * hc)
+{
+  for(idx_t m=0; m < hc->nmodes; ++m) {
+    splatt_free(hc->binds[m]);
+    splatt_free(hc->einds[m]);
+    splatt_free(hc->sched[m]);
+    splatt_free(hc->sched_ptr[m]);
+    splatt_free(hc->brow_nnz[m]);
+  }
+  splatt_free(hc->bptr);
+  splatt_free(hc->vals);
+  splatt_free(hc);
+}
+
+
+size_t hicoo_storage(
+    hicoo_t const * const hc)
+{
+  size_t bytes = 0;
+  bytes += (hc->nblocks + 1) * sizeof(*hc->bptr);
+  bytes += hc->nnz * sizeof(*hc->vals);
+  for(idx_t m=0; m < hc->nmodes; ++m) {
+    bytes += hc->nblocks * sizeof(**hc->binds);
+    bytes += hc->nnz * sizeof(**hc->einds);
+    bytes += hc->nblocks * sizeof(**hc->sched);
+    bytes += (hc->nbrows[m] + 1) * sizeof(**hc->sched_ptr);
+    bytes += hc->nbrows[m] * sizeof(**hc->brow_nnz);
+  }
+  return bytes;
+}
+
+
+void mttkrp_hicoo(
+    hicoo_t const * const hc,
+    matrix_t ** mats,
+    idx_t const mode,
+    idx_t const nthreads)
+{
+  idx_t const nmodes = hc->nmodes;
+  idx_t const bits = hc->bits;
+  matrix_t * const M = mats[MAX_NMODES];
+  idx_t const nfactors = M->J;
+  M->I = hc->dims[mode];
+  memset(M->vals, 0, M->I * nfactors * sizeof(*M->vals));
+
+  /* balance the nonzeros of whole block-rows */
+  idx_t const nbrows = hc->nbrows[mode];
+  idx_t * weights = splatt_malloc(nbrows * sizeof(*weights));
+  memcpy(weights, hc->brow_nnz[mode], nbrows * sizeof(*weights));
+  idx_t bneck;
+  idx_t * parts = partition_weighted(weights, nbrows, nthreads, &bneck);
+  splatt_free(weights);
+
+  val_t * accum_buf = splatt_malloc(nthreads * nfactors * sizeof(*accum_buf));
+
+  idx_t const * const restrict sched = hc->sched[mode];
+  idx_t const * const restrict sched_ptr = hc->sched_ptr[mode];
+  val_t const * const restrict vals = hc->vals;
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    val_t * const restrict accum = accum_buf + (tid * nfactors);
+    val_t const * bmats[MAX_NMODES];
+
+    for(idx_t r=parts[tid]; r < parts[tid+1]; ++r) {
+      for(idx_t x=sched_ptr[r]; x < sched_ptr[r+1]; ++x) {
+        idx_t const b = sched[x];
+
+        /* the first row of each factor covered by this block */
+        for(idx_t m=0; m < nmodes; ++m) {
+          bmats[m] = mats[m]->vals + ((hc->binds[m][b] << bits) * nfactors);
+        }
+        val_t * const restrict out = M->vals +
+            ((hc->binds[mode][b] << bits) * nfactors);
+        uint8_t const * const restrict oinds = hc->einds[mode];
+
+        for(idx_t n=hc->bptr[b]; n < hc->bptr[b+1]; ++n) {
+          for(idx_t f=0; f < nfactors; ++f) {
+            accum[f] = vals[n];
+          }
+          for(idx_t m=0; m < nmodes; ++m) {
+            if(m == mode) {
+              continue;
+            }
+            val_t const * const restrict row = bmats[m] +
+                (hc->einds[m][n] * nfactors);
+            for(idx_t f=0; f < nfactors; ++f) {
+              accum[f] *= row[f];
+            }
+          }
+
+          val_t * const restrict orow = out + (oinds[n] * nfactors);
+          for(idx_t f=0; f < nfactors; ++f) {
+            orow[f] += accum[f];
+          }
+        }
+      }
+    }
+  } /* end omp parallel */
+
+  splatt_free(accum_buf);
+  splatt_free(parts);
+}
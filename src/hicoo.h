@@ -0,0 +1,136 @@
+#ifndef SPLATT_HICOO_H
+#define SPLATT_HICOO_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "sptensor.h"
+#include "matrix.h"
+
+#include <stdint.h>
+
+
+
+/******************************************************************************
+ * DEFINES
+ *****************************************************************************/
+
+/* In-block offsets are 8 bits, so blocks are at most 2^8 wide in each mode. */
+#define HICOO_MAX_BITS 8
+
+/* 2^7 = 128 rows of a rank-16 double factor are 16KB, about half of L1. */
+#define HICOO_DEFAULT_BITS 7
+
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief A hierarchical coordinate (HiCOO) tensor. Nonzeros are grouped into
+*        blocks of 2^bits indices in every mode. Each block stores its block
+*        coordinates once, and each nonzero stores only its 8-bit offsets
+*        within the block. A single copy serves MTTKRP in every mode.
+*/
+typedef struct
+{
+  idx_t nmodes;
+  idx_t nnz;
+  idx_t dims[MAX_NMODES];
+
+  /** @brief log2 of the block width in each mode. */
+  idx_t bits;
+  /** @brief The number of non-empty blocks. */
+  idx_t nblocks;
+
+  /** @brief Block b holds nonzeros [bptr[b], bptr[b+1]). */
+  idx_t * bptr;
+  /** @brief binds[m][b] is the block coordinate of block b in mode m (i.e.,
+   *         its first index is binds[m][b] << bits). */
+  idx_t * binds[MAX_NMODES];
+  /** @brief einds[m][n] is the offset of nonzero n within its block. */
+  uint8_t * einds[MAX_NMODES];
+  /** @brief The nonzero values. */
+  val_t * vals;
+
+  /*
+   * Conflict-free scheduling. Blocks with different block coordinates in
+   * mode m write to disjoint rows of the mode-m output, so threads which own
+   * whole block-rows never need to synchronize.
+   */
+
+  /** @brief The number of block-rows in each mode. */
+  idx_t nbrows[MAX_NMODES];
+  /** @brief sched[m] lists the blocks ordered by binds[m]. */
+  idx_t * sched[MAX_NMODES];
+  /** @brief Block-row r of mode m is sched[m][sched_ptr[m][r]] up to
+   *         sched[m][sched_ptr[m][r+1]]. */
+  idx_t * sched_ptr[MAX_NMODES];
+  /** @brief The nonzeros in each block-row of mode m (for load balance). */
+  idx_t * brow_nnz[MAX_NMODES];
+} hicoo_t;
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define hicoo_alloc splatt_hicoo_alloc
+/**
+* @brief Convert a coordinate tensor to HiCOO form. 'tt' is not modified.
+*
+* @param tt The coordinate tensor.
+* @param bits log2 of the block width, in [1, HICOO_MAX_BITS].
+*
+* @return The HiCOO tensor. Free with hicoo_free().
+*/
+hicoo_t * hicoo_alloc(
+    sptensor_t const * const tt,
+    idx_t const bits);
+
+
+#define hicoo_free splatt_hicoo_free
+/**
+* @brief Free a tensor allocated with hicoo_alloc().
+*
+* @param hc The tensor to free.
+*/
+void hicoo_free(
+    hicoo_t * hc);
+
+
+#define hicoo_storage splatt_hicoo_storage
+/**
+* @brief Compute the number of bytes used to store a HiCOO tensor, including
+*        the per-mode schedules.
+*
+* @param hc The tensor.
+*
+* @return The storage, in bytes.
+*/
+size_t hicoo_storage(
+    hicoo_t const * const hc);
+
+
+#define mttkrp_hicoo splatt_mttkrp_hicoo
+/**
+* @brief MTTKRP with a HiCOO tensor. Block-rows of the output mode are
+*        distributed to threads with chains-on-chains partitioning, so no
+*        locks or atomics are used. Output is written to mats[MAX_NMODES].
+*
+* @param hc The HiCOO tensor.
+* @param mats The input and output matrices.
+* @param mode The output mode.
+* @param nthreads The number of threads to use.
+*/
+void mttkrp_hicoo(
+    hicoo_t const * const hc,
+    matrix_t ** mats,
+    idx_t const mode,
+    idx_t const nthreads);
+
+#endif
@@ -0,0 +1,180 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "kruskal.h"
+#include "thd_info.h"
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Evaluate the model at the leaves below nodes [start, end) of 'level'.
+*        buf[level-1] holds the Hadamard product of the rows on the path from
+*        the root to their parent.
+*
+* @param pt The sparsity pattern of the tile.
+* @param level The level of the nodes.
+* @param start The first node.
+* @param end One past the last node.
+* @param lvals The factor of each level.
+* @param nfactors The rank of the model.
+* @param nmodes The number of levels in the tree.
+* @param buf Path products, one length-nfactors buffer per level.
+* @param[out] out The model values of the tile's leaves.
+*/
+static void p_values_down(
+    csf_sparsity const * const pt,
+    idx_t const level,
+    idx_t const start,
+    idx_t const end,
+    val_t const * const * const lvals,
+    idx_t const nfactors,
+    idx_t const nmodes,
+    val_t ** buf,
+    val_t * const restrict out)
+{
+  idx_t const * const restrict fids = pt->fids[level];
+  val_t const * const restrict mvals = lvals[level];
+  val_t const * const restrict path = buf[level-1];
+
+  /* leaves: one dot product each */
+  if(level == nmodes - 1) {
+    for(idx_t n=start; n < end; ++n) {
+      val_t const * const restrict row = mvals + (fids[n] * nfactors);
+      val_t v = 0;
+      for(idx_t f=0; f < nfactors; ++f) {
+        v += path[f] * row[f];
+      }
+      out[n] = v;
+    }
+    return;
+  }
+
+  idx_t const * const restrict fptr = pt->fptr[level];
+  val_t * const restrict prod = buf[level];
+  for(idx_t n=start; n < end; ++n) {
+    val_t const * const restrict row = mvals + (fids[n] * nfactors);
+    for(idx_t f=0; f < nfactors; ++f) {
+      prod[f] = path[f] * row[f];
+    }
+    p_values_down(pt, level+1, fptr[n], fptr[n+1], lvals, nfactors, nmodes,
+        buf, out);
+  }
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+idx_t kruskal_csf_leaf_offset(
+    splatt_csf const * const csf,
+    idx_t const tile_id)
+{
+  idx_t offset = 0;
+  for(idx_t t=0; t < tile_id; ++t) {
+    if(csf->pt[t].vals != NULL) {
+      offset += csf->pt[t].nfibs[csf->nmodes-1];
+    }
+  }
+  return offset;
+}
+
+
+void kruskal_csf_values(
+    splatt_csf const * const csf,
+    matrix_t ** mats,
+    val_t const * const lambda,
+    val_t * const values,
+    idx_t const nthreads)
+{
+  idx_t const nmodes = csf->nmodes;
+  idx_t const nfactors = mats[0]->J;
+
+  val_t const * lvals[MAX_NMODES];
+  for(idx_t l=0; l < nmodes; ++l) {
+    lvals[l] = mats[csf_depth_to_mode(csf, l)]->vals;
+  }
+
+  thd_info * thds = thd_init(nthreads, 1, nmodes * nfactors * sizeof(val_t));
+
+  idx_t offset = 0;
+  for(idx_t t=0; t < csf->ntiles; ++t) {
+    csf_sparsity const * const pt = csf->pt + t;
+    if(pt->vals == NULL) {
+      continue;
+    }
+
+    /* the same nnz-balanced split of the tree as MTTKRP */
+    idx_t bneck;
+    idx_t * parts = csf_partition_split_1d(csf, t, nthreads, &bneck);
+    val_t * const out = values + offset;
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+      int const tid = splatt_omp_get_thread_num();
+      val_t * buf[MAX_NMODES];
+      for(idx_t l=0; l < nmodes; ++l) {
+        buf[l] = ((val_t *) thds[tid].scratch[0]) + (l * nfactors);
+      }
+
+      idx_t const * const restrict sptr = pt->fptr[0];
+      idx_t const * const restrict sids = pt->fids[0];
+
+      idx_t start, stop, fstart, fstop;
+      csf_thread_range(pt, parts, tid, &start, &stop, &fstart, &fstop);
+      for(idx_t s=start; s < stop; ++s) {
+        idx_t const fid = (sids == NULL) ? s : sids[s];
+        val_t const * const restrict row = lvals[0] + (fid * nfactors);
+        for(idx_t f=0; f < nfactors; ++f) {
+          buf[0][f] = (lambda == NULL) ? row[f] : lambda[f] * row[f];
+        }
+        p_values_down(pt, 1, SS_MAX(sptr[s], fstart), SS_MIN(sptr[s+1], fstop),
+            lvals, nfactors, nmodes, buf, out);
+      }
+    } /* end omp parallel */
+
+    splatt_free(parts);
+    offset += pt->nfibs[nmodes-1];
+  }
+
+  thd_free(thds, nthreads);
+}
+
+
+
+/******************************************************************************
+ * API FUNCTIONS
+ *****************************************************************************/
+
+int splatt_kruskal_values(
+    splatt_csf const * const tensor,
+    splatt_kruskal const * const factored,
+    double const * const options,
+    splatt_val_t * const values)
+{
+  if(factored->nmodes != tensor->nmodes) {
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  matrix_t wrappers[MAX_NMODES];
+  matrix_t * mats[MAX_NMODES];
+  for(idx_t m=0; m < tensor->nmodes; ++m) {
+    if(factored->dims[m] != tensor->dims[m]) {
+      return SPLATT_ERROR_BADINPUT;
+    }
+    wrappers[m].I = factored->dims[m];
+    wrappers[m].J = factored->rank;
+    wrappers[m].rowmajor = 1;
+    wrappers[m].vals = factored->factors[m];
+    mats[m] = wrappers + m;
+  }
+
+  idx_t const nthreads = (idx_t) options[SPLATT_OPTION_NTHREADS];
+  kruskal_csf_values(tensor, mats, factored->lambda, values, nthreads);
+  return SPLATT_SUCCESS;
+}
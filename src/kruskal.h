@@ -0,0 +1,55 @@
+#ifndef SPLATT_KRUSKAL_H
+#define SPLATT_KRUSKAL_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "matrix.h"
+#include "csf.h"
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define kruskal_csf_values splatt_kruskal_csf_values
+/**
+* @brief Evaluate a Kruskal model at every nonzero of a CSF tensor. The
+*        Hadamard product of the factor rows along each root-to-fiber path is
+*        formed once and shared by all of the nonzeros below it, so each
+*        nonzero costs one dot product instead of nmodes row gathers.
+*
+* @param csf The CSF tensor (only csf[0] is used).
+* @param mats The row-major factors, one per mode, with mats[m]->J columns.
+* @param lambda The column weights, or NULL for all ones.
+* @param[out] values The model values, aligned with the leaves of the tree:
+*             tile after tile, in the same order as the pt[t].vals arrays.
+*             Must hold csf->nnz values.
+* @param nthreads The number of threads to use.
+*/
+void kruskal_csf_values(
+    splatt_csf const * const csf,
+    matrix_t ** mats,
+    val_t const * const lambda,
+    val_t * const values,
+    idx_t const nthreads);
+
+
+#define kruskal_csf_leaf_offset splatt_kruskal_csf_leaf_offset
+/**
+* @brief The position of a tile's first leaf in the output of
+*        kruskal_csf_values().
+*
+* @param csf The CSF tensor.
+* @param tile_id The tile.
+*
+* @return The number of nonzeros in tiles [0, tile_id).
+*/
+idx_t kruskal_csf_leaf_offset(
+    splatt_csf const * const csf,
+    idx_t const tile_id);
+
+#endif
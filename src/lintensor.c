@@ -0,0 +1,440 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "lintensor.h"
+#include "thd_info.h"
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Sort keys (and a permutation carried with them) with a parallel LSD
+*        radix sort over the low 'nbits' bits, 8 bits per pass. Each thread
+*        histograms its own range of items, so the scatter needs no
+*        synchronization.
+*
+* @param keys The keys, 'nwords' words per item.
+* @param perm The permutation to reorder along with the keys.
+* @param nitems The number of items.
+* @param nwords The number of words per key.
+* @param nbits The number of key bits which are used.
+*/
+static void p_radix_sort(
+    uint64_t * keys,
+    idx_t * perm,
+    idx_t const nitems,
+    idx_t const nwords,
+    idx_t const nbits)
+{
+  int const maxthreads = splatt_omp_get_max_threads();
+  idx_t * hist = splatt_malloc(maxthreads * 256 * sizeof(*hist));
+  uint64_t * kbuf = splatt_malloc(nitems * nwords * sizeof(*kbuf));
+  idx_t * pbuf = splatt_malloc(nitems * sizeof(*pbuf));
+
+  uint64_t * const korig = keys;
+  idx_t * const porig = perm;
+
+  for(idx_t shift=0; shift < nbits; shift += 8) {
+    /* 64 is a multiple of 8, so a digit never spans two words */
+    idx_t const word = shift / 64;
+    idx_t const bit = shift % 64;
+
+    #pragma omp parallel
+    {
+      int const tid = splatt_omp_get_thread_num();
+      int const nthreads = splatt_omp_get_num_threads();
+      idx_t const start = (nitems * tid) / nthreads;
+      idx_t const end = (nitems * (tid+1)) / nthreads;
+
+      idx_t * const restrict myhist = hist + (tid * 256);
+      memset(myhist, 0, 256 * sizeof(*myhist));
+      for(idx_t x=start; x < end; ++x) {
+        ++myhist[(keys[(x * nwords) + word] >> bit) & 0xff];
+      }
+      #pragma omp barrier
+
+      /* digit-major prefix sum keeps the sort stable across threads */
+      #pragma omp single
+      {
+        idx_t sum = 0;
+        for(idx_t d=0; d < 256; ++d) {
+          for(int t=0; t < nthreads; ++t) {
+            idx_t const count = hist[(t * 256) + d];
+            hist[(t * 256) + d] = sum;
+            sum += count;
+          }
+        }
+      } /* implied barrier */
+
+      for(idx_t x=start; x < end; ++x) {
+        idx_t const d = (keys[(x * nwords) + word] >> bit) & 0xff;
+        idx_t const dst = myhist[d]++;
+        for(idx_t w=0; w < nwords; ++w) {
+          kbuf[(dst * nwords) + w] = keys[(x * nwords) + w];
+        }
+        pbuf[dst] = perm[x];
+      }
+    } /* end omp parallel */
+
+    uint64_t * ktmp = keys;
+    keys = kbuf;
+    kbuf = ktmp;
+    idx_t * ptmp = perm;
+    perm = pbuf;
+    pbuf = ptmp;
+  }
+
+  /* an odd number of passes leaves the result in the scratch arrays */
+  if(keys != korig) {
+    memcpy(korig, keys, nitems * nwords * sizeof(*keys));
+    memcpy(porig, perm, nitems * sizeof(*perm));
+  }
+
+  /* the scratch arrays are whichever pair was not the input */
+  splatt_free((keys != korig) ? keys : kbuf);
+  splatt_free((perm != porig) ? perm : pbuf);
+  splatt_free(hist);
+}
+
+
+
+/**
+* @brief Sum the rows of each range's private buffer which that range touched
+*        into the output, then clear them. Buffer row r of range p holds output
+*        row ws->rows[mode][p][r]. Each thread reduces a contiguous block of
+*        output rows. Must be called from inside a parallel region.
+*
+* @param ws The workspace holding the private buffers.
+* @param global_output The MTTKRP output.
+* @param mode The output mode, used to find the touched rows.
+* @param nrows The number of rows in the output.
+* @param ncols The number of columns in the output.
+*/
+static void p_reduce_touched(
+    lintensor_ws_t * const ws,
+    val_t * const restrict global_output,
+    idx_t const mode,
+    idx_t const nrows,
+    idx_t const ncols)
+{
+  int const tid = splatt_omp_get_thread_num();
+  idx_t const num_threads = splatt_omp_get_num_threads();
+  idx_t const rows_per_thread = nrows / num_threads;
+  idx_t const start = tid * rows_per_thread;
+  idx_t const stop  = ((idx_t)tid == num_threads-1) ?
+     nrows : (tid + 1) * rows_per_thread;
+
+  /* reduction of rows [start, stop) */
+  for(idx_t p=0; p < ws->nparts; ++p) {
+    val_t const * const restrict buf = ws->bufs[p];
+    idx_t const * const restrict rows = ws->rows[mode][p];
+    idx_t const nrows_p = ws->nrows[mode][p];
+
+    /* binary search for the first row >= start */
+    idx_t lo = 0;
+    idx_t hi = nrows_p;
+    while(lo < hi) {
+      idx_t const mid = lo + ((hi - lo) / 2);
+      if(rows[mid] < start) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+
+    for(idx_t r=lo; r < nrows_p && rows[r] < stop; ++r) {
+      val_t       * const restrict out = global_output + (rows[r] * ncols);
+      val_t const * const restrict brow = buf + (r * ncols);
+      for(idx_t f=0; f < ncols; ++f) {
+        out[f] += brow[f];
+      }
+    }
+  }
+
+  /* everyone must be done reading before buffers are cleared */
+  #pragma omp barrier
+
+  #pragma omp for schedule(static, 1)
+  for(idx_t p=0; p < ws->nparts; ++p) {
+    memset(ws->bufs[p], 0, ws->nrows[mode][p] * ncols * sizeof(**ws->bufs));
+  }
+}
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+lintensor_t * lintensor_alloc(
+    sptensor_t const * const tt)
+{
+  idx_t const nmodes = tt->nmodes;
+  idx_t const nnz = tt->nnz;
+
+  /* bits needed by each mode */
+  idx_t mbits[MAX_NMODES];
+  idx_t nbits = 0;
+  idx_t maxbits = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    mbits[m] = 0;
+    while(((uint64_t) 1 << mbits[m]) < (uint64_t) tt->dims[m]) {
+      ++mbits[m];
+    }
+    nbits += mbits[m];
+    maxbits = SS_MAX(maxbits, mbits[m]);
+  }
+  if(nbits > LIN_MAX_WORDS * 64) {
+    fprintf(stderr, "SPLATT ERROR: linearized keys need %"SPLATT_PF_IDX
+        " bits, but at most %d are supported.\n", nbits, LIN_MAX_WORDS * 64);
+    return NULL;
+  }
+
+  lintensor_t * lt = splatt_malloc(sizeof(*lt));
+  lt->nmodes = nmodes;
+  lt->nnz = nnz;
+  lt->nbits = nbits;
+  lt->nwords = (nbits > 64) ? 2 : 1;
+  idx_t const nwords = lt->nwords;
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    lt->dims[m] = (m < nmodes) ? tt->dims[m] : 0;
+    lt->shifts[m] = 0;
+    for(idx_t w=0; w < LIN_MAX_WORDS; ++w) {
+      lt->masks[m][w] = 0;
+    }
+  }
+
+  /* interleave: level l of every mode which still has bits, round-robin */
+  idx_t pos[MAX_NMODES][LIN_MAX_WORDS * 64];
+  idx_t next = 0;
+  for(idx_t l=0; l < maxbits; ++l) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      if(l < mbits[m]) {
+        pos[m][l] = next;
+        lt->masks[m][next / 64] |= (uint64_t) 1 << (next % 64);
+        if(next < 64) {
+          ++lt->shifts[m];
+        }
+        ++next;
+      }
+    }
+  }
+
+  /* encode */
+  lt->keys = splatt_malloc(nnz * nwords * sizeof(*lt->keys));
+  idx_t * perm = splatt_malloc(nnz * sizeof(*perm));
+  #pragma omp parallel for schedule(static)
+  for(idx_t n=0; n < nnz; ++n) {
+    uint64_t key[LIN_MAX_WORDS] = { 0 };
+    for(idx_t m=0; m < nmodes; ++m) {
+      idx_t const ind = tt->ind[m][n];
+      for(idx_t l=0; l < mbits[m]; ++l) {
+        if((ind >> l) & 1) {
+          key[pos[m][l] / 64] |= (uint64_t) 1 << (pos[m][l] % 64);
+        }
+      }
+    }
+    for(idx_t w=0; w < nwords; ++w) {
+      lt->keys[(n * nwords) + w] = key[w];
+    }
+    perm[n] = n;
+  }
+
+  p_radix_sort(lt->keys, perm, nnz, nwords, nbits);
+
+  lt->vals = splatt_malloc(nnz * sizeof(*lt->vals));
+  #pragma omp parallel for schedule(static)
+  for(idx_t n=0; n < nnz; ++n) {
+    lt->vals[n] = tt->vals[perm[n]];
+  }
+  splatt_free(perm);
+
+  return lt;
+}
+
+
+void lintensor_free(
+    lintensor_t * lt)
+{
+  splatt_free(lt->keys);
+  splatt_free(lt->vals);
+  splatt_free(lt);
+}
+
+
+size_t lintensor_storage(
+    lintensor_t const * const lt)
+{
+  return lt->nnz * ((lt->nwords * sizeof(*lt->keys)) + sizeof(*lt->vals));
+}
+
+
+lintensor_ws_t * lintensor_ws_alloc(
+    lintensor_t const * const lt,
+    idx_t const nfactors,
+    idx_t const nthreads)
+{
+  idx_t const nmodes = lt->nmodes;
+  idx_t const nnz = lt->nnz;
+
+  lintensor_ws_t * ws = splatt_malloc(sizeof(*ws));
+  ws->nparts = nthreads;
+  ws->nfactors = nfactors;
+  ws->accum = splatt_malloc(nthreads * nfactors * sizeof(*ws->accum));
+  ws->bufs = NULL;
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    ws->nrows[m] = NULL;
+    ws->rows[m] = NULL;
+    ws->local[m] = NULL;
+  }
+
+  /* a single range writes directly to the output */
+  if(nthreads == 1) {
+    return ws;
+  }
+
+  idx_t maxdim = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    maxdim = SS_MAX(maxdim, lt->dims[m]);
+    ws->nrows[m] = splatt_malloc(nthreads * sizeof(**ws->nrows));
+    ws->rows[m] = splatt_malloc(nthreads * sizeof(**ws->rows));
+    ws->local[m] = splatt_malloc(nnz * sizeof(**ws->local));
+  }
+  ws->bufs = splatt_malloc(nthreads * sizeof(*ws->bufs));
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    /* slot[i] is the compact row of output row i, or 'nnz' if untouched */
+    idx_t * const slot = splatt_malloc(maxdim * sizeof(*slot));
+
+    #pragma omp for schedule(static, 1)
+    for(idx_t p=0; p < nthreads; ++p) {
+      idx_t const start = (nnz * p) / nthreads;
+      idx_t const end = (nnz * (p+1)) / nthreads;
+      idx_t maxrows = 0;
+
+      for(idx_t m=0; m < nmodes; ++m) {
+        idx_t const dim = lt->dims[m];
+        for(idx_t i=0; i < dim; ++i) {
+          slot[i] = nnz;
+        }
+        idx_t count = 0;
+        for(idx_t n=start; n < end; ++n) {
+          idx_t const row = lintensor_ind(lt, n, m);
+          if(slot[row] == nnz) {
+            slot[row] = count++;
+          }
+        }
+
+        /* compact into a sorted list, and renumber in sorted order */
+        ws->rows[m][p] = splatt_malloc(count * sizeof(***ws->rows));
+        ws->nrows[m][p] = count;
+        idx_t ptr = 0;
+        for(idx_t i=0; i < dim; ++i) {
+          if(slot[i] != nnz) {
+            ws->rows[m][p][ptr] = i;
+            slot[i] = ptr++;
+          }
+        }
+        for(idx_t n=start; n < end; ++n) {
+          ws->local[m][n] = slot[lintensor_ind(lt, n, m)];
+        }
+        maxrows = SS_MAX(maxrows, count);
+      }
+
+      ws->bufs[p] = splatt_malloc(maxrows * nfactors * sizeof(**ws->bufs));
+      memset(ws->bufs[p], 0, maxrows * nfactors * sizeof(**ws->bufs));
+    }
+
+    splatt_free(slot);
+  } /* end omp parallel */
+
+  return ws;
+}
+
+
+void lintensor_ws_free(
+    lintensor_ws_t * ws)
+{
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    if(ws->rows[m] != NULL) {
+      for(idx_t p=0; p < ws->nparts; ++p) {
+        splatt_free(ws->rows[m][p]);
+      }
+      splatt_free(ws->rows[m]);
+      splatt_free(ws->nrows[m]);
+      splatt_free(ws->local[m]);
+    }
+  }
+  if(ws->bufs != NULL) {
+    for(idx_t p=0; p < ws->nparts; ++p) {
+      splatt_free(ws->bufs[p]);
+    }
+    splatt_free(ws->bufs);
+  }
+  splatt_free(ws->accum);
+  splatt_free(ws);
+}
+
+
+void mttkrp_lintensor(
+    lintensor_t const * const lt,
+    matrix_t ** mats,
+    idx_t const mode,
+    lintensor_ws_t * const ws)
+{
+  idx_t const nmodes = lt->nmodes;
+  idx_t const nnz = lt->nnz;
+  idx_t const nparts = ws->nparts;
+  matrix_t * const M = mats[MAX_NMODES];
+  idx_t const nfactors = M->J;
+  assert(nfactors == ws->nfactors);
+  M->I = lt->dims[mode];
+  memset(M->vals, 0, M->I * nfactors * sizeof(*M->vals));
+
+  #pragma omp parallel num_threads(nparts)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    val_t * const restrict accum = ws->accum + (tid * nfactors);
+
+    /* the ranges are fixed by 'ws', so a smaller team takes several each */
+    #pragma omp for schedule(static, 1)
+    for(idx_t p=0; p < nparts; ++p) {
+      idx_t const start = (nnz * p) / nparts;
+      idx_t const end = (nnz * (p+1)) / nparts;
+      /* private buffers are indexed by compact row */
+      val_t * const restrict out = (nparts > 1) ? ws->bufs[p] : M->vals;
+      idx_t const * const restrict local = ws->local[mode];
+
+      for(idx_t n=start; n < end; ++n) {
+        for(idx_t f=0; f < nfactors; ++f) {
+          accum[f] = lt->vals[n];
+        }
+        for(idx_t m=0; m < nmodes; ++m) {
+          if(m == mode) {
+            continue;
+          }
+          val_t const * const restrict row = mats[m]->vals +
+              (lintensor_ind(lt, n, m) * nfactors);
+          for(idx_t f=0; f < nfactors; ++f) {
+            accum[f] *= row[f];
+          }
+        }
+
+        idx_t const orow_id = (local != NULL) ? local[n] :
+            lintensor_ind(lt, n, mode);
+        val_t * const restrict orow = out + (orow_id * nfactors);
+        for(idx_t f=0; f < nfactors; ++f) {
+          orow[f] += accum[f];
+        }
+      }
+    } /* implied barrier */
+
+    if(nparts > 1) {
+      p_reduce_touched(ws, M->vals, mode, M->I, nfactors);
+    }
+  } /* end omp parallel */
+}
@@ -0,0 +1,230 @@
+#ifndef SPLATT_LINTENSOR_H
+#define SPLATT_LINTENSOR_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "sptensor.h"
+#include "matrix.h"
+
+#include <stdint.h>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+
+
+/******************************************************************************
+ * DEFINES
+ *****************************************************************************/
+
+/* Keys are one or two 64-bit words. */
+#define LIN_MAX_WORDS 2
+
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief A linearized sparse tensor. The coordinates of each nonzero are
+*        bit-interleaved into a single 64- or 128-bit key, and nonzeros are
+*        sorted by key. This gives a Z-order traversal which has locality in
+*        every mode, so one copy serves MTTKRP in any mode.
+*/
+typedef struct
+{
+  idx_t nmodes;
+  idx_t nnz;
+  idx_t dims[MAX_NMODES];
+
+  /** @brief The total number of key bits over all modes. */
+  idx_t nbits;
+  /** @brief The number of 64-bit words per key (1 or 2). */
+  idx_t nwords;
+
+  /** @brief masks[m][w] selects the bits of key word w that belong to mode m.
+   *         Bits are assigned round-robin from the least significant end. */
+  uint64_t masks[MAX_NMODES][LIN_MAX_WORDS];
+  /** @brief The number of mode-m bits stored in the first key word. */
+  idx_t shifts[MAX_NMODES];
+
+  /** @brief The sorted keys. Nonzero n uses keys[n*nwords] to
+   *         keys[(n+1)*nwords - 1]. */
+  uint64_t * keys;
+  /** @brief The nonzero values, in key order. */
+  val_t * vals;
+} lintensor_t;
+
+
+/**
+* @brief Workspace for MTTKRP with a linearized tensor. The nonzeros are split
+*        into 'nparts' equal ranges, and each range accumulates into its own
+*        private buffer. A buffer only has rows for the output rows which its
+*        range touches, so the memory follows the touched rows instead of
+*        nparts x dim. The price is a compact row id per nonzero and mode.
+*/
+typedef struct
+{
+  /** @brief The number of nonzero ranges (and buffers). */
+  idx_t nparts;
+  /** @brief The number of columns in each buffer. */
+  idx_t nfactors;
+  /** @brief bufs[p] has (max_m nrows[m][p]) x nfactors zeroed values. */
+  val_t ** bufs;
+  /** @brief An nfactors-long accumulator for each thread. */
+  val_t * accum;
+  /** @brief The number of rows of mode m touched by range p: nrows[m][p]. */
+  idx_t * nrows[MAX_NMODES];
+  /** @brief The sorted rows of mode m touched by range p: rows[m][p]. */
+  idx_t ** rows[MAX_NMODES];
+  /** @brief local[m][n] is the position of nonzero n's mode-m index in
+   *         rows[m][p], where p is the range holding n. */
+  idx_t * local[MAX_NMODES];
+} lintensor_ws_t;
+
+
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Gather the bits of 'x' selected by 'mask' into the low bits of the
+*        result (the 'pext' operation).
+*/
+static inline uint64_t lin_pext(
+    uint64_t const x,
+    uint64_t mask)
+{
+#ifdef __BMI2__
+  return _pext_u64(x, mask);
+#else
+  uint64_t ret = 0;
+  for(uint64_t bit = 1; mask != 0; bit <<= 1) {
+    if(x & mask & (~mask + 1)) {
+      ret |= bit;
+    }
+    mask &= mask - 1;
+  }
+  return ret;
+#endif
+}
+
+
+/**
+* @brief Recover the mode-'mode' index of nonzero 'n'.
+*
+* @param lt The linearized tensor.
+* @param n The nonzero.
+* @param mode The mode.
+*
+* @return The index.
+*/
+static inline idx_t lintensor_ind(
+    lintensor_t const * const lt,
+    idx_t const n,
+    idx_t const mode)
+{
+  uint64_t const * const key = lt->keys + (n * lt->nwords);
+  uint64_t ind = lin_pext(key[0], lt->masks[mode][0]);
+  if(lt->nwords > 1) {
+    ind |= lin_pext(key[1], lt->masks[mode][1]) << lt->shifts[mode];
+  }
+  return (idx_t) ind;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define lintensor_alloc splatt_lintensor_alloc
+/**
+* @brief Convert a coordinate tensor to linearized form. The keys are sorted
+*        with a parallel radix sort. 'tt' is not modified.
+*
+* @param tt The coordinate tensor.
+*
+* @return The linearized tensor, or NULL if the coordinates need more than
+*         LIN_MAX_WORDS * 64 bits. Free with lintensor_free().
+*/
+lintensor_t * lintensor_alloc(
+    sptensor_t const * const tt);
+
+
+#define lintensor_free splatt_lintensor_free
+/**
+* @brief Free a tensor allocated with lintensor_alloc().
+*
+* @param lt The tensor to free.
+*/
+void lintensor_free(
+    lintensor_t * lt);
+
+
+#define lintensor_storage splatt_lintensor_storage
+/**
+* @brief Compute the number of bytes used to store a linearized tensor.
+*
+* @param lt The tensor.
+*
+* @return The storage, in bytes.
+*/
+size_t lintensor_storage(
+    lintensor_t const * const lt);
+
+
+#define lintensor_ws_alloc splatt_lintensor_ws_alloc
+/**
+* @brief Allocate the workspace for mttkrp_lintensor(). The rows touched by
+*        each range of nonzeros, and the compact row of each nonzero, are
+*        found here, once for every mode.
+*
+* @param lt The linearized tensor.
+* @param nfactors The number of columns in the factor matrices.
+* @param nthreads The number of threads which will run the MTTKRP.
+*
+* @return The workspace. Free with lintensor_ws_free().
+*/
+lintensor_ws_t * lintensor_ws_alloc(
+    lintensor_t const * const lt,
+    idx_t const nfactors,
+    idx_t const nthreads);
+
+
+#define lintensor_ws_free splatt_lintensor_ws_free
+/**
+* @brief Free a workspace allocated with lintensor_ws_alloc().
+*
+* @param ws The workspace to free.
+*/
+void lintensor_ws_free(
+    lintensor_ws_t * ws);
+
+
+#define mttkrp_lintensor splatt_mttkrp_lintensor
+/**
+* @brief MTTKRP with a linearized tensor. Each thread is given an equal range
+*        of nonzeros and accumulates into a private buffer which holds only
+*        the output rows that range touches. The buffers are then summed into
+*        mats[MAX_NMODES].
+*
+* @param lt The linearized tensor.
+* @param mats The input and output matrices.
+* @param mode The output mode.
+* @param ws Workspace from lintensor_ws_alloc(), which sets the number of
+*           threads.
+*/
+void mttkrp_lintensor(
+    lintensor_t const * const lt,
+    matrix_t ** mats,
+    idx_t const mode,
+    lintensor_ws_t * const ws);
+
+#endif
@@ -84,6 +84,63 @@ static void p_form_gram(
 
 
 
+static void p_mat_1norm(
+  matrix_t * const A,
+  val_t * const restrict lambda,
+  rank_info * const rinfo,
+  thd_info * const thds)
+{
+  idx_t const I = A->I;
+  idx_t const J = A->J;
+  val_t * const restrict vals = A->vals;
+
+  #pragma omp parallel
+  {
+    int const tid = splatt_omp_get_thread_num();
+    val_t * const mylambda = (val_t *) thds[tid].scratch[0];
+    for(idx_t j=0; j < J; ++j) {
+      mylambda[j] = 0;
+    }
+
+    #pragma omp for schedule(static)
+    for(idx_t i=0; i < I; ++i) {
+      for(idx_t j=0; j < J; ++j) {
+        mylambda[j] += fabs(vals[j + (i*J)]);
+      }
+    }
+
+    /* do reduction on partial sums */
+    thd_reduce(thds, 0, J, REDUCE_SUM);
+
+    #pragma omp master
+    {
+#ifdef SPLATT_USE_MPI
+      /* now do an MPI reduction to get the global lambda */
+      timer_start(&timers[TIMER_MPI_NORM]);
+      timer_start(&timers[TIMER_MPI_COMM]);
+      MPI_Allreduce(mylambda, lambda, J, SPLATT_MPI_VAL, MPI_SUM, rinfo->comm_3d);
+      timer_stop(&timers[TIMER_MPI_COMM]);
+      timer_stop(&timers[TIMER_MPI_NORM]);
+#else
+      memcpy(lambda, mylambda, J * sizeof(val_t));
+#endif
+    }
+
+    #pragma omp barrier
+
+    /* do the normalization, leaving zero columns alone */
+    #pragma omp for schedule(static)
+    for(idx_t i=0; i < I; ++i) {
+      for(idx_t j=0; j < J; ++j) {
+        if(lambda[j] > 0.) {
+          vals[j+(i*J)] /= lambda[j];
+        }
+      }
+    }
+  } /* end omp parallel */
+}
+
+
 static void p_mat_2norm(
   matrix_t * const A,
   val_t * const restrict lambda,
@@ -133,11 +190,13 @@ static void p_mat_2norm(
       lambda[j] = sqrt(lambda[j]);
     }
 
-    /* do the normalization */
+    /* do the normalization. Constrained factors may have zero columns. */
     #pragma omp for schedule(static)
     for(idx_t i=0; i < I; ++i) {
       for(idx_t j=0; j < J; ++j) {
-        vals[j+(i*J)] /= lambda[j];
+        if(lambda[j] > 0.) {
+          vals[j+(i*J)] /= lambda[j];
+        }
       }
     }
   } /* end omp for */
@@ -511,6 +570,9 @@ void mat_normalize(
   splatt_omp_set_num_threads(nthreads);
 
   switch(which) {
+  case MAT_NORM_1:
+    p_mat_1norm(A, lambda, rinfo, thds);
+    break;
   case MAT_NORM_2:
     p_mat_2norm(A, lambda, rinfo, thds);
     break;
@@ -518,7 +580,7 @@ void mat_normalize(
     p_mat_maxnorm(A, lambda, rinfo, thds);
     break;
   default:
-    fprintf(stderr, "SPLATT: mat_normalize supports 2 and MAX only.\n");
+    fprintf(stderr, "SPLATT: mat_normalize supports 1, 2, and MAX only.\n");
     abort();
   }
   timer_stop(&timers[TIMER_MATNORM]);
@@ -526,6 +588,16 @@ void mat_normalize(
 
 
 
+void mat_form_gram(
+  matrix_t * * aTa,
+  matrix_t * const gram,
+  idx_t const mode,
+  idx_t const nmodes)
+{
+  p_form_gram(gram, aTa, mode, nmodes, 0.);
+}
+
+
 void mat_solve_normals(
   idx_t const mode,
   idx_t const nmodes,
@@ -27,6 +27,7 @@ typedef struct
 
 typedef enum
 {
+  MAT_NORM_1,
   MAT_NORM_2,
   MAT_NORM_MAX
 } splatt_mat_norm;
@@ -132,6 +133,23 @@ void calc_gram_inv(
   matrix_t ** aTa);
 
 
+#define mat_form_gram splatt_mat_form_gram
+/**
+* @brief Form the Gram matrix of the CPD normal equations,
+*        (BtB * CtC * ...), where * is the Hadamard product.
+*
+* @param aTa An array of matrices (length MAX_NMODES) containing BtB, CtC, etc.
+* @param[out] gram The full (symmetric) Gram matrix.
+* @param mode Which mode we are operating on (it is not used in the product).
+* @param nmodes The number of modes in the tensor.
+*/
+void mat_form_gram(
+  matrix_t * * aTa,
+  matrix_t * const gram,
+  idx_t const mode,
+  idx_t const nmodes);
+
+
 void mat_solve_normals(
   idx_t const mode,
   idx_t const nmodes,
@@ -143,8 +161,9 @@ void mat_solve_normals(
 /**
 * @brief Normalize the columns of A and return the norms in lambda.
 *        Supported norms are:
-*          1. 2-norm
-*          2. max-norm
+*          1. 1-norm
+*          2. 2-norm
+*          3. max-norm
 *
 * @param A The matrix to normalize.
 * @param lambda The vector of column norms.
@@ -7,36 +7,13 @@
 #include "thd_info.h"
 #include "tile.h"
 #include "util.h"
+#include "simd.h"
+#include "precision.h"
 
 #include "mutex_pool.h"
+#include "sort.h"
 
-
-/* XXX: this is a memory leak until cpd_ws is added/freed. */
-static mutex_pool * pool = NULL;
-
-
-
-/**
-* @brief Function pointer that performs MTTKRP on a tile of a CSF tree.
-*
-* @param ct The CSF tensor.
-* @param tile_id The tile to process.
-* @param mats The matrices.
-* @param mode The output mode.
-* @param thds Thread structures.
-* @param partition A partitioning of the slices in the tensor, to distribute
-*                  to threads. Use the thread ID to decide which slices to
-*                  process. This may be NULL, in that case simply process all
-*                  slices.
-*/
-typedef void (* csf_mttkrp_func)(
-    splatt_csf const * const ct,
-    idx_t const tile_id,
-    matrix_t ** mats,
-    idx_t const mode,
-    thd_info * const thds,
-    idx_t const * const partition);
-
+#include <unistd.h>
 
 
 
@@ -81,6 +58,11 @@ static void p_reduce_privatized(
     }
   }
 
+  /* Everyone must be done reading before buffers are cleared. */
+  #pragma omp barrier
+  memset(ws->privatize_buffer[tid], 0,
+      nrows * ncols * sizeof(**(ws->privatize_buffer)));
+
   timer_stop(&reduction_timer);
   #pragma omp master
   ws->reduction_time = reduction_timer.seconds;
@@ -89,136 +71,99 @@ static void p_reduce_privatized(
 
 
 /**
-* @brief Map MTTKRP functions onto a (possibly tiled) CSF tensor. This function
-*        will handle any scheduling required with a partially tiled tensor.
+* @brief Perform a reduction on thread-local MTTKRP outputs, visiting only the
+*        rows that each thread touched. Each thread reduces a contiguous block
+*        of output rows and then clears the rows it touched in its own buffer.
 *
-* @param tensors An array of CSF representations. tensors[csf_id] is processed.
-* @param csf_id Which tensor are we processing?
-* @param atomic_func An MTTKRP function which atomically updates the output.
-* @param nosync_func An MTTKRP function which does not atomically update.
-* @param mats The matrices, with the output stored in mats[MAX_NMODES].
-* @param mode Which mode of 'tensors' is the output (not CSF depth).
-* @param thds Thread structures.
-* @param ws MTTKRP workspace.
+* @param ws MTTKRP workspace containing thread-local outputs.
+* @param global_output The global MTTKRP output we are reducing into.
+* @param mode The mode we are reducing, used to find the touched rows.
+* @param nrows The number of rows in the MTTKRP.
+* @param ncols The number of columns in the MTTKRP.
 */
-static void p_schedule_tiles(
-    splatt_csf const * const tensors,
-    idx_t const csf_id,
-    csf_mttkrp_func atomic_func,
-    csf_mttkrp_func nosync_func,
-    matrix_t ** mats,
+static void p_reduce_privatized_sparse(
+    splatt_mttkrp_ws * const ws,
+    val_t * const restrict global_output,
     idx_t const mode,
-    thd_info * const thds,
-    splatt_mttkrp_ws * const ws)
+    idx_t const nrows,
+    idx_t const ncols)
 {
-  splatt_csf const * const csf = &(tensors[csf_id]);
-  idx_t const nmodes = csf->nmodes;
-  idx_t const depth = nmodes - 1;
-
-  idx_t const nrows = mats[mode]->I;
-  idx_t const ncols = mats[mode]->J;
-
-  /* Store old pointer */
-  val_t * const restrict global_output = mats[MAX_NMODES]->vals;
-
-  #pragma omp parallel
-  {
-    int const tid = splatt_omp_get_thread_num();
-    timer_start(&thds[tid].ttime);
-    idx_t const * const tile_partition = ws->tile_partition[csf_id];
-    idx_t const * const tree_partition = ws->tree_partition[csf_id];
-
-    /*
-     * We may need to edit mats[MAX_NMODES]->vals, so create a private copy of
-     * the pointers to edit. (NOT actual factors).
-     */
-    matrix_t * mats_priv[MAX_NMODES+1];
-    for(idx_t m=0; m < MAX_NMODES; ++m) {
-      mats_priv[m] = mats[m];
-    }
-    /* each thread gets separate structure, but do a shallow copy */
-    mats_priv[MAX_NMODES] = splatt_malloc(sizeof(**mats_priv));
-    *(mats_priv[MAX_NMODES]) = *(mats[MAX_NMODES]);
-
-    /* Give each thread its own private buffer and overwrite atomic
-     * function. */
-    if(ws->is_privatized[mode]) {
-      /* change (thread-private!) output structure */
-      memset(ws->privatize_buffer[tid], 0,
-          nrows * ncols * sizeof(**(ws->privatize_buffer)));
-      mats_priv[MAX_NMODES]->vals = ws->privatize_buffer[tid];
-
-      /* Don't use atomics if we privatized. */
-      atomic_func = nosync_func;
-    }
-
+  /* Ensure everyone has completed their local MTTKRP. */
+  #pragma omp barrier
 
-    /*
-     * Distribute tiles to threads in some fashion.
-     */
-    if(csf->ntiles > 1) {
-      /* We parallelize across tiles, and thus should not distribute within a
-       * tree. This may change if we instead 'split' tiles across a few
-       * threads. */
-      assert(tree_partition == NULL);
+  sp_timer_t reduction_timer;
+  timer_fstart(&reduction_timer);
 
-      /* mode is actually tiled -- avoid synchronization */
-      if(csf->tile_dims[mode] > 1) {
-        idx_t tile_id = 0;
+  int const tid = splatt_omp_get_thread_num();
 
-        /* foreach layer of tiles */
-        #pragma omp for schedule(dynamic, 1) nowait
-        for(idx_t t=0; t < csf->tile_dims[mode]; ++t) {
-          tile_id =
-              get_next_tileid(TILE_BEGIN, csf->tile_dims, nmodes, mode, t);
-          while(tile_id != TILE_END) {
-            nosync_func(csf, tile_id, mats_priv, mode, thds, tree_partition);
-            tile_id =
-              get_next_tileid(tile_id, csf->tile_dims, nmodes, mode, t);
-          }
-        }
+  idx_t const num_threads = splatt_omp_get_num_threads();
+  idx_t const rows_per_thread = nrows / num_threads;
+  idx_t const start = tid * rows_per_thread;
+  idx_t const stop  = ((idx_t)tid == num_threads-1) ?
+     nrows : (tid + 1) * rows_per_thread;
 
-      /* tiled, but not this mode. Atomics are still necessary. */
+  /* reduction of rows [start, stop) */
+  for(idx_t t=0; t < num_threads; ++t){
+    val_t const * const restrict thread_buf = ws->privatize_buffer[t];
+    idx_t const * const restrict rows = ws->priv_rows[mode][t];
+    idx_t const nrows_t = ws->priv_nrows[mode][t];
+
+    /* binary search for the first row >= start */
+    idx_t lo = 0;
+    idx_t hi = nrows_t;
+    while(lo < hi) {
+      idx_t const mid = lo + ((hi - lo) / 2);
+      if(rows[mid] < start) {
+        lo = mid + 1;
       } else {
-        for(idx_t tile_id = tile_partition[tid];
-                  tile_id < tile_partition[tid+1]; ++tile_id) {
-          atomic_func(csf, tile_id, mats_priv, mode, thds, tree_partition);
-        }
+        hi = mid;
       }
-
-    /*
-     * Untiled, parallelize within kernel.
-     */
-    } else {
-      assert(tree_partition != NULL);
-      atomic_func(csf, 0, mats_priv, mode, thds, tree_partition);
     }
-    timer_stop(&thds[tid].ttime);
-
 
-    /* If we used privatization, perform a reduction. */
-    if(ws->is_privatized[mode]) {
-      p_reduce_privatized(ws, global_output, nrows, ncols);
+    for(idx_t r=lo; r < nrows_t && rows[r] < stop; ++r) {
+      val_t       * const restrict out = global_output + (rows[r] * ncols);
+      val_t const * const restrict buf = thread_buf + (rows[r] * ncols);
+      for(idx_t f=0; f < ncols; ++f) {
+        out[f] += buf[f];
+      }
     }
+  }
 
-    splatt_free(mats_priv[MAX_NMODES]);
-  } /* end omp parallel */
+  /* Everyone must be done reading before buffers are cleared. */
+  #pragma omp barrier
 
-  /* restore pointer */
-  mats[MAX_NMODES]->vals = global_output;
+  val_t * const restrict my_buf = ws->privatize_buffer[tid];
+  idx_t const * const restrict my_rows = ws->priv_rows[mode][tid];
+  for(idx_t r=0; r < ws->priv_nrows[mode][tid]; ++r) {
+    memset(my_buf + (my_rows[r] * ncols), 0, ncols * sizeof(*my_buf));
+  }
+
+  timer_stop(&reduction_timer);
+  #pragma omp master
+  ws->reduction_time = reduction_timer.seconds;
 }
 
 
+
 /**
-* @brief Should a certain mode should be privatized to avoid locks?
+* @brief Choose how to handle the MTTKRP output of a mode, based on the ratio
+*        of nonzeros to output rows.
+*
+*        A mode with at least nthreads/PRIVTHRESH nonzeros per row is short
+*        enough that a dense private copy for each thread is cheap to reduce.
+*        Otherwise, a mode with at least nthreads/SPARSE_PRIVTHRESH nonzeros
+*        per row is a candidate for sparse privatization, where only touched
+*        rows are reduced. Anything sparser uses synchronized updates.
+*        SPARSE_PRIVTHRESH is 0 (off) by default: the buffers are still full
+*        length, so it saves reduction work but not memory.
 *
 * @param csf The tensor (just used for dimensions).
 * @param mode The mode we are processing.
-* @param opts Options, storing the # threads and the threshold.
+* @param opts Options, storing the # threads and the thresholds.
 *
-* @return true, if we should privatize.
+* @return The type of privatization to use.
 */
-static bool p_is_privatized(
+static splatt_priv_type p_privatization_type(
     splatt_csf const * const csf,
     idx_t const mode,
     double const * const opts)
@@ -226,23 +171,160 @@ static bool p_is_privatized(
   idx_t const length = csf->dims[mode];
   idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
   double const thresh = opts[SPLATT_OPTION_PRIVTHRESH];
+  double const sparse_thresh = opts[SPLATT_OPTION_SPARSE_PRIVTHRESH];
 
   /* don't bother if it is not multithreaded. */
   if(nthreads == 1) {
-    return false;
+    return SPLATT_PRIV_NONE;
+  }
+
+  double const work = (double)(length * nthreads);
+  if(work <= (thresh * (double)csf->nnz)) {
+    return SPLATT_PRIV_DENSE;
+  }
+  if(work <= (sparse_thresh * (double)csf->nnz)) {
+    return SPLATT_PRIV_SPARSE;
   }
+  return SPLATT_PRIV_NONE;
+}
+
+
+/**
+* @brief Find the output rows that each thread touches during an MTTKRP. This
+*        relies on the static partitioning in 'ws', so it is not valid for
+*        modes which are tiled (those tiles are scheduled dynamically).
+*
+* @param csf The CSF tensor used for the mode.
+* @param csf_id Which CSF in 'ws' this is.
+* @param mode The output mode.
+* @param ws The MTTKRP workspace with partitioning information.
+* @param[out] nrows The number of rows touched by each thread.
+*
+* @return For each thread, a sorted list of the rows it touches.
+*/
+static idx_t * * p_touched_rows(
+    splatt_csf const * const csf,
+    idx_t const csf_id,
+    idx_t const mode,
+    splatt_mttkrp_ws const * const ws,
+    idx_t * const nrows)
+{
+  idx_t const nthreads = ws->num_threads;
+  idx_t const depth = csf_mode_to_depth(csf, mode);
+  idx_t const dim = csf->dims[mode];
+
+  idx_t * * rows = splatt_malloc(nthreads * sizeof(*rows));
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    bool * const touched = splatt_malloc(dim * sizeof(*touched));
+
+    #pragma omp for schedule(static, 1)
+    for(idx_t t=0; t < nthreads; ++t) {
+      memset(touched, 0, dim * sizeof(*touched));
+      idx_t count = 0;
+
+      /* the slices/tiles which thread 't' processes */
+      idx_t tile_start = 0;
+      idx_t tile_stop = 1;
+      if(ws->tile_partition[csf_id] != NULL) {
+        tile_start = ws->tile_partition[csf_id][t];
+        tile_stop  = ws->tile_partition[csf_id][t+1];
+      }
+
+      for(idx_t tile=tile_start; tile < tile_stop; ++tile) {
+        csf_sparsity const * const pt = &(csf->pt[tile]);
+        if(pt->vals == NULL) {
+          continue;
+        }
+
+        /* the part of this tree which thread 't' processes */
+        idx_t sstart, sstop, fstart, fstop;
+        csf_thread_range(pt, ws->tree_partition[csf_id], t, &sstart, &sstop,
+            &fstart, &fstop);
+        idx_t start = (depth == 0) ? sstart : fstart;
+        idx_t end   = (depth == 0) ? sstop  : fstop;
+
+        /* descend to the output level */
+        for(idx_t d=1; d < depth; ++d) {
+          start = pt->fptr[d][start];
+          end   = pt->fptr[d][end];
+        }
+
+        idx_t const * const fids = pt->fids[depth];
+        for(idx_t x=start; x < end; ++x) {
+          idx_t const row = (fids == NULL) ? x : fids[x];
+          if(!touched[row]) {
+            touched[row] = true;
+            ++count;
+          }
+        }
+      }
+
+      /* compact into a sorted list */
+      rows[t] = splatt_malloc(count * sizeof(**rows));
+      nrows[t] = count;
+      idx_t ptr = 0;
+      for(idx_t i=0; i < dim; ++i) {
+        if(touched[i]) {
+          rows[t][ptr++] = i;
+        }
+      }
+    }
+
+    splatt_free(touched);
+  } /* end omp parallel */
 
-  return (double)(length * nthreads) <= (thresh * (double)csf->nnz);
+  return rows;
 }
 
 
 
-static inline void p_add_hada_clear(
+/*
+ * Per-row and per-fiber building blocks of the CSF kernels. 'simd' is always a
+ * compile-time constant in the kernel wrappers below, so the dispatch folds
+ * away and scalar families keep their fully unrolled plain C loops.
+ */
+
+#ifdef SPLATT_SIMD_X86
+#define P_SIMD_DISPATCH(simd, func, ...) \
+  switch(simd) { \
+  case SPLATT_SIMD_AVX512: \
+    simd_##func##_avx512(__VA_ARGS__); \
+    return; \
+  case SPLATT_SIMD_AVX2: \
+    simd_##func##_avx2(__VA_ARGS__); \
+    return; \
+  default: \
+    break; \
+  }
+#else
+#define P_SIMD_DISPATCH(simd, func, ...)
+#endif
+
+
+SPLATT_FORCE_INLINE void p_add_hada(
+  val_t * const restrict out,
+  val_t const * const restrict a,
+  val_t const * const restrict b,
+  idx_t const nfactors,
+  splatt_simd_type const simd)
+{
+  P_SIMD_DISPATCH(simd, hada_accum, out, a, b, nfactors);
+  for(idx_t f=0; f < nfactors; ++f) {
+    out[f] += a[f] * b[f];
+  }
+}
+
+
+SPLATT_FORCE_INLINE void p_add_hada_clear(
   val_t * const restrict out,
   val_t * const restrict a,
   val_t const * const restrict b,
-  idx_t const nfactors)
+  idx_t const nfactors,
+  splatt_simd_type const simd)
 {
+  P_SIMD_DISPATCH(simd, hada_accum_clear, out, a, b, nfactors);
   for(idx_t f=0; f < nfactors; ++f) {
     out[f] += a[f] * b[f];
     a[f] = 0;
@@ -250,47 +332,174 @@ static inline void p_add_hada_clear(
 }
 
 
-static inline void p_assign_hada(
+SPLATT_FORCE_INLINE void p_assign_hada(
   val_t * const restrict out,
   val_t const * const restrict a,
   val_t const * const restrict b,
-  idx_t const nfactors)
+  idx_t const nfactors,
+  splatt_simd_type const simd)
 {
+  P_SIMD_DISPATCH(simd, hada_assign, out, a, b, nfactors);
   for(idx_t f=0; f < nfactors; ++f) {
     out[f] = a[f] * b[f];
   }
 }
 
 
-static inline void p_csf_process_fiber_locked(
+SPLATT_FORCE_INLINE void p_add_scaled_row(
+  val_t * const restrict out,
+  val_t const v,
+  val_t const * const restrict row,
+  idx_t const nfactors,
+  splatt_simd_type const simd)
+{
+  P_SIMD_DISPATCH(simd, axpy, out, v, row, nfactors);
+  for(idx_t f=0; f < nfactors; ++f) {
+    out[f] += v * row[f];
+  }
+}
+
+
+/*
+ * Updates to output rows which other threads may also be writing. 'sync' is a
+ * compile-time constant: SPLATT_SYNC_LOCK guards the whole row with a lock
+ * from the mutex pool and SPLATT_SYNC_ATOMIC instead updates each element
+ * with an atomic add (a CAS loop for floating point types).
+ */
+
+SPLATT_FORCE_INLINE void p_atomic_add(
+  val_t * const addr,
+  val_t const v)
+{
+  #pragma omp atomic
+  *addr += v;
+}
+
+
+SPLATT_FORCE_INLINE void p_sync_add_row(
+  val_t * const restrict out,
+  val_t const * const restrict row,
+  idx_t const nfactors,
+  idx_t const lock_id,
+  mutex_pool * const pool,
+  splatt_sync_type const sync)
+{
+  if(sync == SPLATT_SYNC_ATOMIC) {
+    for(idx_t f=0; f < nfactors; ++f) {
+      p_atomic_add(out + f, row[f]);
+    }
+    return;
+  }
+
+  mutex_set_lock(pool, lock_id);
+  for(idx_t f=0; f < nfactors; ++f) {
+    out[f] += row[f];
+  }
+  mutex_unset_lock(pool, lock_id);
+}
+
+
+SPLATT_FORCE_INLINE void p_sync_add_scaled_row(
+  val_t * const restrict out,
+  val_t const v,
+  val_t const * const restrict row,
+  idx_t const nfactors,
+  idx_t const lock_id,
+  mutex_pool * const pool,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
+{
+  if(sync == SPLATT_SYNC_ATOMIC) {
+    for(idx_t f=0; f < nfactors; ++f) {
+      p_atomic_add(out + f, v * row[f]);
+    }
+    return;
+  }
+
+  mutex_set_lock(pool, lock_id);
+  p_add_scaled_row(out, v, row, nfactors, simd);
+  mutex_unset_lock(pool, lock_id);
+}
+
+
+SPLATT_FORCE_INLINE void p_sync_add_hada(
+  val_t * const restrict out,
+  val_t const * const restrict a,
+  val_t const * const restrict b,
+  idx_t const nfactors,
+  idx_t const lock_id,
+  mutex_pool * const pool,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
+{
+  if(sync == SPLATT_SYNC_ATOMIC) {
+    for(idx_t f=0; f < nfactors; ++f) {
+      p_atomic_add(out + f, a[f] * b[f]);
+    }
+    return;
+  }
+
+  mutex_set_lock(pool, lock_id);
+  p_add_hada(out, a, b, nfactors, simd);
+  mutex_unset_lock(pool, lock_id);
+}
+
+
+SPLATT_FORCE_INLINE void p_sync_add_hada_clear(
+  val_t * const restrict out,
+  val_t * const restrict a,
+  val_t const * const restrict b,
+  idx_t const nfactors,
+  idx_t const lock_id,
+  mutex_pool * const pool,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
+{
+  if(sync == SPLATT_SYNC_ATOMIC) {
+    for(idx_t f=0; f < nfactors; ++f) {
+      p_atomic_add(out + f, a[f] * b[f]);
+      a[f] = 0;
+    }
+    return;
+  }
+
+  mutex_set_lock(pool, lock_id);
+  p_add_hada_clear(out, a, b, nfactors, simd);
+  mutex_unset_lock(pool, lock_id);
+}
+
+
+SPLATT_FORCE_INLINE void p_csf_process_fiber_locked(
   val_t * const leafmat,
   val_t const * const restrict accumbuf,
   idx_t const nfactors,
   idx_t const start,
   idx_t const end,
   idx_t const * const restrict inds,
-  val_t const * const restrict vals)
+  val_t const * const restrict vals,
+  mutex_pool * const pool,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
 {
   for(idx_t jj=start; jj < end; ++jj) {
     val_t * const restrict leafrow = leafmat + (inds[jj] * nfactors);
-    val_t const v = vals[jj];
-    mutex_set_lock(pool, inds[jj]);
-    for(idx_t f=0; f < nfactors; ++f) {
-      leafrow[f] += v * accumbuf[f];
-    }
-    mutex_unset_lock(pool, inds[jj]);
+    p_sync_add_scaled_row(leafrow, vals[jj], accumbuf, nfactors, inds[jj],
+        pool, sync, simd);
   }
 }
 
-static inline void p_csf_process_fiber_nolock(
+SPLATT_FORCE_INLINE void p_csf_process_fiber_nolock(
   val_t * const leafmat,
   val_t const * const restrict accumbuf,
   idx_t const nfactors,
   idx_t const start,
   idx_t const end,
   idx_t const * const restrict inds,
-  val_t const * const restrict vals)
+  val_t const * const restrict vals,
+  splatt_simd_type const simd)
 {
+  P_SIMD_DISPATCH(simd, fiber_scatter, leafmat, accumbuf, nfactors, start, end,
+      inds, vals);
   for(idx_t jj=start; jj < end; ++jj) {
     val_t * const restrict leafrow = leafmat + (inds[jj] * nfactors);
     val_t const v = vals[jj];
@@ -301,15 +510,18 @@ static inline void p_csf_process_fiber_nolock(
 }
 
 
-static inline void p_csf_process_fiber(
+SPLATT_FORCE_INLINE void p_csf_process_fiber(
   val_t * const restrict accumbuf,
   idx_t const nfactors,
   val_t const * const leafmat,
   idx_t const start,
   idx_t const end,
   idx_t const * const inds,
-  val_t const * const vals)
+  val_t const * const vals,
+  splatt_simd_type const simd)
 {
+  P_SIMD_DISPATCH(simd, fiber_accum, accumbuf, nfactors, leafmat, start, end,
+      inds, vals);
   /* foreach nnz in fiber */
   for(idx_t j=start; j < end; ++j) {
     val_t const v = vals[j] ;
@@ -320,23 +532,29 @@ static inline void p_csf_process_fiber(
   }
 }
 
+#undef P_SIMD_DISPATCH
 
-static inline void p_propagate_up(
+
+SPLATT_FORCE_INLINE void p_propagate_up(
   val_t * const out,
   val_t * const * const buf,
   idx_t * const restrict idxstack,
   idx_t const init_depth,
   idx_t const init_idx,
+  idx_t const child_start,
+  idx_t const child_stop,
   idx_t const * const * const fp,
   idx_t const * const * const fids,
   val_t const * const restrict vals,
   val_t ** mvals,
   idx_t const nmodes,
-  idx_t const nfactors)
+  idx_t const nfactors,
+  splatt_simd_type const simd)
 {
   /* push initial idx initialize idxstack */
   idxstack[init_depth] = init_idx;
-  for(idx_t m=init_depth+1; m < nmodes; ++m) {
+  idxstack[init_depth+1] = child_start;
+  for(idx_t m=init_depth+2; m < nmodes; ++m) {
     idxstack[m] = fp[m-1][idxstack[m-1]];
   }
 
@@ -347,7 +565,7 @@ static inline void p_propagate_up(
     buf[init_depth+1][f] = 0;
   }
 
-  while(idxstack[init_depth+1] < fp[init_depth][init_idx+1]) {
+  while(idxstack[init_depth+1] < child_stop) {
     /* skip to last internal mode */
     idx_t depth = nmodes - 2;
 
@@ -355,7 +573,7 @@ static inline void p_propagate_up(
     idx_t const start = fp[depth][idxstack[depth]];
     idx_t const end   = fp[depth][idxstack[depth]+1];
     p_csf_process_fiber(buf[depth+1], nfactors, mvals[depth+1],
-        start, end, fids[depth+1], vals);
+        start, end, fids[depth+1], vals, simd);
 
     idxstack[depth+1] = end;
 
@@ -372,7 +590,7 @@ static inline void p_propagate_up(
       /* propagate result up and clear buffer for next sibling */
       val_t const * const restrict fibrow
           = mvals[depth] + (fids[depth][idxstack[depth]] * nfactors);
-      p_add_hada_clear(buf[depth], buf[depth+1], fibrow, nfactors);
+      p_add_hada_clear(buf[depth], buf[depth+1], fibrow, nfactors, simd);
 
       ++idxstack[depth];
       --depth;
@@ -387,13 +605,16 @@ static inline void p_propagate_up(
 }
 
 
-static void p_csf_mttkrp_root3_nolock(
+SPLATT_FORCE_INLINE void p_csf_mttkrp_root3_nolock_impl(
   splatt_csf const * const ct,
   idx_t const tile_id,
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  mutex_pool * const pool,
+  idx_t const nfactors,
+  splatt_simd_type const simd)
 {
   assert(ct->nmodes == 3);
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -408,7 +629,6 @@ static void p_csf_mttkrp_root3_nolock(
   val_t const * const avals = mats[csf_depth_to_mode(ct, 1)]->vals;
   val_t const * const bvals = mats[csf_depth_to_mode(ct, 2)]->vals;
   val_t * const ovals = mats[MAX_NMODES]->vals;
-  idx_t const nfactors = mats[MAX_NMODES]->J;
 
   int const tid = splatt_omp_get_thread_num();
   val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
@@ -421,38 +641,28 @@ static void p_csf_mttkrp_root3_nolock(
 
 
   /* break up loop by partition */
-  idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(&(ct->pt[tile_id]), partition, tid, &start, &stop,
+      &fstart, &fstop);
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (sids == NULL) ? s : sids[s];
 
     val_t * const restrict mv = ovals + (fid * nfactors);
 
     /* foreach fiber in slice */
-    for(idx_t f=sptr[s]; f < sptr[s+1]; ++f) {
-      /* first entry of the fiber is used to initialize accumF */
-      idx_t const jjfirst  = fptr[f];
-      val_t const vfirst   = vals[jjfirst];
-      val_t const * const restrict bv = bvals + (inds[jjfirst] * nfactors);
+    idx_t const fbegin = SS_MAX(sptr[s], fstart);
+    idx_t const fend   = SS_MIN(sptr[s+1], fstop);
+    for(idx_t f=fbegin; f < fend; ++f) {
+      /* foreach nnz in fiber */
       for(idx_t r=0; r < nfactors; ++r) {
-        accumF[r] = vfirst * bv[r];
-      }
-
-      /* foreach nnz in fiber */
-      for(idx_t jj=fptr[f]+1; jj < fptr[f+1]; ++jj) {
-        val_t const v = vals[jj];
-        val_t const * const restrict bv = bvals + (inds[jj] * nfactors);
-        for(idx_t r=0; r < nfactors; ++r) {
-          accumF[r] += v * bv[r];
-        }
+        accumF[r] = 0.;
       }
+      p_csf_process_fiber(accumF, nfactors, bvals, fptr[f], fptr[f+1], inds,
+          vals, simd);
 
       /* scale inner products by row of A and update to M */
       val_t const * const restrict av = avals  + (fids[f] * nfactors);
-      for(idx_t r=0; r < nfactors; ++r) {
-        writeF[r] += accumF[r] * av[r];
-      }
+      p_add_hada(writeF, accumF, av, nfactors, simd);
     } /* foreach fiber */
 
     /* flush to output */
@@ -464,13 +674,17 @@ static void p_csf_mttkrp_root3_nolock(
 }
 
 
-static void p_csf_mttkrp_root3_locked(
+SPLATT_FORCE_INLINE void p_csf_mttkrp_root3_locked_impl(
   splatt_csf const * const ct,
   idx_t const tile_id,
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  mutex_pool * const pool,
+  idx_t const nfactors,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
 {
   assert(ct->nmodes == 3);
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -485,7 +699,6 @@ static void p_csf_mttkrp_root3_locked(
   val_t const * const avals = mats[csf_depth_to_mode(ct, 1)]->vals;
   val_t const * const bvals = mats[csf_depth_to_mode(ct, 2)]->vals;
   val_t * const ovals = mats[MAX_NMODES]->vals;
-  idx_t const nfactors = mats[MAX_NMODES]->J;
 
 
   int const tid = splatt_omp_get_thread_num();
@@ -497,57 +710,49 @@ static void p_csf_mttkrp_root3_locked(
     writeF[r] = 0.;
   }
 
-  idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(&(ct->pt[tile_id]), partition, tid, &start, &stop,
+      &fstart, &fstop);
   for(idx_t s=start; s < stop; ++s) {
     /* foreach fiber in slice */
-    for(idx_t f=sptr[s]; f < sptr[s+1]; ++f) {
-      /* first entry of the fiber is used to initialize accumF */
-      idx_t const jjfirst  = fptr[f];
-      val_t const vfirst   = vals[jjfirst];
-      val_t const * const restrict bv = bvals + (inds[jjfirst] * nfactors);
-      for(idx_t r=0; r < nfactors; ++r) {
-        accumF[r] = vfirst * bv[r];
-      }
-
+    idx_t const fbegin = SS_MAX(sptr[s], fstart);
+    idx_t const fend   = SS_MIN(sptr[s+1], fstop);
+    for(idx_t f=fbegin; f < fend; ++f) {
       /* foreach nnz in fiber */
-      for(idx_t jj=fptr[f]+1; jj < fptr[f+1]; ++jj) {
-        val_t const v = vals[jj];
-        val_t const * const restrict bv = bvals + (inds[jj] * nfactors);
-        for(idx_t r=0; r < nfactors; ++r) {
-          accumF[r] += v * bv[r];
-        }
+      for(idx_t r=0; r < nfactors; ++r) {
+        accumF[r] = 0.;
       }
+      p_csf_process_fiber(accumF, nfactors, bvals, fptr[f], fptr[f+1], inds,
+          vals, simd);
 
       /* scale inner products by row of A and update to M */
       val_t const * const restrict av = avals  + (fids[f] * nfactors);
-      for(idx_t r=0; r < nfactors; ++r) {
-        writeF[r] += accumF[r] * av[r];
-      }
+      p_add_hada(writeF, accumF, av, nfactors, simd);
     }
 
     idx_t const fid = (sids == NULL) ? s : sids[s];
     val_t * const restrict mv = ovals + (fid * nfactors);
 
     /* flush to output */
-    mutex_set_lock(pool, fid);
+    p_sync_add_row(mv, writeF, nfactors, fid, pool, sync);
     for(idx_t r=0; r < nfactors; ++r) {
-      mv[r] += writeF[r];
       writeF[r] = 0.;
     }
-    mutex_unset_lock(pool, fid);
   }
 }
 
 
-static void p_csf_mttkrp_intl3_locked(
+SPLATT_FORCE_INLINE void p_csf_mttkrp_intl3_locked_impl(
   splatt_csf const * const ct,
   idx_t const tile_id,
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  mutex_pool * const pool,
+  idx_t const nfactors,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
 {
   assert(ct->nmodes == 3);
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -562,14 +767,13 @@ static void p_csf_mttkrp_intl3_locked(
   val_t const * const avals = mats[csf_depth_to_mode(ct, 0)]->vals;
   val_t const * const bvals = mats[csf_depth_to_mode(ct, 2)]->vals;
   val_t * const ovals = mats[MAX_NMODES]->vals;
-  idx_t const nfactors = mats[MAX_NMODES]->J;
 
   int const tid = splatt_omp_get_thread_num();
   val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
 
-  idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(&(ct->pt[tile_id]), partition, tid, &start, &stop,
+      &fstart, &fstop);
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (sids == NULL) ? s : sids[s];
 
@@ -577,43 +781,35 @@ static void p_csf_mttkrp_intl3_locked(
     val_t const * const restrict rv = avals + (fid * nfactors);
 
     /* foreach fiber in slice */
-    for(idx_t f=sptr[s]; f < sptr[s+1]; ++f) {
-      /* first entry of the fiber is used to initialize accumF */
-      idx_t const jjfirst  = fptr[f];
-      val_t const vfirst   = vals[jjfirst];
-      val_t const * const restrict bv = bvals + (inds[jjfirst] * nfactors);
-      for(idx_t r=0; r < nfactors; ++r) {
-        accumF[r] = vfirst * bv[r];
-      }
-
+    idx_t const fbegin = SS_MAX(sptr[s], fstart);
+    idx_t const fend   = SS_MIN(sptr[s+1], fstop);
+    for(idx_t f=fbegin; f < fend; ++f) {
       /* foreach nnz in fiber */
-      for(idx_t jj=fptr[f]+1; jj < fptr[f+1]; ++jj) {
-        val_t const v = vals[jj];
-        val_t const * const restrict bv = bvals + (inds[jj] * nfactors);
-        for(idx_t r=0; r < nfactors; ++r) {
-          accumF[r] += v * bv[r];
-        }
+      for(idx_t r=0; r < nfactors; ++r) {
+        accumF[r] = 0.;
       }
+      p_csf_process_fiber(accumF, nfactors, bvals, fptr[f], fptr[f+1], inds,
+          vals, simd);
 
       /* write to fiber row */
       val_t * const restrict ov = ovals  + (fids[f] * nfactors);
-      mutex_set_lock(pool, fids[f]);
-      for(idx_t r=0; r < nfactors; ++r) {
-        ov[r] += rv[r] * accumF[r];
-      }
-      mutex_unset_lock(pool, fids[f]);
+      p_sync_add_hada(ov, rv, accumF, nfactors, fids[f], pool, sync, simd);
     }
   }
 }
 
 
-static void p_csf_mttkrp_leaf3_locked(
+SPLATT_FORCE_INLINE void p_csf_mttkrp_leaf3_locked_impl(
   splatt_csf const * const ct,
   idx_t const tile_id,
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  mutex_pool * const pool,
+  idx_t const nfactors,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
 {
   assert(ct->nmodes == 3);
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -628,14 +824,13 @@ static void p_csf_mttkrp_leaf3_locked(
   val_t const * const avals = mats[csf_depth_to_mode(ct, 0)]->vals;
   val_t const * const bvals = mats[csf_depth_to_mode(ct, 1)]->vals;
   val_t * const ovals = mats[MAX_NMODES]->vals;
-  idx_t const nfactors = mats[MAX_NMODES]->J;
 
   int const tid = splatt_omp_get_thread_num();
   val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
 
-  idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(&(ct->pt[tile_id]), partition, tid, &start, &stop,
+      &fstart, &fstop);
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (sids == NULL) ? s : sids[s];
 
@@ -643,35 +838,392 @@ static void p_csf_mttkrp_leaf3_locked(
     val_t const * const restrict rv = avals + (fid * nfactors);
 
     /* foreach fiber in slice */
-    for(idx_t f=sptr[s]; f < sptr[s+1]; ++f) {
+    idx_t const fbegin = SS_MAX(sptr[s], fstart);
+    idx_t const fend   = SS_MIN(sptr[s+1], fstop);
+    for(idx_t f=fbegin; f < fend; ++f) {
       /* fill fiber with hada */
       val_t const * const restrict av = bvals  + (fids[f] * nfactors);
-      for(idx_t r=0; r < nfactors; ++r) {
-        accumF[r] = rv[r] * av[r];
-      }
+      p_assign_hada(accumF, rv, av, nfactors, simd);
 
       /* foreach nnz in fiber, scale with hada and write to ovals */
-      for(idx_t jj=fptr[f]; jj < fptr[f+1]; ++jj) {
-        val_t const v = vals[jj];
-        val_t * const restrict ov = ovals + (inds[jj] * nfactors);
-        mutex_set_lock(pool, inds[jj]);
-        for(idx_t r=0; r < nfactors; ++r) {
-          ov[r] += v * accumF[r];
+      p_csf_process_fiber_locked(ovals, accumF, nfactors, fptr[f], fptr[f+1],
+          inds, vals, pool, sync, simd);
+    }
+  }
+}
+
+
+/*
+ * Fixed-depth kernels for 4- and 5-mode tensors. The generic kernels below
+ * walk the tree with an explicit stack because its depth is only known at
+ * runtime. Here each level of the tree is its own loop: P_CSF_FIXED_UP() and
+ * P_CSF_FIXED_DOWN() generate one force-inlined function per level, and the
+ * number of modes, the output level, and the synchronization are constants in
+ * each instantiation, so a traversal compiles to a plain loop nest.
+ *
+ * Buffer conventions match the generic kernels: buf[d] holds the product of
+ * the rows above and including depth d on the way down, or the subtree sum
+ * below depth d on the way up.
+ */
+
+
+/**
+* @brief buf[level] = the sum of vals[j] * row(fids[level+1][j]) over the
+*        leaves j in [start, end).
+*/
+SPLATT_FORCE_INLINE void p_csf_fixed_up1(
+  idx_t const level,
+  idx_t const start,
+  idx_t const end,
+  idx_t const * const * const restrict fp,
+  idx_t const * const * const restrict fids,
+  val_t const * const restrict vals,
+  val_t * const * const mvals,
+  val_t * const * const buf,
+  idx_t const nfactors,
+  splatt_simd_type const simd)
+{
+  val_t * const restrict out = buf[level];
+  for(idx_t f=0; f < nfactors; ++f) {
+    out[f] = 0.;
+  }
+  p_csf_process_fiber(out, nfactors, mvals[level+1], start, end,
+      fids[level+1], vals, simd);
+}
+
+
+/* buf[level] = the sum over the children [start, end) of their subtree sums,
+ * each scaled by the child's row. HEIGHT is the distance to the leaves. */
+#define P_CSF_FIXED_UP(HEIGHT, CHILD) \
+SPLATT_FORCE_INLINE void p_csf_fixed_up##HEIGHT( \
+  idx_t const level, \
+  idx_t const start, \
+  idx_t const end, \
+  idx_t const * const * const restrict fp, \
+  idx_t const * const * const restrict fids, \
+  val_t const * const restrict vals, \
+  val_t * const * const mvals, \
+  val_t * const * const buf, \
+  idx_t const nfactors, \
+  splatt_simd_type const simd) \
+{ \
+  val_t * const restrict out = buf[level]; \
+  for(idx_t f=0; f < nfactors; ++f) { \
+    out[f] = 0.; \
+  } \
+  for(idx_t c=start; c < end; ++c) { \
+    p_csf_fixed_up##CHILD(level+1, fp[level+1][c], fp[level+1][c+1], fp, \
+        fids, vals, mvals, buf, nfactors, simd); \
+    val_t const * const restrict crow = \
+        mvals[level+1] + (fids[level+1][c] * nfactors); \
+    p_add_hada(out, buf[level+1], crow, nfactors, simd); \
+  } \
+}
+
+P_CSF_FIXED_UP(2, 1)
+P_CSF_FIXED_UP(3, 2)
+P_CSF_FIXED_UP(4, 3)
+
+#undef P_CSF_FIXED_UP
+
+
+/**
+* @brief buf[level] = the subtree sum of the children [start, end) of a node,
+*        where 'height' (a constant) is the distance from 'level' to the
+*        leaves.
+*/
+SPLATT_FORCE_INLINE void p_csf_fixed_up(
+  idx_t const height,
+  idx_t const level,
+  idx_t const start,
+  idx_t const end,
+  idx_t const * const * const restrict fp,
+  idx_t const * const * const restrict fids,
+  val_t const * const restrict vals,
+  val_t * const * const mvals,
+  val_t * const * const buf,
+  idx_t const nfactors,
+  splatt_simd_type const simd)
+{
+  switch(height) {
+  case 1:
+    p_csf_fixed_up1(level, start, end, fp, fids, vals, mvals, buf, nfactors,
+        simd);
+    break;
+  case 2:
+    p_csf_fixed_up2(level, start, end, fp, fids, vals, mvals, buf, nfactors,
+        simd);
+    break;
+  case 3:
+    p_csf_fixed_up3(level, start, end, fp, fids, vals, mvals, buf, nfactors,
+        simd);
+    break;
+  case 4:
+    p_csf_fixed_up4(level, start, end, fp, fids, vals, mvals, buf, nfactors,
+        simd);
+    break;
+  default:
+    assert(false);
+  }
+}
+
+
+/**
+* @brief Write the contribution of one node to the output. buf[level-1] holds
+*        the product of the rows above the node.
+*
+*        If the output is an internal level, the node is at 'outdepth' and its
+*        subtree sum is scaled by buf[level-1]. If the output is the leaves,
+*        the node is the parent of the leaves and its row is first multiplied
+*        into buf[level].
+*/
+SPLATT_FORCE_INLINE void p_csf_fixed_node(
+  idx_t const nmodes,
+  idx_t const outdepth,
+  idx_t const level,
+  idx_t const node,
+  idx_t const * const * const restrict fp,
+  idx_t const * const * const restrict fids,
+  val_t const * const restrict vals,
+  val_t * const * const mvals,
+  val_t * const * const buf,
+  val_t * const ovals,
+  idx_t const nfactors,
+  bool const locked,
+  mutex_pool * const pool,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
+{
+  idx_t const start = fp[level][node];
+  idx_t const end = fp[level][node+1];
+
+  if(outdepth == nmodes - 1) {
+    val_t const * const restrict nrow =
+        mvals[level] + (fids[level][node] * nfactors);
+    p_assign_hada(buf[level], buf[level-1], nrow, nfactors, simd);
+    if(locked) {
+      p_csf_process_fiber_locked(ovals, buf[level], nfactors, start, end,
+          fids[level+1], vals, pool, sync, simd);
+    } else {
+      p_csf_process_fiber_nolock(ovals, buf[level], nfactors, start, end,
+          fids[level+1], vals, simd);
+    }
+    return;
+  }
+
+  p_csf_fixed_up(nmodes - 1 - level, level, start, end, fp, fids, vals, mvals,
+      buf, nfactors, simd);
+
+  idx_t const orow_id = fids[level][node];
+  val_t * const restrict orow = ovals + (orow_id * nfactors);
+  if(locked) {
+    p_sync_add_hada(orow, buf[level-1], buf[level], nfactors, orow_id, pool,
+        sync, simd);
+  } else {
+    p_add_hada(orow, buf[level-1], buf[level], nfactors, simd);
+  }
+}
+
+
+/* Visit the children [start, end) of a node at 'level', pushing the product
+ * of rows down. DIST is how many levels remain to the node which writes
+ * output (see p_csf_fixed_node()). */
+#define P_CSF_FIXED_DOWN(DIST, CHILD) \
+SPLATT_FORCE_INLINE void p_csf_fixed_down##DIST( \
+  idx_t const nmodes, \
+  idx_t const outdepth, \
+  idx_t const level, \
+  idx_t const start, \
+  idx_t const end, \
+  idx_t const * const * const restrict fp, \
+  idx_t const * const * const restrict fids, \
+  val_t const * const restrict vals, \
+  val_t * const * const mvals, \
+  val_t * const * const buf, \
+  val_t * const ovals, \
+  idx_t const nfactors, \
+  bool const locked, \
+  mutex_pool * const pool, \
+  splatt_sync_type const sync, \
+  splatt_simd_type const simd) \
+{ \
+  for(idx_t c=start; c < end; ++c) { \
+    val_t const * const restrict crow = \
+        mvals[level+1] + (fids[level+1][c] * nfactors); \
+    p_assign_hada(buf[level+1], buf[level], crow, nfactors, simd); \
+    p_csf_fixed_down##CHILD(nmodes, outdepth, level+1, fp[level+1][c], \
+        fp[level+1][c+1], fp, fids, vals, mvals, buf, ovals, nfactors, \
+        locked, pool, sync, simd); \
+  } \
+}
+
+SPLATT_FORCE_INLINE void p_csf_fixed_down1(
+  idx_t const nmodes,
+  idx_t const outdepth,
+  idx_t const level,
+  idx_t const start,
+  idx_t const end,
+  idx_t const * const * const restrict fp,
+  idx_t const * const * const restrict fids,
+  val_t const * const restrict vals,
+  val_t * const * const mvals,
+  val_t * const * const buf,
+  val_t * const ovals,
+  idx_t const nfactors,
+  bool const locked,
+  mutex_pool * const pool,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
+{
+  for(idx_t c=start; c < end; ++c) {
+    p_csf_fixed_node(nmodes, outdepth, level+1, c, fp, fids, vals, mvals, buf,
+        ovals, nfactors, locked, pool, sync, simd);
+  }
+}
+
+P_CSF_FIXED_DOWN(2, 1)
+P_CSF_FIXED_DOWN(3, 2)
+
+#undef P_CSF_FIXED_DOWN
+
+
+/**
+* @brief MTTKRP for a tensor with exactly 'nmodes' modes, writing to CSF level
+*        'outdepth'. Both are constants in every call site.
+*/
+SPLATT_FORCE_INLINE void p_csf_mttkrp_fixed_impl(
+  splatt_csf const * const ct,
+  idx_t const tile_id,
+  matrix_t ** mats,
+  thd_info * const thds,
+  idx_t const * const restrict partition,
+  mutex_pool * const pool,
+  idx_t const nmodes,
+  idx_t const outdepth,
+  idx_t const nfactors,
+  bool const locked,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
+{
+  assert(ct->nmodes == nmodes);
+  val_t const * const vals = ct->pt[tile_id].vals;
+  idx_t const * const * const restrict fp
+      = (idx_t const * const *) ct->pt[tile_id].fptr;
+  idx_t const * const * const restrict fids
+      = (idx_t const * const *) ct->pt[tile_id].fids;
+
+  val_t * mvals[MAX_NMODES];
+  val_t * buf[MAX_NMODES];
+
+  int const tid = splatt_omp_get_thread_num();
+  for(idx_t m=0; m < nmodes; ++m) {
+    mvals[m] = mats[csf_depth_to_mode(ct, m)]->vals;
+    buf[m] = ((val_t *) thds[tid].scratch[2]) + (nfactors * m);
+  }
+  val_t * const ovals = mats[MAX_NMODES]->vals;
+
+  /* the node which writes output is the parent of the leaves for leaf mode */
+  idx_t const nodedepth = SS_MIN(outdepth, nmodes - 2);
+
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(&(ct->pt[tile_id]), partition, tid, &start, &stop,
+      &fstart, &fstop);
+  for(idx_t s=start; s < stop; ++s) {
+    idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
+    idx_t const cstart = SS_MAX(fp[0][s], fstart);
+    idx_t const cend = SS_MIN(fp[0][s+1], fstop);
+
+    if(outdepth == 0) {
+      p_csf_fixed_up(nmodes - 1, 0, cstart, cend, fp, fids, vals, mvals, buf,
+          nfactors, simd);
+      val_t * const restrict orow = ovals + (fid * nfactors);
+      if(locked) {
+        p_sync_add_row(orow, buf[0], nfactors, fid, pool, sync);
+      } else {
+        for(idx_t f=0; f < nfactors; ++f) {
+          orow[f] += buf[0][f];
         }
-        mutex_unset_lock(pool, inds[jj]);
       }
+      continue;
+    }
+
+    val_t const * const restrict rootrow = mvals[0] + (fid * nfactors);
+    for(idx_t f=0; f < nfactors; ++f) {
+      buf[0][f] = rootrow[f];
+    }
+
+    switch(nodedepth) {
+    case 1:
+      p_csf_fixed_down1(nmodes, outdepth, 0, cstart, cend, fp, fids, vals,
+          mvals, buf, ovals, nfactors, locked, pool, sync, simd);
+      break;
+    case 2:
+      p_csf_fixed_down2(nmodes, outdepth, 0, cstart, cend, fp, fids, vals,
+          mvals, buf, ovals, nfactors, locked, pool, sync, simd);
+      break;
+    case 3:
+      p_csf_fixed_down3(nmodes, outdepth, 0, cstart, cend, fp, fids, vals,
+          mvals, buf, ovals, nfactors, locked, pool, sync, simd);
+      break;
+    default:
+      assert(false);
     }
   }
 }
 
 
-static void p_csf_mttkrp_root_nolock(
+/**
+* @brief Run a fixed-depth kernel if one exists for this tensor and output
+*        level. 'locked', 'sync', and 'simd' are constants in every caller, so
+*        each kernel wrapper only instantiates the cases it can reach.
+*
+* @return True if the MTTKRP was computed.
+*/
+SPLATT_FORCE_INLINE bool p_csf_mttkrp_fixed(
+  splatt_csf const * const ct,
+  idx_t const tile_id,
+  matrix_t ** mats,
+  thd_info * const thds,
+  idx_t const * const restrict partition,
+  mutex_pool * const pool,
+  idx_t const outdepth,
+  idx_t const nfactors,
+  bool const locked,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
+{
+#define P_CSF_FIXED_CASE(NMODES, OUTDEPTH) \
+  if(ct->nmodes == (NMODES) && outdepth == (OUTDEPTH)) { \
+    p_csf_mttkrp_fixed_impl(ct, tile_id, mats, thds, partition, pool, \
+        (NMODES), (OUTDEPTH), nfactors, locked, sync, simd); \
+    return true; \
+  }
+
+  P_CSF_FIXED_CASE(4, 0)
+  P_CSF_FIXED_CASE(4, 1)
+  P_CSF_FIXED_CASE(4, 2)
+  P_CSF_FIXED_CASE(4, 3)
+  P_CSF_FIXED_CASE(5, 0)
+  P_CSF_FIXED_CASE(5, 1)
+  P_CSF_FIXED_CASE(5, 2)
+  P_CSF_FIXED_CASE(5, 3)
+  P_CSF_FIXED_CASE(5, 4)
+
+#undef P_CSF_FIXED_CASE
+  return false;
+}
+
+
+SPLATT_FORCE_INLINE void p_csf_mttkrp_root_nolock_impl(
   splatt_csf const * const ct,
   idx_t const tile_id,
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  mutex_pool * const pool,
+  idx_t const nfactors,
+  splatt_simd_type const simd)
 {
   /* extract tensor structures */
   idx_t const nmodes = ct->nmodes;
@@ -683,7 +1235,12 @@ static void p_csf_mttkrp_root_nolock(
   }
 
   if(nmodes == 3) {
-    p_csf_mttkrp_root3_nolock(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_root3_nolock_impl(ct, tile_id, mats, mode, thds, partition,
+        pool, nfactors, simd);
+    return;
+  }
+  if(p_csf_mttkrp_fixed(ct, tile_id, mats, thds, partition, pool, 0, nfactors,
+      false, SPLATT_SYNC_LOCK, simd)) {
     return;
   }
 
@@ -691,7 +1248,6 @@ static void p_csf_mttkrp_root_nolock(
       = (idx_t const * const *) ct->pt[tile_id].fptr;
   idx_t const * const * const restrict fids
       = (idx_t const * const *) ct->pt[tile_id].fids;
-  idx_t const nfactors = mats[0]->J;
 
   val_t * mvals[MAX_NMODES];
   val_t * buf[MAX_NMODES];
@@ -711,15 +1267,17 @@ static void p_csf_mttkrp_root_nolock(
   assert(nfibs <= mats[MAX_NMODES]->I);
 
   /* break up loop by partition */
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nfibs;
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(&(ct->pt[tile_id]), partition, tid, &start, &stop,
+      &fstart, &fstop);
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
 
     assert(fid < mats[MAX_NMODES]->I);
 
-    p_propagate_up(buf[0], buf, idxstack, 0, s, fp, fids,
-        vals, mvals, nmodes, nfactors);
+    p_propagate_up(buf[0], buf, idxstack, 0, s, SS_MAX(fp[0][s], fstart),
+        SS_MIN(fp[0][s+1], fstop), fp, fids, vals, mvals, nmodes, nfactors,
+        simd);
 
     val_t       * const restrict orow = ovals + (fid * nfactors);
     val_t const * const restrict obuf = buf[0];
@@ -733,13 +1291,17 @@ static void p_csf_mttkrp_root_nolock(
 
 
 
-static void p_csf_mttkrp_root_locked(
+SPLATT_FORCE_INLINE void p_csf_mttkrp_root_locked_impl(
   splatt_csf const * const ct,
   idx_t const tile_id,
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  mutex_pool * const pool,
+  idx_t const nfactors,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
 {
   /* extract tensor structures */
   idx_t const nmodes = ct->nmodes;
@@ -751,7 +1313,12 @@ static void p_csf_mttkrp_root_locked(
   }
 
   if(nmodes == 3) {
-    p_csf_mttkrp_root3_locked(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_root3_locked_impl(ct, tile_id, mats, mode, thds, partition,
+        pool, nfactors, sync, simd);
+    return;
+  }
+  if(p_csf_mttkrp_fixed(ct, tile_id, mats, thds, partition, pool, 0, nfactors,
+      true, sync, simd)) {
     return;
   }
 
@@ -759,7 +1326,6 @@ static void p_csf_mttkrp_root_locked(
       = (idx_t const * const *) ct->pt[tile_id].fptr;
   idx_t const * const * const restrict fids
       = (idx_t const * const *) ct->pt[tile_id].fids;
-  idx_t const nfactors = mats[0]->J;
 
   val_t * mvals[MAX_NMODES];
   val_t * buf[MAX_NMODES];
@@ -778,34 +1344,35 @@ static void p_csf_mttkrp_root_locked(
   idx_t const nfibs = ct->pt[tile_id].nfibs[0];
   assert(nfibs <= mats[MAX_NMODES]->I);
 
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nfibs;
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(&(ct->pt[tile_id]), partition, tid, &start, &stop,
+      &fstart, &fstop);
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
 
     assert(fid < mats[MAX_NMODES]->I);
 
-    p_propagate_up(buf[0], buf, idxstack, 0, s, fp, fids,
-        vals, mvals, nmodes, nfactors);
+    p_propagate_up(buf[0], buf, idxstack, 0, s, SS_MAX(fp[0][s], fstart),
+        SS_MIN(fp[0][s+1], fstop), fp, fids, vals, mvals, nmodes, nfactors,
+        simd);
 
     val_t * const restrict orow = ovals + (fid * nfactors);
     val_t const * const restrict obuf = buf[0];
-    mutex_set_lock(pool, fid);
-    for(idx_t f=0; f < nfactors; ++f) {
-      orow[f] += obuf[f];
-    }
-    mutex_unset_lock(pool, fid);
+    p_sync_add_row(orow, obuf, nfactors, fid, pool, sync);
   } /* end foreach outer slice */
 }
 
 
-static void p_csf_mttkrp_leaf3_nolock(
+SPLATT_FORCE_INLINE void p_csf_mttkrp_leaf3_nolock_impl(
   splatt_csf const * const ct,
   idx_t const tile_id,
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const partition,
+  mutex_pool * const pool,
+  idx_t const nfactors,
+  splatt_simd_type const simd)
 {
   assert(ct->nmodes == 3);
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -820,14 +1387,13 @@ static void p_csf_mttkrp_leaf3_nolock(
   val_t const * const avals = mats[csf_depth_to_mode(ct, 0)]->vals;
   val_t const * const bvals = mats[csf_depth_to_mode(ct, 1)]->vals;
   val_t * const ovals = mats[MAX_NMODES]->vals;
-  idx_t const nfactors = mats[MAX_NMODES]->J;
 
   int const tid = splatt_omp_get_thread_num();
   val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
 
-  idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(&(ct->pt[tile_id]), partition, tid, &start, &stop,
+      &fstart, &fstop);
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (sids == NULL) ? s : sids[s];
 
@@ -835,21 +1401,16 @@ static void p_csf_mttkrp_leaf3_nolock(
     val_t const * const restrict rv = avals + (fid * nfactors);
 
     /* foreach fiber in slice */
-    for(idx_t f=sptr[s]; f < sptr[s+1]; ++f) {
+    idx_t const fbegin = SS_MAX(sptr[s], fstart);
+    idx_t const fend   = SS_MIN(sptr[s+1], fstop);
+    for(idx_t f=fbegin; f < fend; ++f) {
       /* fill fiber with hada */
       val_t const * const restrict av = bvals  + (fids[f] * nfactors);
-      for(idx_t r=0; r < nfactors; ++r) {
-        accumF[r] = rv[r] * av[r];
-      }
+      p_assign_hada(accumF, rv, av, nfactors, simd);
 
       /* foreach nnz in fiber, scale with hada and write to ovals */
-      for(idx_t jj=fptr[f]; jj < fptr[f+1]; ++jj) {
-        val_t const v = vals[jj];
-        val_t * const restrict ov = ovals + (inds[jj] * nfactors);
-        for(idx_t r=0; r < nfactors; ++r) {
-          ov[r] += v * accumF[r];
-        }
-      }
+      p_csf_process_fiber_nolock(ovals, accumF, nfactors, fptr[f], fptr[f+1],
+          inds, vals, simd);
     }
   }
 }
@@ -857,13 +1418,16 @@ static void p_csf_mttkrp_leaf3_nolock(
 
 
 
-static void p_csf_mttkrp_leaf_nolock(
+SPLATT_FORCE_INLINE void p_csf_mttkrp_leaf_nolock_impl(
   splatt_csf const * const ct,
   idx_t const tile_id,
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const partition,
+  mutex_pool * const pool,
+  idx_t const nfactors,
+  splatt_simd_type const simd)
 {
   val_t const * const vals = ct->pt[tile_id].vals;
   idx_t const nmodes = ct->nmodes;
@@ -872,7 +1436,12 @@ static void p_csf_mttkrp_leaf_nolock(
     return;
   }
   if(nmodes == 3) {
-    p_csf_mttkrp_leaf3_nolock(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_leaf3_nolock_impl(ct, tile_id, mats, mode, thds, partition,
+        pool, nfactors, simd);
+    return;
+  }
+  if(p_csf_mttkrp_fixed(ct, tile_id, mats, thds, partition, pool, nmodes-1,
+      nfactors, false, SPLATT_SYNC_LOCK, simd)) {
     return;
   }
 
@@ -882,7 +1451,6 @@ static void p_csf_mttkrp_leaf_nolock(
   idx_t const * const * const restrict fids
       = (idx_t const * const *) ct->pt[tile_id].fids;
 
-  idx_t const nfactors = mats[0]->J;
 
   val_t * mvals[MAX_NMODES];
   val_t * buf[MAX_NMODES];
@@ -896,15 +1464,16 @@ static void p_csf_mttkrp_leaf_nolock(
   }
 
   /* foreach outer slice */
-  idx_t const nouter = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nouter;
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(&(ct->pt[tile_id]), partition, tid, &start, &stop,
+      &fstart, &fstop);
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
     idxstack[0] = s;
 
     /* clear out stale data */
-    for(idx_t m=1; m < nmodes-1; ++m) {
+    idxstack[1] = SS_MAX(fp[0][s], fstart);
+    for(idx_t m=2; m < nmodes-1; ++m) {
       idxstack[m] = fp[m-1][idxstack[m-1]];
     }
 
@@ -917,21 +1486,21 @@ static void p_csf_mttkrp_leaf_nolock(
 
     idx_t depth = 0;
 
-    idx_t const outer_end = fp[0][s+1];
+    idx_t const outer_end = SS_MIN(fp[0][s+1], fstop);
     while(idxstack[1] < outer_end) {
       /* move down to an nnz node */
       for(; depth < nmodes-2; ++depth) {
         /* propogate buf down */
         val_t const * const restrict drow
             = mvals[depth+1] + (fids[depth+1][idxstack[depth+1]] * nfactors);
-        p_assign_hada(buf[depth+1], buf[depth], drow, nfactors);
+        p_assign_hada(buf[depth+1], buf[depth], drow, nfactors, simd);
       }
 
       /* process all nonzeros [start, end) */
       idx_t const start = fp[depth][idxstack[depth]];
       idx_t const end   = fp[depth][idxstack[depth]+1];
       p_csf_process_fiber_nolock(mats[MAX_NMODES]->vals, buf[depth],
-          nfactors, start, end, fids[depth+1], vals);
+          nfactors, start, end, fids[depth+1], vals, simd);
 
       /* now move back up to the next unprocessed child */
       do {
@@ -943,13 +1512,17 @@ static void p_csf_mttkrp_leaf_nolock(
 }
 
 
-static void p_csf_mttkrp_leaf_locked(
+SPLATT_FORCE_INLINE void p_csf_mttkrp_leaf_locked_impl(
   splatt_csf const * const ct,
   idx_t const tile_id,
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  mutex_pool * const pool,
+  idx_t const nfactors,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
 {
   /* extract tensor structures */
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -959,7 +1532,12 @@ static void p_csf_mttkrp_leaf_locked(
     return;
   }
   if(nmodes == 3) {
-    p_csf_mttkrp_leaf3_locked(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_leaf3_locked_impl(ct, tile_id, mats, mode, thds, partition,
+        pool, nfactors, sync, simd);
+    return;
+  }
+  if(p_csf_mttkrp_fixed(ct, tile_id, mats, thds, partition, pool, nmodes-1,
+      nfactors, true, sync, simd)) {
     return;
   }
 
@@ -968,7 +1546,6 @@ static void p_csf_mttkrp_leaf_locked(
   idx_t const * const * const restrict fids
       = (idx_t const * const *) ct->pt[tile_id].fids;
 
-  idx_t const nfactors = mats[0]->J;
 
   val_t * mvals[MAX_NMODES];
   val_t * buf[MAX_NMODES];
@@ -982,15 +1559,16 @@ static void p_csf_mttkrp_leaf_locked(
   }
 
   /* foreach outer slice */
-  idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(&(ct->pt[tile_id]), partition, tid, &start, &stop,
+      &fstart, &fstop);
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
     idxstack[0] = s;
 
     /* clear out stale data */
-    for(idx_t m=1; m < nmodes-1; ++m) {
+    idxstack[1] = SS_MAX(fp[0][s], fstart);
+    for(idx_t m=2; m < nmodes-1; ++m) {
       idxstack[m] = fp[m-1][idxstack[m-1]];
     }
 
@@ -1003,21 +1581,21 @@ static void p_csf_mttkrp_leaf_locked(
 
     idx_t depth = 0;
 
-    idx_t const outer_end = fp[0][s+1];
+    idx_t const outer_end = SS_MIN(fp[0][s+1], fstop);
     while(idxstack[1] < outer_end) {
       /* move down to an nnz node */
       for(; depth < nmodes-2; ++depth) {
         /* propogate buf down */
         val_t const * const restrict drow
             = mvals[depth+1] + (fids[depth+1][idxstack[depth+1]] * nfactors);
-        p_assign_hada(buf[depth+1], buf[depth], drow, nfactors);
+        p_assign_hada(buf[depth+1], buf[depth], drow, nfactors, simd);
       }
 
       /* process all nonzeros [start, end) */
       idx_t const start = fp[depth][idxstack[depth]];
       idx_t const end   = fp[depth][idxstack[depth]+1];
       p_csf_process_fiber_locked(mats[MAX_NMODES]->vals, buf[depth],
-          nfactors, start, end, fids[depth+1], vals);
+          nfactors, start, end, fids[depth+1], vals, pool, sync, simd);
 
       /* now move back up to the next unprocessed child */
       do {
@@ -1029,13 +1607,16 @@ static void p_csf_mttkrp_leaf_locked(
 }
 
 
-static void p_csf_mttkrp_intl3_nolock(
+SPLATT_FORCE_INLINE void p_csf_mttkrp_intl3_nolock_impl(
   splatt_csf const * const ct,
   idx_t const tile_id,
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const partition,
+  mutex_pool * const pool,
+  idx_t const nfactors,
+  splatt_simd_type const simd)
 {
   assert(ct->nmodes == 3);
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -1050,14 +1631,13 @@ static void p_csf_mttkrp_intl3_nolock(
   val_t const * const avals = mats[csf_depth_to_mode(ct, 0)]->vals;
   val_t const * const bvals = mats[csf_depth_to_mode(ct, 2)]->vals;
   val_t * const ovals = mats[MAX_NMODES]->vals;
-  idx_t const nfactors = mats[MAX_NMODES]->J;
 
   int const tid = splatt_omp_get_thread_num();
   val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
 
-  idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(&(ct->pt[tile_id]), partition, tid, &start, &stop,
+      &fstart, &fstop);
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (sids == NULL) ? s : sids[s];
 
@@ -1065,41 +1645,34 @@ static void p_csf_mttkrp_intl3_nolock(
     val_t const * const restrict rv = avals + (fid * nfactors);
 
     /* foreach fiber in slice */
-    for(idx_t f=sptr[s]; f < sptr[s+1]; ++f) {
-      /* first entry of the fiber is used to initialize accumF */
-      idx_t const jjfirst  = fptr[f];
-      val_t const vfirst   = vals[jjfirst];
-      val_t const * const restrict bv = bvals + (inds[jjfirst] * nfactors);
-      for(idx_t r=0; r < nfactors; ++r) {
-        accumF[r] = vfirst * bv[r];
-      }
-
+    idx_t const fbegin = SS_MAX(sptr[s], fstart);
+    idx_t const fend   = SS_MIN(sptr[s+1], fstop);
+    for(idx_t f=fbegin; f < fend; ++f) {
       /* foreach nnz in fiber */
-      for(idx_t jj=fptr[f]+1; jj < fptr[f+1]; ++jj) {
-        val_t const v = vals[jj];
-        val_t const * const restrict bv = bvals + (inds[jj] * nfactors);
-        for(idx_t r=0; r < nfactors; ++r) {
-          accumF[r] += v * bv[r];
-        }
+      for(idx_t r=0; r < nfactors; ++r) {
+        accumF[r] = 0.;
       }
+      p_csf_process_fiber(accumF, nfactors, bvals, fptr[f], fptr[f+1], inds,
+          vals, simd);
 
       /* write to fiber row */
       val_t * const restrict ov = ovals  + (fids[f] * nfactors);
-      for(idx_t r=0; r < nfactors; ++r) {
-        ov[r] += rv[r] * accumF[r];
-      }
+      p_add_hada(ov, rv, accumF, nfactors, simd);
     }
   }
 }
 
 
-static void p_csf_mttkrp_intl_nolock(
+SPLATT_FORCE_INLINE void p_csf_mttkrp_intl_nolock_impl(
   splatt_csf const * const ct,
   idx_t const tile_id,
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const partition,
+  mutex_pool * const pool,
+  idx_t const nfactors,
+  splatt_simd_type const simd)
 {
   /* extract tensor structures */
   idx_t const nmodes = ct->nmodes;
@@ -1109,7 +1682,12 @@ static void p_csf_mttkrp_intl_nolock(
     return;
   }
   if(nmodes == 3) {
-    p_csf_mttkrp_intl3_nolock(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_intl3_nolock_impl(ct, tile_id, mats, mode, thds, partition,
+        pool, nfactors, simd);
+    return;
+  }
+  if(p_csf_mttkrp_fixed(ct, tile_id, mats, thds, partition, pool,
+      csf_mode_to_depth(ct, mode), nfactors, false, SPLATT_SYNC_LOCK, simd)) {
     return;
   }
 
@@ -1118,7 +1696,6 @@ static void p_csf_mttkrp_intl_nolock(
   idx_t const * const * const restrict fids
       = (idx_t const * const *) ct->pt[tile_id].fids;
 
-  idx_t const nfactors = mats[0]->J;
 
   /* find out which level in the tree this is */
   idx_t const outdepth = csf_mode_to_depth(ct, mode);
@@ -1137,15 +1714,16 @@ static void p_csf_mttkrp_intl_nolock(
   val_t * const ovals = mats[MAX_NMODES]->vals;
 
   /* foreach outer slice */
-  idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(&(ct->pt[tile_id]), partition, tid, &start, &stop,
+      &fstart, &fstop);
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
 
     /* push outer slice and fill stack */
     idxstack[0] = s;
-    for(idx_t m=1; m <= outdepth; ++m) {
+    idxstack[1] = SS_MAX(fp[0][s], fstart);
+    for(idx_t m=2; m <= outdepth; ++m) {
       idxstack[m] = fp[m-1][idxstack[m-1]];
     }
 
@@ -1155,25 +1733,29 @@ static void p_csf_mttkrp_intl_nolock(
       buf[0][f] = rootrow[f];
     }
 
-    /* process entire subtree */
+    /* process our part of the subtree */
+    idx_t const outer_end = SS_MIN(fp[0][s+1], fstop);
     idx_t depth = 0;
-    while(idxstack[1] < fp[0][s+1]) {
+    while(idxstack[1] < outer_end) {
       /* propagate values down to outdepth-1 */
       for(; depth < outdepth; ++depth) {
         val_t const * const restrict drow
             = mvals[depth+1] + (fids[depth+1][idxstack[depth+1]] * nfactors);
-        p_assign_hada(buf[depth+1], buf[depth], drow, nfactors);
+        p_assign_hada(buf[depth+1], buf[depth], drow, nfactors, simd);
       }
 
       /* write to output and clear buf[outdepth] for next subtree */
       idx_t const noderow = fids[outdepth][idxstack[outdepth]];
 
       /* propagate value up to buf[outdepth] */
-      p_propagate_up(buf[outdepth], buf, idxstack, outdepth,idxstack[outdepth],
-          fp, fids, vals, mvals, nmodes, nfactors);
+      idx_t const node = idxstack[outdepth];
+      p_propagate_up(buf[outdepth], buf, idxstack, outdepth, node,
+          fp[outdepth][node], fp[outdepth][node+1], fp, fids, vals, mvals,
+          nmodes, nfactors, simd);
 
       val_t * const restrict outbuf = ovals + (noderow * nfactors);
-      p_add_hada_clear(outbuf, buf[outdepth], buf[outdepth-1], nfactors);
+      p_add_hada_clear(outbuf, buf[outdepth], buf[outdepth-1], nfactors,
+          simd);
 
       /* backtrack to next unfinished node */
       do {
@@ -1185,13 +1767,17 @@ static void p_csf_mttkrp_intl_nolock(
 }
 
 
-static void p_csf_mttkrp_intl_locked(
+SPLATT_FORCE_INLINE void p_csf_mttkrp_intl_locked_impl(
   splatt_csf const * const ct,
   idx_t const tile_id,
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const partition,
+  mutex_pool * const pool,
+  idx_t const nfactors,
+  splatt_sync_type const sync,
+  splatt_simd_type const simd)
 {
   /* extract tensor structures */
   idx_t const nmodes = ct->nmodes;
@@ -1201,7 +1787,12 @@ static void p_csf_mttkrp_intl_locked(
     return;
   }
   if(nmodes == 3) {
-    p_csf_mttkrp_intl3_locked(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_intl3_locked_impl(ct, tile_id, mats, mode, thds, partition,
+        pool, nfactors, sync, simd);
+    return;
+  }
+  if(p_csf_mttkrp_fixed(ct, tile_id, mats, thds, partition, pool,
+      csf_mode_to_depth(ct, mode), nfactors, true, sync, simd)) {
     return;
   }
 
@@ -1209,7 +1800,6 @@ static void p_csf_mttkrp_intl_locked(
       = (idx_t const * const *) ct->pt[tile_id].fptr;
   idx_t const * const * const restrict fids
       = (idx_t const * const *) ct->pt[tile_id].fids;
-  idx_t const nfactors = mats[0]->J;
 
   /* find out which level in the tree this is */
   idx_t const outdepth = csf_mode_to_depth(ct, mode);
@@ -1228,15 +1818,16 @@ static void p_csf_mttkrp_intl_locked(
   val_t * const ovals = mats[MAX_NMODES]->vals;
 
   /* foreach outer slice */
-  idx_t const nslices = ct->pt[tile_id].nfibs[0];
-  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
-  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(&(ct->pt[tile_id]), partition, tid, &start, &stop,
+      &fstart, &fstop);
   for(idx_t s=start; s < stop; ++s) {
     idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
 
     /* push outer slice and fill stack */
     idxstack[0] = s;
-    for(idx_t m=1; m <= outdepth; ++m) {
+    idxstack[1] = SS_MAX(fp[0][s], fstart);
+    for(idx_t m=2; m <= outdepth; ++m) {
       idxstack[m] = fp[m-1][idxstack[m-1]];
     }
 
@@ -1246,27 +1837,29 @@ static void p_csf_mttkrp_intl_locked(
       buf[0][f] = rootrow[f];
     }
 
-    /* process entire subtree */
+    /* process our part of the subtree */
+    idx_t const outer_end = SS_MIN(fp[0][s+1], fstop);
     idx_t depth = 0;
-    while(idxstack[1] < fp[0][s+1]) {
+    while(idxstack[1] < outer_end) {
       /* propagate values down to outdepth-1 */
       for(; depth < outdepth; ++depth) {
         val_t const * const restrict drow
             = mvals[depth+1] + (fids[depth+1][idxstack[depth+1]] * nfactors);
-        p_assign_hada(buf[depth+1], buf[depth], drow, nfactors);
+        p_assign_hada(buf[depth+1], buf[depth], drow, nfactors, simd);
       }
 
       /* write to output and clear buf[outdepth] for next subtree */
       idx_t const noderow = fids[outdepth][idxstack[outdepth]];
 
       /* propagate value up to buf[outdepth] */
-      p_propagate_up(buf[outdepth], buf, idxstack, outdepth,idxstack[outdepth],
-          fp, fids, vals, mvals, nmodes, nfactors);
+      idx_t const node = idxstack[outdepth];
+      p_propagate_up(buf[outdepth], buf, idxstack, outdepth, node,
+          fp[outdepth][node], fp[outdepth][node+1], fp, fids, vals, mvals,
+          nmodes, nfactors, simd);
 
       val_t * const restrict outbuf = ovals + (noderow * nfactors);
-      mutex_set_lock(pool, noderow);
-      p_add_hada_clear(outbuf, buf[outdepth], buf[outdepth-1], nfactors);
-      mutex_unset_lock(pool, noderow);
+      p_sync_add_hada_clear(outbuf, buf[outdepth], buf[outdepth-1], nfactors,
+          noderow, pool, sync, simd);
 
       /* backtrack to next unfinished node */
       do {
@@ -1279,65 +1872,1140 @@ static void p_csf_mttkrp_intl_locked(
 
 
 
+/*
+ * Rank-specialized kernels. Each *_impl() above takes 'nfactors' as a
+ * parameter and is force-inlined into the wrappers below, so a constant rank
+ * lets the compiler fully unroll the inner loops and keep rows in registers.
+ * Families for the x86 instruction sets instead call the hand-vectorized
+ * primitives in simd.c, which handle any rank.
+ */
+
+#define P_CSF_KERNEL_WRAP(kernel, suffix, NF, SIMD) \
+static void kernel##suffix( \
+  splatt_csf const * const ct, \
+  idx_t const tile_id, \
+  matrix_t ** mats, \
+  idx_t const mode, \
+  thd_info * const thds, \
+  idx_t const * const partition, \
+  mutex_pool * const pool) \
+{ \
+  kernel##_impl(ct, tile_id, mats, mode, thds, partition, pool, (NF), (SIMD)); \
+}
 
-/******************************************************************************
- * PUBLIC FUNCTIONS
- *****************************************************************************/
-
-void mttkrp_csf(
-  splatt_csf const * const tensors,
-  matrix_t ** mats,
-  idx_t const mode,
-  thd_info * const thds,
-  splatt_mttkrp_ws * const ws,
-  double const * const opts)
-{
-  /* ensure we use as many threads as our partitioning supports */
-  splatt_omp_set_num_threads(ws->num_threads);
+/* The locked kernels are instantiated once for each synchronization type. */
+#define P_CSF_KERNEL_WRAP_SYNC(kernel, impl, suffix, NF, SYNC, SIMD) \
+static void kernel##suffix( \
+  splatt_csf const * const ct, \
+  idx_t const tile_id, \
+  matrix_t ** mats, \
+  idx_t const mode, \
+  thd_info * const thds, \
+  idx_t const * const partition, \
+  mutex_pool * const pool) \
+{ \
+  impl##_impl(ct, tile_id, mats, mode, thds, partition, pool, (NF), (SYNC), \
+      (SIMD)); \
+}
 
-  if(pool == NULL) {
-    pool = mutex_alloc();
-  }
+#define P_CSF_KERNEL_SET(suffix, NF, SIMD) \
+  P_CSF_KERNEL_WRAP_SYNC(p_csf_mttkrp_root_locked, p_csf_mttkrp_root_locked, \
+      suffix, NF, SPLATT_SYNC_LOCK, SIMD) \
+  P_CSF_KERNEL_WRAP_SYNC(p_csf_mttkrp_intl_locked, p_csf_mttkrp_intl_locked, \
+      suffix, NF, SPLATT_SYNC_LOCK, SIMD) \
+  P_CSF_KERNEL_WRAP_SYNC(p_csf_mttkrp_leaf_locked, p_csf_mttkrp_leaf_locked, \
+      suffix, NF, SPLATT_SYNC_LOCK, SIMD) \
+  P_CSF_KERNEL_WRAP_SYNC(p_csf_mttkrp_root_atomic, p_csf_mttkrp_root_locked, \
+      suffix, NF, SPLATT_SYNC_ATOMIC, SIMD) \
+  P_CSF_KERNEL_WRAP_SYNC(p_csf_mttkrp_intl_atomic, p_csf_mttkrp_intl_locked, \
+      suffix, NF, SPLATT_SYNC_ATOMIC, SIMD) \
+  P_CSF_KERNEL_WRAP_SYNC(p_csf_mttkrp_leaf_atomic, p_csf_mttkrp_leaf_locked, \
+      suffix, NF, SPLATT_SYNC_ATOMIC, SIMD) \
+  P_CSF_KERNEL_WRAP(p_csf_mttkrp_root_nolock, suffix, NF, SIMD) \
+  P_CSF_KERNEL_WRAP(p_csf_mttkrp_intl_nolock, suffix, NF, SIMD) \
+  P_CSF_KERNEL_WRAP(p_csf_mttkrp_leaf_nolock, suffix, NF, SIMD)
+
+#define P_CSF_KERNEL_ENTRY(suffix, NF, SIMD, name) \
+  { NF, SIMD, name, \
+    p_csf_mttkrp_root_locked##suffix, p_csf_mttkrp_root_atomic##suffix, \
+    p_csf_mttkrp_root_nolock##suffix, \
+    p_csf_mttkrp_intl_locked##suffix, p_csf_mttkrp_intl_atomic##suffix, \
+    p_csf_mttkrp_intl_nolock##suffix, \
+    p_csf_mttkrp_leaf_locked##suffix, p_csf_mttkrp_leaf_atomic##suffix, \
+    p_csf_mttkrp_leaf_nolock##suffix }
+
+P_CSF_KERNEL_SET(_generic, mats[MAX_NMODES]->J, SPLATT_SIMD_SCALAR)
+P_CSF_KERNEL_SET(_r8,  8,  SPLATT_SIMD_SCALAR)
+P_CSF_KERNEL_SET(_r16, 16, SPLATT_SIMD_SCALAR)
+P_CSF_KERNEL_SET(_r32, 32, SPLATT_SIMD_SCALAR)
+P_CSF_KERNEL_SET(_r64, 64, SPLATT_SIMD_SCALAR)
+#ifdef SPLATT_SIMD_X86
+P_CSF_KERNEL_SET(_avx2,   mats[MAX_NMODES]->J, SPLATT_SIMD_AVX2)
+P_CSF_KERNEL_SET(_avx512, mats[MAX_NMODES]->J, SPLATT_SIMD_AVX512)
+#endif
 
-  /* clear output matrix */
-  matrix_t * const M = mats[MAX_NMODES];
-  M->I = tensors[0].dims[mode];
-  memset(M->vals, 0, M->I * M->J * sizeof(val_t));
 
-  idx_t const nmodes = tensors[0].nmodes;
+/**
+* @brief A family of CSF MTTKRP kernels, one for each output level and
+*        synchronization type.
+*/
+typedef struct
+{
+  /** @brief The rank this family is specialized for. 0 means any rank. */
+  idx_t nfactors;
+  /** @brief The instruction set the family is written for. */
+  splatt_simd_type simd;
+  char const * name;
+  csf_mttkrp_func root_locked;
+  csf_mttkrp_func root_atomic;
+  csf_mttkrp_func root_nolock;
+  csf_mttkrp_func intl_locked;
+  csf_mttkrp_func intl_atomic;
+  csf_mttkrp_func intl_nolock;
+  csf_mttkrp_func leaf_locked;
+  csf_mttkrp_func leaf_atomic;
+  csf_mttkrp_func leaf_nolock;
+} csf_mttkrp_kernels;
+
+
+/* The generic scalar family must be last -- it terminates the search. */
+static csf_mttkrp_kernels const csf_kernel_families[] = {
+#ifdef SPLATT_SIMD_X86
+  P_CSF_KERNEL_ENTRY(_avx512, 0, SPLATT_SIMD_AVX512, "avx512"),
+  P_CSF_KERNEL_ENTRY(_avx2,   0, SPLATT_SIMD_AVX2,   "avx2"),
+#endif
+  P_CSF_KERNEL_ENTRY(_r8,  8,  SPLATT_SIMD_SCALAR, "rank-8"),
+  P_CSF_KERNEL_ENTRY(_r16, 16, SPLATT_SIMD_SCALAR, "rank-16"),
+  P_CSF_KERNEL_ENTRY(_r32, 32, SPLATT_SIMD_SCALAR, "rank-32"),
+  P_CSF_KERNEL_ENTRY(_r64, 64, SPLATT_SIMD_SCALAR, "rank-64"),
+  P_CSF_KERNEL_ENTRY(_generic, 0, SPLATT_SIMD_SCALAR, "generic")
+};
 
-  /* reset thread times */
-  thd_reset(thds, splatt_omp_get_max_threads());
+#undef P_CSF_KERNEL_ENTRY
+#undef P_CSF_KERNEL_SET
+#undef P_CSF_KERNEL_WRAP_SYNC
+#undef P_CSF_KERNEL_WRAP
 
-  /* choose which MTTKRP function to use */
-  idx_t const which_csf = ws->mode_csf_map[mode];
-  idx_t const outdepth = csf_mode_to_depth(&(tensors[which_csf]), mode);
-  if(outdepth == 0) {
-    /* root */
-    p_schedule_tiles(tensors, which_csf,
-        p_csf_mttkrp_root_locked, p_csf_mttkrp_root_nolock,
-        mats, mode, thds, ws);
-  } else if(outdepth == nmodes - 1) {
-    /* leaf */
-    p_schedule_tiles(tensors, which_csf,
-        p_csf_mttkrp_leaf_locked, p_csf_mttkrp_leaf_nolock,
-        mats, mode, thds, ws);
-  } else {
-    /* internal */
-    p_schedule_tiles(tensors, which_csf,
-        p_csf_mttkrp_intl_locked, p_csf_mttkrp_intl_nolock,
-        mats, mode, thds, ws);
-  }
 
-  /* print thread times, if requested */
-  if((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
-    printf("MTTKRP mode %"SPLATT_PF_IDX": ", mode+1);
-    thd_time_stats(thds, splatt_omp_get_max_threads());
-    if(ws->is_privatized[mode]) {
-      printf("  reduction-time: %0.3fs\n", ws->reduction_time);
+/**
+* @brief Choose the kernel family to use for a given rank and instruction set.
+*
+* @param nfactors The number of columns in the factor matrices.
+* @param simd The instruction set from the MTTKRP workspace.
+*
+* @return The first family matching 'simd' and 'nfactors', otherwise the
+*         generic scalar one.
+*/
+static csf_mttkrp_kernels const * p_select_kernels(
+    idx_t const nfactors,
+    splatt_simd_type const simd)
+{
+  csf_mttkrp_kernels const * kern = csf_kernel_families;
+  while(kern->nfactors != 0 || kern->simd != SPLATT_SIMD_SCALAR) {
+    if(kern->simd == simd &&
+        (kern->nfactors == 0 || kern->nfactors == nfactors)) {
+      break;
     }
+    ++kern;
   }
-  thd_reset(thds, splatt_omp_get_max_threads());
+  return kern;
+}
+
+
+
+
+/*
+ * Memoized kernels. The root-mode MTTKRP of a CSF tree computes, bottom-up,
+ * the sum over each node's subtree of the Hadamard products of the deeper
+ * factor rows. The output of a deeper mode is just the top-down product of
+ * the shallower rows times those sums, so if we keep them in ws->memo[] and
+ * only the shallower factors change in between (i.e., an ALS sweep in CSF
+ * order), the deeper modes never need to revisit the nonzeros.
+ */
+
+
+/**
+* @brief Fill ws->memo[] with the partial results of the calling thread's
+*        part of the tree, and accumulate the root-mode MTTKRP.
+*
+* @param ct The CSF tensor.
+* @param mvals The factors, ordered by CSF depth.
+* @param ovals The output (or this thread's private copy).
+* @param priv If the output is private to this thread.
+* @param buf Thread-local scratch, one row of length nfactors per mode.
+* @param nfactors The number of columns in the factors.
+* @param ws The MTTKRP workspace.
+*/
+static void p_csf_memo_root(
+  splatt_csf const * const ct,
+  val_t ** mvals,
+  val_t * const ovals,
+  bool const priv,
+  val_t * const * const buf,
+  idx_t const nfactors,
+  splatt_mttkrp_ws * const ws)
+{
+  csf_sparsity const * const pt = &(ct->pt[0]);
+  idx_t const * const * const restrict fp = (idx_t const * const *) pt->fptr;
+  idx_t const * const * const restrict fids =
+      (idx_t const * const *) pt->fids;
+  idx_t const levels = ws->memo_levels;
+  splatt_simd_type const simd = ws->simd;
+
+  int const tid = splatt_omp_get_thread_num();
+  idx_t sstart, sstop, fstart, fstop;
+  csf_thread_range(pt, ws->tree_partition[0], tid, &sstart, &sstop,
+      &fstart, &fstop);
+
+  /* the nodes owned by this thread at each memoized level */
+  idx_t lo[MAX_NMODES];
+  idx_t hi[MAX_NMODES];
+  lo[1] = fstart;
+  hi[1] = fstop;
+  for(idx_t d=2; d <= levels; ++d) {
+    lo[d] = fp[d-1][lo[d-1]];
+    hi[d] = fp[d-1][hi[d-1]];
+  }
+
+  /* the deepest memoized level comes from the tree itself */
+  idx_t idxstack[MAX_NMODES];
+  for(idx_t n=lo[levels]; n < hi[levels]; ++n) {
+    p_propagate_up(ws->memo[levels] + (n * nfactors), buf, idxstack, levels,
+        n, fp[levels][n], fp[levels][n+1], fp, fids, pt->vals, mvals,
+        ct->nmodes, nfactors, simd);
+  }
+
+  /* the shallower levels come from the level below */
+  for(idx_t d=levels-1; d > 0; --d) {
+    for(idx_t n=lo[d]; n < hi[d]; ++n) {
+      val_t * const restrict out = ws->memo[d] + (n * nfactors);
+      for(idx_t f=0; f < nfactors; ++f) {
+        out[f] = 0.;
+      }
+      for(idx_t c=fp[d][n]; c < fp[d][n+1]; ++c) {
+        p_add_hada(out, mvals[d+1] + (fids[d+1][c] * nfactors),
+            ws->memo[d+1] + (c * nfactors), nfactors, simd);
+      }
+    }
+  }
+
+  /* and finally the root rows */
+  val_t * const restrict accum = buf[0];
+  for(idx_t s=sstart; s < sstop; ++s) {
+    idx_t const fbegin = SS_MAX(fp[0][s], fstart);
+    idx_t const fend   = SS_MIN(fp[0][s+1], fstop);
+    for(idx_t f=0; f < nfactors; ++f) {
+      accum[f] = 0.;
+    }
+    for(idx_t c=fbegin; c < fend; ++c) {
+      p_add_hada(accum, mvals[1] + (fids[1][c] * nfactors),
+          ws->memo[1] + (c * nfactors), nfactors, simd);
+    }
+
+    idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
+    val_t * const restrict orow = ovals + (fid * nfactors);
+
+    /* only a slice which is split with another thread needs to sync */
+    if(priv || (fbegin == fp[0][s] && fend == fp[0][s+1])) {
+      for(idx_t f=0; f < nfactors; ++f) {
+        orow[f] += accum[f];
+      }
+    } else {
+      p_sync_add_row(orow, accum, nfactors, fid, ws->pool, ws->sync);
+    }
+  }
+}
+
+
+/**
+* @brief Push the top-down product of factor rows from 'node' at 'depth' down
+*        the tree, and write to the output once we are one level above it.
+*        buf[depth-1] must hold the product of the rows above 'node'.
+*/
+static void p_csf_memo_descend(
+  idx_t const depth,
+  idx_t const node,
+  idx_t const outdepth,
+  idx_t const * const * const fp,
+  idx_t const * const * const fids,
+  val_t * const * const mvals,
+  val_t * const * const buf,
+  val_t const * const memo,
+  val_t * const ovals,
+  bool const priv,
+  idx_t const nfactors,
+  splatt_mttkrp_ws const * const ws)
+{
+  p_assign_hada(buf[depth], buf[depth-1],
+      mvals[depth] + (fids[depth][node] * nfactors), nfactors, ws->simd);
+
+  if(depth + 1 < outdepth) {
+    for(idx_t c=fp[depth][node]; c < fp[depth][node+1]; ++c) {
+      p_csf_memo_descend(depth+1, c, outdepth, fp, fids, mvals, buf, memo,
+          ovals, priv, nfactors, ws);
+    }
+    return;
+  }
+
+  for(idx_t n=fp[depth][node]; n < fp[depth][node+1]; ++n) {
+    idx_t const row = fids[outdepth][n];
+    val_t * const restrict orow = ovals + (row * nfactors);
+    if(priv) {
+      p_add_hada(orow, buf[depth], memo + (n * nfactors), nfactors, ws->simd);
+    } else {
+      p_sync_add_hada(orow, buf[depth], memo + (n * nfactors), nfactors, row,
+          ws->pool, ws->sync, ws->simd);
+    }
+  }
+}
+
+
+/**
+* @brief Compute the MTTKRP of a memoized internal level of the tree from
+*        ws->memo[outdepth], for the calling thread's part of the tree.
+*
+* @param ct The CSF tensor.
+* @param outdepth The depth of the output mode (1 <= outdepth <= memo_levels).
+* @param mvals The factors, ordered by CSF depth.
+* @param ovals The output (or this thread's private copy).
+* @param priv If the output is private to this thread.
+* @param buf Thread-local scratch, one row of length nfactors per mode.
+* @param nfactors The number of columns in the factors.
+* @param ws The MTTKRP workspace.
+*/
+static void p_csf_memo_intl(
+  splatt_csf const * const ct,
+  idx_t const outdepth,
+  val_t ** mvals,
+  val_t * const ovals,
+  bool const priv,
+  val_t * const * const buf,
+  idx_t const nfactors,
+  splatt_mttkrp_ws const * const ws)
+{
+  csf_sparsity const * const pt = &(ct->pt[0]);
+  idx_t const * const * const restrict fp = (idx_t const * const *) pt->fptr;
+  idx_t const * const * const restrict fids =
+      (idx_t const * const *) pt->fids;
+  val_t const * const memo = ws->memo[outdepth];
+
+  int const tid = splatt_omp_get_thread_num();
+  idx_t sstart, sstop, fstart, fstop;
+  csf_thread_range(pt, ws->tree_partition[0], tid, &sstart, &sstop,
+      &fstart, &fstop);
+
+  for(idx_t s=sstart; s < sstop; ++s) {
+    idx_t const fid = (fids[0] == NULL) ? s : fids[0][s];
+    val_t const * const restrict rootrow = mvals[0] + (fid * nfactors);
+    for(idx_t f=0; f < nfactors; ++f) {
+      buf[0][f] = rootrow[f];
+    }
+
+    idx_t const fbegin = SS_MAX(fp[0][s], fstart);
+    idx_t const fend   = SS_MIN(fp[0][s+1], fstop);
+    if(outdepth > 1) {
+      for(idx_t c=fbegin; c < fend; ++c) {
+        p_csf_memo_descend(1, c, outdepth, fp, fids, mvals, buf, memo, ovals,
+            priv, nfactors, ws);
+      }
+      continue;
+    }
+
+    for(idx_t n=fbegin; n < fend; ++n) {
+      idx_t const row = fids[1][n];
+      val_t * const restrict orow = ovals + (row * nfactors);
+      if(priv) {
+        p_add_hada(orow, buf[0], memo + (n * nfactors), nfactors, ws->simd);
+      } else {
+        p_sync_add_hada(orow, buf[0], memo + (n * nfactors), nfactors, row,
+            ws->pool, ws->sync, ws->simd);
+      }
+    }
+  }
+}
+
+
+/**
+* @brief Can the MTTKRP of a CSF depth be served from ws->memo[]? The root
+*        always can (it refreshes the memo). A deeper level can if it is
+*        memoized and the previous MTTKRP was of the level just above it.
+*
+* @param ws The MTTKRP workspace.
+* @param outdepth The depth of the output mode.
+*
+* @return Whether to use p_csf_mttkrp_memo().
+*/
+static bool p_use_memo(
+    splatt_mttkrp_ws const * const ws,
+    idx_t const outdepth)
+{
+  if(ws->memo_levels == 0) {
+    return false;
+  }
+  if(outdepth == 0) {
+    return true;
+  }
+  return (outdepth <= ws->memo_levels) && (ws->memo_depth + 1 == outdepth);
+}
+
+
+/**
+* @brief Perform a memoized MTTKRP, handling privatization in the same way as
+*        mttkrp_csf_schedule().
+*
+* @param ct The (single, untiled) CSF tensor.
+* @param mats The matrices, with the output stored in mats[MAX_NMODES].
+* @param mode The output mode.
+* @param thds Thread structures.
+* @param ws MTTKRP workspace.
+*/
+static void p_csf_mttkrp_memo(
+    splatt_csf const * const ct,
+    matrix_t ** mats,
+    idx_t const mode,
+    thd_info * const thds,
+    splatt_mttkrp_ws * const ws)
+{
+  idx_t const nmodes = ct->nmodes;
+  idx_t const nrows = mats[mode]->I;
+  idx_t const ncols = mats[MAX_NMODES]->J;
+  idx_t const outdepth = csf_mode_to_depth(ct, mode);
+  val_t * const global_output = mats[MAX_NMODES]->vals;
+
+  val_t * mvals[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    mvals[m] = mats[csf_depth_to_mode(ct, m)]->vals;
+  }
+
+  #pragma omp parallel
+  {
+    int const tid = splatt_omp_get_thread_num();
+    timer_start(&thds[tid].ttime);
+
+    val_t * buf[MAX_NMODES];
+    for(idx_t m=0; m < nmodes; ++m) {
+      buf[m] = ((val_t *) thds[tid].scratch[2]) + (ncols * m);
+      memset(buf[m], 0, ncols * sizeof(val_t));
+    }
+
+    bool const priv = ws->is_privatized[mode];
+    val_t * const ovals = priv ? ws->privatize_buffer[tid] : global_output;
+
+    if(outdepth == 0) {
+      p_csf_memo_root(ct, mvals, ovals, priv, buf, ncols, ws);
+    } else {
+      p_csf_memo_intl(ct, outdepth, mvals, ovals, priv, buf, ncols, ws);
+    }
+    timer_stop(&thds[tid].ttime);
+
+    if(ws->priv_type[mode] == SPLATT_PRIV_SPARSE) {
+      p_reduce_privatized_sparse(ws, global_output, mode, nrows, ncols);
+    } else if(ws->priv_type[mode] == SPLATT_PRIV_DENSE) {
+      p_reduce_privatized(ws, global_output, nrows, ncols);
+    }
+  } /* end omp parallel */
+}
+
+/*
+ * Mixed-precision kernels. Factor rows are gathered from ws->lowp_factors[]
+ * (fp32/bf16/fp16) and every partial result is accumulated in double. One
+ * traversal handles any output depth: a top-down product of the rows above
+ * the output level times a bottom-up sum of the subtree below it.
+ */
+
+
+/**
+* @brief Loop over row 'row' of a low-precision matrix 'rows' with 'nf'
+*        columns, exposing column f as the double 'r' to BODY.
+*/
+#define P_LOWP_FOREACH(prec, rows, row, nf, BODY) \
+  switch(prec) { \
+  case SPLATT_PREC_FP32: { \
+    float const * const restrict lp = ((float const *) (rows)) + \
+        ((row) * (nf)); \
+    for(idx_t f=0; f < (nf); ++f) { \
+      double const r = lp[f]; \
+      BODY; \
+    } \
+    break; \
+  } \
+  case SPLATT_PREC_BF16: { \
+    uint16_t const * const restrict lp = ((uint16_t const *) (rows)) + \
+        ((row) * (nf)); \
+    for(idx_t f=0; f < (nf); ++f) { \
+      double const r = precision_bf16_to_float(lp[f]); \
+      BODY; \
+    } \
+    break; \
+  } \
+  case SPLATT_PREC_FP16: { \
+    uint16_t const * const restrict lp = ((uint16_t const *) (rows)) + \
+        ((row) * (nf)); \
+    for(idx_t f=0; f < (nf); ++f) { \
+      double const r = precision_fp16_to_float(lp[f]); \
+      BODY; \
+    } \
+    break; \
+  } \
+  case SPLATT_PREC_FULL: { \
+    val_t const * const restrict lp = ((val_t const *) (rows)) + \
+        ((row) * (nf)); \
+    for(idx_t f=0; f < (nf); ++f) { \
+      double const r = lp[f]; \
+      BODY; \
+    } \
+    break; \
+  } \
+  }
+
+
+/**
+* @brief The state shared by one thread's traversal of a CSF tile.
+*/
+typedef struct
+{
+  idx_t nmodes;
+  idx_t nfactors;
+  idx_t outdepth;
+  splatt_precision_type prec;
+
+  idx_t const * const * fp;
+  idx_t const * const * fids;
+  val_t const * vals;
+
+  /** @brief The low-precision factors, ordered by CSF depth. */
+  void const * rows[MAX_NMODES];
+  /** @brief Bottom-up subtree sums, one row per depth. */
+  double * up[MAX_NMODES];
+  /** @brief Top-down products of factor rows, one row per depth. */
+  double * down[MAX_NMODES];
+  /** @brief Staging row for writing to the output. */
+  val_t * orow;
+
+  val_t * ovals;
+  bool priv;
+  splatt_sync_type sync;
+  mutex_pool * pool;
+} p_lowp_tree;
+
+
+/**
+* @brief Sum, into t->up[depth], the subtree below a node at 'depth' whose
+*        children are [cstart, cstop). The node's own row is not included.
+*/
+static void p_lowp_up(
+    p_lowp_tree const * const t,
+    idx_t const depth,
+    idx_t const cstart,
+    idx_t const cstop)
+{
+  idx_t const nf = t->nfactors;
+  double * const restrict acc = t->up[depth];
+  for(idx_t f=0; f < nf; ++f) {
+    acc[f] = 0.;
+  }
+
+  if(depth == t->nmodes - 2) {
+    idx_t const * const restrict inds = t->fids[depth+1];
+    for(idx_t j=cstart; j < cstop; ++j) {
+      double const v = t->vals[j];
+      P_LOWP_FOREACH(t->prec, t->rows[depth+1], inds[j], nf,
+          acc[f] += v * r);
+    }
+    return;
+  }
+
+  double const * const restrict child = t->up[depth+1];
+  for(idx_t c=cstart; c < cstop; ++c) {
+    p_lowp_up(t, depth+1, t->fp[depth+1][c], t->fp[depth+1][c+1]);
+    P_LOWP_FOREACH(t->prec, t->rows[depth+1], t->fids[depth+1][c], nf,
+        acc[f] += child[f] * r);
+  }
+}
+
+
+/**
+* @brief Add 'a' (times 'b', or 'scale' if 'b' is NULL) to output row 'row'.
+*        Rows which may be shared with other threads are synchronized.
+*/
+static void p_lowp_write(
+    p_lowp_tree const * const t,
+    idx_t const row,
+    double const * const restrict a,
+    double const * const restrict b,
+    double const scale,
+    bool const owned)
+{
+  idx_t const nf = t->nfactors;
+  val_t * const restrict orow = t->orow;
+  if(b != NULL) {
+    for(idx_t f=0; f < nf; ++f) {
+      orow[f] = (val_t) (a[f] * b[f]);
+    }
+  } else {
+    for(idx_t f=0; f < nf; ++f) {
+      orow[f] = (val_t) (a[f] * scale);
+    }
+  }
+
+  val_t * const restrict out = t->ovals + (row * nf);
+  if(t->priv || owned) {
+    for(idx_t f=0; f < nf; ++f) {
+      out[f] += orow[f];
+    }
+  } else {
+    p_sync_add_row(out, orow, nf, row, t->pool, t->sync);
+  }
+}
+
+
+/**
+* @brief Descend from a node at 'depth' to the output level. t->down[depth-1]
+*        must hold the product of the rows above the node.
+*/
+static void p_lowp_down(
+    p_lowp_tree const * const t,
+    idx_t const depth,
+    idx_t const node)
+{
+  idx_t const nf = t->nfactors;
+  idx_t const * const * const fp = t->fp;
+  double const * const restrict above = t->down[depth-1];
+
+  if(depth == t->outdepth) {
+    idx_t const row = t->fids[depth][node];
+    if(depth == t->nmodes - 1) {
+      p_lowp_write(t, row, above, NULL, t->vals[node], false);
+    } else {
+      p_lowp_up(t, depth, fp[depth][node], fp[depth][node+1]);
+      p_lowp_write(t, row, above, t->up[depth], 1., false);
+    }
+    return;
+  }
+
+  double * const restrict prod = t->down[depth];
+  P_LOWP_FOREACH(t->prec, t->rows[depth], t->fids[depth][node], nf,
+      prod[f] = above[f] * r);
+  for(idx_t c=fp[depth][node]; c < fp[depth][node+1]; ++c) {
+    p_lowp_down(t, depth+1, c);
+  }
+}
+
+
+/**
+* @brief Process the calling thread's part of a CSF tile.
+*
+* @param t The traversal state, with the tile's sparsity pattern set.
+* @param pt The tile.
+* @param partition The fiber partitioning, or NULL to process the whole tile.
+* @param shared If another thread may produce the same output rows.
+*/
+static void p_lowp_tile(
+    p_lowp_tree const * const t,
+    csf_sparsity const * const pt,
+    idx_t const * const partition,
+    bool const shared)
+{
+  idx_t const nf = t->nfactors;
+  idx_t const * const * const fp = t->fp;
+
+  idx_t sstart, sstop, fstart, fstop;
+  csf_thread_range(pt, partition, splatt_omp_get_thread_num(), &sstart,
+      &sstop, &fstart, &fstop);
+
+  for(idx_t s=sstart; s < sstop; ++s) {
+    idx_t const fid = (t->fids[0] == NULL) ? s : t->fids[0][s];
+    idx_t const fbegin = SS_MAX(fp[0][s], fstart);
+    idx_t const fend   = SS_MIN(fp[0][s+1], fstop);
+
+    if(t->outdepth == 0) {
+      bool const whole = (fbegin == fp[0][s] && fend == fp[0][s+1]);
+      p_lowp_up(t, 0, fbegin, fend);
+      p_lowp_write(t, fid, t->up[0], NULL, 1., whole && !shared);
+      continue;
+    }
+
+    double * const restrict prod = t->down[0];
+    P_LOWP_FOREACH(t->prec, t->rows[0], fid, nf, prod[f] = r);
+    for(idx_t c=fbegin; c < fend; ++c) {
+      p_lowp_down(t, 1, c);
+    }
+  }
+}
+
+#undef P_LOWP_FOREACH
+
+
+/**
+* @brief Perform an MTTKRP with factors read at ws->precision, handling
+*        privatization in the same way as mttkrp_csf_schedule().
+*
+* @param tensors The CSF tensor(s).
+* @param csf_id Which tensor to use.
+* @param mats The matrices, with the output stored in mats[MAX_NMODES].
+* @param mode The output mode.
+* @param thds Thread structures.
+* @param ws MTTKRP workspace.
+*/
+static void p_csf_mttkrp_lowp(
+    splatt_csf const * const tensors,
+    idx_t const csf_id,
+    matrix_t ** mats,
+    idx_t const mode,
+    thd_info * const thds,
+    splatt_mttkrp_ws * const ws)
+{
+  splatt_csf const * const csf = &(tensors[csf_id]);
+  idx_t const nmodes = csf->nmodes;
+  idx_t const nrows = mats[mode]->I;
+  idx_t const ncols = mats[MAX_NMODES]->J;
+  val_t * const global_output = mats[MAX_NMODES]->vals;
+
+  /* refresh the low-precision copies of the inputs */
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(m != mode) {
+      precision_pack(ws->lowp_factors[m], mats[m]->vals, csf->dims[m] * ncols,
+          ws->precision);
+    }
+  }
+
+  #pragma omp parallel
+  {
+    int const tid = splatt_omp_get_thread_num();
+    timer_start(&thds[tid].ttime);
+
+    p_lowp_tree t;
+    t.nmodes = nmodes;
+    t.nfactors = ncols;
+    t.outdepth = csf_mode_to_depth(csf, mode);
+    t.prec = ws->precision;
+    t.priv = ws->is_privatized[mode];
+    t.sync = ws->sync;
+    t.pool = ws->pool;
+    t.ovals = t.priv ? ws->privatize_buffer[tid] : global_output;
+
+    double * const scratch = ws->lowp_scratch +
+        (tid * ws->lowp_scratch_stride);
+    for(idx_t d=0; d < nmodes; ++d) {
+      t.rows[d] = ws->lowp_factors[csf_depth_to_mode(csf, d)];
+      t.up[d] = scratch + (d * ncols);
+      t.down[d] = scratch + ((nmodes + d) * ncols);
+    }
+    t.orow = (val_t *) (scratch + (2 * nmodes * ncols));
+
+    if(csf->ntiles > 1) {
+      /* rows may be shared across tiles, so always synchronize */
+      idx_t const * const tile_partition = ws->tile_partition[csf_id];
+      for(idx_t tile=tile_partition[tid]; tile < tile_partition[tid+1];
+          ++tile) {
+        csf_sparsity const * const pt = &(csf->pt[tile]);
+        if(pt->vals == NULL) {
+          continue;
+        }
+        t.fp = (idx_t const * const *) pt->fptr;
+        t.fids = (idx_t const * const *) pt->fids;
+        t.vals = pt->vals;
+        p_lowp_tile(&t, pt, NULL, true);
+      }
+    } else {
+      csf_sparsity const * const pt = &(csf->pt[0]);
+      t.fp = (idx_t const * const *) pt->fptr;
+      t.fids = (idx_t const * const *) pt->fids;
+      t.vals = pt->vals;
+      p_lowp_tile(&t, pt, ws->tree_partition[csf_id], false);
+    }
+
+    timer_stop(&thds[tid].ttime);
+
+    if(ws->priv_type[mode] == SPLATT_PRIV_SPARSE) {
+      p_reduce_privatized_sparse(ws, global_output, mode, nrows, ncols);
+    } else if(ws->priv_type[mode] == SPLATT_PRIV_DENSE) {
+      p_reduce_privatized(ws, global_output, nrows, ncols);
+    }
+  } /* end omp parallel */
+}
+
+
+
+/**
+* @brief Perform one MTTKRP over all columns of mats[], choosing between the
+*        reduced-precision, memoized, and regular kernels.
+*
+* @param tensors The CSF tensor(s).
+* @param mats The matrices, with the output stored in mats[MAX_NMODES].
+* @param mode The output mode.
+* @param thds Thread structures.
+* @param ws MTTKRP workspace.
+*/
+static void p_mttkrp_csf_pass(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  idx_t const mode,
+  thd_info * const thds,
+  splatt_mttkrp_ws * const ws)
+{
+  /* clear output matrix */
+  matrix_t * const M = mats[MAX_NMODES];
+  memset(M->vals, 0, M->I * M->J * sizeof(val_t));
+
+  idx_t const nmodes = tensors[0].nmodes;
+
+  /* choose which MTTKRP function to use */
+  csf_mttkrp_kernels const * const kern = p_select_kernels(M->J, ws->simd);
+  bool const atomic = (ws->sync == SPLATT_SYNC_ATOMIC);
+  idx_t const which_csf = ws->mode_csf_map[mode];
+  idx_t const outdepth = csf_mode_to_depth(&(tensors[which_csf]), mode);
+  bool const use_memo = p_use_memo(ws, outdepth);
+  if(ws->precision != SPLATT_PREC_FULL) {
+    p_csf_mttkrp_lowp(tensors, which_csf, mats, mode, thds, ws);
+  } else if(use_memo) {
+    p_csf_mttkrp_memo(tensors, mats, mode, thds, ws);
+  } else if(outdepth == 0) {
+    /* root */
+    mttkrp_csf_schedule(tensors, which_csf,
+        atomic ? kern->root_atomic : kern->root_locked, kern->root_nolock,
+        mats, mode, thds, ws);
+  } else if(outdepth == nmodes - 1) {
+    /* leaf */
+    mttkrp_csf_schedule(tensors, which_csf,
+        atomic ? kern->leaf_atomic : kern->leaf_locked, kern->leaf_nolock,
+        mats, mode, thds, ws);
+  } else {
+    /* internal */
+    mttkrp_csf_schedule(tensors, which_csf,
+        atomic ? kern->intl_atomic : kern->intl_locked, kern->intl_nolock,
+        mats, mode, thds, ws);
+  }
+  /* anything but the next level of a sweep invalidates the memo */
+  ws->memo_depth = use_memo ? outdepth : nmodes;
+}
+
+
+/**
+* @brief Copy columns [start, start+width) of a row-major matrix with 'ncols'
+*        columns into a matrix with 'width' columns (or back, if 'unpack').
+*/
+static void p_block_copy(
+    idx_t const nrows,
+    val_t * const wide,
+    idx_t const ncols,
+    idx_t const start,
+    idx_t const width,
+    val_t * const narrow,
+    bool const unpack)
+{
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < nrows; ++i) {
+    val_t * const restrict wrow = wide + (i * ncols) + start;
+    val_t * const restrict nrow = narrow + (i * width);
+    if(unpack) {
+      for(idx_t f=0; f < width; ++f) {
+        wrow[f] = nrow[f];
+      }
+    } else {
+      for(idx_t f=0; f < width; ++f) {
+        nrow[f] = wrow[f];
+      }
+    }
+  }
+}
+
+
+/**
+* @brief Perform MTTKRP one block of ws->col_block columns at a time. Each
+*        block of the factors is copied into a narrow matrix so that the
+*        accumulators and factor rows touched by a fiber stay in L1.
+*
+* @param tensors The CSF tensor(s).
+* @param mats The matrices, with the output stored in mats[MAX_NMODES].
+* @param mode The output mode.
+* @param thds Thread structures.
+* @param ws MTTKRP workspace.
+*/
+static void p_mttkrp_csf_blocked(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  idx_t const mode,
+  thd_info * const thds,
+  splatt_mttkrp_ws * const ws)
+{
+  idx_t const nmodes = tensors[0].nmodes;
+  idx_t const ncols = mats[MAX_NMODES]->J;
+
+  matrix_t blocks[MAX_NMODES+1];
+  matrix_t * bmats[MAX_NMODES+1];
+  for(idx_t m=0; m < nmodes; ++m) {
+    blocks[m] = *(mats[m]);
+    blocks[m].vals = ws->block_vals[m];
+    bmats[m] = &(blocks[m]);
+  }
+  blocks[MAX_NMODES] = *(mats[MAX_NMODES]);
+  blocks[MAX_NMODES].vals = ws->block_vals[mode];
+  bmats[MAX_NMODES] = &(blocks[MAX_NMODES]);
+
+  for(idx_t start=0; start < ncols; start += ws->col_block) {
+    idx_t const width = SS_MIN(ws->col_block, ncols - start);
+    for(idx_t m=0; m < nmodes; ++m) {
+      blocks[m].J = width;
+      if(m != mode) {
+        p_block_copy(mats[m]->I, mats[m]->vals, ncols, start, width,
+            blocks[m].vals, false);
+      }
+    }
+    blocks[MAX_NMODES].J = width;
+
+    p_mttkrp_csf_pass(tensors, bmats, mode, thds, ws);
+
+    p_block_copy(mats[MAX_NMODES]->I, mats[MAX_NMODES]->vals, ncols, start,
+        width, blocks[MAX_NMODES].vals, true);
+  }
+}
+
+
+/**
+* @brief Pick how many columns MTTKRP processes per traversal. A fiber touches
+*        one accumulator row per mode plus a couple of factor rows, and we
+*        want those to fit in half of the L1 data cache.
+*
+* @param nfactors The number of columns.
+* @param nmodes The number of modes in the tensor.
+* @param opts SPLATT_OPTION_COLBLOCK gives the width, or 0 to choose.
+*
+* @return The block width. A value >= nfactors means no blocking.
+*/
+static idx_t p_col_block_width(
+    idx_t const nfactors,
+    idx_t const nmodes,
+    double const * const opts)
+{
+  double const requested = opts[SPLATT_OPTION_COLBLOCK];
+  if(requested >= 1.) {
+    return (idx_t) requested;
+  }
+  if(requested < 0.) {
+    return nfactors;
+  }
+
+  long l1 = 0;
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+  l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+#endif
+  if(l1 <= 0) {
+    l1 = 32 * 1024;
+  }
+
+  idx_t width = (idx_t) l1 / (2 * (nmodes + 2) * sizeof(val_t));
+  /* keep blocks a multiple of the widest vector and not too thin */
+  width = SS_MAX(64, width - (width % 16));
+  if(width >= nfactors) {
+    return nfactors;
+  }
+
+  /* spread the columns evenly over the blocks we need */
+  idx_t const nblocks = (nfactors + width - 1) / width;
+  width = (nfactors + nblocks - 1) / nblocks;
+  return width + ((16 - (width % 16)) % 16);
+}
+
+
+/**
+* @brief Make sure the mutex pool matches the synchronization type of 'ws'.
+*        Spinlock pools are sized for the thread count and the output rows,
+*        and only replaced when a larger one is needed.
+*
+* @param ws The MTTKRP workspace.
+* @param nrows The number of rows in the output.
+* @param track_stats Count acquisitions and contention in spinlocks.
+*/
+static void p_prepare_pool(
+    splatt_mttkrp_ws * const ws,
+    idx_t const nrows,
+    bool const track_stats)
+{
+  mutex_pool * pool = ws->pool;
+  if(ws->sync == SPLATT_SYNC_SPIN) {
+    int const nlocks = mutex_spin_size(ws->num_threads, nrows);
+    if(pool == NULL || pool->type != MUTEX_POOL_SPIN ||
+        pool->num_locks < nlocks) {
+      if(pool != NULL) {
+        mutex_free(pool);
+      }
+      pool = mutex_alloc_spin(ws->num_threads, nrows);
+    }
+  } else if(pool == NULL || pool->type != MUTEX_POOL_OMP) {
+    if(pool != NULL) {
+      mutex_free(pool);
+    }
+    pool = mutex_alloc();
+  }
+
+  pool->track_stats = track_stats && (pool->type == MUTEX_POOL_SPIN);
+  ws->pool = pool;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+void mttkrp_csf_schedule(
+    splatt_csf const * const tensors,
+    idx_t const csf_id,
+    csf_mttkrp_func atomic_func,
+    csf_mttkrp_func nosync_func,
+    matrix_t ** mats,
+    idx_t const mode,
+    thd_info * const thds,
+    splatt_mttkrp_ws * const ws)
+{
+  splatt_csf const * const csf = &(tensors[csf_id]);
+  idx_t const nmodes = csf->nmodes;
+  idx_t const depth = nmodes - 1;
+
+  idx_t const nrows = mats[MAX_NMODES]->I;
+  idx_t const ncols = mats[MAX_NMODES]->J;
+
+  /* Store old pointer */
+  val_t * const restrict global_output = mats[MAX_NMODES]->vals;
+
+  #pragma omp parallel
+  {
+    int const tid = splatt_omp_get_thread_num();
+    timer_start(&thds[tid].ttime);
+    idx_t const * const tile_partition = ws->tile_partition[csf_id];
+    idx_t const * const tree_partition = ws->tree_partition[csf_id];
+
+    /*
+     * We may need to edit mats[MAX_NMODES]->vals, so create a private copy of
+     * the pointers to edit. (NOT actual factors).
+     */
+    matrix_t * mats_priv[MAX_NMODES+1];
+    for(idx_t m=0; m < MAX_NMODES; ++m) {
+      mats_priv[m] = mats[m];
+    }
+    /* each thread gets separate structure, but do a shallow copy */
+    matrix_t out_priv = *(mats[MAX_NMODES]);
+    mats_priv[MAX_NMODES] = &out_priv;
+
+    /* Give each thread its own private buffer and overwrite atomic
+     * function. */
+    if(ws->is_privatized[mode]) {
+      /* change (thread-private!) output structure. The buffer is already
+       * zeroed by the previous reduction. */
+      mats_priv[MAX_NMODES]->vals = ws->privatize_buffer[tid];
+
+      /* Don't use atomics if we privatized. */
+      atomic_func = nosync_func;
+    }
+
+
+    /*
+     * Distribute tiles to threads in some fashion.
+     */
+    if(csf->ntiles > 1) {
+      /* We parallelize across tiles, and thus should not distribute within a
+       * tree. This may change if we instead 'split' tiles across a few
+       * threads. */
+      assert(tree_partition == NULL);
+
+      /* mode is actually tiled -- avoid synchronization */
+      if(csf->tile_dims[mode] > 1) {
+        idx_t tile_id = 0;
+
+        /* foreach layer of tiles */
+        #pragma omp for schedule(dynamic, 1) nowait
+        for(idx_t t=0; t < csf->tile_dims[mode]; ++t) {
+          tile_id =
+              get_next_tileid(TILE_BEGIN, csf->tile_dims, nmodes, mode, t);
+          while(tile_id != TILE_END) {
+            nosync_func(csf, tile_id, mats_priv, mode, thds, tree_partition,
+                ws->pool);
+            tile_id =
+              get_next_tileid(tile_id, csf->tile_dims, nmodes, mode, t);
+          }
+        }
+
+      /* tiled, but not this mode. Atomics are still necessary. */
+      } else {
+        for(idx_t tile_id = tile_partition[tid];
+                  tile_id < tile_partition[tid+1]; ++tile_id) {
+          atomic_func(csf, tile_id, mats_priv, mode, thds, tree_partition,
+              ws->pool);
+        }
+      }
+
+    /*
+     * Untiled, parallelize within kernel.
+     */
+    } else {
+      assert(tree_partition != NULL);
+      atomic_func(csf, 0, mats_priv, mode, thds, tree_partition, ws->pool);
+    }
+    timer_stop(&thds[tid].ttime);
+
+
+    /* If we used privatization, perform a reduction. */
+    if(ws->priv_type[mode] == SPLATT_PRIV_SPARSE) {
+      p_reduce_privatized_sparse(ws, global_output, mode, nrows, ncols);
+    } else if(ws->priv_type[mode] == SPLATT_PRIV_DENSE) {
+      p_reduce_privatized(ws, global_output, nrows, ncols);
+    }
+  } /* end omp parallel */
+
+  /* restore pointer */
+  mats[MAX_NMODES]->vals = global_output;
+}
+
+
+char const * mttkrp_csf_kernel_name(
+    idx_t const nfactors,
+    splatt_simd_type const simd)
+{
+  return p_select_kernels(nfactors, simd)->name;
+}
+
+
+void mttkrp_csf(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  idx_t const mode,
+  thd_info * const thds,
+  splatt_mttkrp_ws * const ws,
+  double const * const opts)
+{
+  /* ensure we use as many threads as our partitioning supports */
+  splatt_omp_set_num_threads(ws->num_threads);
+
+  bool const verbose =
+      ((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX);
+  p_prepare_pool(ws, tensors[0].dims[mode], verbose);
+
+  matrix_t * const M = mats[MAX_NMODES];
+  M->I = tensors[0].dims[mode];
+
+  /* reset thread times */
+  thd_reset(thds, splatt_omp_get_max_threads());
+
+  if(ws->col_block < M->J) {
+    p_mttkrp_csf_blocked(tensors, mats, mode, thds, ws);
+  } else {
+    p_mttkrp_csf_pass(tensors, mats, mode, thds, ws);
+  }
+
+  /* print thread times, if requested */
+  if((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
+    printf("MTTKRP mode %"SPLATT_PF_IDX": ", mode+1);
+    thd_time_stats(thds, splatt_omp_get_max_threads());
+    if(ws->is_privatized[mode]) {
+      printf("  reduction-time: %0.3fs\n", ws->reduction_time);
+    }
+    if(ws->pool->track_stats) {
+      mutex_print_stats(ws->pool);
+      mutex_reset_stats(ws->pool);
+    }
+  }
+  thd_reset(thds, splatt_omp_get_max_threads());
 }
 
 
@@ -1649,114 +3317,597 @@ void mttkrp_giga(
 }
 
 
-/******************************************************************************
- * TTBOX MTTKRP
- *****************************************************************************/
-void mttkrp_ttbox(
-  sptensor_t const * const tt,
-  matrix_t ** mats,
-  idx_t const mode,
-  val_t * const scratch)
+/******************************************************************************
+ * TTBOX MTTKRP
+ *****************************************************************************/
+void mttkrp_ttbox(
+  sptensor_t const * const tt,
+  matrix_t ** mats,
+  idx_t const mode,
+  val_t * const scratch)
+{
+  matrix_t       * const M = mats[MAX_NMODES];
+  matrix_t const * const A = mode == 0 ? mats[1] : mats[0];
+  matrix_t const * const B = mode == 2 ? mats[1] : mats[2];
+
+  idx_t const I = tt->dims[mode];
+  idx_t const rank = M->J;
+
+  memset(M->vals, 0, I * rank * sizeof(val_t));
+
+  idx_t const nnz = tt->nnz;
+  idx_t const * const restrict indM = tt->ind[mode];
+  idx_t const * const restrict indA =
+    mode == 0 ? tt->ind[1] : tt->ind[0];
+  idx_t const * const restrict indB =
+    mode == 2 ? tt->ind[1] : tt->ind[2];
+
+  val_t const * const restrict vals = tt->vals;
+
+  for(idx_t r=0; r < rank; ++r) {
+    val_t       * const restrict mv =  M->vals + (r * I);
+    val_t const * const restrict av =  A->vals + (r * A->I);
+    val_t const * const restrict bv =  B->vals + (r * B->I);
+
+    /* stretch out columns of A and B */
+    #pragma omp parallel for
+    for(idx_t x=0; x < nnz; ++x) {
+      scratch[x] = vals[x] * av[indA[x]] * bv[indB[x]];
+    }
+
+    /* now accumulate into m1 */
+    for(idx_t x=0; x < nnz; ++x) {
+      mv[indM[x]] += scratch[x];
+    }
+  }
+}
+
+/**
+* @brief Flush a run of nonzeros which all map to output row 'key'. The run is
+*        either owned by this thread (plain add) or possibly shared (atomic).
+*/
+static inline void p_stream_flush(
+    val_t * const restrict outmat,
+    idx_t const key,
+    val_t * const restrict seg,
+    idx_t const nfactors,
+    bool const exclusive)
+{
+  val_t * const restrict outrow = outmat + (key * nfactors);
+  if(exclusive) {
+    for(idx_t f=0; f < nfactors; ++f) {
+      outrow[f] += seg[f];
+      seg[f] = 0.;
+    }
+  } else {
+    for(idx_t f=0; f < nfactors; ++f) {
+      p_atomic_add(outrow + f, seg[f]);
+      seg[f] = 0.;
+    }
+  }
+}
+
+
+idx_t * mttkrp_stream_order(
+  sptensor_t const * const tt,
+  idx_t const mode)
+{
+  idx_t const dim = tt->dims[mode];
+  idx_t const * const restrict ind = tt->ind[mode];
+
+  /* stable counting sort on the output index */
+  idx_t * counts = splatt_malloc((dim + 1) * sizeof(*counts));
+  memset(counts, 0, (dim + 1) * sizeof(*counts));
+  for(idx_t n=0; n < tt->nnz; ++n) {
+    ++counts[ind[n] + 1];
+  }
+  for(idx_t i=0; i < dim; ++i) {
+    counts[i+1] += counts[i];
+  }
+
+  idx_t * order = splatt_malloc(tt->nnz * sizeof(*order));
+  for(idx_t n=0; n < tt->nnz; ++n) {
+    order[counts[ind[n]]++] = n;
+  }
+  splatt_free(counts);
+  return order;
+}
+
+
+void mttkrp_stream_ordered(
+  sptensor_t const * const tt,
+  matrix_t ** mats,
+  idx_t const mode,
+  idx_t const * const order)
+{
+  matrix_t * const M = mats[MAX_NMODES];
+  idx_t const I = tt->dims[mode];
+  idx_t const nfactors = M->J;
+  idx_t const nnz = tt->nnz;
+  idx_t const nmodes = tt->nmodes;
+
+  val_t * const outmat = M->vals;
+  memset(outmat, 0, I * nfactors * sizeof(*outmat));
+
+  val_t * mvals[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    mvals[m] = mats[m]->vals;
+  }
+  val_t const * const restrict vals = tt->vals;
+  idx_t const * const restrict keys = tt->ind[mode];
+
+  /*
+   * If the output indices are non-decreasing in traversal order, then every
+   * run of equal indices is contiguous and only the runs at the ends of a
+   * thread's range can be shared. Otherwise runs are flushed atomically.
+   */
+  bool sorted = true;
+  #pragma omp parallel for schedule(static) reduction(&&:sorted)
+  for(idx_t n=1; n < nnz; ++n) {
+    idx_t const prev = (order == NULL) ? n-1 : order[n-1];
+    idx_t const curr = (order == NULL) ? n : order[n];
+    sorted = sorted && (keys[prev] <= keys[curr]);
+  }
+
+  int const nthreads = splatt_omp_get_max_threads();
+
+  /* per thread: accumulator, run, first run, last run */
+  val_t * buf = splatt_malloc(nthreads * 4 * nfactors * sizeof(*buf));
+  idx_t * first_key = splatt_malloc(nthreads * sizeof(*first_key));
+  idx_t * last_key = splatt_malloc(nthreads * sizeof(*last_key));
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    int const nt = splatt_omp_get_num_threads();
+    val_t * const restrict accum = buf + (tid * 4 * nfactors);
+    val_t * const restrict seg   = accum + nfactors;
+    val_t * const restrict first = seg + nfactors;
+    val_t * const restrict last  = first + nfactors;
+
+    idx_t const start = (nnz * tid) / nt;
+    idx_t const stop  = (nnz * (tid + 1)) / nt;
+
+    first_key[tid] = I;
+    last_key[tid] = I;
+    for(idx_t f=0; f < nfactors; ++f) {
+      seg[f] = 0.;
+      first[f] = 0.;
+      last[f] = 0.;
+    }
+
+    idx_t key = I;
+    for(idx_t x=start; x < stop; ++x) {
+      idx_t const n = (order == NULL) ? x : order[x];
+
+      /* close the previous run */
+      if(keys[n] != key) {
+        if(key != I) {
+          if(first_key[tid] == I) {
+            /* the first run may continue from the previous thread */
+            first_key[tid] = key;
+            for(idx_t f=0; f < nfactors; ++f) {
+              first[f] = seg[f];
+              seg[f] = 0.;
+            }
+          } else {
+            p_stream_flush(outmat, key, seg, nfactors, sorted);
+          }
+        }
+        key = keys[n];
+      }
+
+      /* initialize with value */
+      for(idx_t f=0; f < nfactors; ++f) {
+        accum[f] = vals[n];
+      }
+      for(idx_t m=0; m < nmodes; ++m) {
+        if(m == mode) {
+          continue;
+        }
+        val_t const * const restrict inrow = mvals[m] + \
+            (tt->ind[m][n] * nfactors);
+        for(idx_t f=0; f < nfactors; ++f) {
+          accum[f] *= inrow[f];
+        }
+      }
+      for(idx_t f=0; f < nfactors; ++f) {
+        seg[f] += accum[f];
+      }
+    }
+
+    /* the last run may continue into the next thread */
+    if(key != I) {
+      last_key[tid] = key;
+      for(idx_t f=0; f < nfactors; ++f) {
+        last[f] = seg[f];
+      }
+    }
+
+    #pragma omp barrier
+
+    /* fix up the (at most two per thread) boundary rows */
+    #pragma omp single
+    {
+      for(int t=0; t < nt; ++t) {
+        val_t const * const tfirst = buf + (t * 4 * nfactors) + (2*nfactors);
+        val_t const * const tlast  = tfirst + nfactors;
+        if(first_key[t] != I) {
+          val_t * const restrict outrow = outmat + (first_key[t] * nfactors);
+          for(idx_t f=0; f < nfactors; ++f) {
+            outrow[f] += tfirst[f];
+          }
+        }
+        if(last_key[t] != I) {
+          val_t * const restrict outrow = outmat + (last_key[t] * nfactors);
+          for(idx_t f=0; f < nfactors; ++f) {
+            outrow[f] += tlast[f];
+          }
+        }
+      }
+    } /* implied barrier */
+  } /* end omp parallel */
+
+  splatt_free(buf);
+  splatt_free(first_key);
+  splatt_free(last_key);
+}
+
+
+void mttkrp_stream(
+  sptensor_t const * const tt,
+  matrix_t ** mats,
+  idx_t const mode)
+{
+  mttkrp_stream_ordered(tt, mats, mode, NULL);
+}
+
+
+/**
+* @brief Copy the columns of several row-major matrices, side by side, into one
+*        wider matrix (or back out of it if 'unpack').
+*
+* @param nrows The number of rows in every matrix.
+* @param nsets The number of narrow matrices.
+* @param ncolumns The number of columns of each narrow matrix.
+* @param narrow The narrow matrices.
+* @param wide The concatenated matrix, with sum(ncolumns) columns.
+* @param unpack Copy from 'wide' to 'narrow' instead.
+*/
+static void p_batch_copy(
+    idx_t const nrows,
+    idx_t const nsets,
+    idx_t const * const ncolumns,
+    val_t ** narrow,
+    val_t * const wide,
+    bool const unpack)
+{
+  idx_t total = 0;
+  for(idx_t s=0; s < nsets; ++s) {
+    total += ncolumns[s];
+  }
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < nrows; ++i) {
+    val_t * restrict wrow = wide + (i * total);
+    for(idx_t s=0; s < nsets; ++s) {
+      idx_t const ncols = ncolumns[s];
+      val_t * const restrict nrow = narrow[s] + (i * ncols);
+      if(unpack) {
+        for(idx_t f=0; f < ncols; ++f) {
+          nrow[f] = wrow[f];
+        }
+      } else {
+        for(idx_t f=0; f < ncols; ++f) {
+          wrow[f] = nrow[f];
+        }
+      }
+      wrow += ncols;
+    }
+  }
+}
+
+
+
+/*
+ * Row-subset MTTKRP. Only the output rows in 'sel' (sorted, without
+ * duplicates) are computed, and row sel[s] is written to row s of a compact
+ * output. If a CSF is rooted at the output mode, each selected row is at most
+ * one slice per tile, which is found by binary search, so only the nonzeros of
+ * the selected rows are visited. Otherwise the tree is walked down to the
+ * output level, where a table of length dims[mode] maps each node to its
+ * compact row (or marks it unselected) in O(1).
+ */
+
+
+/**
+* @brief Binary search for an index in a sorted list.
+*
+* @param list The sorted list.
+* @param nitems The length of the list.
+* @param key The index to look for.
+*
+* @return The position of 'key' in 'list', or 'nitems' if it is not found.
+*/
+static inline idx_t p_rows_lookup(
+    idx_t const * const restrict list,
+    idx_t const nitems,
+    idx_t const key)
+{
+  idx_t lo = 0;
+  idx_t hi = nitems;
+  while(lo < hi) {
+    idx_t const mid = lo + ((hi - lo) / 2);
+    if(list[mid] < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return (lo < nitems && list[lo] == key) ? lo : nitems;
+}
+
+
+/**
+* @brief Accumulate the subtrees of the nodes [start, end) at 'level' into
+*        'out'. Each node contributes the sum of its children's subtrees
+*        times its own row.
+*
+* @param pt The sparsity pattern of the tile.
+* @param level The level of the nodes.
+* @param start The first node.
+* @param end One past the last node.
+* @param mvals The factors, ordered by CSF level.
+* @param nmodes The number of modes.
+* @param ncols The number of columns.
+* @param buf Scratch rows; buf[l] is used for the nodes at level l.
+* @param[out] out The row to accumulate into.
+*/
+static void p_rows_up(
+    csf_sparsity const * const pt,
+    idx_t const level,
+    idx_t const start,
+    idx_t const end,
+    val_t * const * const mvals,
+    idx_t const nmodes,
+    idx_t const ncols,
+    val_t ** buf,
+    val_t * const restrict out)
 {
-  matrix_t       * const M = mats[MAX_NMODES];
-  matrix_t const * const A = mode == 0 ? mats[1] : mats[0];
-  matrix_t const * const B = mode == 2 ? mats[1] : mats[2];
-
-  idx_t const I = tt->dims[mode];
-  idx_t const rank = M->J;
+  idx_t const * const restrict fids = pt->fids[level];
+  val_t const * const restrict mv = mvals[level];
+
+  if(level == nmodes - 1) {
+    val_t const * const restrict vals = pt->vals;
+    for(idx_t n=start; n < end; ++n) {
+      val_t const v = vals[n];
+      val_t const * const restrict row = mv + (fids[n] * ncols);
+      for(idx_t f=0; f < ncols; ++f) {
+        out[f] += v * row[f];
+      }
+    }
+    return;
+  }
 
-  memset(M->vals, 0, I * rank * sizeof(val_t));
+  idx_t const * const restrict fptr = pt->fptr[level];
+  val_t * const restrict accum = buf[level];
+  for(idx_t n=start; n < end; ++n) {
+    memset(accum, 0, ncols * sizeof(*accum));
+    p_rows_up(pt, level+1, fptr[n], fptr[n+1], mvals, nmodes, ncols, buf,
+        accum);
+    val_t const * const restrict row = mv + (fids[n] * ncols);
+    for(idx_t f=0; f < ncols; ++f) {
+      out[f] += accum[f] * row[f];
+    }
+  }
+}
 
-  idx_t const nnz = tt->nnz;
-  idx_t const * const restrict indM = tt->ind[mode];
-  idx_t const * const restrict indA =
-    mode == 0 ? tt->ind[1] : tt->ind[0];
-  idx_t const * const restrict indB =
-    mode == 2 ? tt->ind[1] : tt->ind[2];
 
-  val_t const * const restrict vals = tt->vals;
+/**
+* @brief Walk the nodes [start, end) at 'level' down to the output level and
+*        accumulate the selected output rows. buf[level-1] holds the product of
+*        the rows on the path from the root.
+*
+* @param pt The sparsity pattern of the tile.
+* @param level The level of the nodes.
+* @param outdepth The level of the output mode (> 0).
+* @param start The first node.
+* @param end One past the last node.
+* @param mvals The factors, ordered by CSF level.
+* @param nmodes The number of modes.
+* @param ncols The number of columns.
+* @param slot Maps each output row to its position in the compact output, or
+*             to 'nsel' if it is not selected.
+* @param nsel The number of selected rows.
+* @param buf Scratch rows; buf[l] is used for the nodes at level l.
+* @param[out] out The compact output, one row per selected row.
+*/
+static void p_rows_down(
+    csf_sparsity const * const pt,
+    idx_t const level,
+    idx_t const outdepth,
+    idx_t const start,
+    idx_t const end,
+    val_t * const * const mvals,
+    idx_t const nmodes,
+    idx_t const ncols,
+    idx_t const * const restrict slot,
+    idx_t const nsel,
+    val_t ** buf,
+    val_t * const out)
+{
+  idx_t const * const restrict fids = pt->fids[level];
+  idx_t const * const restrict fptr = pt->fptr[level];
+  val_t const * const restrict mv = mvals[level];
 
-  for(idx_t r=0; r < rank; ++r) {
-    val_t       * const restrict mv =  M->vals + (r * I);
-    val_t const * const restrict av =  A->vals + (r * A->I);
-    val_t const * const restrict bv =  B->vals + (r * B->I);
+  for(idx_t n=start; n < end; ++n) {
+    idx_t const fid = (fids == NULL) ? n : fids[n];
 
-    /* stretch out columns of A and B */
-    #pragma omp parallel for
-    for(idx_t x=0; x < nnz; ++x) {
-      scratch[x] = vals[x] * av[indA[x]] * bv[indB[x]];
+    if(level == outdepth) {
+      idx_t const s = slot[fid];
+      if(s == nsel) {
+        continue;
+      }
+      val_t * const restrict orow = out + (s * ncols);
+      val_t const * const restrict path = buf[level-1];
+      if(level == nmodes - 1) {
+        val_t const v = pt->vals[n];
+        for(idx_t f=0; f < ncols; ++f) {
+          orow[f] += v * path[f];
+        }
+      } else {
+        val_t * const restrict accum = buf[level];
+        memset(accum, 0, ncols * sizeof(*accum));
+        p_rows_up(pt, level+1, fptr[n], fptr[n+1], mvals, nmodes, ncols, buf,
+            accum);
+        for(idx_t f=0; f < ncols; ++f) {
+          orow[f] += accum[f] * path[f];
+        }
+      }
+      continue;
     }
 
-    /* now accumulate into m1 */
-    for(idx_t x=0; x < nnz; ++x) {
-      mv[indM[x]] += scratch[x];
+    val_t const * const restrict row = mv + (fid * ncols);
+    val_t * const restrict prod = buf[level];
+    if(level == 0) {
+      memcpy(prod, row, ncols * sizeof(*prod));
+    } else {
+      val_t const * const restrict path = buf[level-1];
+      for(idx_t f=0; f < ncols; ++f) {
+        prod[f] = path[f] * row[f];
+      }
     }
+    p_rows_down(pt, level+1, outdepth, fptr[n], fptr[n+1], mvals, nmodes,
+        ncols, slot, nsel, buf, out);
   }
 }
 
-void mttkrp_stream(
-  sptensor_t const * const tt,
-  matrix_t ** mats,
-  idx_t const mode)
-{
-  if(pool == NULL) {
-    pool = mutex_alloc();
-  }
 
-  matrix_t * const M = mats[MAX_NMODES];
-  idx_t const I = tt->dims[mode];
-  idx_t const nfactors = M->J;
+/**
+* @brief Compute the selected rows of a MTTKRP with one CSF tensor.
+*
+* @param ct The CSF tensor.
+* @param mode The output mode.
+* @param mvals The factors, indexed by mode.
+* @param ncols The number of columns.
+* @param sel The sorted list of selected rows, without duplicates.
+* @param nsel The number of selected rows.
+* @param nthreads The number of threads to use.
+* @param[out] out The compact output, 'nsel' x 'ncols'. It is overwritten.
+*/
+static void p_mttkrp_csf_rows(
+    splatt_csf const * const ct,
+    idx_t const mode,
+    val_t ** const mvals,
+    idx_t const ncols,
+    idx_t const * const sel,
+    idx_t const nsel,
+    idx_t const nthreads,
+    val_t * const out)
+{
+  idx_t const nmodes = ct->nmodes;
+  idx_t const outdepth = csf_mode_to_depth(ct, mode);
 
-  val_t * const outmat = M->vals;
-  memset(outmat, 0, I * nfactors * sizeof(*outmat));
+  val_t * lvals[MAX_NMODES];
+  for(idx_t l=0; l < nmodes; ++l) {
+    lvals[l] = mvals[csf_depth_to_mode(ct, l)];
+  }
 
-  idx_t const nmodes = tt->nmodes;
+  memset(out, 0, nsel * ncols * sizeof(*out));
 
-  val_t * mvals[MAX_NMODES];
-  for(idx_t m=0; m < nmodes; ++m) {
-    mvals[m] = mats[m]->vals;
+  /* below the root, map output rows to their compact slot in O(1) */
+  idx_t * slot = NULL;
+  if(outdepth > 0) {
+    idx_t const dim = ct->dims[mode];
+    slot = splatt_malloc(dim * sizeof(*slot));
+    #pragma omp parallel num_threads(nthreads)
+    {
+      #pragma omp for schedule(static)
+      for(idx_t i=0; i < dim; ++i) {
+        slot[i] = nsel;
+      }
+      #pragma omp for schedule(static)
+      for(idx_t s=0; s < nsel; ++s) {
+        slot[sel[s]] = s;
+      }
+    }
   }
 
-  val_t const * const restrict vals = tt->vals;
+  /* private outputs are only 'nsel' rows, so the filtered walk can use them */
+  val_t * priv = NULL;
+  idx_t npriv = 0;
 
-  #pragma omp parallel
+  #pragma omp parallel num_threads(nthreads)
   {
-    val_t * restrict accum = splatt_malloc(nfactors * sizeof(*accum));
+    int const tid = splatt_omp_get_thread_num();
+    val_t * const bufmem = splatt_malloc(nmodes * ncols * sizeof(*bufmem));
+    val_t * buf[MAX_NMODES];
+    for(idx_t l=0; l < nmodes; ++l) {
+      buf[l] = bufmem + (l * ncols);
+    }
 
-    /* stream through nnz */
-    #pragma omp for schedule(static)
-    for(idx_t n=0; n < tt->nnz; ++n) {
-      /* initialize with value */
-      for(idx_t f=0; f < nfactors; ++f) {
-        accum[f] = vals[n];
+    if(outdepth == 0) {
+      /* each selected row is written by one thread */
+      #pragma omp for schedule(dynamic, 1)
+      for(idx_t s=0; s < nsel; ++s) {
+        for(idx_t t=0; t < ct->ntiles; ++t) {
+          csf_sparsity const * const pt = ct->pt + t;
+          idx_t const nslices = pt->nfibs[0];
+          idx_t slice = sel[s];
+          if(pt->fids[0] != NULL) {
+            slice = p_rows_lookup(pt->fids[0], nslices, sel[s]);
+          }
+          if(slice >= nslices) {
+            continue;
+          }
+          p_rows_up(pt, 1, pt->fptr[0][slice], pt->fptr[0][slice+1], lvals,
+              nmodes, ncols, buf, out + (s * ncols));
+        }
       }
-
-      for(idx_t m=0; m < nmodes; ++m) {
-        if(m == mode) {
-          continue;
+    } else {
+      /* size by the team we actually got, which may be smaller */
+      #pragma omp single
+      {
+        npriv = splatt_omp_get_num_threads();
+        if(npriv > 1) {
+          priv = splatt_malloc(npriv * nsel * ncols * sizeof(*priv));
         }
-        val_t const * const restrict inrow = mvals[m] + \
-            (tt->ind[m][n] * nfactors);
-        for(idx_t f=0; f < nfactors; ++f) {
-          accum[f] *= inrow[f];
+      } /* implied barrier */
+
+      val_t * const myout = (priv == NULL) ? out : priv + (tid*nsel*ncols);
+      if(priv != NULL) {
+        memset(myout, 0, nsel * ncols * sizeof(*myout));
+      }
+
+      for(idx_t t=0; t < ct->ntiles; ++t) {
+        csf_sparsity const * const pt = ct->pt + t;
+        #pragma omp for schedule(dynamic, 16) nowait
+        for(idx_t slice=0; slice < pt->nfibs[0]; ++slice) {
+          p_rows_down(pt, 0, outdepth, slice, slice+1, lvals, nmodes, ncols,
+              slot, nsel, buf, myout);
         }
       }
 
-      /* write to output */
-      idx_t const out_ind = tt->ind[mode][n];
-      val_t * const restrict outrow = outmat + (tt->ind[mode][n] * nfactors);
-      mutex_set_lock(pool, out_ind);
-      for(idx_t f=0; f < nfactors; ++f) {
-        outrow[f] += accum[f];
+      if(priv != NULL) {
+        #pragma omp barrier
+        #pragma omp for schedule(static)
+        for(idx_t x=0; x < nsel * ncols; ++x) {
+          for(idx_t p=0; p < npriv; ++p) {
+            out[x] += priv[(p * nsel * ncols) + x];
+          }
+        }
       }
-      mutex_unset_lock(pool, out_ind);
     }
 
-    splatt_free(accum);
+    splatt_free(bufmem);
   } /* end omp parallel */
+
+  splatt_free(priv);
+  splatt_free(slot);
 }
 
 
+
 /******************************************************************************
  * API FUNCTIONS
  *****************************************************************************/
@@ -1768,46 +3919,137 @@ int splatt_mttkrp(
     splatt_val_t * const matout,
     double const * const options)
 {
-  idx_t const nmodes = tensors->nmodes;
+  splatt_mttkrp_ctx * ctx = splatt_mttkrp_ctx_alloc(tensors, ncolumns,
+      options);
+  int const ret = splatt_mttkrp_ctx_exec(ctx, mode, matrices, matout);
+  splatt_mttkrp_ctx_free(ctx);
+  return ret;
+}
 
-  /* fill matrix pointers  */
-  matrix_t * mats[MAX_NMODES+1];
-  for(idx_t m=0; m < nmodes; ++m) {
-    mats[m] = (matrix_t *) splatt_malloc(sizeof(matrix_t));
-    mats[m]->I = tensors->dims[m];
-    mats[m]->J = ncolumns,
-    mats[m]->rowmajor = 1;
-    mats[m]->vals = matrices[m];
-  }
-  mats[MAX_NMODES] = (matrix_t *) splatt_malloc(sizeof(matrix_t));
-  mats[MAX_NMODES]->I = tensors->dims[mode];
-  mats[MAX_NMODES]->J = ncolumns;
-  mats[MAX_NMODES]->rowmajor = 1;
-  mats[MAX_NMODES]->vals = matout;
 
-  /* Setup thread structures. + 64 bytes is to avoid false sharing. */
+int splatt_mttkrp_rows(
+    splatt_idx_t const mode,
+    splatt_idx_t const ncolumns,
+    splatt_csf const * const tensors,
+    splatt_val_t ** matrices,
+    splatt_idx_t const nrows,
+    splatt_idx_t const * const rows,
+    splatt_val_t * const matout,
+    double const * const options)
+{
+  if(mode >= tensors->nmodes) {
+    return SPLATT_ERROR_BADINPUT;
+  }
+  for(idx_t i=0; i < nrows; ++i) {
+    if(rows[i] >= tensors->dims[mode]) {
+      return SPLATT_ERROR_BADINPUT;
+    }
+  }
+  if(nrows == 0) {
+    return SPLATT_SUCCESS;
+  }
+
+  /* the CSF which stores 'mode' closest to the root */
+  idx_t which = 0;
+  switch((splatt_csf_type) options[SPLATT_OPTION_CSF_ALLOC]) {
+  case SPLATT_CSF_TWOMODE:
+    if(csf_mode_to_depth(tensors + 1, mode) <
+        csf_mode_to_depth(tensors, mode)) {
+      which = 1;
+    }
+    break;
+  case SPLATT_CSF_ALLMODE:
+    /* tensors[mode] is rooted at 'mode', so only its slices are visited */
+    which = mode;
+    break;
+  default:
+    break;
+  }
+
+  /* sort and remove duplicates */
+  idx_t * sel = splatt_malloc(nrows * sizeof(*sel));
+  memcpy(sel, rows, nrows * sizeof(*sel));
+  quicksort(sel, nrows);
+  idx_t nsel = 1;
+  for(idx_t i=1; i < nrows; ++i) {
+    if(sel[i] != sel[nsel-1]) {
+      sel[nsel++] = sel[i];
+    }
+  }
+
+#ifdef _OPENMP
   idx_t const nthreads = (idx_t) options[SPLATT_OPTION_NTHREADS];
-  splatt_omp_set_num_threads(nthreads);
-  thd_info * thds =  thd_init(nthreads, 3,
-    (nmodes * ncolumns * sizeof(val_t)) + 64,
-    0,
-    (nmodes * ncolumns * sizeof(val_t)) + 64);
+#else
+  idx_t const nthreads = 1;
+#endif
+
+  val_t * out = splatt_malloc(nsel * ncolumns * sizeof(*out));
+  p_mttkrp_csf_rows(tensors + which, mode, matrices, ncolumns, sel, nsel,
+      nthreads, out);
+
+  /* expand to the caller's order */
+  #pragma omp parallel for schedule(static) num_threads(nthreads)
+  for(idx_t i=0; i < nrows; ++i) {
+    idx_t const s = p_rows_lookup(sel, nsel, rows[i]);
+    memcpy(matout + (i * ncolumns), out + (s * ncolumns),
+        ncolumns * sizeof(*matout));
+  }
+
+  splatt_free(out);
+  splatt_free(sel);
+  return SPLATT_SUCCESS;
+}
+
+
+int splatt_mttkrp_batch(
+    splatt_idx_t const mode,
+    splatt_idx_t const nsets,
+    splatt_idx_t const * const ncolumns,
+    splatt_csf const * const tensors,
+    splatt_val_t *** matrices,
+    splatt_val_t ** matouts,
+    double const * const options)
+{
+  if(nsets == 0 || mode >= tensors->nmodes) {
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  idx_t const nmodes = tensors->nmodes;
+
+  /*
+   * MTTKRP is independent across columns, so one MTTKRP with the sets
+   * concatenated column-wise gives the concatenated outputs.
+   */
+  idx_t total = 0;
+  for(idx_t s=0; s < nsets; ++s) {
+    total += ncolumns[s];
+  }
 
-  splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(tensors, ncolumns, options);
+  val_t ** narrow = splatt_malloc(nsets * sizeof(*narrow));
+  val_t * wide[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    wide[m] = splatt_malloc(tensors->dims[m] * total * sizeof(**wide));
+    if(m == mode) {
+      continue;
+    }
+    for(idx_t s=0; s < nsets; ++s) {
+      narrow[s] = matrices[s][m];
+    }
+    p_batch_copy(tensors->dims[m], nsets, ncolumns, narrow, wide[m], false);
+  }
 
-  /* do the MTTKRP */
-  mttkrp_csf(tensors, mats, mode, thds, ws, options);
+  int const ret = splatt_mttkrp(mode, total, tensors, wide, wide[mode],
+      options);
 
-  splatt_mttkrp_free_ws(ws);
+  p_batch_copy(tensors->dims[mode], nsets, ncolumns, matouts, wide[mode],
+      true);
 
-  /* cleanup */
-  thd_free(thds, nthreads);
   for(idx_t m=0; m < nmodes; ++m) {
-    free(mats[m]);
+    splatt_free(wide[m]);
   }
-  free(mats[MAX_NMODES]);
+  splatt_free(narrow);
 
-  return SPLATT_SUCCESS;
+  return ret;
 }
 
 
@@ -1817,6 +4059,12 @@ splatt_mttkrp_ws * splatt_mttkrp_alloc_ws(
     double const * const opts)
 {
   splatt_mttkrp_ws * ws = splatt_malloc(sizeof(*ws));
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    ws->is_privatized[m] = false;
+    ws->priv_type[m] = SPLATT_PRIV_NONE;
+    ws->priv_rows[m] = NULL;
+    ws->priv_nrows[m] = NULL;
+  }
 
   idx_t num_csf = 0;
 
@@ -1867,13 +4115,35 @@ splatt_mttkrp_ws * splatt_mttkrp_alloc_ws(
   for(idx_t c=0; c < num_csf; ++c) {
     ws->tile_partition[c] = NULL;
     ws->tree_partition[c] = NULL;
+    ws->tree_imbalance[c] = 1.;
   }
   for(idx_t c=0; c < num_csf; ++c) {
     splatt_csf const * const csf = &(tensors[c]);
     if(tensors[c].ntiles > 1) {
       ws->tile_partition[c] = csf_partition_tiles_1d(csf, num_threads);
     } else {
-      ws->tree_partition[c] = csf_partition_1d(csf, 0, num_threads);
+      idx_t bneck;
+      ws->tree_partition[c] = csf_partition_split_1d(csf, 0, num_threads,
+          &bneck);
+      if(csf->nnz > 0) {
+        ws->tree_imbalance[c] = (double) (bneck * num_threads) /
+            (double) csf->nnz;
+      }
+
+      if((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
+        /* count the slices which are shared by two threads */
+        idx_t nsplit = 0;
+        for(idx_t t=1; t < num_threads; ++t) {
+          idx_t const fib = ws->tree_partition[c][t];
+          if(fib > 0 && fib < csf->pt[0].nfibs[1] &&
+              csf_find_slice(csf->pt[0].fptr[0], csf->pt[0].nfibs[0], fib) ==
+              csf_find_slice(csf->pt[0].fptr[0], csf->pt[0].nfibs[0], fib-1)) {
+            ++nsplit;
+          }
+        }
+        printf("CSF-%"SPLATT_PF_IDX" IMBALANCE: %0.3f (%"SPLATT_PF_IDX
+            " split slices)\n", c+1, ws->tree_imbalance[c], nsplit);
+      }
     }
   }
 
@@ -1883,11 +4153,50 @@ splatt_mttkrp_ws * splatt_mttkrp_alloc_ws(
   ws->privatize_buffer =
       splatt_malloc(num_threads * sizeof(*(ws->privatize_buffer)));
   for(idx_t m=0; m < tensors->nmodes; ++m) {
-    ws->is_privatized[m] = p_is_privatized(tensors, m, opts);
+    idx_t const c = ws->mode_csf_map[m];
+    splatt_csf const * const csf = &(tensors[c]);
+
+    ws->priv_type[m] = p_privatization_type(tensors, m, opts);
+
+    /* tiled modes are scheduled dynamically, so we can't know the rows */
+    if(ws->priv_type[m] == SPLATT_PRIV_SPARSE &&
+        csf->ntiles > 1 && csf->tile_dims[m] > 1) {
+      ws->priv_type[m] = SPLATT_PRIV_NONE;
+    }
+
+    if(ws->priv_type[m] == SPLATT_PRIV_SPARSE) {
+      ws->priv_nrows[m] = splatt_malloc(num_threads *
+          sizeof(**(ws->priv_nrows)));
+      ws->priv_rows[m] = p_touched_rows(csf, c, m, ws, ws->priv_nrows[m]);
+
+      /* most rows are touched anyway, and the mode already failed the dense
+       * test, so synchronize instead */
+      idx_t total = 0;
+      for(idx_t t=0; t < num_threads; ++t) {
+        total += ws->priv_nrows[m][t];
+      }
+      if(total * 2 > tensors->dims[m] * num_threads) {
+        for(idx_t t=0; t < num_threads; ++t) {
+          splatt_free(ws->priv_rows[m][t]);
+        }
+        splatt_free(ws->priv_rows[m]);
+        splatt_free(ws->priv_nrows[m]);
+        ws->priv_rows[m] = NULL;
+        ws->priv_nrows[m] = NULL;
+        ws->priv_type[m] = SPLATT_PRIV_NONE;
+      } else if((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
+        printf("PRIVATIZING-MODE: %"SPLATT_PF_IDX" (sparse, %0.1f%% rows)\n",
+            m+1, 100. * (double)total /
+                 (double)(tensors->dims[m] * num_threads));
+      }
+    }
+
+    ws->is_privatized[m] = (ws->priv_type[m] != SPLATT_PRIV_NONE);
 
     if(ws->is_privatized[m]) {
       largest_priv_dim = SS_MAX(largest_priv_dim, tensors->dims[m]);
-      if((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
+      if(ws->priv_type[m] == SPLATT_PRIV_DENSE &&
+          (int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
         printf("PRIVATIZING-MODE: %"SPLATT_PF_IDX"\n", m+1);
       }
     }
@@ -1895,6 +4204,9 @@ splatt_mttkrp_ws * splatt_mttkrp_alloc_ws(
   for(idx_t t=0; t < num_threads; ++t) {
     ws->privatize_buffer[t] = splatt_malloc(largest_priv_dim * ncolumns *
         sizeof(**(ws->privatize_buffer)));
+    /* MTTKRP expects private buffers to be zeroed between calls */
+    memset(ws->privatize_buffer[t], 0, largest_priv_dim * ncolumns *
+        sizeof(**(ws->privatize_buffer)));
   }
   if(largest_priv_dim > 0 &&
         (int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
@@ -1908,6 +4220,101 @@ splatt_mttkrp_ws * splatt_mttkrp_alloc_ws(
     free(bstr);
   }
 
+  ws->sync = (splatt_sync_type) opts[SPLATT_OPTION_SYNC];
+
+  /* size the lock pool for the longest mode so MTTKRP need not replace it */
+  idx_t maxdim = 0;
+  for(idx_t m=0; m < tensors->nmodes; ++m) {
+    maxdim = SS_MAX(maxdim, tensors->dims[m]);
+  }
+  ws->pool = NULL;
+  p_prepare_pool(ws, maxdim, false);
+
+  /* low-precision copies of the factors */
+  ws->precision = (splatt_precision_type) opts[SPLATT_OPTION_PRECISION];
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    ws->lowp_factors[m] = NULL;
+  }
+  ws->lowp_scratch = NULL;
+  ws->lowp_scratch_stride = 0;
+  if(ws->precision != SPLATT_PREC_FULL) {
+    size_t bytes = 0;
+    for(idx_t m=0; m < tensors->nmodes; ++m) {
+      size_t const len = tensors->dims[m] * ncolumns *
+          precision_size(ws->precision);
+      ws->lowp_factors[m] = splatt_malloc(len);
+      bytes += len;
+    }
+
+    /* up/down accumulators for each level plus an output row, padded to a
+     * cache line to avoid false sharing */
+    idx_t stride = ((2 * tensors->nmodes) + 1) * ncolumns;
+    stride += (8 - (stride % 8)) % 8;
+    ws->lowp_scratch_stride = stride;
+    ws->lowp_scratch = splatt_malloc(num_threads * stride *
+        sizeof(*(ws->lowp_scratch)));
+
+    if((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
+      char * bstr = bytes_str(bytes);
+      printf("MTTKRP-PRECISION: %s (%s)\n", precision_name(ws->precision),
+          bstr);
+      free(bstr);
+    }
+  }
+
+  /* memoization needs a single untiled CSF with internal levels, and its
+   * partial results are kept at full precision */
+  ws->memo_levels = 0;
+  ws->memo_depth = tensors->nmodes;
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    ws->memo[m] = NULL;
+  }
+  double const memo_levels = opts[SPLATT_OPTION_MEMOIZE];
+  if(memo_levels >= 1. && num_csf == 1 && tensors->ntiles == 1 &&
+      tensors->nmodes > 2 && ws->precision == SPLATT_PREC_FULL) {
+    ws->memo_levels = SS_MIN((idx_t) memo_levels, tensors->nmodes - 2);
+
+    size_t bytes = 0;
+    for(idx_t d=1; d <= ws->memo_levels; ++d) {
+      size_t const len = tensors->pt[0].nfibs[d] * ncolumns;
+      ws->memo[d] = splatt_malloc(len * sizeof(**(ws->memo)));
+      bytes += len * sizeof(**(ws->memo));
+    }
+
+    if((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
+      char * bstr = bytes_str(bytes);
+      printf("MTTKRP-MEMO: %"SPLATT_PF_IDX" levels (%s)\n", ws->memo_levels,
+          bstr);
+      free(bstr);
+    }
+  }
+
+  /* column blocking for large ranks; memoized partials need every column */
+  ws->col_block = p_col_block_width(ncolumns, tensors->nmodes, opts);
+  if(ws->memo_levels > 0) {
+    ws->col_block = ncolumns;
+  }
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    ws->block_vals[m] = NULL;
+  }
+  if(ws->col_block < ncolumns) {
+    for(idx_t m=0; m < tensors->nmodes; ++m) {
+      ws->block_vals[m] = splatt_malloc(tensors->dims[m] * ws->col_block *
+          sizeof(**(ws->block_vals)));
+    }
+    if((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
+      printf("MTTKRP-COLBLOCK: %"SPLATT_PF_IDX" columns (%"SPLATT_PF_IDX
+          " blocks)\n", ws->col_block,
+          (ncolumns + ws->col_block - 1) / ws->col_block);
+    }
+  }
+
+  /* pick the kernel instruction set for this machine */
+  ws->simd = simd_resolve((splatt_simd_type) opts[SPLATT_OPTION_SIMD]);
+  if((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
+    printf("MTTKRP-SIMD: %s\n", simd_name(ws->simd));
+  }
+
   return ws;
 }
 
@@ -1920,12 +4327,102 @@ void splatt_mttkrp_free_ws(
   }
   splatt_free(ws->privatize_buffer);
 
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    if(ws->priv_rows[m] != NULL) {
+      for(idx_t t=0; t < ws->num_threads; ++t) {
+        splatt_free(ws->priv_rows[m][t]);
+      }
+      splatt_free(ws->priv_rows[m]);
+      splatt_free(ws->priv_nrows[m]);
+    }
+  }
+
   for(idx_t c=0; c < ws->num_csf; ++c) {
     splatt_free(ws->tile_partition[c]);
     splatt_free(ws->tree_partition[c]);
   }
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    splatt_free(ws->memo[m]);
+    splatt_free(ws->lowp_factors[m]);
+    splatt_free(ws->block_vals[m]);
+  }
+  splatt_free(ws->lowp_scratch);
+  mutex_free(ws->pool);
   splatt_free(ws);
 }
 
 
+splatt_mttkrp_ctx * splatt_mttkrp_ctx_alloc(
+    splatt_csf const * const tensors,
+    splatt_idx_t const ncolumns,
+    double const * const options)
+{
+  idx_t const nmodes = tensors->nmodes;
+
+  splatt_mttkrp_ctx * ctx = splatt_malloc(sizeof(*ctx));
+  ctx->tensors = tensors;
+  ctx->ncolumns = ncolumns;
+  ctx->opts = splatt_default_opts();
+  memcpy(ctx->opts, options, SPLATT_OPTION_NOPTIONS * sizeof(*options));
+
+  /* Setup thread structures. + 64 bytes is to avoid false sharing. */
+  ctx->nthreads = (idx_t) options[SPLATT_OPTION_NTHREADS];
+  splatt_omp_set_num_threads(ctx->nthreads);
+  ctx->thds = thd_init(ctx->nthreads, 3,
+    (nmodes * ncolumns * sizeof(val_t)) + 64,
+    0,
+    (nmodes * ncolumns * sizeof(val_t)) + 64);
+
+  ctx->ws = splatt_mttkrp_alloc_ws(tensors, ncolumns, options);
+
+  for(idx_t m=0; m <= MAX_NMODES; ++m) {
+    ctx->wrappers[m].I = (m < nmodes) ? tensors->dims[m] : 0;
+    ctx->wrappers[m].J = ncolumns;
+    ctx->wrappers[m].rowmajor = 1;
+    ctx->wrappers[m].vals = NULL;
+    ctx->mats[m] = &(ctx->wrappers[m]);
+  }
+
+  return ctx;
+}
+
+
+int splatt_mttkrp_ctx_exec(
+    splatt_mttkrp_ctx * const ctx,
+    splatt_idx_t const mode,
+    splatt_val_t ** matrices,
+    splatt_val_t * const matout)
+{
+  splatt_csf const * const tensors = ctx->tensors;
+  if(mode >= tensors->nmodes) {
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  /* point the wrappers at this call's matrices */
+  for(idx_t m=0; m < tensors->nmodes; ++m) {
+    ctx->wrappers[m].vals = matrices[m];
+  }
+  ctx->wrappers[MAX_NMODES].I = tensors->dims[mode];
+  ctx->wrappers[MAX_NMODES].vals = matout;
+
+  /* the factors may have changed since the last call, so any memoized
+   * partial results are stale */
+  ctx->ws->memo_depth = tensors->nmodes;
+
+  mttkrp_csf(tensors, ctx->mats, mode, ctx->thds, ctx->ws, ctx->opts);
+
+  return SPLATT_SUCCESS;
+}
+
+
+void splatt_mttkrp_ctx_free(
+    splatt_mttkrp_ctx * ctx)
+{
+  splatt_mttkrp_free_ws(ctx->ws);
+  thd_free(ctx->thds, ctx->nthreads);
+  splatt_free_opts(ctx->opts);
+  splatt_free(ctx);
+}
+
+
 
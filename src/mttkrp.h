@@ -10,6 +10,64 @@
 #include "ftensor.h"
 #include "csf.h"
 #include "thd_info.h"
+#include "mutex_pool.h"
+
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief Function pointer that runs a CSF kernel (e.g., MTTKRP or TTMc) on a
+*        tile of a CSF tree. The output is mats[MAX_NMODES].
+*
+* @param ct The CSF tensor.
+* @param tile_id The tile to process.
+* @param mats The matrices.
+* @param mode The output mode.
+* @param thds Thread structures.
+* @param partition A partitioning of the fibers (the nodes one level below
+*                  the root) in the tensor, to distribute to threads. Use
+*                  csf_thread_range() to decide what to process. This may be
+*                  NULL, in that case simply process all slices.
+* @param pool The locks which guard shared output rows.
+*/
+typedef void (* csf_mttkrp_func)(
+    splatt_csf const * const ct,
+    idx_t const tile_id,
+    matrix_t ** mats,
+    idx_t const mode,
+    thd_info * const thds,
+    idx_t const * const partition,
+    mutex_pool * const pool);
+
+
+/**
+* @brief Everything needed to repeatedly run MTTKRP with the same tensor and
+*        rank: thread structures, the workspace, and matrix wrappers. See
+*        splatt_mttkrp_ctx_alloc().
+*/
+struct splatt_mttkrp_ctx
+{
+  /** @brief The CSF tensor(s), which are not owned by the context. */
+  splatt_csf const * tensors;
+  /** @brief The number of columns in each matrix. */
+  idx_t ncolumns;
+  /** @brief A private copy of the options. */
+  double * opts;
+  /** @brief The number of threads used. */
+  idx_t nthreads;
+  /** @brief Thread structures. */
+  thd_info * thds;
+  /** @brief Partitions, privatization buffers, and other workspace. */
+  splatt_mttkrp_ws * ws;
+  /** @brief Matrix wrappers which are pointed at the caller's data. */
+  matrix_t wrappers[MAX_NMODES+1];
+  /** @brief Pointers to 'wrappers', in the layout mttkrp_csf() expects. */
+  matrix_t * mats[MAX_NMODES+1];
+};
+
 
 
 /******************************************************************************
@@ -41,6 +99,52 @@ void mttkrp_csf(
   double const * const opts);
 
 
+#define mttkrp_csf_schedule splatt_mttkrp_csf_schedule
+/**
+* @brief Map a CSF kernel onto a (possibly tiled) CSF tensor. Tiles or
+*        partitions of the tree are distributed to threads as described by
+*        'ws', and privatized modes are written to thread-local buffers which
+*        are then reduced. The output is mats[MAX_NMODES], whose I and J give
+*        the size of the reduction; it is not cleared.
+*
+* @param tensors An array of CSF representations. tensors[csf_id] is processed.
+* @param csf_id Which tensor are we processing?
+* @param atomic_func A kernel which synchronizes its updates to the output.
+* @param nosync_func A kernel which does not synchronize.
+* @param mats The matrices, with the output stored in mats[MAX_NMODES].
+* @param mode Which mode of 'tensors' is the output (not CSF depth).
+* @param thds Thread structures.
+* @param ws MTTKRP workspace.
+*/
+void mttkrp_csf_schedule(
+    splatt_csf const * const tensors,
+    idx_t const csf_id,
+    csf_mttkrp_func atomic_func,
+    csf_mttkrp_func nosync_func,
+    matrix_t ** mats,
+    idx_t const mode,
+    thd_info * const thds,
+    splatt_mttkrp_ws * const ws);
+
+
+#define mttkrp_csf_kernel_name splatt_mttkrp_csf_kernel_name
+/**
+* @brief Report which family of CSF kernels mttkrp_csf() will use for a given
+*        rank and instruction set. AVX2 and AVX-512 use hand-vectorized
+*        kernels for any rank. Scalar ranks 8, 16, 32, and 64 have specialized
+*        kernels with a compile-time trip count; all others use the generic
+*        kernels.
+*
+* @param nfactors The number of columns in the factor matrices.
+* @param simd The instruction set (ws->simd, not SPLATT_SIMD_AUTO).
+*
+* @return A static string naming the kernel family (e.g., "rank-16").
+*/
+char const * mttkrp_csf_kernel_name(
+    idx_t const nfactors,
+    splatt_simd_type const simd);
+
+
 /******************************************************************************
  * DEPRECATED FUNCTIONS
  *****************************************************************************/
@@ -78,9 +182,56 @@ void mttkrp_ttbox(
   idx_t const mode,
   val_t * const scratch);
 
+#define mttkrp_stream splatt_mttkrp_stream
+/**
+* @brief MTTKRP with a coordinate tensor in any (e.g., unsorted) order.
+*        Equivalent to mttkrp_stream_ordered() with the natural order.
+*
+* @param tt The coordinate tensor.
+* @param mats The output and input matrices.
+* @param mode Which mode we are computing for.
+*/
 void mttkrp_stream(
   sptensor_t const * const tt,
   matrix_t ** mats,
   idx_t const mode);
 
+
+#define mttkrp_stream_ordered splatt_mttkrp_stream_ordered
+/**
+* @brief MTTKRP with a coordinate tensor, without locks. Each thread takes a
+*        contiguous range of nonzeros and reduces runs which share an output
+*        row. If the output indices are sorted in traversal order, each run is
+*        written with a plain add and only the two runs at the ends of each
+*        range are merged afterwards. Otherwise, each run is flushed with
+*        atomics.
+*
+* @param tt The coordinate tensor.
+* @param mats The output and input matrices.
+* @param mode Which mode we are computing for.
+* @param order The order to visit nonzeros (e.g., from mttkrp_stream_order()),
+*              or NULL for the natural order.
+*/
+void mttkrp_stream_ordered(
+  sptensor_t const * const tt,
+  matrix_t ** mats,
+  idx_t const mode,
+  idx_t const * const order);
+
+
+#define mttkrp_stream_order splatt_mttkrp_stream_order
+/**
+* @brief Bucket the nonzeros of a coordinate tensor by their index in 'mode'
+*        with a stable counting sort (O(nnz + dims[mode])). Visiting nonzeros
+*        in this order gives mttkrp_stream_ordered() one run per output row.
+*
+* @param tt The coordinate tensor.
+* @param mode The output mode.
+*
+* @return A permutation of [0, nnz). Must be freed with splatt_free().
+*/
+idx_t * mttkrp_stream_order(
+  sptensor_t const * const tt,
+  idx_t const mode);
+
 #endif
@@ -3,6 +3,8 @@
 #include "base.h"
 #include "mutex_pool.h"
 
+#include <inttypes.h>
+
 
 
 mutex_pool * mutex_alloc_custom(
@@ -13,7 +15,11 @@ mutex_pool * mutex_alloc_custom(
 
   pool->num_locks = num_locks;
   pool->pad_size = pad_size;
-  
+  pool->type = MUTEX_POOL_OMP;
+  pool->spins = NULL;
+  pool->hash_shift = 0;
+  pool->track_stats = false;
+
 #ifdef _OPENMP
   pool->locks = splatt_malloc(num_locks * pad_size * sizeof(*pool->locks));
   for(int l=0; l < num_locks; ++l) {
@@ -35,9 +41,115 @@ mutex_pool * mutex_alloc()
 }
 
 
+int mutex_spin_size(
+    int const num_threads,
+    int const num_ids)
+{
+  int const want = SS_MIN(SS_MAX(num_threads, 1) * SPLATT_SPIN_LOCKS_PER_THREAD,
+      SS_MAX(num_ids, 1));
+  int num_locks = 1;
+  while(num_locks < want) {
+    num_locks *= 2;
+  }
+  return num_locks;
+}
+
+
+mutex_pool * mutex_alloc_spin(
+    int const num_threads,
+    int const num_ids)
+{
+  mutex_pool * pool = splatt_malloc(sizeof(*pool));
+
+  pool->type = MUTEX_POOL_SPIN;
+  pool->num_locks = mutex_spin_size(num_threads, num_ids);
+  pool->pad_size = 1;
+  pool->locks = NULL;
+  pool->track_stats = false;
+
+  /* identity mapping when every ID has its own lock, otherwise hash */
+  pool->hash_shift = 0;
+  if(pool->num_locks < num_ids) {
+    int log2 = 0;
+    while((1 << log2) < pool->num_locks) {
+      ++log2;
+    }
+    pool->hash_shift = 32 - log2;
+  }
+
+  /* splatt_malloc() aligns to 64 bytes, so each lock has its own line */
+  pool->spins = splatt_malloc(pool->num_locks * sizeof(*pool->spins));
+  memset(pool->spins, 0, pool->num_locks * sizeof(*pool->spins));
+
+  return pool;
+}
+
+
+void mutex_reset_stats(
+    mutex_pool * const pool)
+{
+  for(int l=0; l < pool->num_locks && pool->spins != NULL; ++l) {
+    pool->spins[l].acquires = 0;
+    pool->spins[l].contended = 0;
+  }
+}
+
+
+void mutex_print_stats(
+    mutex_pool const * const pool)
+{
+  if(pool->type != MUTEX_POOL_SPIN) {
+    return;
+  }
+
+  /* the most contended locks, in decreasing order */
+  int const ntop = 5;
+  int top[5];
+  int nfound = 0;
+
+  uint64_t acquires = 0;
+  uint64_t contended = 0;
+  for(int l=0; l < pool->num_locks; ++l) {
+    spin_lock_t const * const lock = pool->spins + l;
+    acquires += lock->acquires;
+    contended += lock->contended;
+    if(lock->contended == 0) {
+      continue;
+    }
+
+    int pos = SS_MIN(nfound, ntop - 1);
+    if(nfound == ntop &&
+        lock->contended <= pool->spins[top[ntop-1]].contended) {
+      continue;
+    }
+    while(pos > 0 && pool->spins[top[pos-1]].contended < lock->contended) {
+      top[pos] = top[pos-1];
+      --pos;
+    }
+    top[pos] = l;
+    nfound = SS_MIN(nfound + 1, ntop);
+  }
+
+  printf("SPINLOCKS: %d  ACQUIRES: %"PRIu64"  CONTENDED: %"PRIu64" (%0.2f%%)\n",
+      pool->num_locks, acquires, contended,
+      (acquires > 0) ? 100. * (double) contended / (double) acquires : 0.);
+  for(int t=0; t < nfound; ++t) {
+    spin_lock_t const * const lock = pool->spins + top[t];
+    printf("  lock %d: %"PRIu64" acquires, %"PRIu64" contended\n", top[t],
+        lock->acquires, lock->contended);
+  }
+}
+
+
 void mutex_free(
     mutex_pool * pool)
 {
+  if(pool->type == MUTEX_POOL_SPIN) {
+    splatt_free(pool->spins);
+    splatt_free(pool);
+    return;
+  }
+
 #ifdef _OPENMP
   for(int l=0; l < pool->num_locks; ++l) {
     int const lock = mutex_translate_id(l, pool->num_locks, pool->pad_size);
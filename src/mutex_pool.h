@@ -6,6 +6,7 @@
  * INCLUDES
  *****************************************************************************/
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -17,21 +18,62 @@
  *****************************************************************************/
 
 
+#ifndef SPLATT_CACHE_LINE
+#define SPLATT_CACHE_LINE 64
+#endif
+
+
 /**
-* @brief A pool of mutexes for synchronization.
+* @brief The kinds of locks a mutex pool can hold.
+*/
+typedef enum
+{
+  MUTEX_POOL_OMP,  /** omp_lock_t, padded by 'pad_size' locks. */
+  MUTEX_POOL_SPIN  /** Test-and-test-and-set spinlocks, one per cache line. */
+} mutex_pool_type;
+
+
+/**
+* @brief A test-and-test-and-set spinlock which fills a cache line. The
+*        counters are only written while the lock is held, so they share its
+*        line without adding traffic.
 */
 typedef struct
+{
+  /** @brief The number of times the lock was acquired. */
+  uint64_t acquires;
+  /** @brief The number of acquisitions which found the lock held. */
+  uint64_t contended;
+  /** @brief Nonzero while the lock is held. */
+  int flag;
+  char pad[SPLATT_CACHE_LINE - (2 * sizeof(uint64_t)) - sizeof(int)];
+} spin_lock_t;
+
+
+/**
+* @brief A pool of mutexes for synchronization.
+*/
+typedef struct mutex_pool
 {
   bool initialized;
   int num_locks;
   int pad_size;
+  mutex_pool_type type;
 
 #ifdef _OPENMP
   omp_lock_t * locks;
 #else
   volatile int * locks;
 #endif
-} mutex_pool; 
+
+  /** @brief The spinlocks of a MUTEX_POOL_SPIN pool. */
+  spin_lock_t * spins;
+  /** @brief IDs are hashed with (id * golden ratio) >> hash_shift, unless
+   *         the pool has a lock for every ID (hash_shift == 0). */
+  int hash_shift;
+  /** @brief Count acquisitions and contention in each spinlock. */
+  bool track_stats;
+} mutex_pool;
 
 
 #ifndef SPLATT_DEFAULT_NLOCKS
@@ -44,6 +86,18 @@ typedef struct
 #endif
 
 
+/* Spinlock pools hold this many locks per thread, so that two threads rarely
+ * hash to the same lock, up to one lock per ID. */
+#ifndef SPLATT_SPIN_LOCKS_PER_THREAD
+#define SPLATT_SPIN_LOCKS_PER_THREAD 256
+#endif
+
+/* The most pause instructions issued between probes of a held spinlock. */
+#ifndef SPLATT_SPIN_MAX_BACKOFF
+#define SPLATT_SPIN_MAX_BACKOFF 1024
+#endif
+
+
 /******************************************************************************
  * PUBLIC FUNCTIONS
  *****************************************************************************/
@@ -72,6 +126,59 @@ mutex_pool * mutex_alloc_custom(
     int const pad_size);
 
 
+#define mutex_alloc_spin splatt_mutex_alloc_spin
+/**
+* @brief Allocate a pool of spinlocks sized for a thread count and ID range.
+*        See mutex_spin_size().
+*
+* @param num_threads The number of threads which will share the pool.
+* @param num_ids IDs will be in [0, num_ids) (e.g., the rows of the output).
+*
+* @return The allocated mutex pool.
+*/
+mutex_pool * mutex_alloc_spin(
+    int const num_threads,
+    int const num_ids);
+
+
+#define mutex_spin_size splatt_mutex_spin_size
+/**
+* @brief The number of spinlocks to use: SPLATT_SPIN_LOCKS_PER_THREAD for each
+*        thread, rounded up to a power of two, but never more than needed to
+*        give each ID its own lock.
+*
+* @param num_threads The number of threads which will share the pool.
+* @param num_ids The number of distinct IDs.
+*
+* @return The number of locks.
+*/
+int mutex_spin_size(
+    int const num_threads,
+    int const num_ids);
+
+
+#define mutex_print_stats splatt_mutex_print_stats
+/**
+* @brief Print the acquisition and contention counts of a spinlock pool,
+*        including the most contended locks. Counts are only gathered while
+*        'pool->track_stats' is set.
+*
+* @param pool The pool.
+*/
+void mutex_print_stats(
+    mutex_pool const * const pool);
+
+
+#define mutex_reset_stats splatt_mutex_reset_stats
+/**
+* @brief Zero the counters of a spinlock pool.
+*
+* @param pool The pool.
+*/
+void mutex_reset_stats(
+    mutex_pool * const pool);
+
+
 #define mutex_free splatt_mutex_free
 /**
 * @brief Free the memory allocated for a mutex pool.
@@ -101,6 +208,39 @@ static inline int mutex_translate_id(
 }
 
 
+#define mutex_spin_id splatt_mutex_spin_id
+/**
+* @brief Convert an arbitrary integer ID to a lock in a spinlock pool.
+*        Fibonacci hashing spreads strided IDs (e.g., the rows one thread
+*        writes) over the whole pool.
+*
+* @param pool The spinlock pool.
+* @param id An arbitrary integer ID (e.g., matrix row).
+*
+* @return The index of the spinlock.
+*/
+static inline int mutex_spin_id(
+    mutex_pool const * const pool,
+    int const id)
+{
+  if(pool->hash_shift == 0) {
+    return id & (pool->num_locks - 1);
+  }
+  return (int) (((uint32_t) id * 2654435769u) >> pool->hash_shift);
+}
+
+
+/**
+* @brief Tell the CPU we are in a spin-wait loop.
+*/
+static inline void mutex_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+
 #define mutex_set_lock splatt_mutex_set_lock
 /**
 * @brief Claim a lock of a mutex pool. The lock is identified with an ID,
@@ -115,6 +255,29 @@ static inline void mutex_set_lock(
     mutex_pool * const pool,
     int const id)
 {
+  if(pool->type == MUTEX_POOL_SPIN) {
+    spin_lock_t * const lock = pool->spins + mutex_spin_id(pool, id);
+    bool waited = false;
+    while(__atomic_exchange_n(&(lock->flag), 1, __ATOMIC_ACQUIRE)) {
+      /* spin on a shared copy of the line until the lock looks free */
+      waited = true;
+      int backoff = 1;
+      while(__atomic_load_n(&(lock->flag), __ATOMIC_RELAXED)) {
+        for(int i=0; i < backoff; ++i) {
+          mutex_cpu_relax();
+        }
+        if(backoff < SPLATT_SPIN_MAX_BACKOFF) {
+          backoff *= 2;
+        }
+      }
+    }
+    if(pool->track_stats) {
+      ++(lock->acquires);
+      lock->contended += waited;
+    }
+    return;
+  }
+
 #ifdef _OPENMP
   int const lock_id = mutex_translate_id(id, pool->num_locks, pool->pad_size);
   omp_set_lock(pool->locks + lock_id);
@@ -134,6 +297,12 @@ static inline void mutex_unset_lock(
     mutex_pool * const pool,
     int const id)
 {
+  if(pool->type == MUTEX_POOL_SPIN) {
+    spin_lock_t * const lock = pool->spins + mutex_spin_id(pool, id);
+    __atomic_store_n(&(lock->flag), 0, __ATOMIC_RELEASE);
+    return;
+  }
+
 #ifdef _OPENMP
   int const lock_id = mutex_translate_id(id, pool->num_locks, pool->pad_size);
   omp_unset_lock(pool->locks + lock_id);
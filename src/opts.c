@@ -24,6 +24,20 @@ double * splatt_default_opts(void)
   opts[SPLATT_OPTION_TILE]      = SPLATT_NOTILE;
 
   opts[SPLATT_OPTION_PRIVTHRESH] = 0.02;
+  /* sparse privatization still keeps a full buffer per thread, so it is
+   * opt-in (e.g., 0.5) */
+  opts[SPLATT_OPTION_SPARSE_PRIVTHRESH] = 0.;
+  opts[SPLATT_OPTION_SIMD]       = SPLATT_SIMD_AUTO;
+  opts[SPLATT_OPTION_SYNC]       = SPLATT_SYNC_LOCK;
+  opts[SPLATT_OPTION_MEMOIZE]    = 0;
+  opts[SPLATT_OPTION_PRECISION]  = SPLATT_PREC_FULL;
+  opts[SPLATT_OPTION_COLBLOCK]   = 0;
+  opts[SPLATT_OPTION_NUMA]       = 0;
+  opts[SPLATT_OPTION_LEARNRATE]  = 0.001;
+  opts[SPLATT_OPTION_LINESEARCH] = 0;
+  opts[SPLATT_OPTION_SKETCH]     = 0;
+  opts[SPLATT_OPTION_SAMPLING]   = SPLATT_SAMPLE_LEVERAGE;
+  opts[SPLATT_OPTION_LOSS]       = SPLATT_LOSS_LS;
 
   /* Tile one level by default. */
   opts[SPLATT_OPTION_TILELEVEL] = 1;
@@ -0,0 +1,85 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "precision.h"
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+size_t precision_size(
+    splatt_precision_type const prec)
+{
+  switch(prec) {
+  case SPLATT_PREC_FULL:
+    return sizeof(val_t);
+  case SPLATT_PREC_FP32:
+    return sizeof(float);
+  case SPLATT_PREC_BF16:
+  case SPLATT_PREC_FP16:
+    return sizeof(uint16_t);
+  }
+  return sizeof(val_t);
+}
+
+
+char const * precision_name(
+    splatt_precision_type const prec)
+{
+  switch(prec) {
+  case SPLATT_PREC_FULL:
+    return "full";
+  case SPLATT_PREC_FP32:
+    return "fp32";
+  case SPLATT_PREC_BF16:
+    return "bf16";
+  case SPLATT_PREC_FP16:
+    return "fp16";
+  }
+  return "unknown";
+}
+
+
+void precision_pack(
+    void * const dst,
+    val_t const * const src,
+    idx_t const n,
+    splatt_precision_type const prec)
+{
+  switch(prec) {
+  case SPLATT_PREC_FULL:
+    memcpy(dst, src, n * sizeof(*src));
+    break;
+
+  case SPLATT_PREC_FP32: {
+    float * const restrict out = dst;
+    #pragma omp parallel for schedule(static)
+    for(idx_t i=0; i < n; ++i) {
+      out[i] = (float) src[i];
+    }
+    break;
+  }
+
+  case SPLATT_PREC_BF16: {
+    uint16_t * const restrict out = dst;
+    #pragma omp parallel for schedule(static)
+    for(idx_t i=0; i < n; ++i) {
+      out[i] = precision_float_to_bf16((float) src[i]);
+    }
+    break;
+  }
+
+  case SPLATT_PREC_FP16: {
+    uint16_t * const restrict out = dst;
+    #pragma omp parallel for schedule(static)
+    for(idx_t i=0; i < n; ++i) {
+      out[i] = precision_float_to_fp16((float) src[i]);
+    }
+    break;
+  }
+  }
+}
@@ -0,0 +1,173 @@
+#ifndef SPLATT_PRECISION_H
+#define SPLATT_PRECISION_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+
+#include <stdint.h>
+#include <string.h>
+
+
+
+/******************************************************************************
+ * CONVERSIONS
+ *****************************************************************************/
+
+/*
+ * Software conversions between float and the 16-bit formats. Both round to
+ * nearest-even and preserve infinities and NaNs.
+ */
+
+
+/**
+* @brief Convert a float to bfloat16 (the upper half of an IEEE float).
+*/
+static inline uint16_t precision_float_to_bf16(
+    float const x)
+{
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  if((bits & 0x7fffffffu) > 0x7f800000u) {
+    /* keep NaNs quiet instead of rounding them to infinity */
+    return (uint16_t) ((bits >> 16) | 0x40);
+  }
+  bits += 0x7fffu + ((bits >> 16) & 1u);
+  return (uint16_t) (bits >> 16);
+}
+
+
+/**
+* @brief Convert a bfloat16 to float. This is exact.
+*/
+static inline float precision_bf16_to_float(
+    uint16_t const h)
+{
+  uint32_t const bits = ((uint32_t) h) << 16;
+  float x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+
+/**
+* @brief Convert a float to IEEE half precision.
+*/
+static inline uint16_t precision_float_to_fp16(
+    float const x)
+{
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  uint16_t const sign = (uint16_t) ((bits >> 16) & 0x8000u);
+  uint32_t const absx = bits & 0x7fffffffu;
+
+  /* inf/NaN */
+  if(absx >= 0x7f800000u) {
+    return sign | 0x7c00u | ((absx > 0x7f800000u) ? 0x200u : 0u);
+  }
+  /* rounds to infinity (>= 65520) */
+  if(absx >= 0x477ff000u) {
+    return sign | 0x7c00u;
+  }
+
+  /* subnormal or zero in half precision (< 2^-14) */
+  if(absx < 0x38800000u) {
+    /* below half of the smallest subnormal */
+    if(absx <= 0x33000000u) {
+      return sign;
+    }
+    uint32_t const shift = 126u - (absx >> 23);
+    uint32_t const mant = (absx & 0x7fffffu) | 0x800000u;
+    uint32_t h = mant >> shift;
+    uint32_t const rem = mant & ((1u << shift) - 1);
+    uint32_t const half = 1u << (shift - 1);
+    if(rem > half || (rem == half && (h & 1u))) {
+      ++h;
+    }
+    return sign | (uint16_t) h;
+  }
+
+  /* normal: rebias the exponent, a carry out of the mantissa is fine */
+  uint32_t h = (absx - 0x38000000u) >> 13;
+  uint32_t const rem = absx & 0x1fffu;
+  if(rem > 0x1000u || (rem == 0x1000u && (h & 1u))) {
+    ++h;
+  }
+  return sign | (uint16_t) h;
+}
+
+
+/**
+* @brief Convert an IEEE half to float. This is exact.
+*/
+static inline float precision_fp16_to_float(
+    uint16_t const h)
+{
+  uint32_t const sign = ((uint32_t) (h & 0x8000u)) << 16;
+  uint32_t const expo = (h >> 10) & 0x1fu;
+  uint32_t const mant = h & 0x3ffu;
+
+  uint32_t bits;
+  if(expo == 0) {
+    /* zero or subnormal: mant * 2^-24 */
+    float const x = (float) mant * 5.9604644775390625e-8f;
+    return sign ? -x : x;
+  } else if(expo == 0x1f) {
+    bits = sign | 0x7f800000u | (mant << 13);
+  } else {
+    bits = sign | ((expo + 112u) << 23) | (mant << 13);
+  }
+  float x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define precision_size splatt_precision_size
+/**
+* @brief Return the number of bytes used to store one value.
+*
+* @param prec The storage precision.
+*
+* @return The size of one value, in bytes.
+*/
+size_t precision_size(
+    splatt_precision_type const prec);
+
+
+#define precision_name splatt_precision_name
+/**
+* @brief Return a short human-readable name for a storage precision.
+*
+* @param prec The storage precision.
+*
+* @return A static string (e.g., "bf16").
+*/
+char const * precision_name(
+    splatt_precision_type const prec);
+
+
+#define precision_pack splatt_precision_pack
+/**
+* @brief Convert an array of val_t to a lower storage precision.
+*
+* @param[out] dst The converted values, 'n * precision_size(prec)' bytes.
+* @param src The values to convert.
+* @param n The number of values.
+* @param prec The storage precision of 'dst'.
+*/
+void precision_pack(
+    void * const dst,
+    val_t const * const src,
+    idx_t const n,
+    splatt_precision_type const prec);
+
+
+#endif
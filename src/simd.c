@@ -0,0 +1,195 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "simd.h"
+
+#ifdef SPLATT_SIMD_X86
+#include <immintrin.h>
+#endif
+
+
+
+/******************************************************************************
+ * AVX2 KERNELS
+ *****************************************************************************/
+#ifdef SPLATT_SIMD_X86
+
+#define SIMD_FUNC(name) name##_avx2
+#define SIMD_TARGET __attribute__((target("avx2,fma")))
+
+#if SPLATT_VAL_TYPEWIDTH == 32
+  #define vec_t __m256
+  #define SIMD_WIDTH 8
+  #define SIMD_LOAD(p) _mm256_loadu_ps(p)
+  #define SIMD_STORE(p, v) _mm256_storeu_ps((p), (v))
+  #define SIMD_SET1(x) _mm256_set1_ps(x)
+  #define SIMD_ZERO() _mm256_setzero_ps()
+  #define SIMD_MUL(a, b) _mm256_mul_ps((a), (b))
+  #define SIMD_FMA(a, b, c) _mm256_fmadd_ps((a), (b), (c))
+  #define SIMD_MASK_T __m256i
+  #define SIMD_MASK(n) _mm256_cmpgt_epi32(_mm256_set1_epi32((int) (n)), \
+      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))
+  #define SIMD_MLOAD(p, m) _mm256_maskload_ps((p), (m))
+  #define SIMD_MSTORE(p, m, v) _mm256_maskstore_ps((p), (m), (v))
+#else
+  #define vec_t __m256d
+  #define SIMD_WIDTH 4
+  #define SIMD_LOAD(p) _mm256_loadu_pd(p)
+  #define SIMD_STORE(p, v) _mm256_storeu_pd((p), (v))
+  #define SIMD_SET1(x) _mm256_set1_pd(x)
+  #define SIMD_ZERO() _mm256_setzero_pd()
+  #define SIMD_MUL(a, b) _mm256_mul_pd((a), (b))
+  #define SIMD_FMA(a, b, c) _mm256_fmadd_pd((a), (b), (c))
+  #define SIMD_MASK_T __m256i
+  #define SIMD_MASK(n) _mm256_cmpgt_epi64(_mm256_set1_epi64x(n), \
+      _mm256_setr_epi64x(0, 1, 2, 3))
+  #define SIMD_MLOAD(p, m) _mm256_maskload_pd((p), (m))
+  #define SIMD_MSTORE(p, m, v) _mm256_maskstore_pd((p), (m), (v))
+#endif
+
+#include "simd_template.h"
+
+#undef SIMD_FUNC
+#undef SIMD_TARGET
+#undef vec_t
+#undef SIMD_WIDTH
+#undef SIMD_LOAD
+#undef SIMD_STORE
+#undef SIMD_SET1
+#undef SIMD_ZERO
+#undef SIMD_MUL
+#undef SIMD_FMA
+#undef SIMD_MASK_T
+#undef SIMD_MASK
+#undef SIMD_MLOAD
+#undef SIMD_MSTORE
+
+
+
+/******************************************************************************
+ * AVX-512 KERNELS
+ *****************************************************************************/
+
+#define SIMD_FUNC(name) name##_avx512
+#define SIMD_TARGET __attribute__((target("avx512f")))
+
+#if SPLATT_VAL_TYPEWIDTH == 32
+  #define vec_t __m512
+  #define SIMD_WIDTH 16
+  #define SIMD_LOAD(p) _mm512_loadu_ps(p)
+  #define SIMD_STORE(p, v) _mm512_storeu_ps((p), (v))
+  #define SIMD_SET1(x) _mm512_set1_ps(x)
+  #define SIMD_ZERO() _mm512_setzero_ps()
+  #define SIMD_MUL(a, b) _mm512_mul_ps((a), (b))
+  #define SIMD_FMA(a, b, c) _mm512_fmadd_ps((a), (b), (c))
+  #define SIMD_MASK_T __mmask16
+  #define SIMD_MLOAD(p, m) _mm512_maskz_loadu_ps((m), (p))
+  #define SIMD_MSTORE(p, m, v) _mm512_mask_storeu_ps((p), (m), (v))
+#else
+  #define vec_t __m512d
+  #define SIMD_WIDTH 8
+  #define SIMD_LOAD(p) _mm512_loadu_pd(p)
+  #define SIMD_STORE(p, v) _mm512_storeu_pd((p), (v))
+  #define SIMD_SET1(x) _mm512_set1_pd(x)
+  #define SIMD_ZERO() _mm512_setzero_pd()
+  #define SIMD_MUL(a, b) _mm512_mul_pd((a), (b))
+  #define SIMD_FMA(a, b, c) _mm512_fmadd_pd((a), (b), (c))
+  #define SIMD_MASK_T __mmask8
+  #define SIMD_MLOAD(p, m) _mm512_maskz_loadu_pd((m), (p))
+  #define SIMD_MSTORE(p, m, v) _mm512_mask_storeu_pd((p), (m), (v))
+#endif
+/* first 'n' bits set, clamped to [0, SIMD_WIDTH] */
+#define SIMD_MASK(n) ((SIMD_MASK_T) ((n) <= 0 ? 0 : \
+    ((n) >= SIMD_WIDTH ? ~0u : ((1u << (n)) - 1))))
+
+#include "simd_template.h"
+
+#undef SIMD_FUNC
+#undef SIMD_TARGET
+#undef vec_t
+#undef SIMD_WIDTH
+#undef SIMD_LOAD
+#undef SIMD_STORE
+#undef SIMD_SET1
+#undef SIMD_ZERO
+#undef SIMD_MUL
+#undef SIMD_FMA
+#undef SIMD_MASK_T
+#undef SIMD_MASK
+#undef SIMD_MLOAD
+#undef SIMD_MSTORE
+
+#endif /* SPLATT_SIMD_X86 */
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+splatt_simd_type simd_detect(void)
+{
+#ifdef SPLATT_SIMD_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f")) {
+    return SPLATT_SIMD_AVX512;
+  }
+  if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return SPLATT_SIMD_AVX2;
+  }
+#endif
+  return SPLATT_SIMD_SCALAR;
+}
+
+
+bool simd_supported(
+    splatt_simd_type const simd)
+{
+  switch(simd) {
+  case SPLATT_SIMD_AUTO:
+  case SPLATT_SIMD_SCALAR:
+    return true;
+  case SPLATT_SIMD_AVX2:
+  case SPLATT_SIMD_AVX512:
+    /* AVX-512F machines also have AVX2 + FMA */
+    return simd <= simd_detect();
+  }
+  return false;
+}
+
+
+splatt_simd_type simd_resolve(
+    splatt_simd_type const requested)
+{
+  splatt_simd_type const detected = simd_detect();
+  if(requested == SPLATT_SIMD_AUTO) {
+    return detected;
+  }
+
+  if(!simd_supported(requested)) {
+    fprintf(stderr, "SPLATT: %s kernels are not supported by this CPU. "
+                    "Using %s.\n", simd_name(requested), simd_name(detected));
+    return detected;
+  }
+
+  return requested;
+}
+
+
+char const * simd_name(
+    splatt_simd_type const simd)
+{
+  switch(simd) {
+  case SPLATT_SIMD_AUTO:
+    return "auto";
+  case SPLATT_SIMD_SCALAR:
+    return "scalar";
+  case SPLATT_SIMD_AVX2:
+    return "avx2";
+  case SPLATT_SIMD_AVX512:
+    return "avx512";
+  }
+  return "unknown";
+}
@@ -0,0 +1,150 @@
+#ifndef SPLATT_SIMD_H
+#define SPLATT_SIMD_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+
+
+/******************************************************************************
+ * DEFINES
+ *****************************************************************************/
+
+/* x86 kernels need GCC-style target attributes and CPUID builtins. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SPLATT_SIMD_X86 1
+#endif
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define simd_detect splatt_simd_detect
+/**
+* @brief Query the CPU for the widest instruction set we have kernels for.
+*
+* @return SPLATT_SIMD_AVX512, SPLATT_SIMD_AVX2, or SPLATT_SIMD_SCALAR.
+*/
+splatt_simd_type simd_detect(void);
+
+
+#define simd_supported splatt_simd_supported
+/**
+* @brief Can kernels for instruction set 'simd' be run on this CPU?
+*
+* @param simd The instruction set to check.
+*
+* @return true if supported. SCALAR and AUTO are always supported.
+*/
+bool simd_supported(
+    splatt_simd_type const simd);
+
+
+#define simd_resolve splatt_simd_resolve
+/**
+* @brief Turn a requested instruction set (e.g., SPLATT_OPTION_SIMD) into one
+*        that can run on this CPU. AUTO maps to the detected instruction set.
+*        Unsupported requests fall back to the detected set with a warning.
+*
+* @param requested The requested instruction set.
+*
+* @return An instruction set that is not SPLATT_SIMD_AUTO.
+*/
+splatt_simd_type simd_resolve(
+    splatt_simd_type const requested);
+
+
+#define simd_name splatt_simd_name
+/**
+* @brief Return a short human-readable name for an instruction set.
+*
+* @param simd The instruction set.
+*
+* @return A static string (e.g., "avx2").
+*/
+char const * simd_name(
+    splatt_simd_type const simd);
+
+
+
+/*
+ * Hand-vectorized primitives used by the CSF MTTKRP kernels. Each is provided
+ * for every x86 instruction set, e.g., simd_fiber_accum_avx2(). The plain C
+ * versions live alongside the kernels in mttkrp.c. Rows are length 'nfactors'
+ * and need not be aligned.
+ */
+
+#ifdef SPLATT_SIMD_X86
+
+#define SPLATT_SIMD_DECLARE(suffix) \
+void splatt_simd_fiber_accum_##suffix( \
+    val_t * const restrict accum, \
+    idx_t const nfactors, \
+    val_t const * const restrict mat, \
+    idx_t const start, \
+    idx_t const end, \
+    idx_t const * const restrict inds, \
+    val_t const * const restrict vals); \
+void splatt_simd_fiber_scatter_##suffix( \
+    val_t * const restrict mat, \
+    val_t const * const restrict accum, \
+    idx_t const nfactors, \
+    idx_t const start, \
+    idx_t const end, \
+    idx_t const * const restrict inds, \
+    val_t const * const restrict vals); \
+void splatt_simd_axpy_##suffix( \
+    val_t * const restrict y, \
+    val_t const a, \
+    val_t const * const restrict x, \
+    idx_t const nfactors); \
+void splatt_simd_hada_accum_##suffix( \
+    val_t * const restrict out, \
+    val_t const * const restrict a, \
+    val_t const * const restrict b, \
+    idx_t const nfactors); \
+void splatt_simd_hada_accum_clear_##suffix( \
+    val_t * const restrict out, \
+    val_t * const restrict a, \
+    val_t const * const restrict b, \
+    idx_t const nfactors); \
+void splatt_simd_hada_assign_##suffix( \
+    val_t * const restrict out, \
+    val_t const * const restrict a, \
+    val_t const * const restrict b, \
+    idx_t const nfactors);
+
+/*
+ * fiber_accum:       accum += sum_{j in [start,end)} vals[j] * mat(inds[j],:)
+ * fiber_scatter:     mat(inds[j],:) += vals[j] * accum, for j in [start,end)
+ * axpy:              y += a * x
+ * hada_accum:        out += a .* b
+ * hada_accum_clear:  out += a .* b; a = 0
+ * hada_assign:       out = a .* b
+ */
+SPLATT_SIMD_DECLARE(avx2)
+SPLATT_SIMD_DECLARE(avx512)
+
+#undef SPLATT_SIMD_DECLARE
+
+#define simd_fiber_accum_avx2 splatt_simd_fiber_accum_avx2
+#define simd_fiber_scatter_avx2 splatt_simd_fiber_scatter_avx2
+#define simd_axpy_avx2 splatt_simd_axpy_avx2
+#define simd_hada_accum_avx2 splatt_simd_hada_accum_avx2
+#define simd_hada_accum_clear_avx2 splatt_simd_hada_accum_clear_avx2
+#define simd_hada_assign_avx2 splatt_simd_hada_assign_avx2
+
+#define simd_fiber_accum_avx512 splatt_simd_fiber_accum_avx512
+#define simd_fiber_scatter_avx512 splatt_simd_fiber_scatter_avx512
+#define simd_axpy_avx512 splatt_simd_axpy_avx512
+#define simd_hada_accum_avx512 splatt_simd_hada_accum_avx512
+#define simd_hada_accum_clear_avx512 splatt_simd_hada_accum_clear_avx512
+#define simd_hada_assign_avx512 splatt_simd_hada_assign_avx512
+
+#endif /* SPLATT_SIMD_X86 */
+
+#endif
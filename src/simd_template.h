@@ -0,0 +1,218 @@
+/*
+ * Template for the hand-vectorized MTTKRP primitives. This file is included
+ * once per instruction set by simd.c, which first defines:
+ *
+ *   SIMD_FUNC(name)   -- appends the ISA suffix to a function name
+ *   SIMD_TARGET       -- the function attribute enabling the ISA
+ *   vec_t, SIMD_WIDTH -- the vector type and number of val_t per vector
+ *   SIMD_LOAD(p), SIMD_STORE(p, v), SIMD_SET1(x), SIMD_ZERO()
+ *   SIMD_MUL(a, b), SIMD_FMA(a, b, c)  (a*b + c)
+ *   SIMD_MASK_T, SIMD_MASK(n)  -- a mask enabling the first 'n' lanes (n may
+ *                                 be <= 0 or >= SIMD_WIDTH)
+ *   SIMD_MLOAD(p, m), SIMD_MSTORE(p, m, v) -- masked loads/stores, which do
+ *                                             not touch disabled lanes
+ *
+ * There is intentionally no include guard.
+ */
+
+/* We keep up to this many vectors of an accumulator in registers. */
+#define SIMD_BLOCK (4 * SIMD_WIDTH)
+
+
+SIMD_TARGET
+void SIMD_FUNC(splatt_simd_fiber_accum)(
+    val_t * const restrict accum,
+    idx_t const nfactors,
+    val_t const * const restrict mat,
+    idx_t const start,
+    idx_t const end,
+    idx_t const * const restrict inds,
+    val_t const * const restrict vals)
+{
+  idx_t f = 0;
+
+  /* stream the whole fiber through each block of registers */
+  for(; f + SIMD_BLOCK <= nfactors; f += SIMD_BLOCK) {
+    vec_t a0 = SIMD_LOAD(accum + f);
+    vec_t a1 = SIMD_LOAD(accum + f + SIMD_WIDTH);
+    vec_t a2 = SIMD_LOAD(accum + f + (2 * SIMD_WIDTH));
+    vec_t a3 = SIMD_LOAD(accum + f + (3 * SIMD_WIDTH));
+    for(idx_t j=start; j < end; ++j) {
+      vec_t const v = SIMD_SET1(vals[j]);
+      val_t const * const restrict row = mat + (inds[j] * nfactors) + f;
+      a0 = SIMD_FMA(v, SIMD_LOAD(row), a0);
+      a1 = SIMD_FMA(v, SIMD_LOAD(row + SIMD_WIDTH), a1);
+      a2 = SIMD_FMA(v, SIMD_LOAD(row + (2 * SIMD_WIDTH)), a2);
+      a3 = SIMD_FMA(v, SIMD_LOAD(row + (3 * SIMD_WIDTH)), a3);
+    }
+    SIMD_STORE(accum + f, a0);
+    SIMD_STORE(accum + f + SIMD_WIDTH, a1);
+    SIMD_STORE(accum + f + (2 * SIMD_WIDTH), a2);
+    SIMD_STORE(accum + f + (3 * SIMD_WIDTH), a3);
+  }
+
+  /* leftover columns: up to four masked vectors in a single pass */
+  if(f < nfactors) {
+    long long const left = (long long) (nfactors - f);
+    SIMD_MASK_T const m0 = SIMD_MASK(left);
+    SIMD_MASK_T const m1 = SIMD_MASK(left - SIMD_WIDTH);
+    SIMD_MASK_T const m2 = SIMD_MASK(left - (2 * SIMD_WIDTH));
+    SIMD_MASK_T const m3 = SIMD_MASK(left - (3 * SIMD_WIDTH));
+    vec_t a0 = SIMD_MLOAD(accum + f, m0);
+    vec_t a1 = SIMD_MLOAD(accum + f + SIMD_WIDTH, m1);
+    vec_t a2 = SIMD_MLOAD(accum + f + (2 * SIMD_WIDTH), m2);
+    vec_t a3 = SIMD_MLOAD(accum + f + (3 * SIMD_WIDTH), m3);
+    for(idx_t j=start; j < end; ++j) {
+      vec_t const v = SIMD_SET1(vals[j]);
+      val_t const * const restrict row = mat + (inds[j] * nfactors) + f;
+      a0 = SIMD_FMA(v, SIMD_MLOAD(row, m0), a0);
+      a1 = SIMD_FMA(v, SIMD_MLOAD(row + SIMD_WIDTH, m1), a1);
+      a2 = SIMD_FMA(v, SIMD_MLOAD(row + (2 * SIMD_WIDTH), m2), a2);
+      a3 = SIMD_FMA(v, SIMD_MLOAD(row + (3 * SIMD_WIDTH), m3), a3);
+    }
+    SIMD_MSTORE(accum + f, m0, a0);
+    SIMD_MSTORE(accum + f + SIMD_WIDTH, m1, a1);
+    SIMD_MSTORE(accum + f + (2 * SIMD_WIDTH), m2, a2);
+    SIMD_MSTORE(accum + f + (3 * SIMD_WIDTH), m3, a3);
+  }
+}
+
+
+SIMD_TARGET
+void SIMD_FUNC(splatt_simd_fiber_scatter)(
+    val_t * const restrict mat,
+    val_t const * const restrict accum,
+    idx_t const nfactors,
+    idx_t const start,
+    idx_t const end,
+    idx_t const * const restrict inds,
+    val_t const * const restrict vals)
+{
+  idx_t f = 0;
+
+  /* keep a block of 'accum' in registers and scatter it to each row */
+  for(; f + SIMD_BLOCK <= nfactors; f += SIMD_BLOCK) {
+    vec_t const a0 = SIMD_LOAD(accum + f);
+    vec_t const a1 = SIMD_LOAD(accum + f + SIMD_WIDTH);
+    vec_t const a2 = SIMD_LOAD(accum + f + (2 * SIMD_WIDTH));
+    vec_t const a3 = SIMD_LOAD(accum + f + (3 * SIMD_WIDTH));
+    for(idx_t j=start; j < end; ++j) {
+      vec_t const v = SIMD_SET1(vals[j]);
+      val_t * const restrict row = mat + (inds[j] * nfactors) + f;
+      SIMD_STORE(row, SIMD_FMA(v, a0, SIMD_LOAD(row)));
+      SIMD_STORE(row + SIMD_WIDTH, SIMD_FMA(v, a1, SIMD_LOAD(row + SIMD_WIDTH)));
+      SIMD_STORE(row + (2 * SIMD_WIDTH),
+          SIMD_FMA(v, a2, SIMD_LOAD(row + (2 * SIMD_WIDTH))));
+      SIMD_STORE(row + (3 * SIMD_WIDTH),
+          SIMD_FMA(v, a3, SIMD_LOAD(row + (3 * SIMD_WIDTH))));
+    }
+  }
+
+  if(f < nfactors) {
+    long long const left = (long long) (nfactors - f);
+    SIMD_MASK_T const m0 = SIMD_MASK(left);
+    SIMD_MASK_T const m1 = SIMD_MASK(left - SIMD_WIDTH);
+    SIMD_MASK_T const m2 = SIMD_MASK(left - (2 * SIMD_WIDTH));
+    SIMD_MASK_T const m3 = SIMD_MASK(left - (3 * SIMD_WIDTH));
+    vec_t const a0 = SIMD_MLOAD(accum + f, m0);
+    vec_t const a1 = SIMD_MLOAD(accum + f + SIMD_WIDTH, m1);
+    vec_t const a2 = SIMD_MLOAD(accum + f + (2 * SIMD_WIDTH), m2);
+    vec_t const a3 = SIMD_MLOAD(accum + f + (3 * SIMD_WIDTH), m3);
+    for(idx_t j=start; j < end; ++j) {
+      vec_t const v = SIMD_SET1(vals[j]);
+      val_t * const restrict row = mat + (inds[j] * nfactors) + f;
+      SIMD_MSTORE(row, m0, SIMD_FMA(v, a0, SIMD_MLOAD(row, m0)));
+      SIMD_MSTORE(row + SIMD_WIDTH, m1,
+          SIMD_FMA(v, a1, SIMD_MLOAD(row + SIMD_WIDTH, m1)));
+      SIMD_MSTORE(row + (2 * SIMD_WIDTH), m2,
+          SIMD_FMA(v, a2, SIMD_MLOAD(row + (2 * SIMD_WIDTH), m2)));
+      SIMD_MSTORE(row + (3 * SIMD_WIDTH), m3,
+          SIMD_FMA(v, a3, SIMD_MLOAD(row + (3 * SIMD_WIDTH), m3)));
+    }
+  }
+}
+
+
+SIMD_TARGET
+void SIMD_FUNC(splatt_simd_axpy)(
+    val_t * const restrict y,
+    val_t const a,
+    val_t const * const restrict x,
+    idx_t const nfactors)
+{
+  vec_t const va = SIMD_SET1(a);
+  idx_t f = 0;
+  for(; f + SIMD_WIDTH <= nfactors; f += SIMD_WIDTH) {
+    SIMD_STORE(y + f, SIMD_FMA(va, SIMD_LOAD(x + f), SIMD_LOAD(y + f)));
+  }
+  if(f < nfactors) {
+    SIMD_MASK_T const m = SIMD_MASK((long long) (nfactors - f));
+    SIMD_MSTORE(y + f, m,
+        SIMD_FMA(va, SIMD_MLOAD(x + f, m), SIMD_MLOAD(y + f, m)));
+  }
+}
+
+
+SIMD_TARGET
+void SIMD_FUNC(splatt_simd_hada_accum)(
+    val_t * const restrict out,
+    val_t const * const restrict a,
+    val_t const * const restrict b,
+    idx_t const nfactors)
+{
+  idx_t f = 0;
+  for(; f + SIMD_WIDTH <= nfactors; f += SIMD_WIDTH) {
+    SIMD_STORE(out + f,
+        SIMD_FMA(SIMD_LOAD(a + f), SIMD_LOAD(b + f), SIMD_LOAD(out + f)));
+  }
+  if(f < nfactors) {
+    SIMD_MASK_T const m = SIMD_MASK((long long) (nfactors - f));
+    SIMD_MSTORE(out + f, m, SIMD_FMA(SIMD_MLOAD(a + f, m),
+        SIMD_MLOAD(b + f, m), SIMD_MLOAD(out + f, m)));
+  }
+}
+
+
+SIMD_TARGET
+void SIMD_FUNC(splatt_simd_hada_accum_clear)(
+    val_t * const restrict out,
+    val_t * const restrict a,
+    val_t const * const restrict b,
+    idx_t const nfactors)
+{
+  vec_t const zero = SIMD_ZERO();
+  idx_t f = 0;
+  for(; f + SIMD_WIDTH <= nfactors; f += SIMD_WIDTH) {
+    SIMD_STORE(out + f,
+        SIMD_FMA(SIMD_LOAD(a + f), SIMD_LOAD(b + f), SIMD_LOAD(out + f)));
+    SIMD_STORE(a + f, zero);
+  }
+  if(f < nfactors) {
+    SIMD_MASK_T const m = SIMD_MASK((long long) (nfactors - f));
+    SIMD_MSTORE(out + f, m, SIMD_FMA(SIMD_MLOAD(a + f, m),
+        SIMD_MLOAD(b + f, m), SIMD_MLOAD(out + f, m)));
+    SIMD_MSTORE(a + f, m, zero);
+  }
+}
+
+
+SIMD_TARGET
+void SIMD_FUNC(splatt_simd_hada_assign)(
+    val_t * const restrict out,
+    val_t const * const restrict a,
+    val_t const * const restrict b,
+    idx_t const nfactors)
+{
+  idx_t f = 0;
+  for(; f + SIMD_WIDTH <= nfactors; f += SIMD_WIDTH) {
+    SIMD_STORE(out + f, SIMD_MUL(SIMD_LOAD(a + f), SIMD_LOAD(b + f)));
+  }
+  if(f < nfactors) {
+    SIMD_MASK_T const m = SIMD_MASK((long long) (nfactors - f));
+    SIMD_MSTORE(out + f, m, SIMD_MUL(SIMD_MLOAD(a + f, m),
+        SIMD_MLOAD(b + f, m)));
+  }
+}
+
+
+#undef SIMD_BLOCK
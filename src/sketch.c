@@ -0,0 +1,655 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "sketch.h"
+#include "cpd.h"
+#include "kruskal.h"
+#include "sptensor.h"
+#include "splatt_lapack.h"
+#include "timer.h"
+#include "util.h"
+
+#include <math.h>
+
+
+
+/******************************************************************************
+ * API FUNCTIONS
+ *****************************************************************************/
+
+int splatt_cpd_sketched(
+    splatt_csf const * const tensors,
+    splatt_idx_t const nfactors,
+    double const * const options,
+    splatt_kruskal * factored)
+{
+  idx_t const nmodes = tensors->nmodes;
+  if(nmodes < 2 || nfactors == 0) {
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  idx_t nsamples = (idx_t) options[SPLATT_OPTION_SKETCH];
+  if(options[SPLATT_OPTION_SKETCH] < 1.) {
+    nsamples = SKETCH_SAMPLES_PER_RANK * nfactors;
+  }
+
+  /* allocate factor matrices. The seed is private to this call. */
+  unsigned int seed = (unsigned int) options[SPLATT_OPTION_RANDSEED];
+  matrix_t * mats[MAX_NMODES+1];
+  idx_t maxdim = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    mats[m] = mat_alloc(tensors->dims[m], nfactors);
+    fill_rand_r(mats[m]->vals, tensors->dims[m] * nfactors, &seed);
+    maxdim = SS_MAX(maxdim, tensors->dims[m]);
+  }
+  mats[MAX_NMODES] = mat_alloc(maxdim, nfactors);
+
+  val_t * lambda = splatt_malloc(nfactors * sizeof(*lambda));
+
+  sketch_ws * ws = sketch_alloc(tensors, nsamples, options);
+  factored->fit = sketch_als_iterate(tensors, ws, mats, lambda, nfactors,
+      options);
+  sketch_free(ws);
+
+  /* store output */
+  factored->rank = nfactors;
+  factored->nmodes = nmodes;
+  factored->lambda = lambda;
+  for(idx_t m=0; m < nmodes; ++m) {
+    factored->dims[m] = tensors->dims[m];
+    factored->factors[m] = mats[m]->vals;
+  }
+
+  /* clean up */
+  mat_free(mats[MAX_NMODES]);
+  for(idx_t m=0; m < nmodes; ++m) {
+    free(mats[m]); /* just the matrix_t ptr, data is safely in factored */
+  }
+  return SPLATT_SUCCESS;
+}
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Binary search for 'key' in the sorted ids[start, end).
+*
+* @return The position of 'key', or SPLATT_IDX_MAX if it is absent.
+*/
+static idx_t p_search(
+    idx_t const * const restrict ids,
+    idx_t start,
+    idx_t end,
+    idx_t const key)
+{
+  while(start < end) {
+    idx_t const mid = start + ((end - start) / 2);
+    if(ids[mid] == key) {
+      return mid;
+    } else if(ids[mid] < key) {
+      start = mid + 1;
+    } else {
+      end = mid;
+    }
+  }
+  return SPLATT_IDX_MAX;
+}
+
+
+/**
+* @brief Mirror the upper triangle of an aTa matrix into a full symmetric one.
+*/
+static void p_full_gram(
+    matrix_t const * const aTa,
+    val_t * const restrict gram)
+{
+  idx_t const N = aTa->J;
+  for(idx_t i=0; i < N; ++i) {
+    for(idx_t j=i; j < N; ++j) {
+      gram[j + (i*N)] = aTa->vals[j + (i*N)];
+      gram[i + (j*N)] = aTa->vals[j + (i*N)];
+    }
+  }
+}
+
+
+/**
+* @brief Compute the cumulative leverage scores of the rows of a factor,
+*        l_i = a_i^T (A^T A)^-1 a_i, via the Cholesky factor of A^T A.
+*
+* @param A The factor.
+* @param aTa The Gram matrix of A (upper triangle).
+* @param[out] cdf The running sum of the leverage scores, of length A->I.
+* @param thds Thread structures, with scratch[0] of at least A->J values.
+* @param nthreads The number of threads to use.
+*/
+static void p_leverage_cdf(
+    matrix_t const * const A,
+    matrix_t const * const aTa,
+    val_t * const restrict cdf,
+    thd_info * const thds,
+    idx_t const nthreads)
+{
+  idx_t const I = A->I;
+  idx_t const R = A->J;
+
+  matrix_t * gram = mat_alloc(R, R);
+  matrix_t * chol = mat_alloc(R, R);
+  p_full_gram(aTa, gram->vals);
+
+  /* a little damping keeps rank-deficient factors factorizable */
+  val_t trace = 0.;
+  for(idx_t r=0; r < R; ++r) {
+    trace += gram->vals[r + (r*R)];
+  }
+  for(idx_t r=0; r < R; ++r) {
+    gram->vals[r + (r*R)] += 1e-10 * (trace + 1.);
+  }
+  mat_cholesky(gram, chol);
+  val_t const * const restrict L = chol->vals;
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    val_t * const restrict y = thds[tid].scratch[0];
+
+    #pragma omp for schedule(static)
+    for(idx_t i=0; i < I; ++i) {
+      val_t const * const restrict arow = A->vals + (i * R);
+      val_t score = 0.;
+      for(idx_t r=0; r < R; ++r) {
+        val_t v = arow[r];
+        for(idx_t k=0; k < r; ++k) {
+          v -= L[k + (r*R)] * y[k];
+        }
+        y[r] = v / L[r + (r*R)];
+        score += y[r] * y[r];
+      }
+      cdf[i] = score;
+    }
+  }
+
+  for(idx_t i=1; i < I; ++i) {
+    cdf[i] += cdf[i-1];
+  }
+
+  mat_free(gram);
+  mat_free(chol);
+}
+
+
+/**
+* @brief Draw a row of a factor.
+*
+* @param ws The sketching workspace.
+* @param mode The mode of the factor.
+* @param dim The number of rows in the factor.
+* @param seed The calling thread's random seed.
+* @param[out] prob The probability of the row that was drawn.
+*
+* @return The row.
+*/
+static idx_t p_draw(
+    sketch_ws const * const ws,
+    idx_t const mode,
+    idx_t const dim,
+    unsigned int * const seed,
+    double * const prob)
+{
+  double const u = (double) rand_r(seed) / ((double) RAND_MAX + 1.);
+
+  /* a factor of all zeros has no leverage to sample by */
+  if(ws->sampling == SPLATT_SAMPLE_UNIFORM || !(ws->cdfs[mode][dim-1] > 0.)) {
+    *prob = 1. / (double) dim;
+    return SS_MIN((idx_t) (u * dim), dim - 1);
+  }
+
+  /* the first row whose running sum exceeds u * total */
+  val_t const * const restrict cdf = ws->cdfs[mode];
+  double const target = u * cdf[dim-1];
+  idx_t lo = 0;
+  idx_t hi = dim - 1;
+  while(lo < hi) {
+    idx_t const mid = lo + ((hi - lo) / 2);
+    if(cdf[mid] > target) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  double const score = cdf[lo] - ((lo > 0) ? cdf[lo-1] : 0.);
+  *prob = score / cdf[dim-1];
+  return lo;
+}
+
+
+/**
+* @brief The sketched MTTKRP. Sampled Khatri-Rao rows z_s, each weighted by
+*        w_s = 1 / (nsamples * p_s), form the Gram matrix sum_s w_s z_s z_s^T,
+*        and the fiber X(:, s) of each sample is fetched from the CSF and
+*        accumulated into the output: out(i,:) += w_s X(i, s) z_s.
+*
+* @param mode The mode to update.
+* @param mats The factors.
+* @param ws The sketching workspace.
+* @param[out] out The sketched MTTKRP, with dims[mode] rows.
+* @param[out] gram The sketched Gram matrix (full).
+* @param seed Seed for this update; each thread derives its own from it.
+* @param thds Thread structures, with scratch[0] of R values and scratch[1]
+*             of R*R values.
+* @param nthreads The number of threads to use.
+*/
+static void p_sketch_mttkrp(
+    idx_t const mode,
+    matrix_t ** mats,
+    sketch_ws const * const ws,
+    matrix_t * const out,
+    matrix_t * const gram,
+    unsigned int const seed,
+    thd_info * const thds,
+    idx_t const nthreads)
+{
+  timer_start(&timers[TIMER_SKETCH]);
+
+  splatt_csf const * const csf = ws->leaves + mode;
+  csf_sparsity const * const pt = csf->pt;
+  idx_t const nmodes = csf->nmodes;
+  idx_t const R = out->J;
+  idx_t const nsamples = ws->nsamples;
+
+  idx_t const * const restrict leaf_fptr = (pt->vals == NULL) ?
+      NULL : pt->fptr[nmodes-2];
+  idx_t const * const restrict leaf_fids = pt->fids[nmodes-1];
+  val_t const * const restrict vals = pt->vals;
+  val_t * const restrict ovals = out->vals;
+
+  memset(ovals, 0, csf->dims[mode] * R * sizeof(*ovals));
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    unsigned int myseed = seed + (1009 * (unsigned int) tid);
+    val_t * const restrict zrow = thds[tid].scratch[0];
+    val_t * const restrict mygram = thds[tid].scratch[1];
+    memset(mygram, 0, R * R * sizeof(*mygram));
+
+    idx_t ids[MAX_NMODES];
+
+    #pragma omp for schedule(static)
+    for(idx_t s=0; s < nsamples; ++s) {
+      /* one index in every mode but 'mode', in the order of the tree */
+      double prob = 1.;
+      for(idx_t r=0; r < R; ++r) {
+        zrow[r] = 1.;
+      }
+      for(idx_t d=0; d < nmodes-1; ++d) {
+        idx_t const m = csf_depth_to_mode(csf, d);
+        double p;
+        ids[d] = p_draw(ws, m, csf->dims[m], &myseed, &p);
+        prob *= p;
+
+        val_t const * const restrict arow = mats[m]->vals + (ids[d] * R);
+        for(idx_t r=0; r < R; ++r) {
+          zrow[r] *= arow[r];
+        }
+      }
+      val_t const weight = 1. / ((double) nsamples * prob);
+
+      for(idx_t i=0; i < R; ++i) {
+        val_t const zi = weight * zrow[i];
+        for(idx_t j=0; j < R; ++j) {
+          mygram[j + (i*R)] += zi * zrow[j];
+        }
+      }
+
+      idx_t const fib = sketch_find_fiber(csf, ids);
+      if(fib == SPLATT_IDX_MAX) {
+        continue;
+      }
+      for(idx_t x=leaf_fptr[fib]; x < leaf_fptr[fib+1]; ++x) {
+        idx_t const row = leaf_fids[x];
+        val_t const v = weight * vals[x];
+        val_t * const restrict orow = ovals + (row * R);
+        mutex_set_lock(ws->pool, row);
+        for(idx_t r=0; r < R; ++r) {
+          orow[r] += v * zrow[r];
+        }
+        mutex_unset_lock(ws->pool, row);
+      }
+    }
+
+    thd_reduce(thds, 1, R * R, REDUCE_SUM);
+  } /* end omp parallel */
+
+  memcpy(gram->vals, thds[0].scratch[1], R * R * sizeof(val_t));
+
+  timer_stop(&timers[TIMER_SKETCH]);
+}
+
+
+/**
+* @brief Solve A * gram = rhs for A, overwriting rhs.
+*
+* @param gram The (full, symmetric) Gram matrix. Overwritten.
+* @param rhs The right-hand side, one row per row of A.
+* @param reg Ridge regularization added to the diagonal.
+*/
+static void p_solve(
+    matrix_t * const gram,
+    matrix_t * const rhs,
+    val_t const reg)
+{
+  timer_start(&timers[TIMER_INV]);
+
+  idx_t const R = gram->J;
+  val_t trace = 0.;
+  for(idx_t r=0; r < R; ++r) {
+    trace += gram->vals[r + (r*R)];
+  }
+  /* a sample may miss some directions entirely */
+  for(idx_t r=0; r < R; ++r) {
+    gram->vals[r + (r*R)] += reg + (1e-10 * (trace + 1.));
+  }
+
+  char uplo = 'L';
+  splatt_blas_int N = (splatt_blas_int) R;
+  splatt_blas_int nrhs = (splatt_blas_int) rhs->I;
+  splatt_blas_int info;
+  SPLATT_BLAS(potrf)(&uplo, &N, gram->vals, &N, &info);
+  if(info) {
+    fprintf(stderr, "SPLATT: sketched Gram matrix is not SPD (info=%d).\n",
+        (int) info);
+  } else {
+    SPLATT_BLAS(potrs)(&uplo, &N, &nrhs, gram->vals, &N, rhs->vals, &N,
+        &info);
+  }
+
+  timer_stop(&timers[TIMER_INV]);
+}
+
+
+/**
+* @brief Compute the exact fit of a Kruskal tensor, 1 - ||X - Z|| / ||X||.
+*        <X,Z> comes from the model values at the nonzeros and <Z,Z> from the
+*        Gram matrices.
+*
+* @param tensors The CSF tensor.
+* @param mats The factors.
+* @param lambda The column weights.
+* @param aTa The Gram matrix of each factor (upper triangles).
+* @param ttnormsq The norm of the tensor, squared.
+* @param values Workspace for the model values, of length tensors->nnz.
+* @param nthreads The number of threads to use.
+*
+* @return The fit.
+*/
+static double p_exact_fit(
+    splatt_csf const * const tensors,
+    matrix_t ** mats,
+    val_t const * const lambda,
+    matrix_t ** aTa,
+    val_t const ttnormsq,
+    val_t * const values,
+    idx_t const nthreads)
+{
+  timer_start(&timers[TIMER_FIT]);
+
+  idx_t const nmodes = tensors->nmodes;
+  idx_t const R = mats[0]->J;
+
+  kruskal_csf_values(tensors, mats, lambda, values, nthreads);
+  double inner = 0.;
+  for(idx_t t=0; t < tensors->ntiles; ++t) {
+    val_t const * const restrict vals = tensors->pt[t].vals;
+    if(vals == NULL) {
+      continue;
+    }
+    idx_t const nnz = tensors->pt[t].nfibs[nmodes-1];
+    val_t const * const restrict model = values +
+        kruskal_csf_leaf_offset(tensors, t);
+    #pragma omp parallel for schedule(static) num_threads(nthreads) \
+        reduction(+:inner)
+    for(idx_t x=0; x < nnz; ++x) {
+      inner += vals[x] * model[x];
+    }
+  }
+
+  /* <Z,Z> = lambda^T (AtA * BtB * ...) lambda */
+  matrix_t * hada = mat_alloc(R, R);
+  mat_form_gram(aTa, hada, 0, nmodes);
+  double normsq = 0.;
+  for(idx_t i=0; i < R; ++i) {
+    for(idx_t j=0; j < R; ++j) {
+      idx_t const lo = SS_MIN(i, j);
+      idx_t const hi = SS_MAX(i, j);
+      normsq += hada->vals[j + (i*R)] * aTa[0]->vals[hi + (lo*R)] *
+          lambda[i] * lambda[j];
+    }
+  }
+  mat_free(hada);
+
+  double residual = ttnormsq + normsq - (2 * inner);
+  residual = (residual > 0.) ? sqrt(residual) : 0.;
+
+  timer_stop(&timers[TIMER_FIT]);
+  return 1 - (residual / sqrt(ttnormsq));
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+sketch_ws * sketch_alloc(
+    splatt_csf const * const tensors,
+    idx_t const nsamples,
+    double const * const opts)
+{
+  idx_t const nmodes = tensors->nmodes;
+
+  sketch_ws * ws = splatt_malloc(sizeof(*ws));
+  ws->nmodes = nmodes;
+  ws->nsamples = nsamples;
+  ws->sampling = (splatt_sample_type) opts[SPLATT_OPTION_SAMPLING];
+  ws->pool = mutex_alloc();
+
+  /* the searches need sorted, untiled trees */
+  double * leaf_opts = splatt_default_opts();
+  memcpy(leaf_opts, opts, SPLATT_OPTION_NOPTIONS * sizeof(*opts));
+  leaf_opts[SPLATT_OPTION_TILE] = SPLATT_NOTILE;
+
+  sptensor_t * tt = csf_to_coord(tensors);
+  for(idx_t m=0; m < nmodes; ++m) {
+    /* the other modes in their natural order, then m at the leaves */
+    splatt_csf * const csf = ws->leaves + m;
+    idx_t d = 0;
+    for(idx_t k=0; k < nmodes; ++k) {
+      if(k != m) {
+        csf->dim_perm[d++] = k;
+      }
+    }
+    csf->dim_perm[nmodes-1] = m;
+    csf_alloc_mode(tt, CSF_MODE_CUSTOM, m, csf, leaf_opts);
+
+    ws->cdfs[m] = NULL;
+    if(ws->sampling == SPLATT_SAMPLE_LEVERAGE) {
+      ws->cdfs[m] = splatt_malloc(tensors->dims[m] * sizeof(**ws->cdfs));
+    }
+  }
+  tt_free(tt);
+  splatt_free_opts(leaf_opts);
+
+  return ws;
+}
+
+
+void sketch_free(
+    sketch_ws * ws)
+{
+  for(idx_t m=0; m < ws->nmodes; ++m) {
+    csf_free_mode(ws->leaves + m);
+    if(ws->cdfs[m] != NULL) {
+      splatt_free(ws->cdfs[m]);
+    }
+  }
+  mutex_free(ws->pool);
+  splatt_free(ws);
+}
+
+
+idx_t sketch_find_fiber(
+    splatt_csf const * const csf,
+    idx_t const * const ids)
+{
+  csf_sparsity const * const pt = csf->pt;
+  if(pt->vals == NULL) {
+    return SPLATT_IDX_MAX;
+  }
+
+  idx_t const nmodes = csf->nmodes;
+
+  /* the root level */
+  idx_t node;
+  if(pt->fids[0] == NULL) {
+    node = (ids[0] < pt->nfibs[0]) ? ids[0] : SPLATT_IDX_MAX;
+  } else {
+    node = p_search(pt->fids[0], 0, pt->nfibs[0], ids[0]);
+  }
+
+  for(idx_t d=1; d < nmodes-1 && node != SPLATT_IDX_MAX; ++d) {
+    node = p_search(pt->fids[d], pt->fptr[d-1][node],
+        pt->fptr[d-1][node+1], ids[d]);
+  }
+
+  /* with implicit slice ids, a slice may still be empty */
+  if(node != SPLATT_IDX_MAX && pt->fptr[nmodes-2][node] ==
+      pt->fptr[nmodes-2][node+1]) {
+    return SPLATT_IDX_MAX;
+  }
+  return node;
+}
+
+
+double sketch_als_iterate(
+    splatt_csf const * const tensors,
+    sketch_ws * const ws,
+    matrix_t ** mats,
+    val_t * const lambda,
+    idx_t const nfactors,
+    double const * const opts)
+{
+  idx_t const nmodes = tensors->nmodes;
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+
+  rank_info rinfo;
+  rinfo.rank = 0;
+
+  splatt_omp_set_num_threads(nthreads);
+  thd_info * thds = thd_init(nthreads, 2,
+      (nfactors * sizeof(val_t)) + 64,
+      (nfactors * nfactors * sizeof(val_t)) + 64);
+
+  matrix_t * aTa[MAX_NMODES+1];
+  for(idx_t m=0; m < nmodes; ++m) {
+    aTa[m] = mat_alloc(nfactors, nfactors);
+    memset(aTa[m]->vals, 0, nfactors * nfactors * sizeof(val_t));
+    mat_aTa(mats[m], aTa[m], &rinfo, thds, nthreads);
+    if(ws->sampling == SPLATT_SAMPLE_LEVERAGE) {
+      p_leverage_cdf(mats[m], aTa[m], ws->cdfs[m], thds, nthreads);
+    }
+  }
+  aTa[MAX_NMODES] = mat_alloc(nfactors, nfactors);
+  matrix_t * gram = aTa[MAX_NMODES];
+
+  val_t * values = splatt_malloc(tensors->nnz * sizeof(*values));
+  val_t const ttnormsq = csf_frobsq(tensors);
+
+  unsigned int seed = (unsigned int) opts[SPLATT_OPTION_RANDSEED];
+
+  double oldfit = 0;
+  double fit = 0;
+
+  sp_timer_t itertime;
+  sp_timer_t modetime[MAX_NMODES];
+  timer_start(&timers[TIMER_CPD]);
+
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  idx_t last_eval = 0;
+  for(idx_t it=0; it < niters; ++it) {
+    timer_fstart(&itertime);
+    for(idx_t m=0; m < nmodes; ++m) {
+      timer_fstart(&modetime[m]);
+      matrix_t * const out = mats[MAX_NMODES];
+      out->I = tensors->dims[m];
+
+      /* a fresh sample for every update */
+      seed = (seed * 1103515245u) + 12345u;
+      p_sketch_mttkrp(m, mats, ws, out, gram, seed, thds, nthreads);
+      p_solve(gram, out, opts[SPLATT_OPTION_REGULARIZE]);
+      par_memcpy(mats[m]->vals, out->vals, out->I * nfactors * sizeof(val_t));
+
+      if(it == 0) {
+        mat_normalize(mats[m], lambda, MAT_NORM_2, &rinfo, thds, nthreads);
+      } else {
+        mat_normalize(mats[m], lambda, MAT_NORM_MAX, &rinfo, thds, nthreads);
+      }
+
+      mat_aTa(mats[m], aTa[m], &rinfo, thds, nthreads);
+      if(ws->sampling == SPLATT_SAMPLE_LEVERAGE) {
+        p_leverage_cdf(mats[m], aTa[m], ws->cdfs[m], thds, nthreads);
+      }
+      timer_stop(&modetime[m]);
+    }
+    timer_stop(&itertime);
+
+    /* the exact fit costs about as much as an exact MTTKRP */
+    bool const evaluate = ((it + 1) % SKETCH_FIT_EVERY == 0) ||
+        (it + 1 == niters);
+    if(!evaluate) {
+      if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW) {
+        printf("  its = %3"SPLATT_PF_IDX" (%0.3fs)\n", it+1,
+            itertime.seconds);
+      }
+      continue;
+    }
+
+    fit = p_exact_fit(tensors, mats, lambda, aTa, ttnormsq, values,
+        nthreads);
+    if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      printf("  its = %3"SPLATT_PF_IDX" (%0.3fs)  fit = %0.5f  "
+          "delta = %+0.4e\n", it+1, itertime.seconds, fit, fit - oldfit);
+      if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW) {
+        for(idx_t m=0; m < nmodes; ++m) {
+          printf("     mode = %1"SPLATT_PF_IDX" (%0.3fs)\n", m+1,
+              modetime[m].seconds);
+        }
+      }
+    }
+    if(fit == 1. || (last_eval > 0 &&
+        fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE])) {
+      break;
+    }
+    oldfit = fit;
+    last_eval = it + 1;
+  }
+  timer_stop(&timers[TIMER_CPD]);
+
+  cpd_post_process(nfactors, nmodes, mats, lambda, NULL, thds, nthreads,
+      &rinfo);
+
+  /* CLEAN UP */
+  splatt_free(values);
+  for(idx_t m=0; m < nmodes; ++m) {
+    mat_free(aTa[m]);
+  }
+  mat_free(aTa[MAX_NMODES]);
+  thd_free(thds, nthreads);
+
+  return fit;
+}
@@ -0,0 +1,126 @@
+#ifndef SPLATT_SKETCH_H
+#define SPLATT_SKETCH_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "csf.h"
+#include "matrix.h"
+#include "mutex_pool.h"
+#include "thd_info.h"
+
+
+
+/******************************************************************************
+ * DEFAULTS
+ *****************************************************************************/
+
+/* Khatri-Rao rows sampled per unit of rank if SPLATT_OPTION_SKETCH is 0. */
+static idx_t const SKETCH_SAMPLES_PER_RANK = 100;
+
+/* Evaluate the exact fit once every this many sketched iterations. */
+static idx_t const SKETCH_FIT_EVERY = 5;
+
+
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+* @brief Workspace for sketched CPD-ALS. Each Khatri-Rao row of mode m is a
+*        tuple of indices in the other modes, which selects one mode-m fiber
+*        of the tensor. leaves[m] stores mode m at its leaves, so a fiber is
+*        found by descending the tree.
+*/
+typedef struct
+{
+  /** @brief The number of modes. */
+  idx_t nmodes;
+  /** @brief The number of Khatri-Rao rows sampled per factor update. */
+  idx_t nsamples;
+  /** @brief How rows are sampled. */
+  splatt_sample_type sampling;
+  /** @brief leaves[m] is an untiled CSF with mode m as its last level. */
+  splatt_csf leaves[MAX_NMODES];
+  /** @brief The cumulative leverage scores of each factor's rows. */
+  val_t * cdfs[MAX_NMODES];
+  /** @brief Protects the output rows of the sketched MTTKRP. */
+  mutex_pool * pool;
+} sketch_ws;
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define sketch_alloc splatt_sketch_alloc
+/**
+* @brief Allocate a sketched CPD-ALS workspace, building one CSF per mode
+*        from the nonzeros of 'tensors'.
+*
+* @param tensors The CSF tensor(s) to factor. Only tensors[0] is used.
+* @param nsamples The number of Khatri-Rao rows to sample per factor update.
+* @param opts SPLATT options. SPLATT_OPTION_SAMPLING selects the sampling.
+*
+* @return The workspace. Free with sketch_free().
+*/
+sketch_ws * sketch_alloc(
+    splatt_csf const * const tensors,
+    idx_t const nsamples,
+    double const * const opts);
+
+
+#define sketch_free splatt_sketch_free
+/**
+* @brief Free a sketched CPD-ALS workspace.
+*
+* @param ws The workspace to free.
+*/
+void sketch_free(
+    sketch_ws * ws);
+
+
+#define sketch_find_fiber splatt_sketch_find_fiber
+/**
+* @brief Find a fiber of an untiled CSF tensor by its indices.
+*
+* @param csf The tensor.
+* @param ids The index of each level 0 to nmodes-2 of the tree.
+*
+* @return The fiber's node at depth nmodes-2, or SPLATT_IDX_MAX if the fiber
+*         is empty.
+*/
+idx_t sketch_find_fiber(
+    splatt_csf const * const csf,
+    idx_t const * const ids);
+
+
+#define sketch_als_iterate splatt_sketch_als_iterate
+/**
+* @brief The primary computation in sketched CPD-ALS. Each factor is the
+*        solution of a least squares problem over a random sample of the
+*        Khatri-Rao rows, and the exact fit is computed every
+*        SKETCH_FIT_EVERY iterations and after the last one.
+*
+* @param tensors The CSF tensor(s) to factor. Only tensors[0] is used.
+* @param ws The sketching workspace.
+* @param mats [OUT] The factors, randomly initialized.
+* @param lambda [OUT] The output vector for scaling.
+* @param nfactors The rank of the factorization.
+* @param opts SPLATT options array.
+*
+* @return The final (exact) fitness of the factorization.
+*/
+double sketch_als_iterate(
+    splatt_csf const * const tensors,
+    sketch_ws * const ws,
+    matrix_t ** mats,
+    val_t * const lambda,
+    idx_t const nfactors,
+    double const * const opts);
+
+#endif
@@ -93,4 +93,17 @@ void SPLATT_BLAS(gelss)(
     splatt_blas_int *,
     splatt_blas_int *);
 
+
+/* Symmetric eigenvalue decomposition */
+void SPLATT_BLAS(syev)(
+    char *,
+    char *,
+    splatt_blas_int *,
+    splatt_val_t *,
+    splatt_blas_int *,
+    splatt_val_t *,
+    splatt_val_t *,
+    splatt_blas_int *,
+    splatt_blas_int *);
+
 #endif
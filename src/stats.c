@@ -10,6 +10,8 @@
 #include "io.h"
 #include "reorder.h"
 #include "util.h"
+#include "precision.h"
+#include "ttm.h"
 
 
 /******************************************************************************
@@ -265,6 +267,29 @@ void cpd_stats(
   }
   printf(" ");
 
+  if(opts[SPLATT_OPTION_MEMOIZE] >= 1.) {
+    printf("MEMO-LEVELS=%"SPLATT_PF_IDX" ", (idx_t) opts[SPLATT_OPTION_MEMOIZE]);
+  }
+  if(opts[SPLATT_OPTION_NUMA]) {
+    printf("NUMA ");
+  }
+  if(opts[SPLATT_OPTION_SKETCH] >= 1.) {
+    printf("SKETCH=%"SPLATT_PF_IDX"(%s) ", (idx_t) opts[SPLATT_OPTION_SKETCH],
+        ((splatt_sample_type) opts[SPLATT_OPTION_SAMPLING] ==
+            SPLATT_SAMPLE_UNIFORM) ? "UNIFORM" : "LEVERAGE");
+  }
+  if((splatt_loss_type) opts[SPLATT_OPTION_LOSS] == SPLATT_LOSS_POISSON) {
+    printf("LOSS=POISSON ");
+  }
+  if(opts[SPLATT_OPTION_LINESEARCH] >= 1.) {
+    printf("LINESEARCH=%"SPLATT_PF_IDX" ",
+        (idx_t) opts[SPLATT_OPTION_LINESEARCH]);
+  }
+  if((splatt_precision_type) opts[SPLATT_OPTION_PRECISION] != SPLATT_PREC_FULL) {
+    printf("PREC=%s ", precision_name(
+        (splatt_precision_type) opts[SPLATT_OPTION_PRECISION]));
+  }
+
   /* tiling info */
   printf("TILE=");
   splatt_tile_type which_tile = opts[SPLATT_OPTION_TILE];
@@ -294,6 +319,111 @@ void cpd_stats(
 }
 
 
+
+void tucker_stats(
+  splatt_csf const * const csf,
+  idx_t const * const ranks,
+  double const * const opts)
+{
+  idx_t const nmodes = csf[0].nmodes;
+
+  /* find total storage: factors, the TTMc output, and the core */
+  size_t fbytes = csf_storage(csf, opts);
+  size_t mbytes = 0;
+  idx_t maxdim = 0;
+  idx_t ncore = 1;
+  for(idx_t m=0; m < nmodes; ++m) {
+    mbytes += csf[0].dims[m] * ranks[m] * sizeof(val_t);
+    maxdim = SS_MAX(maxdim, csf[0].dims[m]);
+    ncore *= ranks[m];
+  }
+  size_t const tbytes = maxdim * ttmc_max_width(nmodes, ranks) *
+      sizeof(val_t);
+  mbytes += ncore * sizeof(val_t);
+
+  /* header */
+  printf("Factoring "
+         "------------------------------------------------------\n");
+  printf("RANKS=");
+  for(idx_t m=0; m < nmodes; ++m) {
+    printf("%"SPLATT_PF_IDX"%s", ranks[m], (m < nmodes-1) ? "x" : " ");
+  }
+  printf("MAXITS=%"SPLATT_PF_IDX" TOL=%0.1e ",
+      (idx_t) opts[SPLATT_OPTION_NITER], opts[SPLATT_OPTION_TOLERANCE]);
+  printf("SEED=%d ", (int) opts[SPLATT_OPTION_RANDSEED]);
+  printf("THREADS=%"SPLATT_PF_IDX" ", (idx_t) opts[SPLATT_OPTION_NTHREADS]);
+  printf("\n");
+
+  printf("CSF-ALLOC=");
+  switch((splatt_csf_type) opts[SPLATT_OPTION_CSF_ALLOC]) {
+  case SPLATT_CSF_ONEMODE:
+    printf("ONEMODE");
+    break;
+  case SPLATT_CSF_TWOMODE:
+    printf("TWOMODE");
+    break;
+  case SPLATT_CSF_ALLMODE:
+    printf("ALLMODE");
+    break;
+  }
+  printf(" TILE=%s\n",
+      ((splatt_tile_type) opts[SPLATT_OPTION_TILE] == SPLATT_NOTILE) ?
+      "NO" : "DENSE");
+
+  char * fstorage = bytes_str(fbytes);
+  char * mstorage = bytes_str(mbytes);
+  char * tstorage = bytes_str(tbytes);
+  printf("CSF-STORAGE=%s FACTOR-STORAGE=%s TTMC-STORAGE=%s", fstorage,
+      mstorage, tstorage);
+  free(fstorage);
+  free(mstorage);
+  free(tstorage);
+  printf("\n\n");
+}
+
+
+void tc_stats(
+  splatt_csf const * const csf,
+  idx_t const nfactors,
+  splatt_tc_type const which,
+  double const * const opts)
+{
+  size_t fbytes = csf_storage(csf, opts);
+  size_t mbytes = 0;
+  for(idx_t m=0; m < csf[0].nmodes; ++m) {
+    mbytes += csf[0].dims[m] * nfactors * sizeof(val_t);
+  }
+
+  /* header */
+  printf("Completing "
+         "-----------------------------------------------------\n");
+  printf("ALG=");
+  switch(which) {
+  case SPLATT_TC_ALS:
+    printf("ALS");
+    break;
+  case SPLATT_TC_CCD:
+    printf("CCD++");
+    break;
+  case SPLATT_TC_SGD:
+    printf("SGD RATE=%0.1e", opts[SPLATT_OPTION_LEARNRATE]);
+    break;
+  }
+  printf(" NFACTORS=%"SPLATT_PF_IDX" MAXITS=%"SPLATT_PF_IDX" TOL=%0.1e "
+         "REG=%0.1e ",
+      nfactors, (idx_t) opts[SPLATT_OPTION_NITER],
+      opts[SPLATT_OPTION_TOLERANCE], opts[SPLATT_OPTION_REGULARIZE]);
+  printf("SEED=%d ", (int) opts[SPLATT_OPTION_RANDSEED]);
+  printf("THREADS=%"SPLATT_PF_IDX"\n", (idx_t) opts[SPLATT_OPTION_NTHREADS]);
+
+  char * fstorage = bytes_str(fbytes);
+  char * mstorage = bytes_str(mbytes);
+  printf("CSF-STORAGE=%s FACTOR-STORAGE=%s", fstorage, mstorage);
+  free(fstorage);
+  free(mstorage);
+  printf("\n\n");
+}
+
 #ifdef SPLATT_USE_MPI
 void mpi_cpd_stats(
   splatt_csf const * const csf,
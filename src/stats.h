@@ -75,6 +75,38 @@ void cpd_stats(
   double const * const opts);
 
 
+#define tucker_stats splatt_tucker_stats
+/**
+* @brief Output work-related statistics before a Tucker factorization. This
+*        includes the ranks, #threads, tolerance, etc.
+*
+* @param csf The CSF tensor we are factoring.
+* @param ranks The rank of each mode.
+* @param opts Other Tucker options.
+*/
+void tucker_stats(
+  splatt_csf const * const csf,
+  idx_t const * const ranks,
+  double const * const opts);
+
+
+#define tc_stats splatt_tc_stats
+/**
+* @brief Output work-related statistics before tensor completion. This
+*        includes the algorithm, rank, regularization, #threads, etc.
+*
+* @param csf The CSF tensor of training entries.
+* @param nfactors The rank of the model.
+* @param which The completion algorithm.
+* @param opts Other completion options.
+*/
+void tc_stats(
+  splatt_csf const * const csf,
+  idx_t const nfactors,
+  splatt_tc_type const which,
+  double const * const opts);
+
+
 /******************************************************************************
  * MPI FUNCTIONS
  *****************************************************************************/
@@ -13,7 +13,7 @@
  * PRIVATE FUNCTIONS
  *****************************************************************************/
 
-static idx_t nprobes = 0;
+static SPLATT_THREAD_LOCAL idx_t nprobes = 0;
 
 
 
@@ -107,12 +107,18 @@ bool lprobe(
     parts[p] = p_binary_search(weights, step - (nitems/nparts),
         SS_MIN(step,nitems), bsum);
 
+    /* the search never returns 0, so catch a first item which is by itself
+     * heavier than the bottleneck */
+    if(weights[parts[p]-1] > bsum) {
+      return false;
+    }
+
     /* we ran out of stuff to do */
     if(parts[p] == nitems) {
       /* check for pathological case when the last weight is larger than
        * bottleneck */
-      idx_t const size_last = weights[nitems-1] - weights[parts[p-1]-1];
-      return size_last < bottleneck;
+      idx_t const prev = (parts[p-1] > 0) ? weights[parts[p-1]-1] : 0;
+      return (weights[nitems-1] - prev) < bottleneck;
     }
     bsum = weights[parts[p]-1] + bottleneck;
   }
@@ -181,7 +187,9 @@ idx_t * partition_weighted(
   } else {
     for(idx_t p=0; p < nitems; ++p) {
       parts[p] = p;
-      bneck = SS_MAX(bneck, weights[p]);
+      /* weights[] has been prefix-summed */
+      idx_t const w = (p == 0) ? weights[0] : weights[p] - weights[p-1];
+      bneck = SS_MAX(bneck, w);
     }
     for(idx_t p=nitems; p <= nparts; ++p) {
       parts[p] = nitems;
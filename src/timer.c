@@ -13,9 +13,15 @@
 static char const * const timer_names[] = {
   [TIMER_ALL]       = "TOTAL",
   [TIMER_CPD]       = "CPD",
+  [TIMER_TUCKER]    = "TUCKER",
+  [TIMER_TC]        = "COMPLETION",
   [TIMER_IO]        = "IO",
   [TIMER_MTTKRP]    = "MTTKRP",
+  [TIMER_TTMC]      = "TTMc",
+  [TIMER_SKETCH]    = "SKETCHED MTTKRP",
+  [TIMER_PHI]       = "CP-APR PHI",
   [TIMER_INV]       = "INVERSE",
+  [TIMER_SVD]       = "SVD",
   [TIMER_SPLATT]    = "SPLATT",
   [TIMER_GIGA]      = "GIGA",
   [TIMER_TTBOX]     = "TTBOX",
@@ -48,6 +54,13 @@ static char const * const timer_names[] = {
 };
 
 
+/******************************************************************************
+ * GLOBALS
+ *****************************************************************************/
+int timer_lvl;
+SPLATT_THREAD_LOCAL sp_timer_t timers[TIMER_NTIMERS];
+
+
 /******************************************************************************
  * PUBLIC FUNCTIONS
  *****************************************************************************/
@@ -4,6 +4,8 @@
 /******************************************************************************
  * INCLUDES
  *****************************************************************************/
+#include "base.h"
+
 #include <time.h>
 #include <stddef.h>
 #include <stdbool.h>
@@ -38,11 +40,17 @@ typedef enum
   TIMER_LVL0,   /* LEVEL 0 */
   TIMER_ALL,
   TIMER_CPD,
+  TIMER_TUCKER,
+  TIMER_TC,
   TIMER_REORDER,
   TIMER_CONVERT,
   TIMER_LVL1,   /* LEVEL 1 */
   TIMER_MTTKRP,
+  TIMER_TTMC,
+  TIMER_SKETCH,
+  TIMER_PHI,
   TIMER_INV,
+  TIMER_SVD,
   TIMER_FIT,
   TIMER_MATMUL,
   TIMER_ATA,
@@ -78,8 +86,10 @@ typedef enum
 
 
 /* globals */
-int timer_lvl;
-sp_timer_t timers[TIMER_NTIMERS];
+extern int timer_lvl;
+/* Each thread has its own timers, so concurrent decompositions (each driven
+ * by a different thread) do not mix their timings. */
+extern SPLATT_THREAD_LOCAL sp_timer_t timers[TIMER_NTIMERS];
 
 
 /******************************************************************************
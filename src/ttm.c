@@ -0,0 +1,454 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "ttm.h"
+#include "mttkrp.h"
+#include "mutex_pool.h"
+#include "timer.h"
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/*
+ * The kernels work in CSF order: the columns of an output row are a row-major
+ * tensor over the tree levels other than the output level, shallower levels
+ * varying slowest. For a node n at level l, S(n) is the sum over its children
+ * c of kron(row(c), S(c)), with S(leaf) = value. The output row of a node at
+ * the output level d is kron(P, S(n)), where P is the Kronecker product of the
+ * rows on the path from the root.
+ */
+
+
+/**
+* @brief Add the Kronecker product of 'a' and 'b' to 'out'.
+*
+* @param[out] out The output, of length na * nb.
+* @param a The first (slower) vector.
+* @param na The length of 'a'.
+* @param b The second (faster) vector.
+* @param nb The length of 'b'.
+*/
+static inline void p_add_kron(
+    val_t * const restrict out,
+    val_t const * const restrict a,
+    idx_t const na,
+    val_t const * const restrict b,
+    idx_t const nb)
+{
+  for(idx_t i=0; i < na; ++i) {
+    val_t const ai = a[i];
+    val_t * const restrict orow = out + (i * nb);
+    for(idx_t j=0; j < nb; ++j) {
+      orow[j] += ai * b[j];
+    }
+  }
+}
+
+
+/**
+* @brief Sizes of the partial products for each level of a CSF tree.
+*/
+typedef struct
+{
+  idx_t nmodes;
+  /** @brief The rank of the factor at each level. */
+  idx_t ranks[MAX_NMODES];
+  /** @brief above[l] is the product of ranks[0..l]. */
+  idx_t above[MAX_NMODES];
+  /** @brief below[l] is the product of ranks[l+1..nmodes-1]. */
+  idx_t below[MAX_NMODES];
+} p_ttmc_sizes;
+
+
+/**
+* @brief Accumulate sum_n kron(row(n), S(n)) over the nodes [start, end) at
+*        'level' into 'out'.
+*
+* @param pt The sparsity pattern of the tile.
+* @param level The level of the nodes (> 0).
+* @param start The first node.
+* @param end One past the last node.
+* @param lvals The factors, ordered by CSF level.
+* @param sz The sizes of the partial products.
+* @param buf Scratch space; buf[l] holds S() of a node at level l.
+* @param[out] out The accumulation, of length ranks[level] * below[level].
+*/
+static void p_ttmc_up(
+    csf_sparsity const * const pt,
+    idx_t const level,
+    idx_t const start,
+    idx_t const end,
+    val_t * const * const lvals,
+    p_ttmc_sizes const * const sz,
+    val_t ** buf,
+    val_t * const restrict out)
+{
+  idx_t const * const restrict fids = pt->fids[level];
+  val_t const * const restrict mv = lvals[level];
+  idx_t const rank = sz->ranks[level];
+
+  if(level == sz->nmodes - 1) {
+    val_t const * const restrict vals = pt->vals;
+    for(idx_t n=start; n < end; ++n) {
+      val_t const v = vals[n];
+      val_t const * const restrict row = mv + (fids[n] * rank);
+      for(idx_t f=0; f < rank; ++f) {
+        out[f] += v * row[f];
+      }
+    }
+    return;
+  }
+
+  idx_t const * const restrict fptr = pt->fptr[level];
+  idx_t const nbelow = sz->below[level];
+  val_t * const restrict accum = buf[level];
+  for(idx_t n=start; n < end; ++n) {
+    memset(accum, 0, nbelow * sizeof(*accum));
+    p_ttmc_up(pt, level+1, fptr[n], fptr[n+1], lvals, sz, buf, accum);
+    p_add_kron(out, mv + (fids[n] * rank), rank, accum, nbelow);
+  }
+}
+
+
+/**
+* @brief Walk the nodes [start, end) at 'level' down to the output level and
+*        accumulate into their output rows. buf[level-1] holds the Kronecker
+*        product of the rows on the path from the root.
+*
+* @param pt The sparsity pattern of the tile.
+* @param level The level of the nodes (> 0).
+* @param outdepth The level of the output mode.
+* @param start The first node.
+* @param end One past the last node.
+* @param lvals The factors, ordered by CSF level.
+* @param sz The sizes of the partial products.
+* @param buf Scratch space; buf[l] holds the path product (l < outdepth) or
+*            S() (l >= outdepth) of a node at level l.
+* @param ovals The output matrix.
+* @param width The number of columns in the output.
+* @param pool Locks for the output rows, or NULL to not synchronize.
+*/
+static void p_ttmc_down(
+    csf_sparsity const * const pt,
+    idx_t const level,
+    idx_t const outdepth,
+    idx_t const start,
+    idx_t const end,
+    val_t * const * const lvals,
+    p_ttmc_sizes const * const sz,
+    val_t ** buf,
+    val_t * const ovals,
+    idx_t const width,
+    mutex_pool * const pool)
+{
+  idx_t const * const restrict fids = pt->fids[level];
+  idx_t const * const restrict fptr = pt->fptr[level];
+  val_t const * const restrict path = buf[level-1];
+  idx_t const npath = sz->above[level-1];
+
+  for(idx_t n=start; n < end; ++n) {
+    idx_t const fid = fids[n];
+
+    if(level == outdepth) {
+      val_t * const restrict orow = ovals + (fid * width);
+      if(level == sz->nmodes - 1) {
+        val_t const v = pt->vals[n];
+        if(pool != NULL) {
+          mutex_set_lock(pool, fid);
+        }
+        for(idx_t f=0; f < npath; ++f) {
+          orow[f] += v * path[f];
+        }
+      } else {
+        idx_t const nbelow = sz->below[level];
+        val_t * const restrict accum = buf[level];
+        memset(accum, 0, nbelow * sizeof(*accum));
+        p_ttmc_up(pt, level+1, fptr[n], fptr[n+1], lvals, sz, buf, accum);
+        if(pool != NULL) {
+          mutex_set_lock(pool, fid);
+        }
+        p_add_kron(orow, path, npath, accum, nbelow);
+      }
+      if(pool != NULL) {
+        mutex_unset_lock(pool, fid);
+      }
+      continue;
+    }
+
+    /* extend the path product with this node's row */
+    idx_t const rank = sz->ranks[level];
+    val_t * const restrict prod = buf[level];
+    memset(prod, 0, npath * rank * sizeof(*prod));
+    p_add_kron(prod, path, npath, lvals[level] + (fid * rank), rank);
+
+    p_ttmc_down(pt, level+1, outdepth, fptr[n], fptr[n+1], lvals, sz, buf,
+        ovals, width, pool);
+  }
+}
+
+
+/**
+* @brief TTMc on one tile of a CSF tensor. See csf_mttkrp_func.
+*
+* @param locked Synchronize updates to output rows with 'pool'.
+*/
+static inline void p_ttmc_tile(
+    splatt_csf const * const ct,
+    idx_t const tile_id,
+    matrix_t ** mats,
+    idx_t const mode,
+    thd_info * const thds,
+    idx_t const * const partition,
+    mutex_pool * const pool,
+    bool const locked)
+{
+  csf_sparsity const * const pt = ct->pt + tile_id;
+  if(pt->vals == NULL) {
+    return;
+  }
+
+  idx_t const nmodes = ct->nmodes;
+  idx_t const outdepth = csf_mode_to_depth(ct, mode);
+  idx_t const width = mats[MAX_NMODES]->J;
+  val_t * const ovals = mats[MAX_NMODES]->vals;
+  mutex_pool * const lock_pool = locked ? pool : NULL;
+
+  val_t * lvals[MAX_NMODES];
+  p_ttmc_sizes sz;
+  sz.nmodes = nmodes;
+  for(idx_t l=0; l < nmodes; ++l) {
+    matrix_t const * const mat = mats[csf_depth_to_mode(ct, l)];
+    lvals[l] = mat->vals;
+    sz.ranks[l] = (l == outdepth) ? 1 : mat->J;
+  }
+  for(idx_t l=0; l < nmodes; ++l) {
+    sz.above[l] = sz.ranks[l] * ((l > 0) ? sz.above[l-1] : 1);
+    sz.below[nmodes-l-1] = (l > 0) ?
+        sz.ranks[nmodes-l] * sz.below[nmodes-l] : 1;
+  }
+
+  int const tid = splatt_omp_get_thread_num();
+  val_t * buf[MAX_NMODES];
+  for(idx_t l=0; l < nmodes; ++l) {
+    buf[l] = ((val_t *) thds[tid].scratch[0]) + (l * width);
+  }
+
+  idx_t const * const restrict sptr = pt->fptr[0];
+  idx_t const * const restrict sids = pt->fids[0];
+
+  idx_t start, stop, fstart, fstop;
+  csf_thread_range(pt, partition, tid, &start, &stop, &fstart, &fstop);
+  for(idx_t s=start; s < stop; ++s) {
+    idx_t const fid = (sids == NULL) ? s : sids[s];
+    idx_t const cstart = SS_MAX(sptr[s], fstart);
+    idx_t const cstop = SS_MIN(sptr[s+1], fstop);
+
+    if(outdepth == 0) {
+      memset(buf[0], 0, width * sizeof(**buf));
+      p_ttmc_up(pt, 1, cstart, cstop, lvals, &sz, buf, buf[0]);
+
+      val_t * const restrict orow = ovals + (fid * width);
+      if(lock_pool != NULL) {
+        mutex_set_lock(lock_pool, fid);
+      }
+      for(idx_t f=0; f < width; ++f) {
+        orow[f] += buf[0][f];
+      }
+      if(lock_pool != NULL) {
+        mutex_unset_lock(lock_pool, fid);
+      }
+    } else {
+      memcpy(buf[0], lvals[0] + (fid * sz.ranks[0]),
+          sz.ranks[0] * sizeof(**buf));
+      p_ttmc_down(pt, 1, outdepth, cstart, cstop, lvals, &sz, buf, ovals,
+          width, lock_pool);
+    }
+  }
+}
+
+
+static void p_ttmc_locked(
+    splatt_csf const * const ct,
+    idx_t const tile_id,
+    matrix_t ** mats,
+    idx_t const mode,
+    thd_info * const thds,
+    idx_t const * const partition,
+    mutex_pool * const pool)
+{
+  p_ttmc_tile(ct, tile_id, mats, mode, thds, partition, pool, true);
+}
+
+
+static void p_ttmc_nolock(
+    splatt_csf const * const ct,
+    idx_t const tile_id,
+    matrix_t ** mats,
+    idx_t const mode,
+    thd_info * const thds,
+    idx_t const * const partition,
+    mutex_pool * const pool)
+{
+  p_ttmc_tile(ct, tile_id, mats, mode, thds, partition, pool, false);
+}
+
+
+/**
+* @brief Reorder the columns of a TTMc output from CSF order to increasing
+*        mode order. Nothing is done if the two are the same.
+*
+* @param ct The CSF tensor which was used.
+* @param mats The factors and the output.
+* @param mode The output mode.
+* @param thds Thread structures; scratch[0] holds a row of the output.
+*/
+static void p_ttmc_canonical(
+    splatt_csf const * const ct,
+    matrix_t ** mats,
+    idx_t const mode,
+    thd_info * const thds)
+{
+  idx_t const nmodes = ct->nmodes;
+  matrix_t * const M = mats[MAX_NMODES];
+  idx_t const width = M->J;
+
+  bool sorted = true;
+  idx_t prev = 0;
+  for(idx_t l=0; l < nmodes; ++l) {
+    idx_t const m = csf_depth_to_mode(ct, l);
+    if(m == mode) {
+      continue;
+    }
+    if(l > 0 && m < prev) {
+      sorted = false;
+    }
+    prev = m;
+  }
+  if(sorted) {
+    return;
+  }
+
+  /* column strides in increasing mode order */
+  idx_t stride[MAX_NMODES];
+  idx_t next = 1;
+  for(idx_t m=nmodes; m-- > 0; ) {
+    stride[m] = 0;
+    if(m != mode) {
+      stride[m] = next;
+      next *= mats[m]->J;
+    }
+  }
+
+  /* map[c] is the canonical position of CSF-order column c */
+  idx_t * map = splatt_malloc(width * sizeof(*map));
+  for(idx_t c=0; c < width; ++c) {
+    idx_t rem = c;
+    idx_t col = 0;
+    for(idx_t l=nmodes; l-- > 0; ) {
+      idx_t const m = csf_depth_to_mode(ct, l);
+      if(m == mode) {
+        continue;
+      }
+      col += (rem % mats[m]->J) * stride[m];
+      rem /= mats[m]->J;
+    }
+    map[c] = col;
+  }
+
+  #pragma omp parallel
+  {
+    int const tid = splatt_omp_get_thread_num();
+    val_t * const restrict tmp = (val_t *) thds[tid].scratch[0];
+
+    #pragma omp for schedule(static)
+    for(idx_t i=0; i < M->I; ++i) {
+      val_t * const restrict row = M->vals + (i * width);
+      for(idx_t c=0; c < width; ++c) {
+        tmp[map[c]] = row[c];
+      }
+      memcpy(row, tmp, width * sizeof(*row));
+    }
+  }
+
+  splatt_free(map);
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+idx_t ttmc_width(
+    idx_t const nmodes,
+    idx_t const * const ranks,
+    idx_t const mode)
+{
+  idx_t width = 1;
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(m != mode) {
+      width *= ranks[m];
+    }
+  }
+  return width;
+}
+
+
+idx_t ttmc_max_width(
+    idx_t const nmodes,
+    idx_t const * const ranks)
+{
+  idx_t width = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    width = SS_MAX(width, ttmc_width(nmodes, ranks, m));
+  }
+  return width;
+}
+
+
+void ttmc_csf(
+    splatt_csf const * const tensors,
+    matrix_t ** mats,
+    idx_t const mode,
+    thd_info * const thds,
+    splatt_mttkrp_ws * const ws,
+    double const * const opts)
+{
+  timer_start(&timers[TIMER_TTMC]);
+
+  /* ensure we use as many threads as our partitioning supports */
+  splatt_omp_set_num_threads(ws->num_threads);
+
+  idx_t const nmodes = tensors->nmodes;
+  idx_t ranks[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    ranks[m] = mats[m]->J;
+  }
+
+  matrix_t * const M = mats[MAX_NMODES];
+  M->I = tensors->dims[mode];
+  M->J = ttmc_width(nmodes, ranks, mode);
+  memset(M->vals, 0, M->I * M->J * sizeof(*M->vals));
+
+  thd_reset(thds, splatt_omp_get_max_threads());
+
+  idx_t const which_csf = ws->mode_csf_map[mode];
+  mttkrp_csf_schedule(tensors, which_csf, p_ttmc_locked, p_ttmc_nolock, mats,
+      mode, thds, ws);
+  p_ttmc_canonical(tensors + which_csf, mats, mode, thds);
+
+  if((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
+    printf("TTMc mode %"SPLATT_PF_IDX": ", mode+1);
+    thd_time_stats(thds, splatt_omp_get_max_threads());
+    if(ws->is_privatized[mode]) {
+      printf("  reduction-time: %0.3fs\n", ws->reduction_time);
+    }
+  }
+  thd_reset(thds, splatt_omp_get_max_threads());
+
+  timer_stop(&timers[TIMER_TTMC]);
+}
@@ -0,0 +1,83 @@
+#ifndef SPLATT_TTM_H
+#define SPLATT_TTM_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "matrix.h"
+#include "csf.h"
+#include "thd_info.h"
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define ttmc_width splatt_ttmc_width
+/**
+* @brief The number of columns in the output of a TTMc: the product of the
+*        ranks of all modes except 'mode'.
+*
+* @param nmodes The number of modes.
+* @param ranks The number of columns in each factor.
+* @param mode The output mode.
+*
+* @return The number of columns.
+*/
+idx_t ttmc_width(
+    idx_t const nmodes,
+    idx_t const * const ranks,
+    idx_t const mode);
+
+
+#define ttmc_max_width splatt_ttmc_max_width
+/**
+* @brief The largest ttmc_width() over all modes.
+*
+* @param nmodes The number of modes.
+* @param ranks The number of columns in each factor.
+*
+* @return The number of columns.
+*/
+idx_t ttmc_max_width(
+    idx_t const nmodes,
+    idx_t const * const ranks);
+
+
+#define ttmc_csf splatt_ttmc_csf
+/**
+* @brief Tensor times matrix chain (TTMc) with a CSF tensor: multiply the
+*        tensor by the transpose of every factor except mode 'mode's and
+*        matricize the result along 'mode'. This is the primary computation
+*        in Tucker/HOOI. Output is written to mats[SPLATT_MAX_NMODES].
+*
+*        Output row i holds, for every combination of the other modes' ranks,
+*        sum_{nonzeros x in slice i} x * (row products). Its columns are a
+*        row-major tensor over the other modes in increasing order, so the
+*        rank of the lowest mode varies slowest.
+*
+*        Tiles and partitions are scheduled with mttkrp_csf_schedule(), so the
+*        tiling, thread partitioning, locks, and privatization of 'ws' are
+*        used exactly as in MTTKRP.
+*
+* @param tensors The CSF tensor(s).
+* @param mats The factors (mats[m]->J is the rank of mode m) and the output.
+* @param mode Which mode we are computing for.
+* @param thds Thread structures. scratch[0] must hold at least
+*             nmodes * ttmc_max_width() values.
+* @param ws MTTKRP workspace, allocated with ttmc_max_width() columns so that
+*           privatization buffers are large enough.
+* @param opts SPLATT options.
+*/
+void ttmc_csf(
+    splatt_csf const * const tensors,
+    matrix_t ** mats,
+    idx_t const mode,
+    thd_info * const thds,
+    splatt_mttkrp_ws * const ws,
+    double const * const opts);
+
+#endif
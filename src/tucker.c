@@ -0,0 +1,348 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "tucker.h"
+#include "csf.h"
+#include "ttm.h"
+#include "timer.h"
+#include "thd_info.h"
+#include "util.h"
+#include "splatt_lapack.h"
+
+#include <math.h>
+
+
+
+/******************************************************************************
+ * API FUNCTIONS
+ *****************************************************************************/
+
+int splatt_tucker_hooi(
+    splatt_csf const * const tensors,
+    splatt_idx_t const * const ranks,
+    double const * const options,
+    splatt_tucker * factored)
+{
+  idx_t const nmodes = tensors->nmodes;
+
+  /* each factor needs that many independent rows and TTMc columns */
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(ranks[m] == 0 || ranks[m] > tensors->dims[m] ||
+        ranks[m] > ttmc_width(nmodes, ranks, m)) {
+      return SPLATT_ERROR_BADINPUT;
+    }
+  }
+
+  /* random orthonormal factors. The seed is private to this call. */
+  unsigned int seed = (unsigned int) options[SPLATT_OPTION_RANDSEED];
+  matrix_t * mats[MAX_NMODES+1];
+  idx_t maxdim = 0;
+  idx_t ncore = 1;
+  for(idx_t m=0; m < nmodes; ++m) {
+    mats[m] = mat_alloc(tensors->dims[m], ranks[m]);
+    fill_rand_r(mats[m]->vals, tensors->dims[m] * ranks[m], &seed);
+    tucker_orthonormalize(mats[m]);
+    maxdim = SS_MAX(maxdim, tensors->dims[m]);
+    ncore *= ranks[m];
+  }
+  mats[MAX_NMODES] = mat_alloc(maxdim, ttmc_max_width(nmodes, ranks));
+
+  val_t * core = splatt_malloc(ncore * sizeof(*core));
+
+  factored->fit = tucker_hooi_iterate(tensors, mats, core, options);
+
+  /* store output */
+  factored->nmodes = nmodes;
+  factored->core = core;
+  for(idx_t m=0; m < nmodes; ++m) {
+    factored->dims[m] = tensors->dims[m];
+    factored->ranks[m] = ranks[m];
+    factored->factors[m] = mats[m]->vals;
+  }
+
+  /* clean up */
+  mat_free(mats[MAX_NMODES]);
+  for(idx_t m=0; m < nmodes; ++m) {
+    free(mats[m]); /* just the matrix_t ptr, data is safely in factored */
+  }
+  return SPLATT_SUCCESS;
+}
+
+
+void splatt_free_tucker(
+    splatt_tucker * factored)
+{
+  free(factored->core);
+  for(idx_t m=0; m < factored->nmodes; ++m) {
+    free(factored->factors[m]);
+  }
+}
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Find the leading left singular vectors of a TTMc output Y, via the
+*        eigendecomposition of its smaller Gram matrix. If Y is tall, the
+*        right singular vectors V come from Y^T Y and U = Y V (normalized);
+*        otherwise U comes directly from Y Y^T.
+*
+* @param Y The TTMc output.
+* @param[out] U The factor to overwrite; U->J vectors are computed.
+* @param gram Workspace of at least min(Y->I, Y->J)^2 values.
+*/
+static void p_leading_vecs(
+  matrix_t const * const Y,
+  matrix_t * const U,
+  val_t * const gram)
+{
+  timer_start(&timers[TIMER_SVD]);
+
+  idx_t const I = Y->I;
+  idx_t const W = Y->J;
+  idx_t const rank = U->J;
+  bool const tall = (W <= I);
+  idx_t const N = tall ? W : I;
+
+  /* gram = Y^T Y or Y Y^T; row-major Y is column-major Y^T */
+  char uplo = 'L';
+  char trans = tall ? 'N' : 'T';
+  splatt_blas_int n = (splatt_blas_int) N;
+  splatt_blas_int k = (splatt_blas_int) (tall ? I : W);
+  splatt_blas_int lda = (splatt_blas_int) W;
+  splatt_blas_int ldc = n;
+  val_t alpha = 1.;
+  val_t beta = 0.;
+  SPLATT_BLAS(syrk)(&uplo, &trans, &n, &k, &alpha, Y->vals, &lda, &beta, gram,
+      &ldc);
+
+  /* eigenvectors are left in gram, in order of ascending eigenvalue */
+  char jobz = 'V';
+  splatt_blas_int info;
+  splatt_blas_int lwork = -1;
+  val_t query;
+  val_t * evals = splatt_malloc(N * sizeof(*evals));
+  SPLATT_BLAS(syev)(&jobz, &uplo, &n, gram, &ldc, evals, &query, &lwork,
+      &info);
+  lwork = (splatt_blas_int) query;
+  val_t * work = splatt_malloc(lwork * sizeof(*work));
+  SPLATT_BLAS(syev)(&jobz, &uplo, &n, gram, &ldc, evals, work, &lwork, &info);
+  if(info != 0) {
+    fprintf(stderr, "SPLATT: syev returned %d\n", (int) info);
+  }
+  splatt_free(work);
+  splatt_free(evals);
+
+  val_t * const restrict uv = U->vals;
+  if(tall) {
+    #pragma omp parallel for schedule(static)
+    for(idx_t i=0; i < I; ++i) {
+      val_t const * const restrict yrow = Y->vals + (i * W);
+      for(idx_t r=0; r < rank; ++r) {
+        val_t const * const restrict vec = gram + ((N - r - 1) * N);
+        val_t accum = 0;
+        for(idx_t w=0; w < W; ++w) {
+          accum += yrow[w] * vec[w];
+        }
+        uv[r + (i * rank)] = accum;
+      }
+    }
+    /* the columns are orthogonal; this normalizes them */
+    tucker_orthonormalize(U);
+  } else {
+    #pragma omp parallel for schedule(static)
+    for(idx_t i=0; i < I; ++i) {
+      for(idx_t r=0; r < rank; ++r) {
+        uv[r + (i * rank)] = gram[i + ((N - r - 1) * N)];
+      }
+    }
+  }
+
+  timer_stop(&timers[TIMER_SVD]);
+}
+
+
+/**
+* @brief Compute the core from the TTMc of the last mode: core = U^T Y. The
+*        columns of Y are ordered over modes 0 to nmodes-2, so the transpose
+*        of U^T Y is the row-major core.
+*
+* @param U The factor of the last mode.
+* @param Y The TTMc output of the last mode.
+* @param[out] core The core tensor.
+*
+* @return The Frobenius norm of the core, squared.
+*/
+static val_t p_form_core(
+  matrix_t const * const U,
+  matrix_t const * const Y,
+  val_t * const restrict core)
+{
+  idx_t const I = Y->I;
+  idx_t const W = Y->J;
+  idx_t const rank = U->J;
+
+  val_t normsq = 0;
+  #pragma omp parallel reduction(+:normsq)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    int const nthreads = splatt_omp_get_num_threads();
+    idx_t const start = (W * tid) / nthreads;
+    idx_t const stop = (W * (tid+1)) / nthreads;
+
+    memset(core + (start * rank), 0, (stop - start) * rank * sizeof(*core));
+    for(idx_t i=0; i < I; ++i) {
+      val_t const * const restrict urow = U->vals + (i * rank);
+      val_t const * const restrict yrow = Y->vals + (i * W);
+      for(idx_t c=start; c < stop; ++c) {
+        val_t const y = yrow[c];
+        val_t * const restrict crow = core + (c * rank);
+        for(idx_t r=0; r < rank; ++r) {
+          crow[r] += y * urow[r];
+        }
+      }
+    }
+
+    for(idx_t x=start * rank; x < stop * rank; ++x) {
+      normsq += core[x] * core[x];
+    }
+  }
+
+  return normsq;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+double tucker_hooi_iterate(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  val_t * const core,
+  double const * const opts)
+{
+  idx_t const nmodes = tensors[0].nmodes;
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+
+  idx_t ranks[MAX_NMODES] = { 0 };
+  for(idx_t m=0; m < nmodes; ++m) {
+    ranks[m] = mats[m]->J;
+  }
+  idx_t const maxwidth = ttmc_max_width(nmodes, ranks);
+
+  /* one TTMc buffer per level, + 64 bytes to avoid false sharing */
+  splatt_omp_set_num_threads(nthreads);
+  thd_info * thds = thd_init(nthreads, 1,
+      (nmodes * maxwidth * sizeof(val_t)) + 64);
+
+  /* TTMc reuses the MTTKRP machinery, but nothing which is rank-specific */
+  double * ttmc_opts = splatt_default_opts();
+  memcpy(ttmc_opts, opts, SPLATT_OPTION_NOPTIONS * sizeof(*opts));
+  ttmc_opts[SPLATT_OPTION_MEMOIZE] = 0;
+  ttmc_opts[SPLATT_OPTION_PRECISION] = SPLATT_PREC_FULL;
+  ttmc_opts[SPLATT_OPTION_COLBLOCK] = -1;
+  splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(tensors, maxwidth,
+      ttmc_opts);
+
+  idx_t maxgram = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    idx_t const N = SS_MIN(tensors->dims[m], ttmc_width(nmodes, ranks, m));
+    maxgram = SS_MAX(maxgram, N * N);
+  }
+  val_t * gram = splatt_malloc(maxgram * sizeof(*gram));
+
+  double oldfit = 0;
+  double fit = 0;
+  val_t const ttnormsq = csf_frobsq(tensors);
+
+  sp_timer_t itertime;
+  sp_timer_t modetime[MAX_NMODES];
+  timer_start(&timers[TIMER_TUCKER]);
+
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  for(idx_t it=0; it < niters; ++it) {
+    timer_fstart(&itertime);
+    for(idx_t m=0; m < nmodes; ++m) {
+      timer_fstart(&modetime[m]);
+      ttmc_csf(tensors, mats, m, thds, ws, ttmc_opts);
+      p_leading_vecs(mats[MAX_NMODES], mats[m], gram);
+      timer_stop(&modetime[m]);
+    }
+
+    /* the factors are orthonormal, so ||X - Z||^2 = ||X||^2 - ||core||^2 */
+    val_t const coresq = p_form_core(mats[nmodes-1], mats[MAX_NMODES], core);
+    val_t residual = ttnormsq - coresq;
+    residual = (residual > 0.) ? sqrt(residual) : 0.;
+    fit = 1 - (residual / sqrt(ttnormsq));
+    timer_stop(&itertime);
+
+    if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      printf("  its = %3"SPLATT_PF_IDX" (%0.3fs)  fit = %0.5f  delta = %+0.4e\n",
+          it+1, itertime.seconds, fit, fit - oldfit);
+      if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW) {
+        for(idx_t m=0; m < nmodes; ++m) {
+          printf("     mode = %1"SPLATT_PF_IDX" (%0.3fs)\n", m+1,
+              modetime[m].seconds);
+        }
+      }
+    }
+    if(fit == 1. ||
+        (it > 0 && fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE])) {
+      break;
+    }
+    oldfit = fit;
+  }
+  timer_stop(&timers[TIMER_TUCKER]);
+
+  /* CLEAN UP */
+  splatt_free(gram);
+  splatt_mttkrp_free_ws(ws);
+  splatt_free_opts(ttmc_opts);
+  thd_free(thds, nthreads);
+
+  return fit;
+}
+
+
+void tucker_orthonormalize(
+  matrix_t * const A)
+{
+  idx_t const I = A->I;
+  idx_t const rank = A->J;
+  val_t * const restrict av = A->vals;
+
+  for(idx_t r=0; r < rank; ++r) {
+    /* remove the components along the previous columns */
+    for(idx_t p=0; p < r; ++p) {
+      val_t dot = 0;
+      #pragma omp parallel for schedule(static) reduction(+:dot)
+      for(idx_t i=0; i < I; ++i) {
+        dot += av[r + (i*rank)] * av[p + (i*rank)];
+      }
+      #pragma omp parallel for schedule(static)
+      for(idx_t i=0; i < I; ++i) {
+        av[r + (i*rank)] -= dot * av[p + (i*rank)];
+      }
+    }
+
+    val_t norm = 0;
+    #pragma omp parallel for schedule(static) reduction(+:norm)
+    for(idx_t i=0; i < I; ++i) {
+      norm += av[r + (i*rank)] * av[r + (i*rank)];
+    }
+    norm = sqrt(norm);
+    val_t const scale = (norm > 1e-12) ? 1. / norm : 0.;
+    #pragma omp parallel for schedule(static)
+    for(idx_t i=0; i < I; ++i) {
+      av[r + (i*rank)] *= scale;
+    }
+  }
+}
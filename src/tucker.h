@@ -0,0 +1,47 @@
+#ifndef SPLATT_TUCKER_H
+#define SPLATT_TUCKER_H
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "base.h"
+#include "matrix.h"
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define tucker_hooi_iterate splatt_tucker_hooi_iterate
+/**
+* @brief The primary computation in Tucker-HOOI. API functions call this one.
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param mats [OUT] The factors, initialized with orthonormal columns. The
+*             rank of mode m is mats[m]->J. mats[MAX_NMODES] is workspace for
+*             the TTMc, with room for max_m dims[m] * ttmc_max_width() values.
+* @param[out] core The dense core, of length prod(ranks).
+* @param opts SPLATT options array.
+*
+* @return The final fitness of the factorization.
+*/
+double tucker_hooi_iterate(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  val_t * const core,
+  double const * const opts);
+
+
+#define tucker_orthonormalize splatt_tucker_orthonormalize
+/**
+* @brief Orthonormalize the columns of a matrix with modified Gram-Schmidt.
+*        Columns which are (numerically) dependent on earlier ones are zeroed.
+*
+* @param A The row-major matrix, with at least as many rows as columns.
+*/
+void tucker_orthonormalize(
+  matrix_t * const A);
+
+#endif
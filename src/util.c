@@ -40,6 +40,21 @@ void fill_rand(
 }
 
 
+void fill_rand_r(
+  val_t * const restrict vals,
+  idx_t const nelems,
+  unsigned int * const seed)
+{
+  for(idx_t i=0; i < nelems; ++i) {
+    val_t v = 3.0 * ((val_t) rand_r(seed) / (val_t) RAND_MAX);
+    if(rand_r(seed) % 2 == 0) {
+      v *= -1;
+    }
+    vals[i] = v;
+  }
+}
+
+
 char * bytes_str(
   size_t const bytes)
 {
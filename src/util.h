@@ -52,6 +52,21 @@ void fill_rand(
   idx_t const nelems);
 
 
+#define fill_rand_r splatt_fill_rand_r
+/**
+* @brief Fill a val_t array with random values like fill_rand(), but from the
+*        caller's generator state instead of the global one used by rand().
+*
+* @param vals The array of values to fill
+* @param nelems The length of the array.
+* @param seed The generator state, which is updated.
+*/
+void fill_rand_r(
+  val_t * const restrict vals,
+  idx_t const nelems,
+  unsigned int * const seed);
+
+
 #define bytes_str splatt_bytes_str
 /**
 * @brief Return a string describing a human-readable number of bytes.
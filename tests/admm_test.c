@@ -0,0 +1,192 @@
+#include "../src/admm.h"
+#include "../src/cpd.h"
+#include "../src/csf.h"
+#include "../src/io.h"
+#include "../src/sptensor.h"
+
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+#define RANK 4
+
+
+CTEST(admm, prox_nonneg)
+{
+  val_t row[] = {1.5, -2., 0., -0.1};
+  admm_prox_lookup(SPLATT_CON_NONNEG)(row, 4, 1., 0.);
+  ASSERT_DBL_NEAR_TOL(1.5, row[0], 0.);
+  ASSERT_DBL_NEAR_TOL(0., row[1], 0.);
+  ASSERT_DBL_NEAR_TOL(0., row[2], 0.);
+  ASSERT_DBL_NEAR_TOL(0., row[3], 0.);
+}
+
+
+CTEST(admm, prox_l1)
+{
+  /* threshold = param / rho = 0.5 */
+  val_t row[] = {1.5, -2., 0.3, -0.4};
+  admm_prox_lookup(SPLATT_CON_L1)(row, 4, 2., 1.);
+  ASSERT_DBL_NEAR_TOL(1., row[0], 1e-12);
+  ASSERT_DBL_NEAR_TOL(-1.5, row[1], 1e-12);
+  ASSERT_DBL_NEAR_TOL(0., row[2], 0.);
+  ASSERT_DBL_NEAR_TOL(0., row[3], 0.);
+}
+
+
+CTEST(admm, prox_simplex)
+{
+  /* the projection of (2, 1, -1) is (1, 0, 0) */
+  val_t row[] = {2., 1., -1.};
+  admm_prox_lookup(SPLATT_CON_SIMPLEX)(row, 3, 1., 0.);
+  ASSERT_DBL_NEAR_TOL(1., row[0], 1e-12);
+  ASSERT_DBL_NEAR_TOL(0., row[1], 0.);
+  ASSERT_DBL_NEAR_TOL(0., row[2], 0.);
+
+  /* and of (0.5, 0.5, 0.5, -3) is (1/3, 1/3, 1/3, 0) */
+  val_t row2[] = {0.5, 0.5, 0.5, -3.};
+  admm_prox_lookup(SPLATT_CON_SIMPLEX)(row2, 4, 1., 0.);
+  for(idx_t f=0; f < 3; ++f) {
+    ASSERT_DBL_NEAR_TOL(1./3., row2[f], 1e-12);
+  }
+  ASSERT_DBL_NEAR_TOL(0., row2[3], 0.);
+}
+
+
+CTEST(admm, prox_rowsparse)
+{
+  /* ||row|| = 5 */
+  val_t row[] = {3., 4.};
+  admm_prox_lookup(SPLATT_CON_ROWSPARSE)(row, 2, 1., 2.5);
+  ASSERT_DBL_NEAR_TOL(1.5, row[0], 1e-12);
+  ASSERT_DBL_NEAR_TOL(2., row[1], 1e-12);
+
+  admm_prox_lookup(SPLATT_CON_ROWSPARSE)(row, 2, 1., 2.5);
+  ASSERT_DBL_NEAR_TOL(0., row[0], 0.);
+  ASSERT_DBL_NEAR_TOL(0., row[1], 0.);
+}
+
+
+CTEST_DATASETS(admm)
+
+
+CTEST_SETUP(admm)
+{
+  data->ntensors = test_read_datasets(data->tensors);
+  data->opts = test_default_opts(3);
+  data->opts[SPLATT_OPTION_NITER] = 10;
+}
+
+
+CTEST2(admm, nonneg)
+{
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    splatt_csf * csf = csf_alloc(tt, data->opts);
+
+    splatt_cpd_constraint cons[MAX_NMODES];
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      cons[m].type = SPLATT_CON_NONNEG;
+      cons[m].param = 0.;
+    }
+
+    splatt_kruskal factored;
+    int ret = splatt_cpd_constrained(csf, RANK, cons, data->opts, &factored);
+    ASSERT_EQUAL(SPLATT_SUCCESS, ret);
+    ASSERT_TRUE(factored.fit > 0.);
+    ASSERT_TRUE(factored.fit <= 1.);
+
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      for(idx_t x=0; x < tt->dims[m] * RANK; ++x) {
+        ASSERT_TRUE(factored.factors[m][x] >= 0.);
+      }
+    }
+    for(idx_t f=0; f < RANK; ++f) {
+      ASSERT_TRUE(factored.lambda[f] >= 0.);
+    }
+
+    splatt_free_kruskal(&factored);
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(admm, simplex)
+{
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    splatt_csf * csf = csf_alloc(tt, data->opts);
+
+    /* a simplex-constrained first mode, the others non-negative */
+    splatt_cpd_constraint cons[MAX_NMODES];
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      cons[m].type = (m == 0) ? SPLATT_CON_SIMPLEX : SPLATT_CON_NONNEG;
+      cons[m].param = 0.;
+    }
+
+    splatt_kruskal factored;
+    int ret = splatt_cpd_constrained(csf, RANK, cons, data->opts, &factored);
+    ASSERT_EQUAL(SPLATT_SUCCESS, ret);
+    ASSERT_TRUE(factored.fit > 0.);
+
+    for(idx_t r=0; r < tt->dims[0]; ++r) {
+      val_t sum = 0.;
+      for(idx_t f=0; f < RANK; ++f) {
+        val_t const v = factored.factors[0][f + (r*RANK)];
+        ASSERT_TRUE(v >= 0.);
+        sum += v;
+      }
+      ASSERT_DBL_NEAR_TOL(1., sum, 1e-10);
+    }
+
+    splatt_free_kruskal(&factored);
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(admm, unconstrained)
+{
+  /* SPLATT_CON_NONE everywhere is exactly CPD-ALS */
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    splatt_csf * csf = csf_alloc(tt, data->opts);
+
+    splatt_cpd_constraint cons[MAX_NMODES];
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      cons[m].type = SPLATT_CON_NONE;
+      cons[m].param = 0.;
+    }
+
+    splatt_kruskal gold;
+    splatt_kruskal factored;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_cpd_als(csf, RANK, data->opts, &gold));
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_cpd_constrained(csf, RANK, cons, data->opts, &factored));
+    ASSERT_DBL_NEAR_TOL(gold.fit, factored.fit, 1e-6);
+
+    splatt_free_kruskal(&gold);
+    splatt_free_kruskal(&factored);
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(admm, badinput)
+{
+  splatt_csf * csf = csf_alloc(data->tensors[0], data->opts);
+
+  splatt_cpd_constraint cons[MAX_NMODES];
+  for(idx_t m=0; m < csf->nmodes; ++m) {
+    cons[m].type = SPLATT_CON_NONE;
+    cons[m].param = 0.;
+  }
+  cons[0].type = SPLATT_CON_L1;
+  cons[0].param = -1.;
+
+  splatt_kruskal factored;
+  ASSERT_EQUAL(SPLATT_ERROR_BADINPUT,
+      splatt_cpd_constrained(csf, RANK, cons, data->opts, &factored));
+
+  csf_free(csf, data->opts);
+}
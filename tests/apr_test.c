@@ -0,0 +1,177 @@
+#include "../src/apr.h"
+#include "../src/csf.h"
+#include "../src/io.h"
+#include "../src/sptensor.h"
+#include "../src/util.h"
+
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+#include <math.h>
+
+
+CTEST_DATASETS(apr)
+
+
+CTEST_SETUP(apr)
+{
+  data->ntensors = test_read_datasets(data->tensors);
+  data->opts = test_default_opts(1);
+}
+
+
+CTEST2(apr, phi)
+{
+  idx_t const nfactors = 5;
+  splatt_csf_type const allocs[] = {SPLATT_CSF_ONEMODE, SPLATT_CSF_ALLMODE};
+  splatt_tile_type const tiles[] = {SPLATT_NOTILE, SPLATT_DENSETILE};
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    idx_t const nmodes = tt->nmodes;
+
+    matrix_t * mats[MAX_NMODES+1];
+    idx_t maxdim = 0;
+    for(idx_t m=0; m < nmodes; ++m) {
+      mats[m] = mat_rand(tt->dims[m], nfactors);
+      for(idx_t x=0; x < tt->dims[m] * nfactors; ++x) {
+        mats[m]->vals[x] = fabs(mats[m]->vals[x]);
+      }
+      maxdim = SS_MAX(maxdim, tt->dims[m]);
+    }
+    mats[MAX_NMODES] = mat_alloc(maxdim, nfactors);
+    val_t * gold = splatt_malloc(maxdim * nfactors * sizeof(*gold));
+    val_t row[5];
+
+    for(idx_t c=0; c < 2; ++c) {
+      data->opts[SPLATT_OPTION_CSF_ALLOC] = allocs[c];
+      data->opts[SPLATT_OPTION_TILE] = tiles[c];
+      splatt_csf * csf = csf_alloc(tt, data->opts);
+      apr_ws * ws = apr_ws_alloc(csf, nfactors, data->opts);
+
+      for(idx_t m=0; m < nmodes; ++m) {
+        /* Phi from the coordinate format */
+        memset(gold, 0, tt->dims[m] * nfactors * sizeof(*gold));
+        for(idx_t n=0; n < tt->nnz; ++n) {
+          for(idx_t f=0; f < nfactors; ++f) {
+            row[f] = 1.;
+          }
+          for(idx_t o=0; o < nmodes; ++o) {
+            if(o == m) {
+              continue;
+            }
+            val_t const * const orow = mats[o]->vals +
+                (tt->ind[o][n] * nfactors);
+            for(idx_t f=0; f < nfactors; ++f) {
+              row[f] *= orow[f];
+            }
+          }
+          val_t const * const brow = mats[m]->vals + (tt->ind[m][n] * nfactors);
+          val_t model = 0.;
+          for(idx_t f=0; f < nfactors; ++f) {
+            model += brow[f] * row[f];
+          }
+          val_t const ratio = tt->vals[n] / SS_MAX(model, APR_EPS);
+          val_t * const grow = gold + (tt->ind[m][n] * nfactors);
+          for(idx_t f=0; f < nfactors; ++f) {
+            grow[f] += ratio * row[f];
+          }
+        }
+
+        apr_phi(csf, m, mats, ws);
+        for(idx_t x=0; x < tt->dims[m] * nfactors; ++x) {
+          ASSERT_DBL_NEAR_TOL(gold[x], mats[MAX_NMODES]->vals[x],
+              1e-6 * fabs(gold[x]) + 1e-9);
+        }
+      }
+
+      apr_ws_free(ws);
+      csf_free(csf, data->opts);
+    }
+
+    splatt_free(gold);
+    for(idx_t m=0; m < nmodes; ++m) {
+      mat_free(mats[m]);
+    }
+    mat_free(mats[MAX_NMODES]);
+  }
+}
+
+
+CTEST2(apr, counts)
+{
+  idx_t const rank = 2;
+
+  /* expected counts of a non-negative model with unit weights, rounded */
+  idx_t const dims[3] = {12, 10, 8};
+  unsigned int seed = 3;
+  val_t * truth[3];
+  sptensor_t * tt = test_dense_lowrank(3, dims, rank, &seed, true, true,
+      truth);
+  splatt_csf * csf = csf_alloc(tt, data->opts);
+
+  data->opts[SPLATT_OPTION_NITER] = 200;
+  data->opts[SPLATT_OPTION_TOLERANCE] = 1e-4;
+
+  splatt_kruskal factored;
+  ASSERT_EQUAL(SPLATT_SUCCESS,
+      splatt_cpd_apr(csf, rank, data->opts, &factored));
+
+  /* stochastic factors, and the weights account for every count */
+  double total = 0.;
+  double weights = 0.;
+  for(idx_t n=0; n < tt->nnz; ++n) {
+    total += tt->vals[n];
+  }
+  for(idx_t f=0; f < rank; ++f) {
+    weights += factored.lambda[f];
+  }
+  ASSERT_DBL_NEAR_TOL(total, weights, 1e-3 * total);
+  for(idx_t m=0; m < 3; ++m) {
+    for(idx_t f=0; f < rank; ++f) {
+      double colsum = 0.;
+      for(idx_t i=0; i < tt->dims[m]; ++i) {
+        ASSERT_TRUE(factored.factors[m][f + (i*rank)] >= 0.);
+        colsum += factored.factors[m][f + (i*rank)];
+      }
+      ASSERT_DBL_NEAR_TOL(1., colsum, 1e-6);
+    }
+  }
+
+  /* the fitted model is at least as likely as the one which made the data */
+  double truth_ll = 0.;
+  for(idx_t n=0; n < tt->nnz; ++n) {
+    val_t m = 0.;
+    for(idx_t f=0; f < rank; ++f) {
+      m += truth[0][f + (tt->ind[0][n] * rank)] *
+          truth[1][f + (tt->ind[1][n] * rank)] *
+          truth[2][f + (tt->ind[2][n] * rank)];
+    }
+    if(tt->vals[n] > 0.) {
+      truth_ll += tt->vals[n] * log(m);
+    }
+    truth_ll -= m;
+  }
+  ASSERT_TRUE(factored.fit >= truth_ll - (1e-3 * fabs(truth_ll)));
+
+  splatt_free_kruskal(&factored);
+  for(idx_t m=0; m < 3; ++m) {
+    splatt_free(truth[m]);
+  }
+  csf_free(csf, data->opts);
+  tt_free(tt);
+}
+
+
+CTEST2(apr, badinput)
+{
+  sptensor_t * tt = data->tensors[0];
+  tt->vals[0] = -1.;
+  splatt_csf * csf = csf_alloc(tt, data->opts);
+
+  splatt_kruskal factored;
+  ASSERT_EQUAL(SPLATT_ERROR_BADINPUT,
+      splatt_cpd_apr(csf, 4, data->opts, &factored));
+
+  csf_free(csf, data->opts);
+}
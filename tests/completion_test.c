@@ -0,0 +1,167 @@
+#include "../src/completion.h"
+#include "../src/csf.h"
+#include "../src/sptensor.h"
+#include "../src/util.h"
+
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+#define NMODES 3
+#define RANK 2
+
+
+/**
+* @brief Sample 'nnz' entries of a random rank-RANK tensor. The model and the
+*        order of the samples only depend on the fixed seed, so 'offset'
+*        selects disjoint samples of the same tensor.
+*/
+static sptensor_t * p_sample_lowrank(
+    idx_t const * const dims,
+    idx_t const nnz,
+    idx_t const offset)
+{
+  unsigned int seed = 11;
+  sptensor_t * dense = test_dense_lowrank(NMODES, dims, RANK, &seed, false,
+      false, NULL);
+
+  /* visit the entries in a fixed pseudo-random order */
+  idx_t const total = dense->nnz;
+  idx_t * perm = splatt_malloc(total * sizeof(*perm));
+  for(idx_t x=0; x < total; ++x) {
+    perm[x] = x;
+  }
+  for(idx_t x=total; x-- > 1; ) {
+    idx_t const y = rand_r(&seed) % (x + 1);
+    idx_t const tmp = perm[x];
+    perm[x] = perm[y];
+    perm[y] = tmp;
+  }
+
+  sptensor_t * tt = tt_alloc(nnz, NMODES);
+  for(idx_t m=0; m < NMODES; ++m) {
+    tt->dims[m] = dims[m];
+  }
+  for(idx_t n=0; n < nnz; ++n) {
+    idx_t const x = perm[n + offset];
+    for(idx_t m=0; m < NMODES; ++m) {
+      tt->ind[m][n] = dense->ind[m][x];
+    }
+    /* as if each factor were scaled by 1/3, to keep the entries small */
+    tt->vals[n] = dense->vals[x] / 27.;
+  }
+
+  splatt_free(perm);
+  tt_free(dense);
+  return tt;
+}
+
+
+CTEST_DATA(completion)
+{
+  sptensor_t * train;
+  sptensor_t * validate;
+};
+
+
+CTEST_SETUP(completion)
+{
+  idx_t const dims[NMODES] = {20, 18, 16};
+  data->train = p_sample_lowrank(dims, 2000, 0);
+  data->validate = p_sample_lowrank(dims, 300, 2000);
+}
+
+
+CTEST_TEARDOWN(completion)
+{
+  tt_free(data->train);
+  tt_free(data->validate);
+}
+
+
+static void p_check_alg(
+    sptensor_t * const train_tt,
+    sptensor_t * const val_tt,
+    splatt_tc_type const which,
+    splatt_csf_type const alloc,
+    idx_t const nthreads,
+    double const max_rmse)
+{
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_CSF_ALLOC] = alloc;
+  opts[SPLATT_OPTION_NTHREADS] = nthreads;
+  opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+  opts[SPLATT_OPTION_RANDSEED] = 5;
+  opts[SPLATT_OPTION_REGULARIZE] = 1e-5;
+  opts[SPLATT_OPTION_LEARNRATE] = 0.01;
+  opts[SPLATT_OPTION_NITER] = 400;
+  opts[SPLATT_OPTION_TOLERANCE] = 1e-7;
+
+  splatt_csf * train = csf_alloc(train_tt, opts);
+  double * val_opts = splatt_default_opts();
+  val_opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+  splatt_csf * validate = csf_alloc(val_tt, val_opts);
+
+  splatt_kruskal factored;
+  ASSERT_EQUAL(SPLATT_SUCCESS, splatt_tc(train, validate, RANK, which, opts,
+      &factored));
+  ASSERT_TRUE(factored.fit < max_rmse);
+
+  /* the reported RMSE is that of the returned factors */
+  matrix_t * mats[NMODES];
+  for(idx_t m=0; m < NMODES; ++m) {
+    mats[m] = mat_alloc(0, RANK);
+    free(mats[m]->vals);
+    mats[m]->I = factored.dims[m];
+    mats[m]->vals = factored.factors[m];
+  }
+  ASSERT_DBL_NEAR_TOL(factored.fit, tc_rmse(validate, mats, 2), 1e-6);
+  for(idx_t m=0; m < NMODES; ++m) {
+    free(mats[m]);
+  }
+
+  splatt_free_kruskal(&factored);
+  csf_free(validate, val_opts);
+  csf_free(train, opts);
+  splatt_free_opts(val_opts);
+  splatt_free_opts(opts);
+}
+
+
+CTEST2(completion, als)
+{
+  p_check_alg(data->train, data->validate, SPLATT_TC_ALS, SPLATT_CSF_ALLMODE,
+      3, 1e-2);
+}
+
+
+CTEST2(completion, ccd)
+{
+  p_check_alg(data->train, data->validate, SPLATT_TC_CCD, SPLATT_CSF_ALLMODE,
+      3, 1e-2);
+}
+
+
+CTEST2(completion, sgd)
+{
+  /* serial, and with unsynchronized concurrent updates */
+  p_check_alg(data->train, data->validate, SPLATT_TC_SGD, SPLATT_CSF_ONEMODE,
+      1, 1e-2);
+  p_check_alg(data->train, data->validate, SPLATT_TC_SGD, SPLATT_CSF_ONEMODE,
+      3, 1e-2);
+}
+
+
+CTEST2(completion, badinput)
+{
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+  splatt_csf * train = csf_alloc(data->train, opts);
+
+  /* ALS needs a tree rooted at every mode */
+  splatt_kruskal factored;
+  ASSERT_EQUAL(SPLATT_ERROR_BADINPUT, splatt_tc(train, NULL, RANK,
+      SPLATT_TC_ALS, opts, &factored));
+
+  csf_free(train, opts);
+  splatt_free_opts(opts);
+}
@@ -0,0 +1,132 @@
+#include "../src/cpd.h"
+#include "../src/csf.h"
+#include "../src/io.h"
+#include "../src/sptensor.h"
+#include "../src/util.h"
+
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+#include <pthread.h>
+
+#define NJOBS 4
+
+
+/**
+* @brief One decomposition, as run by a single application thread.
+*/
+typedef struct
+{
+  splatt_csf * csf;
+  double * opts;
+  idx_t rank;
+  int ret;
+  double fit;
+} p_cpd_job;
+
+
+static void * p_run_job(
+    void * arg)
+{
+  p_cpd_job * const job = arg;
+  splatt_kruskal factored;
+  job->ret = splatt_cpd_als(job->csf, job->rank, job->opts, &factored);
+  if(job->ret == SPLATT_SUCCESS) {
+    job->fit = factored.fit;
+    splatt_free_kruskal(&factored);
+  }
+  return NULL;
+}
+
+
+CTEST(cpd, concurrent_als)
+{
+  /* different tensors and lock types, so jobs would share any global pool */
+  splatt_sync_type const syncs[NJOBS] = {
+      SPLATT_SYNC_LOCK, SPLATT_SYNC_SPIN, SPLATT_SYNC_ATOMIC, SPLATT_SYNC_LOCK};
+
+  sptensor_t * tts[NJOBS];
+  p_cpd_job jobs[NJOBS];
+  double gold[NJOBS];
+  for(idx_t j=0; j < NJOBS; ++j) {
+    tts[j] = tt_read(datasets[j]);
+    double * opts = splatt_default_opts();
+    opts[SPLATT_OPTION_NTHREADS] = 2;
+    opts[SPLATT_OPTION_NITER] = 5;
+    opts[SPLATT_OPTION_TOLERANCE] = 0.;
+    opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+    opts[SPLATT_OPTION_RANDSEED] = j + 1;
+    opts[SPLATT_OPTION_SYNC] = syncs[j];
+
+    jobs[j].csf = csf_alloc(tts[j], opts);
+    jobs[j].opts = opts;
+    jobs[j].rank = 4 + j;
+
+    /* one at a time for reference */
+    p_run_job(jobs + j);
+    ASSERT_EQUAL(SPLATT_SUCCESS, jobs[j].ret);
+    gold[j] = jobs[j].fit;
+  }
+
+  for(idx_t rep=0; rep < 3; ++rep) {
+    pthread_t threads[NJOBS];
+    for(idx_t j=0; j < NJOBS; ++j) {
+      jobs[j].ret = SPLATT_ERROR_BADINPUT;
+      ASSERT_EQUAL(0, pthread_create(threads + j, NULL, p_run_job, jobs + j));
+    }
+    for(idx_t j=0; j < NJOBS; ++j) {
+      ASSERT_EQUAL(0, pthread_join(threads[j], NULL));
+    }
+
+    /* the order of shared-row updates may vary, but nothing else */
+    for(idx_t j=0; j < NJOBS; ++j) {
+      ASSERT_EQUAL(SPLATT_SUCCESS, jobs[j].ret);
+      ASSERT_DBL_NEAR_TOL(gold[j], jobs[j].fit, 1e-6);
+    }
+  }
+
+  for(idx_t j=0; j < NJOBS; ++j) {
+    csf_free(jobs[j].csf, jobs[j].opts);
+    splatt_free_opts(jobs[j].opts);
+    tt_free(tts[j]);
+  }
+}
+
+
+CTEST(cpd, line_search)
+{
+  /* positive factors have correlated columns, so ALS converges slowly */
+  idx_t const dims[3] = {20, 15, 10};
+  unsigned int gen_seed = 7;
+  sptensor_t * tt = test_dense_lowrank(3, dims, 3, &gen_seed, true, false,
+      NULL);
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS] = 2;
+  opts[SPLATT_OPTION_NITER] = 40;
+  opts[SPLATT_OPTION_TOLERANCE] = 0.;
+  opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+  splatt_csf * csf = csf_alloc(tt, opts);
+
+  for(int run_seed=1; run_seed <= 3; ++run_seed) {
+    opts[SPLATT_OPTION_RANDSEED] = run_seed;
+
+    splatt_kruskal plain;
+    opts[SPLATT_OPTION_LINESEARCH] = 0;
+    ASSERT_EQUAL(SPLATT_SUCCESS, splatt_cpd_als(csf, 3, opts, &plain));
+
+    splatt_kruskal accel;
+    opts[SPLATT_OPTION_LINESEARCH] = 2;
+    ASSERT_EQUAL(SPLATT_SUCCESS, splatt_cpd_als(csf, 3, opts, &accel));
+
+    /* extrapolation must get further in the same number of iterations */
+    ASSERT_TRUE(accel.fit <= 1.);
+    ASSERT_TRUE(accel.fit > plain.fit);
+
+    splatt_free_kruskal(&plain);
+    splatt_free_kruskal(&accel);
+  }
+
+  csf_free(csf, opts);
+  splatt_free_opts(opts);
+  tt_free(tt);
+}
@@ -201,3 +201,51 @@ CTEST2(csf_one_init, dense_tiled_normsq)
     ASSERT_DBL_NEAR_TOL(gold_norm, mynorm, 1e-5);
   }
 }
+
+
+CTEST2(csf_one_init, numa_first_touch)
+{
+  int const tiles[] = {SPLATT_NOTILE, SPLATT_DENSETILE};
+  data->opts[SPLATT_OPTION_NTHREADS] = 7;
+
+  for(idx_t i=0; i < sizeof(tiles) / sizeof(tiles[0]); ++i) {
+    data->opts[SPLATT_OPTION_TILE] = tiles[i];
+    data->opts[SPLATT_OPTION_NUMA] = 0;
+    splatt_csf * gold = csf_alloc(data->tt, data->opts);
+    data->opts[SPLATT_OPTION_NUMA] = 1;
+    splatt_csf * cs = csf_alloc(data->tt, data->opts);
+
+    /* placement must not change the contents */
+    ASSERT_EQUAL(gold->ntiles, cs->ntiles);
+    idx_t const nmodes = cs->nmodes;
+    for(idx_t t=0; t < cs->ntiles; ++t) {
+      csf_sparsity const * const gpt = gold->pt + t;
+      csf_sparsity const * const pt = cs->pt + t;
+      for(idx_t d=0; d < nmodes; ++d) {
+        ASSERT_EQUAL(gpt->nfibs[d], pt->nfibs[d]);
+        if(gpt->fids[d] == NULL) {
+          ASSERT_NULL(pt->fids[d]);
+          continue;
+        }
+        for(idx_t f=0; f < pt->nfibs[d]; ++f) {
+          ASSERT_EQUAL(gpt->fids[d][f], pt->fids[d][f]);
+        }
+      }
+      for(idx_t d=0; d < nmodes-1; ++d) {
+        if(gpt->fptr[d] == NULL) {
+          ASSERT_NULL(pt->fptr[d]);
+          continue;
+        }
+        for(idx_t f=0; f <= pt->nfibs[d]; ++f) {
+          ASSERT_EQUAL(gpt->fptr[d][f], pt->fptr[d][f]);
+        }
+      }
+      for(idx_t n=0; n < pt->nfibs[nmodes-1]; ++n) {
+        ASSERT_DBL_NEAR_TOL(gpt->vals[n], pt->vals[n], 0);
+      }
+    }
+
+    csf_free(cs, data->opts);
+    csf_free(gold, data->opts);
+  }
+}
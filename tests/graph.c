@@ -38,6 +38,11 @@ CTEST2(graph, graph_convert)
   for(idx_t i=0; i < data->ntensors; ++i) {
     sptensor_t * const tt = data->tensors[i];
 
+    /* not every dataset ships with a gold graph */
+    if(access(graphs[i], R_OK) != 0) {
+      continue;
+    }
+
     splatt_graph * graph = graph_convert(tt);
 
     /* count vtxs */
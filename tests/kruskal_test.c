@@ -0,0 +1,155 @@
+#include "../src/kruskal.h"
+#include "../src/csf.h"
+#include "../src/io.h"
+#include "../src/util.h"
+
+#include <math.h>
+
+#include "ctest/ctest.h"
+
+#include "splatt_test.h"
+
+
+/**
+* @brief Evaluate the model at the leaves below a CSF node by gathering one
+*        row per mode, in leaf order.
+*/
+static void p_naive_values(
+    splatt_csf const * const csf,
+    csf_sparsity const * const pt,
+    idx_t const level,
+    idx_t const node,
+    idx_t * const coord,
+    matrix_t ** mats,
+    val_t const * const lambda,
+    val_t * const out)
+{
+  idx_t const nmodes = csf->nmodes;
+  idx_t const * const fids = pt->fids[level];
+  coord[csf_depth_to_mode(csf, level)] = (fids == NULL) ? node : fids[node];
+
+  if(level == nmodes - 1) {
+    idx_t const nfactors = mats[0]->J;
+    val_t v = 0;
+    for(idx_t f=0; f < nfactors; ++f) {
+      val_t prod = lambda[f];
+      for(idx_t m=0; m < nmodes; ++m) {
+        prod *= mats[m]->vals[f + (coord[m] * nfactors)];
+      }
+      v += prod;
+    }
+    out[node] = v;
+    return;
+  }
+
+  for(idx_t c=pt->fptr[level][node]; c < pt->fptr[level][node+1]; ++c) {
+    p_naive_values(csf, pt, level+1, c, coord, mats, lambda, out);
+  }
+}
+
+
+CTEST_DATA(kruskal)
+{
+  idx_t ntensors;
+  sptensor_t * tensors[MAX_DSETS];
+};
+
+
+CTEST_SETUP(kruskal)
+{
+  data->ntensors = sizeof(datasets) / sizeof(datasets[0]);
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    data->tensors[i] = tt_read(datasets[i]);
+  }
+}
+
+
+CTEST_TEARDOWN(kruskal)
+{
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    tt_free(data->tensors[i]);
+  }
+}
+
+
+CTEST2(kruskal, csf_values)
+{
+  idx_t const nfactors = 7;
+  splatt_tile_type const tiles[] = {SPLATT_NOTILE, SPLATT_DENSETILE};
+  idx_t const threads[] = {1, 3};
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+
+    matrix_t * mats[MAX_NMODES];
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      mats[m] = mat_rand(tt->dims[m], nfactors);
+    }
+    val_t lambda[7];
+    for(idx_t f=0; f < nfactors; ++f) {
+      lambda[f] = 1. + (val_t) f;
+    }
+
+    val_t * gold = splatt_malloc(tt->nnz * sizeof(*gold));
+    val_t * values = splatt_malloc(tt->nnz * sizeof(*values));
+
+    for(idx_t c=0; c < 2; ++c) {
+      double * opts = splatt_default_opts();
+      opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+      opts[SPLATT_OPTION_TILE] = tiles[c];
+      splatt_csf * csf = csf_alloc(tt, opts);
+
+      for(idx_t t=0; t < csf->ntiles; ++t) {
+        csf_sparsity const * const pt = csf->pt + t;
+        if(pt->vals == NULL) {
+          continue;
+        }
+        idx_t coord[MAX_NMODES];
+        val_t * const out = gold + kruskal_csf_leaf_offset(csf, t);
+        for(idx_t s=0; s < pt->nfibs[0]; ++s) {
+          p_naive_values(csf, pt, 0, s, coord, mats, lambda, out);
+        }
+      }
+
+      kruskal_csf_values(csf, mats, lambda, values, threads[c]);
+      for(idx_t x=0; x < tt->nnz; ++x) {
+        ASSERT_DBL_NEAR_TOL(gold[x], values[x], 1e-5 * fabs(gold[x]) + 1e-9);
+      }
+
+      csf_free(csf, opts);
+      splatt_free_opts(opts);
+    }
+
+    splatt_free(gold);
+    splatt_free(values);
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      mat_free(mats[m]);
+    }
+  }
+}
+
+
+CTEST(kruskal, api_badinput)
+{
+  sptensor_t * tt = tt_read(DATASET(small.tns));
+  double * opts = splatt_default_opts();
+  splatt_csf * csf = csf_alloc(tt, opts);
+
+  splatt_kruskal factored;
+  factored.nmodes = tt->nmodes;
+  factored.rank = 2;
+  factored.lambda = NULL;
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    factored.dims[m] = tt->dims[m] + 1;
+    factored.factors[m] = NULL;
+  }
+
+  val_t * values = splatt_malloc(tt->nnz * sizeof(*values));
+  ASSERT_EQUAL(SPLATT_ERROR_BADINPUT,
+      splatt_kruskal_values(csf, &factored, opts, values));
+  splatt_free(values);
+
+  csf_free(csf, opts);
+  splatt_free_opts(opts);
+  tt_free(tt);
+}
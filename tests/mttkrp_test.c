@@ -3,9 +3,15 @@
 #include "../src/ftensor.h"
 #include "../src/csf.h"
 #include "../src/thd_info.h"
+#include "../src/simd.h"
+#include "../src/util.h"
+#include "../src/hicoo.h"
+#include "../src/lintensor.h"
 
 #include "../src/io.h"
 
+#include <math.h>
+
 #include "ctest/ctest.h"
 
 #include "splatt_test.h"
@@ -258,3 +264,963 @@ CTEST2(mttkrp, csf_two_densetile_alldepth)
   }
 }
 
+
+
+CTEST2(mttkrp, csf_atomic)
+{
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS]   = 7;
+  opts[SPLATT_OPTION_SYNC]       = SPLATT_SYNC_ATOMIC;
+  /* never privatize, so every shared row goes through the atomics */
+  opts[SPLATT_OPTION_PRIVTHRESH] = 0.;
+  opts[SPLATT_OPTION_SPARSE_PRIVTHRESH] = 0.;
+
+  splatt_csf_type const allocs[] = {
+    SPLATT_CSF_ONEMODE, SPLATT_CSF_TWOMODE, SPLATT_CSF_ALLMODE
+  };
+  for(idx_t i=0; i < sizeof(allocs) / sizeof(allocs[0]); ++i) {
+    opts[SPLATT_OPTION_CSF_ALLOC] = allocs[i];
+
+    opts[SPLATT_OPTION_TILE]      = SPLATT_NOTILE;
+    opts[SPLATT_OPTION_TILELEVEL] = 0;
+    p_csf_mttkrp(opts, data->tensors, data->ntensors, data->mats, data->gold,
+        data->nfactors);
+
+    opts[SPLATT_OPTION_TILE]      = SPLATT_DENSETILE;
+    opts[SPLATT_OPTION_TILELEVEL] = 1;
+    p_csf_mttkrp(opts, data->tensors, data->ntensors, data->mats, data->gold,
+        data->nfactors);
+  }
+
+  splatt_free_opts(opts);
+}
+
+
+/* The index of the first nonzero under a node at 'depth' of a CSF tree. */
+static idx_t p_node_to_nnz(
+    csf_sparsity const * const pt,
+    idx_t const nmodes,
+    idx_t const depth,
+    idx_t node)
+{
+  for(idx_t d=depth; d < nmodes-1; ++d) {
+    node = pt->fptr[d][node];
+  }
+  return node;
+}
+
+
+CTEST2(mttkrp, csf_split_slices)
+{
+  /* enough threads that some slices hold more than a fair share of nnz */
+  idx_t const nthreads = 31;
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS]   = nthreads;
+  opts[SPLATT_OPTION_CSF_ALLOC]  = SPLATT_CSF_ALLMODE;
+  opts[SPLATT_OPTION_TILE]       = SPLATT_NOTILE;
+  opts[SPLATT_OPTION_PRIVTHRESH] = 0.;
+  opts[SPLATT_OPTION_SPARSE_PRIVTHRESH] = 0.;
+
+  idx_t nsplit = 0;
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    splatt_csf * cs = splatt_csf_alloc(tt, opts);
+    splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(cs, data->nfactors, opts);
+
+    for(idx_t c=0; c < ws->num_csf; ++c) {
+      csf_sparsity const * const pt = &(cs[c].pt[0]);
+      idx_t const * const parts = ws->tree_partition[c];
+      ASSERT_NOT_NULL(parts);
+      ASSERT_EQUAL(0, parts[0]);
+      ASSERT_EQUAL(pt->nfibs[1], parts[nthreads]);
+      ASSERT_TRUE(ws->tree_imbalance[c] >= 1.);
+
+      /* never worse than balancing whole slices */
+      idx_t * slice_parts = csf_partition_1d(&(cs[c]), 0, nthreads);
+      idx_t slice_bneck = 0;
+      idx_t split_bneck = 0;
+      for(idx_t t=0; t < nthreads; ++t) {
+        ASSERT_TRUE(parts[t] <= parts[t+1]);
+        slice_bneck = SS_MAX(slice_bneck,
+            p_node_to_nnz(pt, tt->nmodes, 0, slice_parts[t+1]) -
+            p_node_to_nnz(pt, tt->nmodes, 0, slice_parts[t]));
+        split_bneck = SS_MAX(split_bneck,
+            p_node_to_nnz(pt, tt->nmodes, 1, parts[t+1]) -
+            p_node_to_nnz(pt, tt->nmodes, 1, parts[t]));
+      }
+      splatt_free(slice_parts);
+      ASSERT_TRUE(split_bneck <= slice_bneck);
+      ASSERT_DBL_NEAR_TOL((double) (split_bneck * nthreads) / (double) tt->nnz,
+          ws->tree_imbalance[c], 1e-12);
+
+      /* count boundaries which are not at the start of a slice */
+      for(idx_t t=1; t < nthreads; ++t) {
+        bool at_slice = false;
+        for(idx_t sl=0; sl <= pt->nfibs[0]; ++sl) {
+          if(pt->fptr[0][sl] == parts[t]) {
+            at_slice = true;
+          }
+        }
+        if(!at_slice) {
+          ++nsplit;
+        }
+      }
+    }
+    splatt_mttkrp_free_ws(ws);
+    csf_free(cs, opts);
+  }
+
+  ASSERT_TRUE(nsplit > 0);
+
+  /* every synchronization type must merge the partial rows */
+  opts[SPLATT_OPTION_SYNC] = SPLATT_SYNC_LOCK;
+  p_csf_mttkrp(opts, data->tensors, data->ntensors, data->mats, data->gold,
+      data->nfactors);
+  opts[SPLATT_OPTION_SYNC] = SPLATT_SYNC_SPIN;
+  p_csf_mttkrp(opts, data->tensors, data->ntensors, data->mats, data->gold,
+      data->nfactors);
+  opts[SPLATT_OPTION_SYNC] = SPLATT_SYNC_ATOMIC;
+  p_csf_mttkrp(opts, data->tensors, data->ntensors, data->mats, data->gold,
+      data->nfactors);
+
+  /* and so must privatization */
+  opts[SPLATT_OPTION_PRIVTHRESH] = 1e9;
+  p_csf_mttkrp(opts, data->tensors, data->ntensors, data->mats, data->gold,
+      data->nfactors);
+
+  splatt_free_opts(opts);
+}
+
+
+CTEST2(mttkrp, csf_sparse_privatization)
+{
+  idx_t const nthreads = 7;
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS]   = nthreads;
+  opts[SPLATT_OPTION_CSF_ALLOC]  = SPLATT_CSF_TWOMODE;
+  opts[SPLATT_OPTION_TILE]       = SPLATT_NOTILE;
+  /* only allow sparse privatization (or its synchronized fallback) */
+  opts[SPLATT_OPTION_PRIVTHRESH] = 0.;
+  opts[SPLATT_OPTION_SPARSE_PRIVTHRESH] = 1e9;
+
+  idx_t nsparse = 0;
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    matrix_t ** mats = data->mats[i];
+    splatt_csf * cs = splatt_csf_alloc(tt, opts);
+    thd_info * thds = thd_init(nthreads, 3,
+      (tt->nmodes * data->nfactors * sizeof(val_t)) + 64,
+      0,
+      (tt->nmodes * data->nfactors * sizeof(val_t)) + 64);
+
+    /* one workspace for all modes, twice, so buffers must stay clean */
+    splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(cs, data->nfactors, opts);
+    for(idx_t it=0; it < 2; ++it) {
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        ASSERT_TRUE(ws->priv_type[m] != SPLATT_PRIV_DENSE);
+        if(ws->priv_type[m] == SPLATT_PRIV_SPARSE) {
+          ++nsparse;
+        }
+
+        mats[MAX_NMODES]->I = tt->dims[m];
+        data->gold[i]->I = tt->dims[m];
+        mttkrp_stream(tt, mats, m);
+
+        matrix_t * tmp = mats[MAX_NMODES];
+        mats[MAX_NMODES] = data->gold[i];
+        data->gold[i] = tmp;
+
+        mttkrp_csf(cs, mats, m, thds, ws, opts);
+        __compare_mats(mats[MAX_NMODES], data->gold[i]);
+      }
+    }
+    splatt_mttkrp_free_ws(ws);
+    thd_free(thds, nthreads);
+    csf_free(cs, opts);
+  }
+
+  ASSERT_TRUE(nsparse > 0);
+  splatt_free_opts(opts);
+}
+
+
+CTEST2(mttkrp, csf_memo)
+{
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+  opts[SPLATT_OPTION_TILE]      = SPLATT_NOTILE;
+
+  /* {nthreads, levels, privatize} */
+  double const configs[][3] = {
+    {7, 1e9, 0.},
+    {7, 1, 1e9},
+    {1, 2, 0.},
+  };
+
+  for(idx_t c=0; c < sizeof(configs) / sizeof(configs[0]); ++c) {
+    idx_t const nthreads = configs[c][0];
+    opts[SPLATT_OPTION_NTHREADS]   = nthreads;
+    opts[SPLATT_OPTION_MEMOIZE]    = configs[c][1];
+    opts[SPLATT_OPTION_PRIVTHRESH] = configs[c][2];
+
+    for(idx_t i=0; i < data->ntensors; ++i) {
+      sptensor_t * const tt = data->tensors[i];
+      idx_t const nmodes = tt->nmodes;
+      matrix_t ** mats = data->mats[i];
+      splatt_csf * cs = splatt_csf_alloc(tt, opts);
+      thd_info * thds = thd_init(nthreads, 3,
+        (nmodes * data->nfactors * sizeof(val_t)) + 64,
+        0,
+        (nmodes * data->nfactors * sizeof(val_t)) + 64);
+
+      splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(cs, data->nfactors, opts);
+      ASSERT_EQUAL(SS_MIN((idx_t) configs[c][1], nmodes - 2),
+          ws->memo_levels);
+
+      /* two sweeps in tree order, then one in reverse to use the fallback */
+      for(idx_t it=0; it < 3; ++it) {
+        for(idx_t d=0; d < nmodes; ++d) {
+          idx_t const depth = (it < 2) ? d : nmodes - d - 1;
+          idx_t const m = csf_depth_to_mode(cs, depth);
+
+          mats[MAX_NMODES]->I = tt->dims[m];
+          data->gold[i]->I = tt->dims[m];
+          mttkrp_stream(tt, mats, m);
+
+          matrix_t * tmp = mats[MAX_NMODES];
+          mats[MAX_NMODES] = data->gold[i];
+          data->gold[i] = tmp;
+
+          mttkrp_csf(cs, mats, m, thds, ws, opts);
+          __compare_mats(mats[MAX_NMODES], data->gold[i]);
+        }
+      }
+      splatt_mttkrp_free_ws(ws);
+      thd_free(thds, nthreads);
+      csf_free(cs, opts);
+    }
+  }
+
+  splatt_free_opts(opts);
+}
+
+
+CTEST2(mttkrp, csf_memo_update)
+{
+  idx_t const nthreads = 7;
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS]  = nthreads;
+  opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+  opts[SPLATT_OPTION_TILE]      = SPLATT_NOTILE;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    idx_t const nmodes = tt->nmodes;
+    matrix_t ** mats = data->mats[i];
+    splatt_csf * cs = splatt_csf_alloc(tt, opts);
+    thd_info * thds = thd_init(nthreads, 3,
+      (nmodes * data->nfactors * sizeof(val_t)) + 64,
+      0,
+      (nmodes * data->nfactors * sizeof(val_t)) + 64);
+
+    opts[SPLATT_OPTION_MEMOIZE] = 1e9;
+    splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(cs, data->nfactors, opts);
+    opts[SPLATT_OPTION_MEMOIZE] = 0;
+    splatt_mttkrp_ws * gold_ws = splatt_mttkrp_alloc_ws(cs, data->nfactors,
+        opts);
+
+    /* sweeps in tree order, updating factors as CPD-ALS does */
+    for(idx_t it=0; it < 3; ++it) {
+      /* between sweeps, every factor may change */
+      for(idx_t m=0; m < nmodes; ++m) {
+        for(idx_t x=0; x < mats[m]->I * mats[m]->J; ++x) {
+          mats[m]->vals[x] = (0.5 * mats[m]->vals[x]) + 0.25;
+        }
+      }
+
+      for(idx_t d=0; d < nmodes; ++d) {
+        idx_t const m = csf_depth_to_mode(cs, d);
+
+        matrix_t * out = mats[MAX_NMODES];
+        mats[MAX_NMODES] = data->gold[i];
+        mats[MAX_NMODES]->I = tt->dims[m];
+        mttkrp_csf(cs, mats, m, thds, gold_ws, opts);
+        mats[MAX_NMODES] = out;
+        mats[MAX_NMODES]->I = tt->dims[m];
+        mttkrp_csf(cs, mats, m, thds, ws, opts);
+        __compare_mats(mats[MAX_NMODES], data->gold[i]);
+
+        /* the factor of the mode just computed is updated */
+        for(idx_t x=0; x < mats[m]->I * mats[m]->J; ++x) {
+          mats[m]->vals[x] = (0.5 * mats[m]->vals[x]) + 0.1;
+        }
+      }
+    }
+
+    splatt_mttkrp_free_ws(gold_ws);
+    splatt_mttkrp_free_ws(ws);
+    thd_free(thds, nthreads);
+    csf_free(cs, opts);
+  }
+
+  splatt_free_opts(opts);
+}
+
+
+CTEST2(mttkrp, batch)
+{
+  idx_t const nsets = 3;
+  idx_t const ncolumns[] = {3, 5, 16};
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS] = 7;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    idx_t const nmodes = tt->nmodes;
+    idx_t maxdim = 0;
+    for(idx_t m=0; m < nmodes; ++m) {
+      maxdim = SS_MAX(tt->dims[m], maxdim);
+    }
+
+    matrix_t * mats[3][MAX_NMODES+1];
+    matrix_t * outs[3];
+    val_t ** matvals[3];
+    val_t * outvals[3];
+    for(idx_t s=0; s < nsets; ++s) {
+      matvals[s] = splatt_malloc(nmodes * sizeof(**matvals));
+      for(idx_t m=0; m < nmodes; ++m) {
+        mats[s][m] = mat_rand(tt->dims[m], ncolumns[s]);
+        matvals[s][m] = mats[s][m]->vals;
+      }
+      mats[s][MAX_NMODES] = mat_alloc(maxdim, ncolumns[s]);
+      outs[s] = mat_alloc(maxdim, ncolumns[s]);
+      outvals[s] = outs[s]->vals;
+    }
+
+    splatt_csf * cs = splatt_csf_alloc(tt, opts);
+    for(idx_t m=0; m < nmodes; ++m) {
+      int const ret = splatt_mttkrp_batch(m, nsets, ncolumns, cs, matvals,
+          outvals, opts);
+      ASSERT_EQUAL(SPLATT_SUCCESS, ret);
+
+      for(idx_t s=0; s < nsets; ++s) {
+        mats[s][MAX_NMODES]->I = tt->dims[m];
+        outs[s]->I = tt->dims[m];
+        mttkrp_stream(tt, mats[s], m);
+        __compare_mats(outs[s], mats[s][MAX_NMODES]);
+      }
+    }
+    csf_free(cs, opts);
+
+    for(idx_t s=0; s < nsets; ++s) {
+      for(idx_t m=0; m < nmodes; ++m) {
+        mat_free(mats[s][m]);
+      }
+      mat_free(mats[s][MAX_NMODES]);
+      mat_free(outs[s]);
+      splatt_free(matvals[s]);
+    }
+  }
+
+  splatt_free_opts(opts);
+}
+
+
+/*
+ * Mixed precision
+ */
+
+/* Relative Frobenius error of A with respect to B. */
+static double p_rel_error(
+  matrix_t const * const A,
+  matrix_t const * const B)
+{
+  double diff = 0.;
+  double norm = 0.;
+  for(idx_t x=0; x < A->I * A->J; ++x) {
+    double const d = A->vals[x] - B->vals[x];
+    diff += d * d;
+    norm += B->vals[x] * B->vals[x];
+  }
+  return (norm > 0.) ? sqrt(diff / norm) : sqrt(diff);
+}
+
+
+CTEST2(mttkrp, mixed_precision)
+{
+  splatt_precision_type const precs[] = {
+      SPLATT_PREC_FP32, SPLATT_PREC_BF16, SPLATT_PREC_FP16};
+  /* a few units in the last place, summed over the factor rows */
+  double const tols[] = {1e-6, 2e-2, 3e-3};
+
+  /* {csf alloc, tiling} */
+  splatt_csf_type const allocs[] = {SPLATT_CSF_ALLMODE, SPLATT_CSF_ONEMODE};
+  splatt_tile_type const tiles[] = {SPLATT_NOTILE, SPLATT_DENSETILE};
+
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS] = 7;
+
+  for(idx_t p=0; p < 3; ++p) {
+    opts[SPLATT_OPTION_PRECISION] = precs[p];
+    for(idx_t c=0; c < 2; ++c) {
+      opts[SPLATT_OPTION_CSF_ALLOC] = allocs[c];
+      opts[SPLATT_OPTION_TILE] = tiles[c];
+
+      for(idx_t i=0; i < data->ntensors; ++i) {
+        sptensor_t * const tt = data->tensors[i];
+        matrix_t ** mats = data->mats[i];
+        splatt_csf * cs = splatt_csf_alloc(tt, opts);
+        thd_info * thds = thd_init(7, 3,
+          (tt->nmodes * data->nfactors * sizeof(val_t)) + 64,
+          0,
+          (tt->nmodes * data->nfactors * sizeof(val_t)) + 64);
+        splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(cs, data->nfactors,
+            opts);
+
+        for(idx_t m=0; m < tt->nmodes; ++m) {
+          mats[MAX_NMODES]->I = tt->dims[m];
+          data->gold[i]->I = tt->dims[m];
+          mttkrp_stream(tt, mats, m);
+
+          matrix_t * tmp = mats[MAX_NMODES];
+          mats[MAX_NMODES] = data->gold[i];
+          data->gold[i] = tmp;
+
+          mttkrp_csf(cs, mats, m, thds, ws, opts);
+          double const err = p_rel_error(mats[MAX_NMODES], data->gold[i]);
+          ASSERT_TRUE(err <= tols[p]);
+        }
+        splatt_mttkrp_free_ws(ws);
+        thd_free(thds, 7);
+        csf_free(cs, opts);
+      }
+    }
+  }
+
+  splatt_free_opts(opts);
+}
+
+
+CTEST(mttkrp, mixed_precision_fit)
+{
+  /* a dense tensor with exact rank 3 */
+  idx_t const dims[] = {12, 10, 8};
+  idx_t const rank = 3;
+  unsigned int seed = 1;
+  sptensor_t * tt = test_dense_lowrank(3, dims, rank, &seed, false, false,
+      NULL);
+
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS] = 3;
+  opts[SPLATT_OPTION_RANDSEED] = 1;
+  opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+  opts[SPLATT_OPTION_NITER] = 100;
+  opts[SPLATT_OPTION_TOLERANCE] = 1e-8;
+  splatt_csf * cs = splatt_csf_alloc(tt, opts);
+
+  splatt_precision_type const precs[] = {
+      SPLATT_PREC_FULL, SPLATT_PREC_FP32, SPLATT_PREC_BF16, SPLATT_PREC_FP16};
+  double fits[4];
+  for(idx_t p=0; p < 4; ++p) {
+    opts[SPLATT_OPTION_PRECISION] = precs[p];
+    splatt_kruskal factored;
+    ASSERT_EQUAL(SPLATT_SUCCESS, splatt_cpd_als(cs, rank, opts, &factored));
+    fits[p] = factored.fit;
+    splatt_free_kruskal(&factored);
+  }
+
+  /* reduced precision should cost at most a little fit */
+  ASSERT_TRUE(fits[0] > 0.99);
+  ASSERT_DBL_NEAR_TOL(fits[0], fits[1], 1e-5);
+  ASSERT_DBL_NEAR_TOL(fits[0], fits[2], 1e-2);
+  ASSERT_DBL_NEAR_TOL(fits[0], fits[3], 1e-3);
+
+  csf_free(cs, opts);
+  splatt_free_opts(opts);
+  tt_free(tt);
+}
+
+
+/*
+ * Rank-specialized and SIMD kernels
+ */
+
+/* Run p_csf_mttkrp() with freshly allocated factors of rank 'nfactors'. */
+static void p_csf_mttkrp_rank(
+    double const * const opts,
+    sptensor_t ** tensors,
+    idx_t ntensors,
+    idx_t const nfactors)
+{
+  matrix_t * mats[MAX_DSETS][MAX_NMODES+1];
+  matrix_t * gold[MAX_DSETS];
+  for(idx_t i=0; i < ntensors; ++i) {
+    sptensor_t const * const tt = tensors[i];
+    idx_t maxdim = 0;
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      mats[i][m] = mat_rand(tt->dims[m], nfactors);
+      maxdim = SS_MAX(tt->dims[m], maxdim);
+    }
+    mats[i][MAX_NMODES] = mat_alloc(maxdim, nfactors);
+    gold[i] = mat_alloc(maxdim, nfactors);
+  }
+
+  p_csf_mttkrp(opts, tensors, ntensors, mats, gold, nfactors);
+
+  for(idx_t i=0; i < ntensors; ++i) {
+    for(idx_t m=0; m < tensors[i]->nmodes; ++m) {
+      mat_free(mats[i][m]);
+    }
+    mat_free(mats[i][MAX_NMODES]);
+    mat_free(gold[i]);
+  }
+}
+
+
+CTEST2(mttkrp, csf_rank_specialized)
+{
+  idx_t const ranks[] = {8, 16, 32, 64};
+
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS]   = 7;
+  opts[SPLATT_OPTION_CSF_ALLOC]  = SPLATT_CSF_TWOMODE;
+  opts[SPLATT_OPTION_TILE]       = SPLATT_NOTILE;
+  opts[SPLATT_OPTION_TILELEVEL]  = 0;
+  opts[SPLATT_OPTION_SIMD]       = SPLATT_SIMD_SCALAR;
+
+  for(idx_t r=0; r < sizeof(ranks) / sizeof(ranks[0]); ++r) {
+    idx_t const nfactors = ranks[r];
+    ASSERT_NOT_EQUAL(0, strcmp("generic",
+        mttkrp_csf_kernel_name(nfactors, SPLATT_SIMD_SCALAR)));
+    p_csf_mttkrp_rank(opts, data->tensors, data->ntensors, nfactors);
+  }
+
+  ASSERT_STR("generic",
+      mttkrp_csf_kernel_name(data->nfactors, SPLATT_SIMD_SCALAR));
+  splatt_free_opts(opts);
+}
+
+
+CTEST2(mttkrp, csf_simd)
+{
+  splatt_simd_type const isas[] = {
+    SPLATT_SIMD_SCALAR, SPLATT_SIMD_AVX2, SPLATT_SIMD_AVX512
+  };
+  /* exercise register blocks, single vectors, and leftover columns */
+  idx_t const ranks[] = {13, 40};
+
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS]   = 7;
+  opts[SPLATT_OPTION_CSF_ALLOC]  = SPLATT_CSF_TWOMODE;
+
+  for(idx_t i=0; i < sizeof(isas) / sizeof(isas[0]); ++i) {
+    if(!simd_supported(isas[i])) {
+      continue;
+    }
+    opts[SPLATT_OPTION_SIMD] = isas[i];
+    ASSERT_EQUAL(isas[i], simd_resolve(isas[i]));
+    if(isas[i] != SPLATT_SIMD_SCALAR) {
+      ASSERT_STR(simd_name(isas[i]),
+          mttkrp_csf_kernel_name(data->nfactors, isas[i]));
+    }
+
+    for(idx_t r=0; r < sizeof(ranks) / sizeof(ranks[0]); ++r) {
+      /* untiled (locked) and tiled (lock-free) kernels */
+      opts[SPLATT_OPTION_TILE]      = SPLATT_NOTILE;
+      opts[SPLATT_OPTION_TILELEVEL] = 0;
+      p_csf_mttkrp_rank(opts, data->tensors, data->ntensors, ranks[r]);
+
+      opts[SPLATT_OPTION_TILE]      = SPLATT_DENSETILE;
+      opts[SPLATT_OPTION_TILELEVEL] = 1;
+      p_csf_mttkrp_rank(opts, data->tensors, data->ntensors, ranks[r]);
+    }
+  }
+
+  ASSERT_EQUAL(simd_detect(), simd_resolve(SPLATT_SIMD_AUTO));
+  splatt_free_opts(opts);
+}
+
+
+CTEST2(mttkrp, csf_col_block)
+{
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS] = 7;
+
+  /* automatic: no blocking at small ranks, vector-sized blocks at huge ones */
+  splatt_csf * cs = splatt_csf_alloc(data->tensors[0], opts);
+  splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(cs, data->nfactors, opts);
+  ASSERT_TRUE(ws->col_block >= data->nfactors);
+  splatt_mttkrp_free_ws(ws);
+  ws = splatt_mttkrp_alloc_ws(cs, 4096, opts);
+  ASSERT_TRUE(ws->col_block < 4096);
+  ASSERT_EQUAL(0, ws->col_block % 16);
+  ASSERT_NOT_NULL(ws->block_vals[0]);
+  splatt_mttkrp_free_ws(ws);
+  csf_free(cs, opts);
+
+  /* 37 columns in blocks of 16, 16, and 5 */
+  opts[SPLATT_OPTION_COLBLOCK] = 16;
+  opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
+  p_csf_mttkrp_rank(opts, data->tensors, data->ntensors, 37);
+
+  opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+  opts[SPLATT_OPTION_TILE] = SPLATT_DENSETILE;
+  p_csf_mttkrp_rank(opts, data->tensors, data->ntensors, 37);
+
+  opts[SPLATT_OPTION_TILE] = SPLATT_NOTILE;
+  opts[SPLATT_OPTION_PRIVTHRESH] = 1e9;
+  p_csf_mttkrp_rank(opts, data->tensors, data->ntensors, 37);
+
+  splatt_free_opts(opts);
+}
+
+
+/* A serial, obviously-correct MTTKRP to check mttkrp_stream() against. */
+static void p_naive_mttkrp(
+    sptensor_t const * const tt,
+    matrix_t ** mats,
+    idx_t const mode,
+    matrix_t * const out)
+{
+  idx_t const nfactors = out->J;
+  out->I = tt->dims[mode];
+  memset(out->vals, 0, out->I * nfactors * sizeof(*out->vals));
+  for(idx_t n=0; n < tt->nnz; ++n) {
+    val_t * const orow = out->vals + (tt->ind[mode][n] * nfactors);
+    for(idx_t f=0; f < nfactors; ++f) {
+      val_t v = tt->vals[n];
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        if(m != mode) {
+          v *= mats[m]->vals[f + (tt->ind[m][n] * nfactors)];
+        }
+      }
+      orow[f] += v;
+    }
+  }
+}
+
+
+CTEST2(mttkrp, stream_segmented)
+{
+  int const oldthreads = splatt_omp_get_max_threads();
+  splatt_omp_set_num_threads(7);
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    matrix_t ** mats = data->mats[i];
+
+    /* a shuffled copy, so that runs of equal rows are short */
+    sptensor_t * shuf = tt_alloc(tt->nnz, tt->nmodes);
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      shuf->dims[m] = tt->dims[m];
+    }
+    srand(i);
+    idx_t * perm = splatt_malloc(tt->nnz * sizeof(*perm));
+    for(idx_t n=0; n < tt->nnz; ++n) {
+      perm[n] = n;
+    }
+    for(idx_t n=tt->nnz; n > 1; --n) {
+      idx_t const j = rand_idx() % n;
+      idx_t const tmp = perm[n-1];
+      perm[n-1] = perm[j];
+      perm[j] = tmp;
+    }
+    for(idx_t n=0; n < tt->nnz; ++n) {
+      shuf->vals[n] = tt->vals[perm[n]];
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        shuf->ind[m][n] = tt->ind[m][perm[n]];
+      }
+    }
+    splatt_free(perm);
+
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      p_naive_mttkrp(tt, mats, m, data->gold[i]);
+      mats[MAX_NMODES]->I = tt->dims[m];
+
+      mttkrp_stream(tt, mats, m);
+      __compare_mats(mats[MAX_NMODES], data->gold[i]);
+
+      mttkrp_stream(shuf, mats, m);
+      __compare_mats(mats[MAX_NMODES], data->gold[i]);
+
+      /* bucketed: one run per row */
+      idx_t * order = mttkrp_stream_order(shuf, m);
+      for(idx_t n=1; n < shuf->nnz; ++n) {
+        ASSERT_TRUE(shuf->ind[m][order[n-1]] <= shuf->ind[m][order[n]]);
+      }
+      mttkrp_stream_ordered(shuf, mats, m, order);
+      __compare_mats(mats[MAX_NMODES], data->gold[i]);
+      splatt_free(order);
+    }
+    tt_free(shuf);
+  }
+
+  splatt_omp_set_num_threads(oldthreads);
+}
+
+
+CTEST2(mttkrp, hicoo)
+{
+  idx_t const bits[] = {1, 3, HICOO_MAX_BITS};
+  idx_t const threads[] = {1, 7};
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    matrix_t ** mats = data->mats[i];
+
+    for(idx_t b=0; b < sizeof(bits) / sizeof(bits[0]); ++b) {
+      hicoo_t * hc = hicoo_alloc(tt, bits[b]);
+      ASSERT_EQUAL(tt->nnz, hc->nnz);
+      ASSERT_EQUAL(tt->nnz, hc->bptr[hc->nblocks]);
+
+      /* every nonzero is recoverable and each block is counted once */
+      val_t tt_sum = 0;
+      val_t hc_sum = 0;
+      for(idx_t n=0; n < tt->nnz; ++n) {
+        tt_sum += tt->vals[n];
+      }
+      for(idx_t blk=0; blk < hc->nblocks; ++blk) {
+        ASSERT_TRUE(hc->bptr[blk] < hc->bptr[blk+1]);
+        for(idx_t n=hc->bptr[blk]; n < hc->bptr[blk+1]; ++n) {
+          for(idx_t m=0; m < tt->nmodes; ++m) {
+            idx_t const ind = (hc->binds[m][blk] << hc->bits) + hc->einds[m][n];
+            ASSERT_TRUE(ind < tt->dims[m]);
+          }
+          hc_sum += hc->vals[n];
+        }
+      }
+      ASSERT_DBL_NEAR_TOL(tt_sum, hc_sum, 1e-6 * (1. + SS_MAX(tt_sum, -tt_sum)));
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        ASSERT_EQUAL(hc->nblocks, hc->sched_ptr[m][hc->nbrows[m]]);
+      }
+
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        p_naive_mttkrp(tt, mats, m, data->gold[i]);
+        for(idx_t t=0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+          mttkrp_hicoo(hc, mats, m, threads[t]);
+          __compare_mats(mats[MAX_NMODES], data->gold[i]);
+        }
+      }
+
+      hicoo_free(hc);
+    }
+  }
+}
+
+
+CTEST2(mttkrp, linear)
+{
+  idx_t const threads[] = {1, 7};
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    matrix_t ** mats = data->mats[i];
+
+    lintensor_t * lt = lintensor_alloc(tt);
+    ASSERT_NOT_NULL(lt);
+    ASSERT_EQUAL(tt->nnz, lt->nnz);
+
+    /* keys are sorted and decode to valid coordinates */
+    for(idx_t n=0; n < lt->nnz; ++n) {
+      if(n > 0) {
+        uint64_t const * const prev = lt->keys + ((n-1) * lt->nwords);
+        uint64_t const * const curr = lt->keys + (n * lt->nwords);
+        if(lt->nwords == 2 && prev[1] != curr[1]) {
+          ASSERT_TRUE(prev[1] < curr[1]);
+        } else {
+          ASSERT_TRUE(prev[0] <= curr[0]);
+        }
+      }
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        ASSERT_TRUE(lintensor_ind(lt, n, m) < tt->dims[m]);
+      }
+    }
+
+    lintensor_ws_t * ws[2];
+    for(idx_t t=0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+      ws[t] = lintensor_ws_alloc(lt, data->nfactors, threads[t]);
+    }
+
+    /* twice, so the second pass relies on the buffers being cleared */
+    for(idx_t pass=0; pass < 2; ++pass) {
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        p_naive_mttkrp(tt, mats, m, data->gold[i]);
+        for(idx_t t=0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+          mttkrp_lintensor(lt, mats, m, ws[t]);
+          __compare_mats(mats[MAX_NMODES], data->gold[i]);
+        }
+      }
+    }
+
+    for(idx_t t=0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+      lintensor_ws_free(ws[t]);
+    }
+    lintensor_free(lt);
+  }
+}
+
+
+CTEST2(mttkrp, ctx)
+{
+  /* {csf alloc, tiling} */
+  splatt_csf_type const allocs[] = {SPLATT_CSF_ALLMODE, SPLATT_CSF_ONEMODE};
+  splatt_tile_type const tiles[] = {SPLATT_NOTILE, SPLATT_DENSETILE};
+
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS] = 7;
+
+  for(idx_t c=0; c < 2; ++c) {
+    opts[SPLATT_OPTION_CSF_ALLOC] = allocs[c];
+    opts[SPLATT_OPTION_TILE] = tiles[c];
+
+    for(idx_t i=0; i < data->ntensors; ++i) {
+      sptensor_t * const tt = data->tensors[i];
+      matrix_t ** mats = data->mats[i];
+      val_t * matvals[MAX_NMODES];
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        matvals[m] = mats[m]->vals;
+      }
+
+      splatt_csf * cs = splatt_csf_alloc(tt, opts);
+      splatt_mttkrp_ctx * ctx = splatt_mttkrp_ctx_alloc(cs, data->nfactors,
+          opts);
+      ASSERT_EQUAL(SPLATT_ERROR_BADINPUT,
+          splatt_mttkrp_ctx_exec(ctx, tt->nmodes, matvals,
+              mats[MAX_NMODES]->vals));
+
+      /* the context is reused across modes and repeated calls */
+      for(idx_t rep=0; rep < 2; ++rep) {
+        for(idx_t m=0; m < tt->nmodes; ++m) {
+          p_naive_mttkrp(tt, mats, m, data->gold[i]);
+          mats[MAX_NMODES]->I = tt->dims[m];
+          int const ret = splatt_mttkrp_ctx_exec(ctx, m, matvals,
+              mats[MAX_NMODES]->vals);
+          ASSERT_EQUAL(SPLATT_SUCCESS, ret);
+          __compare_mats(mats[MAX_NMODES], data->gold[i]);
+        }
+      }
+
+      splatt_mttkrp_ctx_free(ctx);
+      csf_free(cs, opts);
+    }
+  }
+
+  splatt_free_opts(opts);
+}
+
+
+CTEST2(mttkrp, ctx_memo)
+{
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS] = 7;
+  opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+  opts[SPLATT_OPTION_TILE] = SPLATT_NOTILE;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    idx_t const nmodes = tt->nmodes;
+    matrix_t ** mats = data->mats[i];
+    if(nmodes < 3) {
+      continue;
+    }
+    val_t * matvals[MAX_NMODES];
+    for(idx_t m=0; m < nmodes; ++m) {
+      matvals[m] = mats[m]->vals;
+    }
+
+    splatt_csf * cs = splatt_csf_alloc(tt, opts);
+    opts[SPLATT_OPTION_MEMOIZE] = 1e9;
+    splatt_mttkrp_ctx * ctx = splatt_mttkrp_ctx_alloc(cs, data->nfactors,
+        opts);
+    opts[SPLATT_OPTION_MEMOIZE] = 0;
+    splatt_mttkrp_ctx * gold_ctx = splatt_mttkrp_ctx_alloc(cs,
+        data->nfactors, opts);
+    idx_t const root = csf_depth_to_mode(cs, 0);
+    idx_t const next = csf_depth_to_mode(cs, 1);
+    idx_t const leaf = csf_depth_to_mode(cs, nmodes-1);
+
+    mats[MAX_NMODES]->I = tt->dims[root];
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_mttkrp_ctx_exec(ctx, root, matvals, mats[MAX_NMODES]->vals));
+
+    /* change a memoized factor between a root and a depth-1 exec */
+    for(idx_t x=0; x < mats[leaf]->I * mats[leaf]->J; ++x) {
+      mats[leaf]->vals[x] = (0.5 * mats[leaf]->vals[x]) + 0.25;
+    }
+
+    data->gold[i]->I = tt->dims[next];
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_mttkrp_ctx_exec(gold_ctx, next, matvals, data->gold[i]->vals));
+    mats[MAX_NMODES]->I = tt->dims[next];
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_mttkrp_ctx_exec(ctx, next, matvals, mats[MAX_NMODES]->vals));
+    __compare_mats(mats[MAX_NMODES], data->gold[i]);
+
+    splatt_mttkrp_ctx_free(gold_ctx);
+    splatt_mttkrp_ctx_free(ctx);
+    csf_free(cs, opts);
+  }
+
+  splatt_free_opts(opts);
+}
+
+
+CTEST2(mttkrp, rows)
+{
+  /* ALLMODE uses root-mode slices; ONEMODE walks the tree for most modes */
+  splatt_csf_type const allocs[] = {SPLATT_CSF_ALLMODE, SPLATT_CSF_ONEMODE};
+  splatt_tile_type const tiles[] = {SPLATT_DENSETILE, SPLATT_NOTILE};
+
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS] = 3;
+
+  for(idx_t c=0; c < 2; ++c) {
+    opts[SPLATT_OPTION_CSF_ALLOC] = allocs[c];
+    opts[SPLATT_OPTION_TILE] = tiles[c];
+
+    for(idx_t i=0; i < data->ntensors; ++i) {
+      sptensor_t * const tt = data->tensors[i];
+      matrix_t ** mats = data->mats[i];
+      idx_t const nfactors = data->nfactors;
+      val_t * matvals[MAX_NMODES];
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        matvals[m] = mats[m]->vals;
+      }
+
+      splatt_csf * cs = splatt_csf_alloc(tt, opts);
+
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        p_naive_mttkrp(tt, mats, m, data->gold[i]);
+
+        /* unsorted, with a duplicate and the last row */
+        idx_t const dim = tt->dims[m];
+        idx_t const rows[] = {dim-1, dim/2, 0, dim/2, dim/3};
+        idx_t const nrows = sizeof(rows) / sizeof(rows[0]);
+        val_t * out = splatt_malloc(nrows * nfactors * sizeof(*out));
+
+        int const ret = splatt_mttkrp_rows(m, nfactors, cs, matvals, nrows,
+            rows, out, opts);
+        ASSERT_EQUAL(SPLATT_SUCCESS, ret);
+        for(idx_t r=0; r < nrows; ++r) {
+          val_t const * const gold = data->gold[i]->vals + (rows[r]*nfactors);
+          for(idx_t f=0; f < nfactors; ++f) {
+#if SPLATT_VAL_TYPEWIDTH == 32
+            ASSERT_DBL_NEAR_TOL(gold[f], out[f + (r*nfactors)], 9e-3);
+#else
+            ASSERT_DBL_NEAR_TOL(gold[f], out[f + (r*nfactors)], 1e-10);
+#endif
+          }
+        }
+
+        idx_t const bad = dim;
+        ASSERT_EQUAL(SPLATT_ERROR_BADINPUT,
+            splatt_mttkrp_rows(m, nfactors, cs, matvals, 1, &bad, out, opts));
+        splatt_free(out);
+      }
+
+      csf_free(cs, opts);
+    }
+  }
+
+  splatt_free_opts(opts);
+}
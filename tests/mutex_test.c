@@ -90,3 +90,70 @@ CTEST2(mutex, omp_lock)
 }
 #endif
 
+
+
+CTEST2(mutex, spin_size)
+{
+  /* one lock per ID when there are few IDs */
+  ASSERT_EQUAL(16, mutex_spin_size(4, 10));
+  ASSERT_EQUAL(1, mutex_spin_size(4, 1));
+  /* otherwise a power of two per thread */
+  ASSERT_EQUAL(SPLATT_SPIN_LOCKS_PER_THREAD, mutex_spin_size(1, 1 << 30));
+  ASSERT_EQUAL(4 * SPLATT_SPIN_LOCKS_PER_THREAD, mutex_spin_size(3, 1 << 30));
+
+  mutex_pool * pool = mutex_alloc_spin(2, 1 << 30);
+  ASSERT_EQUAL(MUTEX_POOL_SPIN, pool->type);
+  ASSERT_EQUAL(SPLATT_CACHE_LINE, sizeof(*pool->spins));
+  ASSERT_EQUAL(0, ((size_t) pool->spins) % SPLATT_CACHE_LINE);
+  for(int id=0; id < 100000; id += 7) {
+    int const lock = mutex_spin_id(pool, id);
+    ASSERT_TRUE(lock >= 0 && lock < pool->num_locks);
+  }
+  mutex_free(pool);
+
+  /* identity mapping */
+  pool = mutex_alloc_spin(2, 100);
+  for(int id=0; id < 100; ++id) {
+    ASSERT_EQUAL(id, mutex_spin_id(pool, id));
+  }
+  mutex_free(pool);
+}
+
+
+#ifdef _OPENMP
+CTEST2(mutex, spin_lock)
+{
+  int const num_threads = 4;
+
+  /* few locks, so that IDs collide */
+  mutex_pool * pool = mutex_alloc_spin(1, 1 << 20);
+  pool->track_stats = true;
+
+  #pragma omp parallel num_threads(num_threads) shared(pool)
+  {
+    for(int i=0; i < data->num_ints; ++i) {
+      for(int x=0; x < data->num_incs; ++x) {
+        mutex_set_lock(pool, i);
+        ++(data->counts[i]);
+        mutex_unset_lock(pool, i);
+      }
+    }
+  } /* end omp parallel */
+
+  for(int i=0; i < data->num_ints; ++i) {
+    ASSERT_EQUAL(num_threads * data->num_incs, data->counts[i]);
+  }
+
+  uint64_t acquires = 0;
+  for(int l=0; l < pool->num_locks; ++l) {
+    acquires += pool->spins[l].acquires;
+    ASSERT_TRUE(pool->spins[l].contended <= pool->spins[l].acquires);
+  }
+  ASSERT_EQUAL(num_threads * data->num_incs * data->num_ints, acquires);
+
+  mutex_reset_stats(pool);
+  ASSERT_EQUAL(0, pool->spins[mutex_spin_id(pool, 0)].acquires);
+
+  mutex_free(pool);
+}
+#endif
@@ -0,0 +1,122 @@
+#include "../src/sketch.h"
+#include "../src/csf.h"
+#include "../src/io.h"
+#include "../src/sptensor.h"
+#include "../src/util.h"
+
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+#include <math.h>
+
+
+CTEST_DATASETS(sketch)
+
+
+CTEST_SETUP(sketch)
+{
+  data->ntensors = test_read_datasets(data->tensors);
+  data->opts = test_default_opts(1);
+}
+
+
+CTEST2(sketch, find_fiber)
+{
+  splatt_tile_type const tiles[] = {SPLATT_NOTILE, SPLATT_DENSETILE};
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    idx_t const nmodes = tt->nmodes;
+
+    for(idx_t t=0; t < 2; ++t) {
+      data->opts[SPLATT_OPTION_TILE] = tiles[t];
+      splatt_csf * csf = csf_alloc(tt, data->opts);
+      sketch_ws * ws = sketch_alloc(csf, 1, data->opts);
+
+      /* every nonzero must be found at the leaves of every mode */
+      for(idx_t m=0; m < nmodes; ++m) {
+        splatt_csf const * const leaf = ws->leaves + m;
+        ASSERT_EQUAL(m, leaf->dim_perm[nmodes-1]);
+        ASSERT_EQUAL(tt->nnz, leaf->nnz);
+
+        idx_t const * const fp = leaf->pt->fptr[nmodes-2];
+        idx_t const * const fids = leaf->pt->fids[nmodes-1];
+        for(idx_t n=0; n < tt->nnz; ++n) {
+          idx_t ids[MAX_NMODES];
+          for(idx_t d=0; d < nmodes-1; ++d) {
+            ids[d] = tt->ind[leaf->dim_perm[d]][n];
+          }
+          idx_t const fib = sketch_find_fiber(leaf, ids);
+          ASSERT_NOT_EQUAL(SPLATT_IDX_MAX, fib);
+
+          bool found = false;
+          for(idx_t x=fp[fib]; x < fp[fib+1]; ++x) {
+            if(fids[x] == tt->ind[m][n]) {
+              ASSERT_DBL_NEAR_TOL(tt->vals[n], leaf->pt->vals[x], 0.);
+              found = true;
+            }
+          }
+          ASSERT_TRUE(found);
+        }
+
+        /* one past the last slice is never a fiber */
+        idx_t ids[MAX_NMODES] = {0};
+        ids[0] = leaf->dims[leaf->dim_perm[0]];
+        ASSERT_EQUAL(SPLATT_IDX_MAX, sketch_find_fiber(leaf, ids));
+      }
+
+      sketch_free(ws);
+      csf_free(csf, data->opts);
+    }
+  }
+  data->opts[SPLATT_OPTION_TILE] = SPLATT_NOTILE;
+}
+
+
+CTEST2(sketch, lowrank)
+{
+  /* dense, so every Khatri-Rao row has a fiber */
+  idx_t const rank = 3;
+  idx_t const dims[3] = {20, 15, 10};
+  unsigned int seed = 5;
+  sptensor_t * tt = test_dense_lowrank(3, dims, rank, &seed, false, false,
+      NULL);
+  splatt_csf * csf = csf_alloc(tt, data->opts);
+
+  data->opts[SPLATT_OPTION_NITER] = 30;
+  data->opts[SPLATT_OPTION_TOLERANCE] = 0.;
+  data->opts[SPLATT_OPTION_SKETCH] = 500;
+
+  splatt_sample_type const samplings[] = {
+      SPLATT_SAMPLE_UNIFORM, SPLATT_SAMPLE_LEVERAGE};
+  for(idx_t s=0; s < 2; ++s) {
+    data->opts[SPLATT_OPTION_SAMPLING] = samplings[s];
+
+    splatt_kruskal factored;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_cpd_sketched(csf, rank, data->opts, &factored));
+    ASSERT_TRUE(factored.fit > 0.95);
+
+    /* the reported fit is exact; the tensor is dense, so check it directly */
+    val_t * model = splatt_malloc(tt->nnz * sizeof(*model));
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_kruskal_values(csf, &factored, data->opts, model));
+    double err = 0.;
+    double norm = 0.;
+    for(idx_t t=0; t < csf->ntiles; ++t) {
+      val_t const * const vals = csf->pt[t].vals;
+      for(idx_t n=0; n < csf->pt[t].nfibs[2]; ++n) {
+        double const diff = vals[n] - model[n];
+        err += diff * diff;
+        norm += vals[n] * vals[n];
+      }
+    }
+    ASSERT_DBL_NEAR_TOL(1. - sqrt(err / norm), factored.fit, 1e-6);
+
+    splatt_free(model);
+    splatt_free_kruskal(&factored);
+  }
+
+  csf_free(csf, data->opts);
+  tt_free(tt);
+}
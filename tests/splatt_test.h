@@ -1,6 +1,11 @@
 #ifndef SPLATT_TEST_H
 #define SPLATT_TEST_H
 
+#include "../src/sptensor.h"
+#include "../src/util.h"
+
+#include <math.h>
+
 /* DATASET(med.tns) will return "/tests/tensors/med.tns" */
 #define DATASET_(x) SPLATT_TEST_DATASETS #x
 #define DATASET(x) DATASET_(x)
@@ -27,4 +32,142 @@ static char const * const graphs[] = {
 };
 #define MAX_GRAPHS 16
 
+
+/*
+ * The fixture shared by the factorization tests: every dataset and a set of
+ * options. Each suite still writes its own CTEST_SETUP(), usually with
+ * test_read_datasets() and test_default_opts().
+ */
+#define CTEST_DATASETS(sname) \
+  CTEST_DATA(sname) \
+  { \
+    idx_t ntensors; \
+    sptensor_t * tensors[MAX_DSETS]; \
+    double * opts; \
+  }; \
+  \
+  CTEST_TEARDOWN(sname) \
+  { \
+    for(idx_t i=0; i < data->ntensors; ++i) { \
+      tt_free(data->tensors[i]); \
+    } \
+    splatt_free_opts(data->opts); \
+  }
+
+
+/**
+* @brief Read every dataset.
+*
+* @param[out] tensors The tensors, at least MAX_DSETS long.
+*
+* @return The number of tensors read.
+*/
+static inline idx_t test_read_datasets(
+    sptensor_t ** tensors)
+{
+  idx_t const ntensors = sizeof(datasets) / sizeof(datasets[0]);
+  for(idx_t i=0; i < ntensors; ++i) {
+    tensors[i] = tt_read(datasets[i]);
+  }
+  return ntensors;
+}
+
+
+/**
+* @brief Quiet, two-threaded, seeded options for factorization tests.
+*
+* @param seed The random seed.
+*
+* @return The options. Free with splatt_free_opts().
+*/
+static inline double * test_default_opts(
+    int const seed)
+{
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS] = 2;
+  opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+  opts[SPLATT_OPTION_RANDSEED] = seed;
+  return opts;
+}
+
+
+
+/**
+* @brief A dense tensor from a random Kruskal model with unit weights. Entries
+*        are stored in row-major order, so entry 'n' has linear index 'n'.
+*
+* @param nmodes The number of modes.
+* @param dims The dimensions of the tensor.
+* @param rank The rank of the model.
+* @param seed The random seed, which is advanced.
+* @param nonneg Use the absolute values of the random factors.
+* @param round_vals Round each entry to the nearest integer (e.g., counts).
+* @param[out] factors If not NULL, the model's factors (row-major, 'rank'
+*                     columns). Otherwise they are freed.
+*
+* @return The tensor.
+*/
+static inline sptensor_t * test_dense_lowrank(
+    idx_t const nmodes,
+    idx_t const * const dims,
+    idx_t const rank,
+    unsigned int * const seed,
+    bool const nonneg,
+    bool const round_vals,
+    val_t ** factors)
+{
+  val_t * mats[MAX_NMODES];
+  idx_t nnz = 1;
+  for(idx_t m=0; m < nmodes; ++m) {
+    mats[m] = splatt_malloc(dims[m] * rank * sizeof(**mats));
+    fill_rand_r(mats[m], dims[m] * rank, seed);
+    if(nonneg) {
+      for(idx_t x=0; x < dims[m] * rank; ++x) {
+        mats[m][x] = fabs(mats[m][x]);
+      }
+    }
+    nnz *= dims[m];
+  }
+
+  sptensor_t * tt = tt_alloc(nnz, nmodes);
+  for(idx_t m=0; m < nmodes; ++m) {
+    tt->dims[m] = dims[m];
+  }
+
+  val_t * accum = splatt_malloc(rank * sizeof(*accum));
+  for(idx_t n=0; n < nnz; ++n) {
+    /* the last mode varies fastest */
+    idx_t lin = n;
+    for(idx_t m=nmodes; m-- > 0; ) {
+      tt->ind[m][n] = lin % dims[m];
+      lin /= dims[m];
+    }
+
+    for(idx_t f=0; f < rank; ++f) {
+      accum[f] = 1.;
+    }
+    for(idx_t m=0; m < nmodes; ++m) {
+      val_t const * const row = mats[m] + (tt->ind[m][n] * rank);
+      for(idx_t f=0; f < rank; ++f) {
+        accum[f] *= row[f];
+      }
+    }
+    val_t v = 0;
+    for(idx_t f=0; f < rank; ++f) {
+      v += accum[f];
+    }
+    tt->vals[n] = round_vals ? round(v) : v;
+  }
+  splatt_free(accum);
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(factors != NULL) {
+      factors[m] = mats[m];
+    } else {
+      splatt_free(mats[m]);
+    }
+  }
+  return tt;
+}
+
 #endif
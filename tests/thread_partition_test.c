@@ -230,6 +230,32 @@ CTEST2(partition, probe)
 }
 
 
+CTEST2(partition, heavy_first)
+{
+  idx_t const N = 100;
+  idx_t const P = 8;
+  idx_t * weights = splatt_malloc(N * sizeof(*weights));
+
+  /* the first item is heavier than all the rest */
+  weights[0] = 1000;
+  for(idx_t x=1; x < N; ++x) {
+    weights[x] = 1;
+  }
+
+  idx_t bneck;
+  idx_t * parts = partition_weighted(weights, N, P, &bneck);
+  ASSERT_EQUAL(1000, bneck);
+  ASSERT_EQUAL(1, parts[1]);
+
+  /* a bottleneck smaller than the first item is not feasible */
+  bool success = lprobe(weights, N, parts, P, 999);
+  ASSERT_EQUAL(false, success);
+
+  splatt_free(weights);
+  splatt_free(parts);
+}
+
+
 CTEST2(partition, bigpart)
 {
   idx_t const N = 25000000;
@@ -0,0 +1,170 @@
+#include "../src/ttm.h"
+#include "../src/mttkrp.h"
+#include "../src/csf.h"
+#include "../src/thd_info.h"
+#include "../src/util.h"
+
+#include "../src/io.h"
+
+#include "ctest/ctest.h"
+
+#include "splatt_test.h"
+
+
+/**
+* @brief TTMc directly from the coordinate tensor. Columns are ordered over
+*        the other modes in increasing order, the lowest varying slowest.
+*/
+static void p_naive_ttmc(
+    sptensor_t const * const tt,
+    matrix_t ** mats,
+    idx_t const mode,
+    matrix_t * const out)
+{
+  idx_t const nmodes = tt->nmodes;
+  idx_t width = 1;
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(m != mode) {
+      width *= mats[m]->J;
+    }
+  }
+  out->I = tt->dims[mode];
+  out->J = width;
+  memset(out->vals, 0, out->I * width * sizeof(*out->vals));
+
+  for(idx_t n=0; n < tt->nnz; ++n) {
+    val_t * const orow = out->vals + (tt->ind[mode][n] * width);
+    for(idx_t c=0; c < width; ++c) {
+      /* decompose c into one column per mode, last mode fastest */
+      idx_t rem = c;
+      val_t v = tt->vals[n];
+      for(idx_t m=nmodes; m-- > 0; ) {
+        if(m == mode) {
+          continue;
+        }
+        idx_t const rank = mats[m]->J;
+        v *= mats[m]->vals[(rem % rank) + (tt->ind[m][n] * rank)];
+        rem /= rank;
+      }
+      orow[c] += v;
+    }
+  }
+}
+
+
+static void p_compare_mats(
+  matrix_t const * const A,
+  matrix_t const * const B)
+{
+  ASSERT_EQUAL(A->I, B->I);
+  ASSERT_EQUAL(A->J, B->J);
+  for(idx_t x=0; x < A->I * A->J; ++x) {
+#if SPLATT_VAL_TYPEWIDTH == 32
+    ASSERT_DBL_NEAR_TOL(A->vals[x], B->vals[x], 9e-3);
+#else
+    ASSERT_DBL_NEAR_TOL(A->vals[x], B->vals[x], 1e-10);
+#endif
+  }
+}
+
+
+CTEST_DATA(ttm)
+{
+  idx_t ntensors;
+  idx_t ranks[MAX_NMODES];
+  sptensor_t * tensors[MAX_DSETS];
+  matrix_t * mats[MAX_DSETS][MAX_NMODES+1];
+  matrix_t * gold[MAX_DSETS];
+};
+
+
+CTEST_SETUP(ttm)
+{
+  /* unequal ranks catch mixed-up column orders */
+  idx_t const ranks[] = {3, 2, 4, 2, 3};
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    data->ranks[m] = ranks[m % 5];
+  }
+
+  data->ntensors = sizeof(datasets) / sizeof(datasets[0]);
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = tt_read(datasets[i]);
+    data->tensors[i] = tt;
+
+    idx_t maxdim = 0;
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      data->mats[i][m] = mat_rand(tt->dims[m], data->ranks[m]);
+      maxdim = SS_MAX(tt->dims[m], maxdim);
+    }
+    idx_t const width = ttmc_max_width(tt->nmodes, data->ranks);
+    data->mats[i][MAX_NMODES] = mat_alloc(maxdim, width);
+    data->gold[i] = mat_alloc(maxdim, width);
+  }
+}
+
+
+CTEST_TEARDOWN(ttm)
+{
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    for(idx_t m=0; m < data->tensors[i]->nmodes; ++m) {
+      mat_free(data->mats[i][m]);
+    }
+    mat_free(data->mats[i][MAX_NMODES]);
+    mat_free(data->gold[i]);
+    tt_free(data->tensors[i]);
+  }
+}
+
+
+CTEST2(ttm, width)
+{
+  idx_t const ranks[] = {3, 2, 4};
+  ASSERT_EQUAL(8, ttmc_width(3, ranks, 0));
+  ASSERT_EQUAL(12, ttmc_width(3, ranks, 1));
+  ASSERT_EQUAL(6, ttmc_width(3, ranks, 2));
+  ASSERT_EQUAL(12, ttmc_max_width(3, ranks));
+}
+
+
+CTEST2(ttm, csf)
+{
+  /* {csf alloc, tiling, threads, privatization threshold} */
+  splatt_csf_type const allocs[] = {SPLATT_CSF_ONEMODE, SPLATT_CSF_TWOMODE,
+      SPLATT_CSF_ALLMODE, SPLATT_CSF_ALLMODE, SPLATT_CSF_ONEMODE};
+  splatt_tile_type const tiles[] = {SPLATT_NOTILE, SPLATT_NOTILE,
+      SPLATT_NOTILE, SPLATT_DENSETILE, SPLATT_NOTILE};
+  idx_t const threads[] = {1, 3, 3, 3, 3};
+  double const privs[] = {0.02, 0.02, 0.02, 0.02, 1e9};
+  idx_t const nconfigs = sizeof(allocs) / sizeof(allocs[0]);
+
+  for(idx_t c=0; c < nconfigs; ++c) {
+    double * opts = splatt_default_opts();
+    opts[SPLATT_OPTION_CSF_ALLOC] = allocs[c];
+    opts[SPLATT_OPTION_TILE] = tiles[c];
+    opts[SPLATT_OPTION_NTHREADS] = threads[c];
+    opts[SPLATT_OPTION_PRIVTHRESH] = privs[c];
+    opts[SPLATT_OPTION_COLBLOCK] = -1;
+
+    for(idx_t i=0; i < data->ntensors; ++i) {
+      sptensor_t * const tt = data->tensors[i];
+      matrix_t ** mats = data->mats[i];
+      idx_t const width = ttmc_max_width(tt->nmodes, data->ranks);
+
+      splatt_csf * cs = splatt_csf_alloc(tt, opts);
+      thd_info * thds = thd_init(threads[c], 1,
+          (tt->nmodes * width * sizeof(val_t)) + 64);
+      splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(cs, width, opts);
+
+      for(idx_t m=0; m < tt->nmodes; ++m) {
+        p_naive_ttmc(tt, mats, m, data->gold[i]);
+        ttmc_csf(cs, mats, m, thds, ws, opts);
+        p_compare_mats(mats[MAX_NMODES], data->gold[i]);
+      }
+
+      splatt_mttkrp_free_ws(ws);
+      thd_free(thds, threads[c]);
+      csf_free(cs, opts);
+    }
+    splatt_free_opts(opts);
+  }
+}
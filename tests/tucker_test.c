@@ -0,0 +1,109 @@
+#include "../src/tucker.h"
+#include "../src/csf.h"
+#include "../src/sptensor.h"
+#include "../src/util.h"
+
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+#define NMODES 3
+
+
+CTEST(tucker, exact_recovery)
+{
+  idx_t const dims[NMODES] = {9, 7, 8};
+  idx_t const ranks[NMODES] = {3, 2, 2};
+
+  /* a dense tensor with exactly this multilinear rank */
+  unsigned int seed = 7;
+  matrix_t * U[NMODES];
+  for(idx_t m=0; m < NMODES; ++m) {
+    U[m] = mat_alloc(dims[m], ranks[m]);
+    fill_rand_r(U[m]->vals, dims[m] * ranks[m], &seed);
+  }
+  val_t core[3 * 2 * 2];
+  fill_rand_r(core, 3 * 2 * 2, &seed);
+
+  sptensor_t * tt = tt_alloc(dims[0] * dims[1] * dims[2], NMODES);
+  for(idx_t m=0; m < NMODES; ++m) {
+    tt->dims[m] = dims[m];
+  }
+  idx_t n = 0;
+  for(idx_t i=0; i < dims[0]; ++i) {
+    for(idx_t j=0; j < dims[1]; ++j) {
+      for(idx_t k=0; k < dims[2]; ++k) {
+        val_t v = 0;
+        for(idx_t a=0; a < ranks[0]; ++a) {
+          for(idx_t b=0; b < ranks[1]; ++b) {
+            for(idx_t c=0; c < ranks[2]; ++c) {
+              v += core[c + (ranks[2] * (b + (ranks[1] * a)))] *
+                  U[0]->vals[a + (i * ranks[0])] *
+                  U[1]->vals[b + (j * ranks[1])] *
+                  U[2]->vals[c + (k * ranks[2])];
+            }
+          }
+        }
+        tt->ind[0][n] = i;
+        tt->ind[1][n] = j;
+        tt->ind[2][n] = k;
+        tt->vals[n] = v;
+        ++n;
+      }
+    }
+  }
+
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS] = 2;
+  opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+  opts[SPLATT_OPTION_RANDSEED] = 3;
+  opts[SPLATT_OPTION_TOLERANCE] = 1e-10;
+  splatt_csf * csf = csf_alloc(tt, opts);
+
+  /* ranks which cannot be realized */
+  splatt_tucker factored;
+  idx_t const toobig[NMODES] = {5, 2, 2};
+  ASSERT_EQUAL(SPLATT_ERROR_BADINPUT,
+      splatt_tucker_hooi(csf, toobig, opts, &factored));
+
+  ASSERT_EQUAL(SPLATT_SUCCESS, splatt_tucker_hooi(csf, ranks, opts,
+      &factored));
+  ASSERT_DBL_NEAR_TOL(1., factored.fit, 1e-6);
+
+  /* factors are orthonormal */
+  for(idx_t m=0; m < NMODES; ++m) {
+    val_t const * const f = factored.factors[m];
+    for(idx_t a=0; a < ranks[m]; ++a) {
+      for(idx_t b=0; b < ranks[m]; ++b) {
+        val_t dot = 0;
+        for(idx_t i=0; i < dims[m]; ++i) {
+          dot += f[a + (i * ranks[m])] * f[b + (i * ranks[m])];
+        }
+        ASSERT_DBL_NEAR_TOL((a == b) ? 1. : 0., dot, 1e-8);
+      }
+    }
+  }
+
+  /* the core and factors reproduce the tensor */
+  for(idx_t x=0; x < tt->nnz; x += 17) {
+    val_t v = 0;
+    for(idx_t a=0; a < ranks[0]; ++a) {
+      for(idx_t b=0; b < ranks[1]; ++b) {
+        for(idx_t c=0; c < ranks[2]; ++c) {
+          v += factored.core[c + (ranks[2] * (b + (ranks[1] * a)))] *
+              factored.factors[0][a + (tt->ind[0][x] * ranks[0])] *
+              factored.factors[1][b + (tt->ind[1][x] * ranks[1])] *
+              factored.factors[2][c + (tt->ind[2][x] * ranks[2])];
+        }
+      }
+    }
+    ASSERT_DBL_NEAR_TOL(tt->vals[x], v, 1e-6);
+  }
+
+  splatt_free_tucker(&factored);
+  csf_free(csf, opts);
+  splatt_free_opts(opts);
+  tt_free(tt);
+  for(idx_t m=0; m < NMODES; ++m) {
+    mat_free(U[m]);
+  }
+}